@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+#ifndef TINS_BATCH_DECODER_H
+#define TINS_BATCH_DECODER_H
+
+#include <tins/config.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include <tins/macros.h>
+#include <tins/packet.h>
+#include <tins/timestamp.h>
+#include <tins/detail/pdu_helpers.h>
+
+namespace Tins {
+
+/**
+ * \class BatchDecoder
+ * \brief Decodes batches of raw frames into Packets using several threads.
+ *
+ * Frames are decoded using the same rules BaseSniffer uses for the
+ * given link layer type. Decoding frames is independent of each
+ * other, so each batch is split across a pool of worker threads and
+ * the calling thread. The results are always stored in the same order
+ * as the input frames.
+ *
+ * Worker threads are created once and reused for every batch. Packets
+ * decoded by a worker are usually destroyed on another thread, but the
+ * PDU pool hands their memory back to the worker, so its pool is warm
+ * after the first batch. The decoding options set through DecodingScope on the thread
+ * calling BatchDecoder::decode are used by every worker.
+ *
+ * \code
+ * BatchDecoder decoder(DLT_EN10MB);
+ * std::vector<BatchDecoder::frame> frames;
+ * // fill frames...
+ * std::vector<Packet> packets;
+ * decoder.decode(frames, packets);
+ * \endcode
+ *
+ * The frames' buffers must be kept alive while decode is executing (or
+ * longer, when using DecodingScope::LAZY_INNER_PDUS). A BatchDecoder
+ * must not be used from more than one thread at a time.
+ *
+ * If the library is built without C++11 support, frames are decoded
+ * on the calling thread.
+ */
+class TINS_API BatchDecoder {
+public:
+    /**
+     * \brief A captured frame to be decoded.
+     */
+    struct frame {
+        const uint8_t* buffer;
+        uint32_t size;
+        Timestamp timestamp;
+
+        frame()
+        : buffer(0), size(0) {
+
+        }
+
+        frame(const uint8_t* buffer, uint32_t size, const Timestamp& timestamp)
+        : buffer(buffer), size(size), timestamp(timestamp) {
+
+        }
+    };
+
+    /**
+     * \brief Constructs a BatchDecoder.
+     *
+     * If the link layer type is not supported, an unknown_link_type
+     * exception is thrown.
+     *
+     * \param link_type The link layer type the frames were captured on,
+     * as one of libpcap's DLT_* constants.
+     * \param thread_count The amount of threads used to decode each batch,
+     * including the calling one. If this is 0, one thread per hardware
+     * thread is used.
+     */
+    explicit BatchDecoder(int link_type, uint32_t thread_count = 0);
+
+    /**
+     * \brief Destructor.
+     *
+     * Stops and joins the worker threads.
+     */
+    ~BatchDecoder();
+
+    /**
+     * \brief Decodes a batch of frames.
+     *
+     * Frames that are malformed produce a Packet which doesn't contain
+     * a PDU, so output[i] always corresponds to frames[i].
+     *
+     * \param frames The frames to be decoded.
+     * \param count The amount of frames.
+     * \param output The array in which the decoded packets will be
+     * stored. This must contain at least count elements.
+     */
+    void decode(const frame* frames, size_t count, Packet* output);
+
+    /**
+     * \brief Decodes a batch of frames.
+     *
+     * The output vector is resized to contain exactly one Packet per frame.
+     *
+     * \sa BatchDecoder::decode(const frame*, size_t, Packet*)
+     *
+     * \param frames The frames to be decoded.
+     * \param output The vector in which the decoded packets will be stored.
+     */
+    void decode(const std::vector<frame>& frames, std::vector<Packet>& output);
+
+    /**
+     * \brief Getter for the amount of threads used to decode each batch.
+     */
+    uint32_t thread_count() const;
+private:
+    class worker_pool;
+
+    BatchDecoder(const BatchDecoder&);
+    BatchDecoder& operator=(const BatchDecoder&);
+
+    Internals::frame_decoder decoder_;
+    worker_pool* pool_;
+};
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
+
+#endif // TINS_BATCH_DECODER_H
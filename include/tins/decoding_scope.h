@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+
+#ifndef TINS_DECODING_SCOPE_H
+#define TINS_DECODING_SCOPE_H
+
+#include <stdint.h>
+#include <tins/macros.h>
+
+namespace Tins {
+
+/**
+ * \class DecodingScope
+ * \brief Sets the options used when decoding PDUs from raw buffers.
+ *
+ * Decoding options are kept per thread. Creating a DecodingScope object
+ * replaces the calling thread's options until the object is destroyed,
+ * at which point the previous ones are restored.
+ *
+ * \code
+ * {
+ *     DecodingScope scope(DecodingScope::LAZY_INNER_PDUS);
+ *     EthernetII eth(buffer, size);
+ *     // Only the Ethernet header has been parsed at this point. The
+ *     // IP layer will be decoded when it's first accessed.
+ *     const IP* ip = eth.find_pdu<IP>();
+ * }
+ * \endcode
+ */
+class TINS_API DecodingScope {
+public:
+    /**
+     * \brief The flags that can be set on a decoding scope.
+     */
+    enum Flags {
+        /**
+         * Inner PDUs are not decoded when the outer PDU is constructed. 
+         * Instead, the outer PDU keeps a pointer to the inner PDU's bytes
+         * and decodes them the first time PDU::inner_pdu is called (this
+         * includes PDU::find_pdu and PDUIterator).
+         *
+         * The buffer the PDUs were constructed from must be kept alive
+         * and unmodified until every layer has been decoded or the 
+         * PDUs are destroyed. Copying or cloning a PDU decodes every 
+         * layer below it, so copies never refer to the original buffer.
+         *
+         * If an inner PDU is found to be malformed while being decoded,
+         * a RawPDU containing its bytes is used in its place.
+         */
+        LAZY_INNER_PDUS = 1,
+
+        /**
+         * RawPDUs constructed from a buffer keep a pointer to it rather
+         * than copying its contents. The payload is copied the first time 
+         * RawPDU::payload is called or when RawPDU::materialize is used.
+         *
+         * As with LAZY_INNER_PDUS, the buffer must outlive the PDUs 
+         * constructed from it, and copies of a RawPDU always own their
+         * payload.
+         */
+        BORROWED_PAYLOADS = 2,
+
+        /**
+         * Inner PDUs which are malformed or truncated, e.g. because of the
+         * capture's snapshot length, are stored as a RawPDU containing
+         * their bytes instead of making the outer PDU's constructor throw
+         * a malformed_packet exception.
+         *
+         * Layers that are too short to contain their protocol's fixed 
+         * header are detected up front, so no exception is thrown at all
+         * for them. The amount of layers replaced this way can be
+         * retrieved using DecodingScope::malformed_layers.
+         *
+         * Only the outermost PDU can still throw, as there's no PDU to 
+         * store its bytes in.
+         */
+        MALFORMED_INNER_PDUS_AS_RAW = 4,
+
+        /**
+         * The options of IP, TCP, DHCP and Dot11 PDUs are validated when 
+         * the PDU is constructed, but they are only parsed the first time
+         * they're accessed, e.g. by calling TCP::mss or IP::options. This
+         * makes decoding cheaper when options are never looked at.
+         *
+         * As with LAZY_INNER_PDUS, the buffer must outlive the PDUs 
+         * constructed from it until their options are parsed. Copies of a
+         * PDU keep their own copy of the option bytes.
+         */
+        LAZY_OPTIONS = 8
+    };
+
+    /**
+     * \brief Constructs a decoding scope using the given flags.
+     *
+     * \param flags The bitwise OR of the flags to be used.
+     */
+    explicit DecodingScope(uint32_t flags);
+
+    /**
+     * \brief Restores the flags that were in use before this scope was
+     * created.
+     */
+    ~DecodingScope();
+
+    /**
+     * \brief Returns the flags in use on the calling thread.
+     */
+    static uint32_t current_flags();
+
+    /**
+     * \brief Returns the amount of malformed inner PDUs that were 
+     * replaced by RawPDUs on this thread since this scope was created.
+     *
+     * This includes the layers replaced while nested scopes, such as 
+     * the one BaseSniffer uses to apply its decoding flags, were active.
+     *
+     * \sa DecodingScope::MALFORMED_INNER_PDUS_AS_RAW
+     */
+    uint32_t malformed_layers() const;
+private:
+    friend class PDU;
+
+    DecodingScope(const DecodingScope&);
+    DecodingScope& operator=(const DecodingScope&);
+
+    static void record_malformed_layer();
+
+    uint32_t previous_flags_;
+    uint32_t initial_malformed_layers_;
+};
+
+} // Tins
+
+#endif // TINS_DECODING_SCOPE_H
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_CHECKSUM_KERNELS_H
+#define TINS_CHECKSUM_KERNELS_H
+
+#include <stdint.h>
+#include <tins/macros.h>
+
+/**
+ * \cond
+ */
+namespace Tins {
+namespace Internals {
+
+// Implementations of the 16 bit one's complement sum used by Utils::sum_range
+enum checksum_kernel {
+    CHECKSUM_KERNEL_SCALAR,
+    CHECKSUM_KERNEL_SSE2,
+    CHECKSUM_KERNEL_AVX2,
+    CHECKSUM_KERNEL_NEON
+};
+
+// Indicates whether the kernel was compiled in and is supported by this CPU
+TINS_API bool checksum_kernel_supported(checksum_kernel kernel);
+
+// The fastest kernel supported by this CPU. This is detected only once
+TINS_API checksum_kernel best_checksum_kernel();
+
+// Computes the folded 16 bit sum between start and end using the given
+// kernel, which must be supported. The result is in network endian
+TINS_API uint16_t checksum_sum_range(checksum_kernel kernel, const uint8_t* start,
+                                     const uint8_t* end);
+
+// Implementations of the CRC32 used by Utils::crc32
+enum crc32_kernel {
+    CRC32_KERNEL_SLICE_BY_8,
+    CRC32_KERNEL_PCLMUL
+};
+
+TINS_API bool crc32_kernel_supported(crc32_kernel kernel);
+TINS_API crc32_kernel best_crc32_kernel();
+
+// Extends crc, the CRC32 of the previous data (0 if there's none), with
+// the given buffer using the given kernel, which must be supported
+TINS_API uint32_t crc32_update(crc32_kernel kernel, uint32_t crc, const uint8_t* data,
+                               uint32_t data_size);
+
+} // namespace Internals
+} // namespace Tins
+/**
+ * \endcond
+ */
+
+#endif // TINS_CHECKSUM_KERNELS_H
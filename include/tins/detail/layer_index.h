@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+
+#ifndef TINS_LAYER_INDEX_H
+#define TINS_LAYER_INDEX_H
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <tins/config.h>
+#include <tins/detail/pdu_pool.h>
+
+/**
+ * \cond
+ */
+
+namespace Tins {
+
+class PDU;
+
+namespace Internals {
+
+/**
+ * Maps PDU types to the first layer of that type in a PDU chain.
+ *
+ * Indexes are built and invalidated by PDU. Chains that are too deep or
+ * contain PDU types outside of the indexed range are flagged as not 
+ * indexable, in which case lookups fall back to walking the chain.
+ */
+class LayerIndex {
+public:
+    /**
+     * The maximum amount of layers that can be indexed.
+     */
+    static const size_t max_layers = 16;
+
+    /**
+     * PDU types at or above this value are not indexed.
+     */
+    static const uint32_t max_indexed_type = 64;
+
+    LayerIndex() {
+        clear();
+    }
+
+    #ifdef TINS_HAVE_PDU_POOL
+        static void* operator new(size_t size) {
+            return PDUPool::allocate(size);
+        }
+
+        static void operator delete(void* ptr) {
+            PDUPool::deallocate(ptr);
+        }
+    #endif // TINS_HAVE_PDU_POOL
+
+    void clear() {
+        memset(first_layer_, 0, sizeof(first_layer_));
+        size_ = 0;
+        valid_ = false;
+        indexable_ = true;
+        has_pending_layers_ = false;
+    }
+
+    // Returns false and flags the index as not indexable if the layer can't be added
+    bool add(PDU* layer, uint32_t type) {
+        if (size_ == max_layers || type >= max_indexed_type) {
+            indexable_ = false;
+            return false;
+        }
+        layers_[size_++] = layer;
+        if (first_layer_[type] == 0) {
+            first_layer_[type] = size_;
+        }
+        return true;
+    }
+
+    PDU* find(uint32_t type) const {
+        const uint8_t position = first_layer_[type];
+        return position ? layers_[position - 1] : 0;
+    }
+
+    PDU* last_layer() const {
+        return size_ ? layers_[size_ - 1] : 0;
+    }
+
+    bool valid() const {
+        return valid_;
+    }
+
+    void valid(bool value) {
+        valid_ = value;
+    }
+
+    bool indexable() const {
+        return indexable_;
+    }
+
+    bool has_pending_layers() const {
+        return has_pending_layers_;
+    }
+
+    void has_pending_layers(bool value) {
+        has_pending_layers_ = value;
+    }
+private:
+    PDU* layers_[max_layers];
+    uint8_t first_layer_[max_indexed_type];
+    uint8_t size_;
+    bool valid_;
+    bool indexable_;
+    bool has_pending_layers_;
+};
+
+} // Internals
+} // Tins
+
+/**
+ * \endcond
+ */
+
+#endif // TINS_LAYER_INDEX_H
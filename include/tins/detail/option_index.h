@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+
+#ifndef TINS_OPTION_INDEX_H
+#define TINS_OPTION_INDEX_H
+
+#include <string.h>
+#include <stdint.h>
+#include <vector>
+#include <tins/pdu_option.h>
+
+/**
+ * \cond
+ */
+
+namespace Tins {
+namespace Internals {
+
+/**
+ * Converts an option type into the 8 bit value used to index it.
+ *
+ * Every indexed option type fits in a byte, this is specialized for
+ * the ones that aren't integral types.
+ */
+template <typename OptionType>
+struct option_index_key {
+    static uint8_t get(OptionType type) {
+        return static_cast<uint8_t>(type);
+    }
+};
+
+/**
+ * Maps option types to the position of the first option of that type in
+ * a PDU's options vector.
+ *
+ * The index is built on the first lookup (or by OptionIndex::prepare) and
+ * must be invalidated every time the options vector is modified. Copies of an index start out 
+ * invalid, since they belong to a different vector.
+ */
+template <typename Option>
+class OptionIndex {
+public:
+    typedef typename Option::option_type option_type;
+    typedef std::vector<Option> options_type;
+
+    /**
+     * Below this amount of options, a linear search is as fast as the index.
+     */
+    static const size_t min_indexed_options = 8;
+
+    /**
+     * Positions are stored in a byte, so larger vectors aren't indexed.
+     */
+    static const size_t max_indexed_options = 254;
+
+    OptionIndex()
+    : positions_(0), valid_(false) {
+
+    }
+
+    OptionIndex(const OptionIndex&)
+    : positions_(0), valid_(false) {
+
+    }
+
+    OptionIndex& operator=(const OptionIndex&) {
+        invalidate();
+        return *this;
+    }
+
+    ~OptionIndex() {
+        delete[] positions_;
+    }
+
+    void invalidate() {
+        valid_ = false;
+    }
+
+    typename options_type::const_iterator find(const options_type& options,
+                                               option_type type) const {
+        if (options.size() < min_indexed_options || options.size() > max_indexed_options) {
+            return find_option_const<Option>(options, type);
+        }
+        if (!valid_) {
+            build(options);
+        }
+        const uint8_t position = positions_[option_index_key<option_type>::get(type)];
+        return position ? options.begin() + (position - 1) : options.end();
+    }
+
+    typename options_type::iterator find(options_type& options, option_type type) const {
+        const options_type& const_options = options;
+        return options.begin() + (find(const_options, type) - const_options.begin());
+    }
+
+    // Builds the index now, so that lookups don't modify it afterwards
+    void prepare(const options_type& options) const {
+        if (!valid_ && options.size() >= min_indexed_options &&
+            options.size() <= max_indexed_options) {
+            build(options);
+        }
+    }
+private:
+    static const size_t key_count = 256;
+
+    void build(const options_type& options) const {
+        if (!positions_) {
+            positions_ = new uint8_t[key_count];
+        }
+        memset(positions_, 0, key_count);
+        // Iterate backwards so the first option of each type wins
+        for (size_t i = options.size(); i > 0; --i) {
+            const option_type type = options[i - 1].option();
+            positions_[option_index_key<option_type>::get(type)] = static_cast<uint8_t>(i);
+        }
+        valid_ = true;
+    }
+
+    mutable uint8_t* positions_;
+    mutable bool valid_;
+};
+
+/**
+ * The bytes of a PDU's options, kept around until they're parsed.
+ *
+ * These point to the buffer the PDU was constructed from. Copies own
+ * their bytes instead, so copies of a PDU never refer to that buffer.
+ */
+class PendingOptions {
+public:
+    PendingOptions()
+    : buffer_(0), size_(0) {
+
+    }
+
+    PendingOptions(const PendingOptions& rhs)
+    : buffer_(0), size_(0) {
+        *this = rhs;
+    }
+
+    PendingOptions& operator=(const PendingOptions& rhs) {
+        if (this != &rhs) {
+            storage_.assign(rhs.buffer_, rhs.buffer_ + rhs.size_);
+            buffer_ = storage_.empty() ? 0 : &storage_[0];
+            size_ = rhs.size_;
+        }
+        return *this;
+    }
+
+    void assign(const uint8_t* buffer, uint32_t total_sz) {
+        storage_.clear();
+        buffer_ = total_sz ? buffer : 0;
+        size_ = total_sz;
+    }
+
+    void clear() {
+        std::vector<uint8_t>().swap(storage_);
+        buffer_ = 0;
+        size_ = 0;
+    }
+
+    bool empty() const {
+        return buffer_ == 0;
+    }
+
+    const uint8_t* data() const {
+        return buffer_;
+    }
+
+    uint32_t size() const {
+        return size_;
+    }
+private:
+    std::vector<uint8_t> storage_;
+    const uint8_t* buffer_;
+    uint32_t size_;
+};
+
+} // Internals
+} // Tins
+
+/**
+ * \endcond
+ */
+
+#endif // TINS_OPTION_INDEX_H
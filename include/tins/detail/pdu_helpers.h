@@ -45,17 +45,85 @@ PDU* pdu_from_flag(Constants::Ethernet::e flag, const uint8_t* buffer,
                    uint32_t size, bool rawpdu_on_no_match = true);
 PDU* pdu_from_flag(Constants::IP::e flag, const uint8_t* buffer,
                    uint32_t size, bool rawpdu_on_no_match = true);
+
+// Decodes a whole frame captured on some link layer type. Returns a null
+// pointer if the frame can't be decoded as that link layer type
+typedef PDU* (*frame_decoder)(const uint8_t* buffer, uint32_t size);
+
+// Decodes the whole frame as a RawPDU. Used when extracting raw PDUs and
+// for frames captured on unknown link layer types
+PDU* decode_raw_frame(const uint8_t* buffer, uint32_t size);
+
 #ifdef TINS_HAVE_PCAP
 PDU* pdu_from_dlt_flag(int flag, const uint8_t* buffer,
                        uint32_t size, bool rawpdu_on_no_match = true);
+
+// Returns the decoder for frames captured on the given link layer type,
+// using the same rules BaseSniffer does. Throws unknown_link_type if the
+// link layer type is not supported
+frame_decoder frame_decoder_from_dlt_flag(int flag);
+
+// Convert between the LINKTYPE_* values stored in capture files and the
+// DLT_* values used by libpcap. These only differ for a few link types
+int dlt_from_link_type(uint32_t link_type);
+uint32_t link_type_from_dlt(int dlt);
 #endif // TINS_HAVE_PCAP
+#ifdef TINS_HAVE_PACKET_RING
+// Returns the decoder for frames captured through an AF_PACKET socket
+// bound to an interface of the given ARPHRD_* hardware type. Frames
+// captured on unknown hardware types are decoded as RawPDUs
+frame_decoder frame_decoder_from_hardware_type(int type);
+#endif // TINS_HAVE_PACKET_RING
 PDU* pdu_from_flag(PDU::PDUType type, const uint8_t* buffer, uint32_t size);
 
+// Inner PDU decoders, used along with PDU::inner_pdu(inner_pdu_decoder, ...)
+PDU* decode_ether_payload(uint32_t ether_type, const uint8_t* buffer, uint32_t size);
+PDU* decode_ip_payload(uint32_t protocol, const uint8_t* buffer, uint32_t size);
+PDU* decode_raw_payload(uint32_t, const uint8_t* buffer, uint32_t size);
+#ifdef TINS_HAVE_DOT11
+PDU* decode_dot11_payload(uint32_t, const uint8_t* buffer, uint32_t size);
+#endif // TINS_HAVE_DOT11
+
+// Decodes the inner PDU as a T, for layers whose payload's type is
+// already known. The identifier is ignored
+template <typename T>
+PDU* decode_payload_as(uint32_t, const uint8_t* buffer, uint32_t size) {
+    return new T(buffer, size);
+}
+
 Constants::Ethernet::e pdu_flag_to_ether_type(PDU::PDUType flag);
 PDU::PDUType ether_type_to_pdu_flag(Constants::Ethernet::e flag);
 Constants::IP::e pdu_flag_to_ip_type(PDU::PDUType flag);
 PDU::PDUType ip_type_to_pdu_flag(Constants::IP::e flag);
 
+// Returns false if the buffer is too short to contain the fixed header of
+// the PDU the decoder would construct. This never throws, so it can be used
+// to skip decoding truncated layers
+bool inner_pdu_fits(PDU* (*decoder)(uint32_t, const uint8_t*, uint32_t),
+                    uint32_t identifier, const uint8_t* buffer, uint32_t size);
+
+// Returns false if the buffer is too short to contain the headers of a PDU
+// of the given type, i.e. if its extract_metadata would throw. Types this
+// doesn't know about are assumed to fit
+bool layer_fits(PDU::PDUType type, const uint8_t* buffer, uint32_t size);
+
+// Returns the protocol carried by the IPv6 header in buffer, skipping its
+// extension headers. If the payload is fragmented, the fragment header's
+// identifier is returned. The headers must fit, see layer_fits
+uint8_t ipv6_payload_protocol(const uint8_t* buffer);
+
+// Overwrites the data_size bytes at field with new_data and adjusts the big
+// endian checksum stored at checksum. The checksum is left untouched if
+// it's a null pointer
+void patch_checksummed_field(uint8_t* field, const uint8_t* new_data,
+                             uint32_t data_size, uint8_t* checksum);
+
+// Adjusts the checksum of the TCP/UDP segment or ICMPv6 message in buffer
+// after a field covered by its pseudo header changed
+void patch_pseudoheader_checksum(Constants::IP::e protocol, uint8_t* buffer,
+                                 uint32_t total_sz, const uint8_t* old_data,
+                                 const uint8_t* new_data, uint32_t data_size);
+
 inline bool is_dot3(const uint8_t* ptr, size_t sz) {
     return (sz >= 13 && ptr[12] < 8);
 }
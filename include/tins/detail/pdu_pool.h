@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+#ifndef TINS_PDU_POOL_H
+#define TINS_PDU_POOL_H
+
+#include <stddef.h>
+#include <tins/macros.h>
+
+/**
+ * \cond
+ */
+
+namespace Tins {
+namespace Internals {
+
+/**
+ * Per thread pools used to allocate PDU objects.
+ *
+ * Memory blocks are grouped in size classes. Blocks that are released are
+ * kept in the allocating thread's free list for its size class, so after
+ * a few packets have been processed, constructing and destroying PDUs
+ * doesn't hit the general purpose allocator anymore.
+ *
+ * Blocks may be released on a different thread than the one that allocated
+ * them. In that case they are handed back to the allocating thread, which
+ * picks them up the next time it runs out of blocks of that size class.
+ * This keeps the pools of threads that only produce PDUs (e.g. decoding
+ * threads whose packets are consumed somewhere else) warm. Each thread's
+ * cached blocks are freed when the thread exits.
+ */
+class TINS_API PDUPool {
+public:
+    /**
+     * Objects larger than this are allocated using operator new.
+     */
+    static const size_t max_pooled_size = 512;
+
+    /**
+     * The granularity of the size classes.
+     */
+    static const size_t size_class_step = 16;
+
+    /**
+     * The maximum amount of free blocks cached per thread and size class.
+     */
+    static const size_t max_cached_blocks = 512;
+
+    static void* allocate(size_t size);
+    static void deallocate(void* ptr);
+
+    /**
+     * Frees every block cached by the calling thread, including the ones
+     * other threads have handed back to it.
+     */
+    static void trim();
+
+    /**
+     * Returns the amount of bytes cached by the calling thread.
+     */
+    static size_t cached_bytes();
+};
+
+} // Internals
+} // Tins
+
+/**
+ * \endcond
+ */
+
+#endif // TINS_PDU_POOL_H
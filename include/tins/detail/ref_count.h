@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef TINS_REF_COUNT_H
+#define TINS_REF_COUNT_H
+
+#include <stdint.h>
+#include <tins/cxxstd.h>
+#if TINS_IS_CXX11
+    #include <atomic>
+#endif // TINS_IS_CXX11
+
+/**
+ * \cond
+ */
+
+namespace Tins {
+namespace Internals {
+
+// Intrusive reference count, starting at 1. Copies of the object holding 
+// it are never shared, so copying this resets the count
+class ref_count {
+public:
+    ref_count()
+    : count_(1) {
+
+    }
+
+    ref_count(const ref_count&)
+    : count_(1) {
+
+    }
+
+    ref_count& operator=(const ref_count&) {
+        return *this;
+    }
+
+    void increment() {
+        #if TINS_IS_CXX11
+        count_.fetch_add(1, std::memory_order_relaxed);
+        #else
+        ++count_;
+        #endif // TINS_IS_CXX11
+    }
+
+    // Returns true if the last reference was dropped
+    bool decrement() {
+        #if TINS_IS_CXX11
+        return count_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+        #else
+        return --count_ == 0;
+        #endif // TINS_IS_CXX11
+    }
+
+    bool is_shared() const {
+        #if TINS_IS_CXX11
+        return count_.load(std::memory_order_acquire) > 1;
+        #else
+        return count_ > 1;
+        #endif // TINS_IS_CXX11
+    }
+private:
+    #if TINS_IS_CXX11
+    std::atomic<uint32_t> count_;
+    #else
+    // Without C++11 there are no atomics, packets can't be shared across threads
+    uint32_t count_;
+    #endif // TINS_IS_CXX11
+};
+
+} // Internals
+} // Tins
+
+/**
+ * \endcond
+ */
+
+#endif // TINS_REF_COUNT_H
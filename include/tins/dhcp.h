@@ -36,6 +36,7 @@
 #include <tins/macros.h>
 #include <tins/pdu_option.h>
 #include <tins/cxxstd.h>
+#include <tins/detail/option_index.h>
 
 namespace Tins {
 
@@ -214,8 +215,10 @@ public:
          * \param opt The option to be added.
          */
         void add_option(option &&opt) {
+            parse_pending_options();
             internal_add_option(opt);
             options_.push_back(std::move(opt));
+            option_index_.invalidate();
         }
     #endif 
 
@@ -483,7 +486,10 @@ public:
      * \brief Getter for the options list.
      * \return The option list.
      */
-    const options_type options() const { return options_; }
+    const options_type options() const { 
+        parse_pending_options();
+        return options_; 
+    }
     
     /**
      * \brief Getter for the PDU's type.
@@ -518,12 +524,25 @@ private:
         return option->to<T>();
     }
     
+    // Options are parsed on first access when using DecodingScope::LAZY_OPTIONS
+    void parse_pending_options() const {
+        if (TINS_UNLIKELY(!pending_options_.empty())) {
+            parse_options(pending_options_.data(), pending_options_.size(), true);
+            pending_options_.clear();
+        }
+    }
+
+    uint32_t parse_options(const uint8_t* buffer, uint32_t total_sz, bool store) const;
+    void finish_lazy_parsing() const;
     void internal_add_option(const option& opt);
+    static uint32_t count_options(const uint8_t* buffer, uint32_t total_sz);
     serialization_type serialize_list(const std::vector<ipaddress_type>& ip_list);
     options_type::const_iterator search_option_iterator(OptionTypes opt) const;
     options_type::iterator search_option_iterator(OptionTypes opt);
     
-    options_type options_;
+    mutable options_type options_;
+    mutable Internals::PendingOptions pending_options_;
+    Internals::OptionIndex<option> option_index_;
     uint32_t size_;
 };
 
@@ -39,6 +39,7 @@
 #include <tins/endianness.h>
 #include <tins/cxxstd.h>
 #include <tins/macros.h>
+#include <tins/detail/option_index.h>
 
 namespace Tins {
 namespace Memory {
@@ -448,8 +449,10 @@ public:
          * \param opt The option to be added.
          */
         void add_option(option &&opt) {
+            parse_pending_options();
             internal_add_option(opt);
             options_.push_back(std::move(opt));
+            option_index_.invalidate();
         }
     #endif
 
@@ -504,6 +507,7 @@ public:
      * \return The options list.
      */
     const options_type& options() const {
+        parse_pending_options();
         return options_;
     }
 
@@ -568,6 +572,16 @@ protected:
 private:
     Dot11(const dot11_header* header_ptr);
     
+    // Options are parsed on first access when using DecodingScope::LAZY_OPTIONS
+    void parse_pending_options() const {
+        if (TINS_UNLIKELY(!pending_options_.empty())) {
+            parse_options(pending_options_.data(), pending_options_.size(), true);
+            pending_options_.clear();
+        }
+    }
+
+    uint32_t parse_options(const uint8_t* buffer, uint32_t total_sz, bool store) const;
+    void finish_lazy_parsing() const;
     void internal_add_option(const option& opt);
     void write_serialization(uint8_t* buffer, uint32_t total_sz);
     options_type::const_iterator search_option_iterator(OptionTypes type) const;
@@ -576,7 +590,9 @@ private:
 
     dot11_header header_;
     uint32_t options_size_;
-    options_type options_;
+    mutable options_type options_;
+    mutable Internals::PendingOptions pending_options_;
+    Internals::OptionIndex<option> option_index_;
 };
 
 } // Tins
@@ -100,6 +100,32 @@ public:
      */
     static metadata extract_metadata(const uint8_t *buffer, uint32_t total_sz);
 
+    /**
+     * \brief Sets the identifier of a serialized ICMP echo message.
+     *
+     * The checksum is updated incrementally, so this takes constant time.
+     * A malformed_packet exception is thrown if the buffer is too small
+     * to contain a ICMP header.
+     *
+     * \param buffer Pointer to the start of the ICMP header.
+     * \param total_sz Size of the buffer pointed by buffer.
+     * \param new_id The new identifier.
+     */
+    static void patch_id(uint8_t* buffer, uint32_t total_sz, uint16_t new_id);
+
+    /**
+     * \brief Sets the sequence number of a serialized ICMP echo message.
+     *
+     * The checksum is updated incrementally, so this takes constant time.
+     * A malformed_packet exception is thrown if the buffer is too small
+     * to contain a ICMP header.
+     *
+     * \param buffer Pointer to the start of the ICMP header.
+     * \param total_sz Size of the buffer pointed by buffer.
+     * \param new_seq The new sequence number.
+     */
+    static void patch_sequence(uint8_t* buffer, uint32_t total_sz, uint16_t new_seq);
+
     /**
      * \brief Creates an instance of ICMP.
      *
@@ -470,6 +496,9 @@ public:
         return new ICMP(*this);
     }
 private:
+    static void patch_field(uint8_t* buffer, uint32_t total_sz, uint32_t offset,
+                            uint16_t value);
+
     TINS_BEGIN_PACK
     struct icmp_header {
         uint8_t	type;
@@ -37,6 +37,7 @@
 #include <tins/pdu_option.h>
 #include <tins/macros.h>
 #include <tins/cxxstd.h>
+#include <tins/detail/option_index.h>
 
 namespace Tins {
 namespace Memory {
@@ -253,6 +254,46 @@ public:
      */
     static metadata extract_metadata(const uint8_t *buffer, uint32_t total_sz);
 
+    /**
+     * \brief Sets the TTL field of a serialized IP packet.
+     *
+     * The header checksum is updated incrementally, so this takes
+     * constant time. A malformed_packet exception is thrown if the 
+     * buffer doesn't contain a valid IP header.
+     *
+     * \param buffer Pointer to the start of the IP header.
+     * \param total_sz Size of the buffer pointed by buffer.
+     * \param new_ttl The new TTL.
+     */
+    static void patch_ttl(uint8_t* buffer, uint32_t total_sz, uint8_t new_ttl);
+
+    /**
+     * \brief Sets the source address of a serialized IP packet.
+     *
+     * Both the header checksum and, if the payload is the first fragment
+     * of a TCP or UDP segment, the segment's checksum are updated 
+     * incrementally. A malformed_packet exception is thrown if the 
+     * buffer doesn't contain a valid IP header.
+     *
+     * \param buffer Pointer to the start of the IP header.
+     * \param total_sz Size of the buffer pointed by buffer.
+     * \param new_src_addr The new source address.
+     */
+    static void patch_src_addr(uint8_t* buffer, uint32_t total_sz,
+                               address_type new_src_addr);
+
+    /**
+     * \brief Sets the destination address of a serialized IP packet.
+     *
+     * \sa IP::patch_src_addr
+     *
+     * \param buffer Pointer to the start of the IP header.
+     * \param total_sz Size of the buffer pointed by buffer.
+     * \param new_dst_addr The new destination address.
+     */
+    static void patch_dst_addr(uint8_t* buffer, uint32_t total_sz,
+                               address_type new_dst_addr);
+
     /**
      * \brief Constructor for building the IP PDU.
      *
@@ -409,6 +450,7 @@ public:
      * \return The stored options.
      */
     const options_type& options() const {
+        parse_pending_options();
         return options_;
     }
 
@@ -523,7 +565,9 @@ public:
          * \param opt The option to be added.
          */
         void add_option(option &&opt) {
+            parse_pending_options();
             options_.push_back(std::move(opt));
+            option_index_.invalidate();
         }
 
         /**
@@ -536,7 +580,9 @@ public:
          */
         template<typename... Args>
         void add_option(Args&&... args) {
+            parse_pending_options();
             options_.emplace_back(std::forward<Args>(args)...);
+            option_index_.invalidate();
         }
     #endif
 
@@ -750,10 +796,22 @@ private:
         uint32_t daddr;
     } TINS_END_PACK;
 
+    static void patch_address(uint8_t* buffer, uint32_t total_sz,
+                              uint32_t offset, address_type new_addr);
     void head_len(small_uint<4> new_head_len);
     void tot_len(uint16_t new_tot_len);
 
+    // Options are parsed on first access when using DecodingScope::LAZY_OPTIONS
+    void parse_pending_options() const {
+        if (TINS_UNLIKELY(!pending_options_.empty())) {
+            parse_options(pending_options_.data(), pending_options_.size(), true);
+            pending_options_.clear();
+        }
+    }
+
+    void parse_options(const uint8_t* buffer, uint32_t total_sz, bool store) const;
     void prepare_for_serialize();
+    void finish_lazy_parsing() const;
     uint32_t calculate_options_size() const;
     uint32_t pad_options_size(uint32_t size) const;
     void init_ip_fields();
@@ -765,10 +823,29 @@ private:
     options_type::const_iterator search_option_iterator(option_identifier id) const;
     options_type::iterator search_option_iterator(option_identifier id);
 
-    options_type options_;
+    mutable options_type options_;
+    mutable Internals::PendingOptions pending_options_;
+    Internals::OptionIndex<option> option_index_;
     ip_header header_;
 };
 
+/**
+ * \cond
+ */
+namespace Internals {
+
+template <>
+struct option_index_key<IP::option_identifier> {
+    static uint8_t get(IP::option_identifier id) {
+        return static_cast<uint8_t>((id.copied << 7) | (id.op_class << 5) | id.number);
+    }
+};
+
+} // Internals
+/**
+ * \endcond
+ */
+
 } // Tins
 
 #endif // TINS_IP_H
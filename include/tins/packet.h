@@ -61,8 +61,9 @@ typedef PacketWrapper<PDU*, Timestamp> PtrPacket;
  * to a PDU, and not a pointer to one. 
  * 
  * This class is only used in some BaseSniffer methods as a thin wrapper 
- * to a PDU pointer/reference. Only BaseSniffer and derived objects can
- * create instances of it.
+ * to a PDU pointer/reference. Only BaseSniffer, RingSniffer,
+ * PcapFileReader, PcapngReader and derived objects can create instances
+ * of it.
  */
 template<typename PDUType, typename TimestampType>
 class PacketWrapper {
@@ -107,6 +108,9 @@ public:
 private:
     friend class BaseSniffer;
     friend class SnifferIterator;
+    friend class RingSniffer;
+    friend class PcapFileReader;
+    friend class PcapngReader;
     
     PacketWrapper(pdu_type pdu, const Timestamp& ts) 
     : pdu_(pdu), ts_(ts) {}
@@ -126,6 +130,20 @@ private:
  * A Packet contains a PDU pointer and a Timestamp object. Packets
  * <b>will delete</b> the stored PDU* unless you call release_pdu at 
  * some point before destruction. 
+ *
+ * Copying a Packet doesn't copy its PDU. Instead, both packets share 
+ * it until one of them needs to modify it, at which point that packet 
+ * gets its own copy (copy on write). Shared PDUs are only accessed 
+ * through const methods, so copies of a Packet can be handed to 
+ * several threads. Every non-const access (the non-const Packet::pdu,
+ * Packet::release_pdu and Packet::operator/=) detaches the PDU first,
+ * so pointers obtained through them shouldn't be kept after the 
+ * Packet is copied.
+ *
+ * The first time a Packet is copied, any layer of its PDU that was 
+ * decoded lazily (see DecodingScope) is decoded, so that the copies don't
+ * depend on the buffer the PDU was constructed from. This first copy 
+ * must not race with other accesses to the same Packet.
  */
 class Packet {
 public:
@@ -200,22 +218,24 @@ public:
     /**
      * \brief Copy constructor.
      * 
-     * This calls PDU::clone on the rhs's PDU* member.
+     * The PDU is shared with rhs rather than copied.
      */
-    Packet(const Packet& rhs) : ts_(rhs.timestamp()) {
-        pdu_ = rhs.pdu() ? rhs.pdu()->clone() : 0;
+    Packet(const Packet& rhs) 
+    : pdu_(share(rhs.pdu_)), ts_(rhs.timestamp()) {
+        
     }
     
     /**
      * \brief Copy assignment operator.
      * 
-     * This calls PDU::clone on the rhs's PDU* member.
+     * The PDU is shared with rhs rather than copied.
      */
     Packet& operator=(const Packet& rhs) {
         if (this != &rhs) {
-            delete pdu_;
+            PDU* new_pdu = share(rhs.pdu_);
+            release(pdu_);
             ts_ = rhs.timestamp();
-            pdu_ = rhs.pdu() ? rhs.pdu()->clone() : 0;
+            pdu_ = new_pdu;
         }
         return* this;
     }
@@ -224,7 +244,7 @@ public:
     /**
      * Move constructor.
      */
-    Packet(Packet &&rhs) TINS_NOEXCEPT : pdu_(rhs.pdu()), ts_(rhs.timestamp()) {
+    Packet(Packet &&rhs) TINS_NOEXCEPT : pdu_(rhs.pdu_), ts_(rhs.timestamp()) {
         rhs.pdu_ = nullptr;
     }
     
@@ -245,10 +265,11 @@ public:
     /**
      * \brief Packet destructor.
      * 
-     * This calls operator delete on the stored PDU*.
+     * This calls operator delete on the stored PDU*, unless it's still
+     * shared with another Packet.
      */
     ~Packet() {
-        delete pdu_;
+        release(pdu_);
     }
     
     /**
@@ -261,9 +282,13 @@ public:
     /**
      * \brief Returns the stored PDU*. 
      * 
+     * If the PDU is shared with other Packets, it's copied first so it
+     * can be modified.
+     *
      * Caller <b>must not</b> delete the pointer. \sa Packet::release_pdu
      */
     PDU* pdu() {
+        detach();
         return pdu_;
     }
     
@@ -286,10 +311,18 @@ public:
      * deleted.
      */
     PDU* release_pdu() {
+        detach();
         PDU* some_pdu = pdu_;
         pdu_ = 0;
         return some_pdu;
     }
+
+    /**
+     * \brief Indicates whether the stored PDU is shared with other Packets.
+     */
+    bool is_shared() const {
+        return pdu_ && pdu_->share_count_.is_shared();
+    }
     
     /**
      * \brief Tests whether this is Packet contains a valid PDU.
@@ -309,10 +342,35 @@ public:
      * \param rhs The PDU to be appended.
      */
     Packet& operator/=(const PDU& rhs) {
+        detach();
         pdu_ /= rhs;
         return* this;
     }
 private:
+    static PDU* share(PDU* pdu) {
+        if (pdu) {
+            if (!pdu->share_count_.is_shared()) {
+                pdu->prepare_for_sharing();
+            }
+            pdu->share_count_.increment();
+        }
+        return pdu;
+    }
+
+    static void release(PDU* pdu) {
+        if (pdu && pdu->share_count_.decrement()) {
+            delete pdu;
+        }
+    }
+
+    void detach() {
+        if (is_shared()) {
+            PDU* copy = pdu_->clone();
+            release(pdu_);
+            pdu_ = copy;
+        }
+    }
+
     PDU* pdu_;
     Timestamp ts_;
 };
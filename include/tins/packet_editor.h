@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+#ifndef TINS_PACKET_EDITOR_H
+#define TINS_PACKET_EDITOR_H
+
+#include <stdint.h>
+#include <tins/macros.h>
+#include <tins/pdu.h>
+#include <tins/packet_view.h>
+#include <tins/small_uint.h>
+#include <tins/hw_address.h>
+#include <tins/ip_address.h>
+#include <tins/ipv6_address.h>
+
+namespace Tins {
+
+/**
+ * \class PacketEditor
+ * \brief Edits the fields of a packet directly on its buffer.
+ *
+ * Modifying a field using the PDU classes requires constructing the
+ * whole PDU chain, calling the setter and then serializing the packet
+ * again. PacketEditor instead locates each layer using a PacketView
+ * and writes the new values straight into the buffer, without
+ * allocating or copying anything.
+ *
+ * Every setter keeps the packet consistent: IP header checksums and
+ * TCP, UDP and ICMPv6 checksums are updated incrementally, including the
+ * ones covering a modified address through the pseudo header. ICMPv6
+ * messages that are fragmented are left untouched.
+ *
+ * \code
+ * PacketEditor editor(buffer, size);
+ * editor.ip_src_addr("10.0.0.1");
+ * editor.tcp_dport(8080);
+ * \endcode
+ *
+ * Setters act on the first layer of the requested type. If the packet
+ * doesn't contain such layer, a pdu_not_found exception is thrown.
+ *
+ * The buffer is not copied, so it must outlive the editor.
+ */
+class TINS_API PacketEditor {
+public:
+    /**
+     * \brief Constructs a PacketEditor.
+     *
+     * \param buffer The buffer which contains the packet.
+     * \param total_sz The size of the buffer.
+     * \param first_layer The type of the first layer in the buffer.
+     */
+    PacketEditor(uint8_t* buffer, uint32_t total_sz,
+                 PDU::PDUType first_layer = PDU::ETHERNET_II);
+
+    /**
+     * \brief Getter for the view of the edited packet.
+     */
+    const PacketView& view() const {
+        return view_;
+    }
+
+    /**
+     * \brief Getter for the pointer to the start of the packet.
+     */
+    uint8_t* data() {
+        return buffer_;
+    }
+
+    /**
+     * \brief Getter for the size of the packet.
+     *
+     * This is the size given on construction unless the packet was
+     * truncated.
+     */
+    uint32_t size() const {
+        return view_.size();
+    }
+
+    /**
+     * \brief Sets the destination address of the EthernetII layer.
+     *
+     * \param new_dst_addr The new destination address.
+     */
+    void eth_dst_addr(const HWAddress<6>& new_dst_addr);
+
+    /**
+     * \brief Sets the source address of the EthernetII layer.
+     *
+     * \param new_src_addr The new source address.
+     */
+    void eth_src_addr(const HWAddress<6>& new_src_addr);
+
+    /**
+     * \brief Sets the VLAN identifier of the Dot1Q layer.
+     *
+     * \param new_id The new VLAN identifier.
+     */
+    void vlan_id(small_uint<12> new_id);
+
+    /**
+     * \brief Sets the priority of the Dot1Q layer.
+     *
+     * \param new_priority The new priority.
+     */
+    void vlan_priority(small_uint<3> new_priority);
+
+    /**
+     * \brief Sets the type of service field of the IP layer.
+     *
+     * \param new_tos The new type of service.
+     */
+    void ip_tos(uint8_t new_tos);
+
+    /**
+     * \brief Sets the identification field of the IP layer.
+     *
+     * \param new_id The new identification.
+     */
+    void ip_id(uint16_t new_id);
+
+    /**
+     * \brief Sets the TTL field of the IP layer.
+     *
+     * \param new_ttl The new TTL.
+     */
+    void ip_ttl(uint8_t new_ttl);
+
+    /**
+     * \brief Sets the source address of the IP layer.
+     *
+     * \param new_src_addr The new source address.
+     */
+    void ip_src_addr(IPv4Address new_src_addr);
+
+    /**
+     * \brief Sets the destination address of the IP layer.
+     *
+     * \param new_dst_addr The new destination address.
+     */
+    void ip_dst_addr(IPv4Address new_dst_addr);
+
+    /**
+     * \brief Sets the hop limit field of the IPv6 layer.
+     *
+     * \param new_hop_limit The new hop limit.
+     */
+    void ipv6_hop_limit(uint8_t new_hop_limit);
+
+    /**
+     * \brief Sets the source address of the IPv6 layer.
+     *
+     * \param new_src_addr The new source address.
+     */
+    void ipv6_src_addr(const IPv6Address& new_src_addr);
+
+    /**
+     * \brief Sets the destination address of the IPv6 layer.
+     *
+     * \param new_dst_addr The new destination address.
+     */
+    void ipv6_dst_addr(const IPv6Address& new_dst_addr);
+
+    /**
+     * \brief Sets the source port of the TCP layer.
+     *
+     * \param new_sport The new source port.
+     */
+    void tcp_sport(uint16_t new_sport);
+
+    /**
+     * \brief Sets the destination port of the TCP layer.
+     *
+     * \param new_dport The new destination port.
+     */
+    void tcp_dport(uint16_t new_dport);
+
+    /**
+     * \brief Sets the sequence number of the TCP layer.
+     *
+     * \param new_seq The new sequence number.
+     */
+    void tcp_seq(uint32_t new_seq);
+
+    /**
+     * \brief Sets the acknowledgement number of the TCP layer.
+     *
+     * \param new_ack_seq The new acknowledgement number.
+     */
+    void tcp_ack_seq(uint32_t new_ack_seq);
+
+    /**
+     * \brief Sets the window size of the TCP layer.
+     *
+     * \param new_window The new window size.
+     */
+    void tcp_window(uint16_t new_window);
+
+    /**
+     * \brief Sets the source port of the UDP layer.
+     *
+     * \param new_sport The new source port.
+     */
+    void udp_sport(uint16_t new_sport);
+
+    /**
+     * \brief Sets the destination port of the UDP layer.
+     *
+     * \param new_dport The new destination port.
+     */
+    void udp_dport(uint16_t new_dport);
+
+    /**
+     * \brief Shrinks the packet, dropping the bytes at its end.
+     *
+     * The length fields of the IP, IPv6, UDP and IEEE 802.3 layers
+     * and the checksums of every layer whose size changed are updated.
+     * Only payloads can be truncated: if new_size is larger than the
+     * current size or it would cut through a header, an invalid_packet
+     * exception is thrown.
+     *
+     * \param new_size The new size of the packet.
+     */
+    void truncate(uint32_t new_size);
+
+    /**
+     * \brief Recomputes every IP, TCP, UDP, ICMP and ICMPv6 checksum in the
+     * packet.
+     *
+     * Setters already keep checksums up to date. This is only needed
+     * after modifying the buffer by other means, e.g. writing into a
+     * payload through data().
+     */
+    void update_checksums();
+private:
+    uint32_t find_layer(PDU::PDUType type) const;
+    uint8_t* layer_data(uint32_t index);
+    void patch_ipv6_address(uint32_t offset, const IPv6Address& new_addr);
+    void patch_tcp_field(uint32_t offset, const uint8_t* new_data, uint32_t data_size);
+    void update_checksum(uint32_t index);
+
+    uint8_t* buffer_;
+    PDU::PDUType first_layer_;
+    PacketView view_;
+};
+
+} // Tins
+
+#endif // TINS_PACKET_EDITOR_H
@@ -414,6 +414,8 @@ private:
     SocketTypeMap types_;
     uint32_t _timeout, timeout_usec_;
     NetworkInterface default_iface_;
+    // Reused across sends so serializing doesn't allocate every time
+    std::vector<uint8_t> send_buffer_;
     // In BSD we need to store the buffer size, retrieved using BIOCGBLEN
     #if defined(BSD) || defined(__FreeBSD_kernel__)
     int buffer_size_;
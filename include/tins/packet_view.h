@@ -0,0 +1,819 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+#ifndef TINS_PACKET_VIEW_H
+#define TINS_PACKET_VIEW_H
+
+#include <stdint.h>
+#include <cstring>
+#include <tins/pdu.h>
+#include <tins/macros.h>
+#include <tins/endianness.h>
+#include <tins/ip_address.h>
+#include <tins/ipv6_address.h>
+#include <tins/hw_address.h>
+
+namespace Tins {
+
+/**
+ * \class LayerView
+ * \brief Read-only view over a single protocol layer inside a buffer.
+ *
+ * A LayerView doesn't own any memory. It simply points to the region
+ * of the buffer the layer was found on, so it is only valid as long as
+ * the underlying buffer is.
+ *
+ * \sa PacketView
+ */
+class TINS_API LayerView {
+public:
+    /**
+     * \brief Default constructs an empty LayerView.
+     */
+    LayerView()
+    : buffer_(0), header_size_(0), size_(0), type_(PDU::UNKNOWN) {
+
+    }
+
+    /**
+     * \brief Constructs a LayerView.
+     *
+     * \param type The type of this layer.
+     * \param buffer The pointer to the start of this layer.
+     * \param header_size The size of this layer's header.
+     * \param total_sz The size of this layer, including its payload.
+     */
+    LayerView(PDU::PDUType type, const uint8_t* buffer, uint32_t header_size,
+              uint32_t total_sz)
+    : buffer_(buffer), header_size_(header_size), size_(total_sz), type_(type) {
+
+    }
+
+    /**
+     * \brief Getter for this layer's type.
+     */
+    PDU::PDUType pdu_type() const {
+        return type_;
+    }
+
+    /**
+     * \brief Getter for the pointer to the start of this layer.
+     */
+    const uint8_t* data() const {
+        return buffer_;
+    }
+
+    /**
+     * \brief Getter for the size of this layer's header.
+     */
+    uint32_t header_size() const {
+        return header_size_;
+    }
+
+    /**
+     * \brief Getter for the size of this layer, including its payload.
+     */
+    uint32_t size() const {
+        return size_;
+    }
+
+    /**
+     * \brief Getter for the pointer to this layer's payload.
+     */
+    const uint8_t* payload() const {
+        return buffer_ + header_size_;
+    }
+
+    /**
+     * \brief Getter for the size of this layer's payload.
+     */
+    uint32_t payload_size() const {
+        return size_ - header_size_;
+    }
+
+    /**
+     * \brief Reads a value at the given offset, as it is stored in the buffer.
+     *
+     * If the value doesn't fit in this layer, a malformed_packet exception
+     * is thrown.
+     *
+     * \param offset The offset, relative to the start of this layer.
+     */
+    template <typename T>
+    T read(uint32_t offset) const {
+        if (TINS_UNLIKELY(offset > size_ || size_ - offset < sizeof(T))) {
+            throw malformed_packet();
+        }
+        T output;
+        std::memcpy(&output, buffer_ + offset, sizeof(output));
+        return output;
+    }
+
+    /**
+     * \brief Reads a big endian value at the given offset.
+     *
+     * The value is converted to host endianness before being returned.
+     *
+     * \param offset The offset, relative to the start of this layer.
+     */
+    template <typename T>
+    T read_be(uint32_t offset) const {
+        return Endian::be_to_host(read<T>(offset));
+    }
+
+    /**
+     * \brief Indicates whether this view points to an actual layer.
+     */
+    operator bool() const {
+        return buffer_ != 0;
+    }
+private:
+    const uint8_t* buffer_;
+    uint32_t header_size_;
+    uint32_t size_;
+    PDU::PDUType type_;
+};
+
+/**
+ * \class PacketView
+ * \brief Read-only, allocation free view over a whole packet.
+ *
+ * PacketView walks the protocol layers contained in a buffer, using
+ * the same rules the PDU classes use when being constructed from a
+ * buffer, but without allocating or copying anything. This is useful
+ * when only a few fields of each packet are inspected, for example
+ * when filtering packets as soon as they are captured:
+ *
+ * \code
+ * PacketView view(buffer, size);
+ * const LayerView* layer = view.find_layer<TCP>();
+ * if (layer && TCPView(*layer).dport() == 80) {
+ *     // Only construct the whole PDU for the packets we care about
+ *     EthernetII packet(buffer, size);
+ * }
+ * \endcode
+ *
+ * The currently walked protocols are EthernetII, Dot1Q, IP, IPv6, ARP,
+ * TCP, UDP and ICMP. Whenever a protocol which is not understood is found,
+ * or a layer is malformed, the rest of the buffer is exposed as a
+ * PDU::RAW layer.
+ *
+ * The buffer is not copied, so the view and every LayerView taken
+ * from it are only valid while the buffer is.
+ */
+class TINS_API PacketView {
+public:
+    /**
+     * The maximum amount of layers a PacketView can hold.
+     */
+    static const uint32_t max_layers = 8;
+
+    /**
+     * \brief Constructs a PacketView.
+     *
+     * \param buffer The buffer which contains the packet.
+     * \param total_sz The size of the buffer.
+     * \param first_layer The type of the first layer in the buffer.
+     */
+    PacketView(const uint8_t* buffer, uint32_t total_sz,
+               PDU::PDUType first_layer = PDU::ETHERNET_II);
+
+    /**
+     * \brief Getter for the amount of layers found.
+     */
+    uint32_t layer_count() const {
+        return layer_count_;
+    }
+
+    /**
+     * \brief Getter for the layer at the given index.
+     *
+     * \param index The index of the layer. This must be lower than layer_count.
+     */
+    const LayerView& layer(uint32_t index) const {
+        return layers_[index];
+    }
+
+    /**
+     * \brief Finds the first layer of the given type.
+     *
+     * \param type The type to look for.
+     * \return A pointer to the layer or a null pointer if it wasn't found.
+     */
+    const LayerView* find_layer(PDU::PDUType type) const;
+
+    /**
+     * \brief Finds the first layer for the given PDU type.
+     *
+     * \code
+     * const LayerView* ip = view.find_layer<IP>();
+     * \endcode
+     */
+    template <typename T>
+    const LayerView* find_layer() const {
+        return find_layer(T::pdu_flag);
+    }
+
+    /**
+     * \brief Getter for the pointer to the start of the packet.
+     */
+    const uint8_t* data() const {
+        return buffer_;
+    }
+
+    /**
+     * \brief Getter for the size of the packet.
+     */
+    uint32_t size() const {
+        return size_;
+    }
+private:
+    LayerView layers_[max_layers];
+    const uint8_t* buffer_;
+    uint32_t size_;
+    uint32_t layer_count_;
+};
+
+/**
+ * \brief The protocol layers found in a packet by classify.
+ *
+ * \sa classify
+ */
+struct TINS_API PacketClassification {
+    /**
+     * \brief A single layer in the packet.
+     */
+    struct layer_info {
+        /**
+         * The type of this layer.
+         */
+        PDU::PDUType type;
+
+        /**
+         * The offset of this layer from the start of the packet.
+         */
+        uint32_t offset;
+
+        /**
+         * The size of this layer, including its payload.
+         */
+        uint32_t length;
+    };
+
+    /**
+     * The maximum amount of layers, including the link layer pseudo header
+     * used by some link types.
+     */
+    static const uint32_t max_layers = PacketView::max_layers + 1;
+
+    /**
+     * The layers found, from the outermost to the innermost one.
+     */
+    layer_info layers[max_layers];
+
+    /**
+     * The amount of valid entries in layers.
+     */
+    uint32_t layer_count;
+};
+
+/**
+ * \brief Classifies the protocol layers in a captured packet.
+ *
+ * This walks the packet the same way PacketView does, but starts from a
+ * pcap link layer type, such as the one returned by
+ * BaseSniffer::link_type. It doesn't allocate memory and never throws,
+ * so it can be used to route, shard or drop packets before constructing
+ * any PDU:
+ *
+ * \code
+ * PacketClassification layers = classify(data, size, DLT_EN10MB);
+ * for (uint32_t i = 0; i < layers.layer_count; ++i) {
+ *     if (layers.layers[i].type == PDU::TCP) {
+ *         // ...
+ *     }
+ * }
+ * \endcode
+ *
+ * Ethernet, raw IP, BSD loopback and Linux cooked captures are
+ * understood. Any other link type, as well as any malformed layer, is
+ * classified as PDU::RAW.
+ *
+ * \param buffer The buffer which contains the packet.
+ * \param total_sz The size of the buffer.
+ * \param link_type The link layer type of the packet (a DLT_* value).
+ */
+TINS_API PacketClassification classify(const uint8_t* buffer, uint32_t total_sz,
+                                       int link_type);
+
+/**
+ * \brief The result of verifying the checksums found in a packet.
+ *
+ * \sa verify_checksums
+ */
+struct TINS_API ChecksumReport {
+    /**
+     * The checksums that can be verified.
+     */
+    enum checksum_flags {
+        IP_CHECKSUM = 1,
+        TCP_CHECKSUM = 2,
+        UDP_CHECKSUM = 4,
+        ICMP_CHECKSUM = 8
+    };
+
+    /**
+     * \brief Default constructs a ChecksumReport, with no checksums verified.
+     */
+    ChecksumReport()
+    : verified(0), invalid(0) {
+
+    }
+
+    /**
+     * The checksums that were verified, as a combination of checksum_flags.
+     */
+    uint32_t verified;
+
+    /**
+     * The checksums that were found to be wrong, as a combination of 
+     * checksum_flags. This is always a subset of verified.
+     */
+    uint32_t invalid;
+
+    /**
+     * \brief Indicates whether every verified checksum is correct.
+     */
+    bool valid() const {
+        return invalid == 0;
+    }
+};
+
+/**
+ * \brief Verifies the checksums of the layers in a packet.
+ *
+ * The checksums are computed over the bytes the view points to, so
+ * nothing is serialized or copied. This verifies the IPv4 header checksum
+ * and the ICMP, TCP and UDP checksums, using the IPv4 or IPv6 pseudo 
+ * header for the latter. 
+ *
+ * Some checksums can't be verified, which is reported by not setting them
+ * in ChecksumReport::verified: UDP over IPv4 datagrams with a zero 
+ * checksum don't use one, and the transport checksum of packets that were
+ * truncated during capture or of IP fragments can't be computed.
+ *
+ * Note that packets sent by the capturing host often carry wrong 
+ * checksums when the NIC computes them (checksum offloading).
+ *
+ * \param view The view of the packet to verify.
+ */
+TINS_API ChecksumReport verify_checksums(const PacketView& view);
+
+/**
+ * \brief Verifies the checksums of the layers in a packet.
+ *
+ * \param buffer The buffer which contains the packet.
+ * \param total_sz The size of the buffer.
+ * \param first_layer The type of the first layer in the buffer.
+ * \sa verify_checksums(const PacketView&)
+ */
+TINS_API ChecksumReport verify_checksums(const uint8_t* buffer, uint32_t total_sz,
+                                         PDU::PDUType first_layer = PDU::ETHERNET_II);
+
+/**
+ * \brief Verifies the checksums of the layers in several packets.
+ *
+ * \param packets Pointers to the start of each packet.
+ * \param packet_sizes The size of each packet.
+ * \param packet_count The amount of packets.
+ * \param first_layer The type of the first layer in every packet.
+ * \param results Output array where the report for each packet is stored.
+ * This can be a null pointer.
+ * \return The amount of packets in which every verified checksum is correct.
+ * \sa verify_checksums(const PacketView&)
+ */
+TINS_API uint32_t verify_checksums(const uint8_t* const* packets,
+                                   const uint32_t* packet_sizes,
+                                   uint32_t packet_count,
+                                   PDU::PDUType first_layer,
+                                   ChecksumReport* results);
+
+/**
+ * \cond
+ */
+namespace Internals {
+
+inline uint16_t view_read_be16(const uint8_t* ptr) {
+    return static_cast<uint16_t>((ptr[0] << 8) | ptr[1]);
+}
+
+inline uint32_t view_read_be32(const uint8_t* ptr) {
+    return (static_cast<uint32_t>(ptr[0]) << 24) | (static_cast<uint32_t>(ptr[1]) << 16) |
+           (static_cast<uint32_t>(ptr[2]) << 8) | ptr[3];
+}
+
+} // Internals
+/**
+ * \endcond
+ */
+
+/**
+ * \class EthernetIIView
+ * \brief Typed accessors for a PDU::ETHERNET_II LayerView.
+ *
+ * The wrapped layer must be of the right type and must not outlive
+ * the buffer it points to.
+ */
+class EthernetIIView {
+public:
+    /**
+     * \brief The hardware address type.
+     */
+    typedef HWAddress<6> address_type;
+
+    /**
+     * \brief Constructs an EthernetIIView.
+     *
+     * \param layer The layer to wrap.
+     */
+    explicit EthernetIIView(const LayerView& layer)
+    : ptr_(layer.data()) { }
+
+    /**
+     * \brief Getter for the destination's hardware address.
+     */
+    address_type dst_addr() const {
+        return address_type(ptr_);
+    }
+
+    /**
+     * \brief Getter for the source's hardware address.
+     */
+    address_type src_addr() const {
+        return address_type(ptr_ + 6);
+    }
+
+    /**
+     * \brief Getter for the payload type field.
+     */
+    uint16_t payload_type() const {
+        return Internals::view_read_be16(ptr_ + 12);
+    }
+private:
+    const uint8_t* ptr_;
+};
+
+/**
+ * \class IPView
+ * \brief Typed accessors for a PDU::IP LayerView.
+ *
+ * The wrapped layer must be of the right type and must not outlive
+ * the buffer it points to.
+ */
+class IPView {
+public:
+    /**
+     * \brief The address type.
+     */
+    typedef IPv4Address address_type;
+
+    /**
+     * \brief Constructs an IPView.
+     *
+     * \param layer The layer to wrap.
+     */
+    explicit IPView(const LayerView& layer)
+    : ptr_(layer.data()) { }
+
+    /**
+     * \brief Getter for the header length field.
+     */
+    uint8_t head_len() const {
+        return ptr_[0] & 0x0f;
+    }
+
+    /**
+     * \brief Getter for the type of service field.
+     */
+    uint8_t tos() const {
+        return ptr_[1];
+    }
+
+    /**
+     * \brief Getter for the total length field.
+     */
+    uint16_t tot_len() const {
+        return Internals::view_read_be16(ptr_ + 2);
+    }
+
+    /**
+     * \brief Getter for the id field.
+     */
+    uint16_t id() const {
+        return Internals::view_read_be16(ptr_ + 4);
+    }
+
+    /**
+     * \brief Getter for the fragment offset field.
+     *
+     * This will return the fragment offset field, as present in the packet,
+     * which indicates the offset of this fragment in blocks of 8 bytes.
+     */
+    uint16_t fragment_offset() const {
+        return Internals::view_read_be16(ptr_ + 6) & 0x1fff;
+    }
+
+    /**
+     * \brief Getter for the flags field, as in IP::Flags.
+     */
+    uint8_t flags() const {
+        return ptr_[6] >> 5;
+    }
+
+    /**
+     * \brief Getter for the time to live field.
+     */
+    uint8_t ttl() const {
+        return ptr_[8];
+    }
+
+    /**
+     * \brief Getter for the protocol field.
+     */
+    uint8_t protocol() const {
+        return ptr_[9];
+    }
+
+    /**
+     * \brief Getter for the checksum field.
+     */
+    uint16_t checksum() const {
+        return Internals::view_read_be16(ptr_ + 10);
+    }
+
+    /**
+     * \brief Getter for the source address field.
+     */
+    address_type src_addr() const {
+        return address_type(read_address(ptr_ + 12));
+    }
+
+    /**
+     * \brief Getter for the destination address field.
+     */
+    address_type dst_addr() const {
+        return address_type(read_address(ptr_ + 16));
+    }
+private:
+    static uint32_t read_address(const uint8_t* ptr) {
+        uint32_t output;
+        std::memcpy(&output, ptr, sizeof(output));
+        return output;
+    }
+
+    const uint8_t* ptr_;
+};
+
+/**
+ * \class IPv6View
+ * \brief Typed accessors for a PDU::IPv6 LayerView.
+ *
+ * The wrapped layer must be of the right type and must not outlive
+ * the buffer it points to.
+ */
+class IPv6View {
+public:
+    /**
+     * \brief The address type.
+     */
+    typedef IPv6Address address_type;
+
+    /**
+     * \brief Constructs an IPv6View.
+     *
+     * \param layer The layer to wrap.
+     */
+    explicit IPv6View(const LayerView& layer)
+    : ptr_(layer.data()) { }
+
+    /**
+     * \brief Getter for the traffic class field.
+     */
+    uint8_t traffic_class() const {
+        return static_cast<uint8_t>(((ptr_[0] & 0x0f) << 4) | (ptr_[1] >> 4));
+    }
+
+    /**
+     * \brief Getter for the flow label field.
+     */
+    uint32_t flow_label() const {
+        return ((ptr_[1] & 0x0f) << 16) | (ptr_[2] << 8) | ptr_[3];
+    }
+
+    /**
+     * \brief Getter for the payload length field.
+     */
+    uint16_t payload_length() const {
+        return Internals::view_read_be16(ptr_ + 4);
+    }
+
+    /**
+     * \brief Getter for the next header field.
+     */
+    uint8_t next_header() const {
+        return ptr_[6];
+    }
+
+    /**
+     * \brief Getter for the hop limit field.
+     */
+    uint8_t hop_limit() const {
+        return ptr_[7];
+    }
+
+    /**
+     * \brief Getter for the source address field.
+     */
+    address_type src_addr() const {
+        return address_type(ptr_ + 8);
+    }
+
+    /**
+     * \brief Getter for the destination address field.
+     */
+    address_type dst_addr() const {
+        return address_type(ptr_ + 24);
+    }
+private:
+    const uint8_t* ptr_;
+};
+
+/**
+ * \class TCPView
+ * \brief Typed accessors for a PDU::TCP LayerView.
+ *
+ * The wrapped layer must be of the right type and must not outlive
+ * the buffer it points to.
+ */
+class TCPView {
+public:
+    /**
+     * \brief Constructs a TCPView.
+     *
+     * \param layer The layer to wrap.
+     */
+    explicit TCPView(const LayerView& layer)
+    : ptr_(layer.data()) { }
+
+    /**
+     * \brief Getter for the source port field.
+     */
+    uint16_t sport() const {
+        return Internals::view_read_be16(ptr_);
+    }
+
+    /**
+     * \brief Getter for the destination port field.
+     */
+    uint16_t dport() const {
+        return Internals::view_read_be16(ptr_ + 2);
+    }
+
+    /**
+     * \brief Getter for the sequence number field.
+     */
+    uint32_t seq() const {
+        return Internals::view_read_be32(ptr_ + 4);
+    }
+
+    /**
+     * \brief Getter for the acknowledge number field.
+     */
+    uint32_t ack_seq() const {
+        return Internals::view_read_be32(ptr_ + 8);
+    }
+
+    /**
+     * \brief Getter for the data offset field.
+     */
+    uint8_t data_offset() const {
+        return ptr_[12] >> 4;
+    }
+
+    /**
+     * \brief Getter for the flags field, as in TCP::Flags.
+     */
+    uint8_t flags() const {
+        return ptr_[13];
+    }
+
+    /**
+     * \brief Check if the given flags are set.
+     *
+     * \param check_flags The flags to be checked, as in TCP::Flags.
+     */
+    bool has_flags(uint8_t check_flags) const {
+        return (flags() & check_flags) == check_flags;
+    }
+
+    /**
+     * \brief Getter for the window size field.
+     */
+    uint16_t window() const {
+        return Internals::view_read_be16(ptr_ + 14);
+    }
+
+    /**
+     * \brief Getter for the checksum field.
+     */
+    uint16_t checksum() const {
+        return Internals::view_read_be16(ptr_ + 16);
+    }
+
+    /**
+     * \brief Getter for the urgent pointer field.
+     */
+    uint16_t urg_ptr() const {
+        return Internals::view_read_be16(ptr_ + 18);
+    }
+private:
+    const uint8_t* ptr_;
+};
+
+/**
+ * \class UDPView
+ * \brief Typed accessors for a PDU::UDP LayerView.
+ *
+ * The wrapped layer must be of the right type and must not outlive
+ * the buffer it points to.
+ */
+class UDPView {
+public:
+    /**
+     * \brief Constructs a UDPView.
+     *
+     * \param layer The layer to wrap.
+     */
+    explicit UDPView(const LayerView& layer)
+    : ptr_(layer.data()) { }
+
+    /**
+     * \brief Getter for the source port field.
+     */
+    uint16_t sport() const {
+        return Internals::view_read_be16(ptr_);
+    }
+
+    /**
+     * \brief Getter for the destination port field.
+     */
+    uint16_t dport() const {
+        return Internals::view_read_be16(ptr_ + 2);
+    }
+
+    /**
+     * \brief Getter for the length field.
+     */
+    uint16_t length() const {
+        return Internals::view_read_be16(ptr_ + 4);
+    }
+
+    /**
+     * \brief Getter for the checksum field.
+     */
+    uint16_t checksum() const {
+        return Internals::view_read_be16(ptr_ + 6);
+    }
+private:
+    const uint8_t* ptr_;
+};
+
+} // Tins
+
+#endif // TINS_PACKET_VIEW_H
@@ -31,6 +31,7 @@
 #define TINS_PACKET_WRITER_H
 
 #include <string>
+#include <vector>
 #include <tins/macros.h>
 #include <tins/cxxstd.h>
 #include <tins/utils/pdu_utils.h>
@@ -220,6 +221,8 @@ private:
 
     pcap_t* handle_;
     pcap_dumper_t* dumper_; 
+    // Reused across writes so serializing doesn't allocate every time
+    std::vector<uint8_t> buffer_;
 };
 
 } // Tins
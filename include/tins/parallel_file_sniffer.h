@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+
+#ifndef TINS_PARALLEL_FILE_SNIFFER_H
+#define TINS_PARALLEL_FILE_SNIFFER_H
+
+#include <tins/config.h>
+#include <tins/cxxstd.h>
+
+#if defined(TINS_HAVE_PCAP) && !defined(_WIN32) && TINS_IS_CXX11
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include <tins/macros.h>
+#include <tins/packet.h>
+#include <tins/exceptions.h>
+#include <tins/pcap_file_reader.h>
+#include <tins/detail/type_traits.h>
+#include <tins/detail/pdu_helpers.h>
+
+namespace Tins {
+
+/**
+ * \class ParallelFileSniffer
+ * \brief Reads and decodes a pcap file using several threads.
+ *
+ * This is a multi threaded alternative to FileSniffer for processing
+ * large captures. A reader thread splits the file into batches of
+ * records, a pool of decoder threads turns each batch into Packets and
+ * the thread running the loop consumes them:
+ *
+ * \code
+ * ParallelFileSniffer sniffer("capture.pcap");
+ * sniffer.sniff_loop([&](Packet& packet) {
+ *     // ...
+ *     return true;
+ * });
+ * \endcode
+ *
+ * By default packets are delivered in the same order they're stored in
+ * the file. Using UNORDERED, batches are delivered as soon as they're
+ * decoded, which avoids waiting for slower batches. Packets inside a
+ * batch always keep their relative order.
+ *
+ * The amount of batches being read or decoded ahead of the consumer is
+ * bounded, so memory usage doesn't depend on the file's size. Threads
+ * are started by the first loop and keep running until the sniffer is
+ * destroyed, so a loop that is stopped can be resumed by starting
+ * another one. Frames that can't be decoded are skipped.
+ *
+ * The file is mapped into memory, so packets decoded using the flags
+ * described in BaseSniffer::set_decoding_flags can point to it for as
+ * long as the sniffer is alive.
+ *
+ * This class is only available when the library is built with C++11
+ * support.
+ */
+class TINS_API ParallelFileSniffer {
+public:
+    /**
+     * \brief The order in which packets are delivered.
+     */
+    enum DeliveryOrder {
+        ORDERED,
+        UNORDERED
+    };
+
+    /**
+     * \brief The default amount of records in each batch.
+     */
+    static const uint32_t DEFAULT_BATCH_SIZE;
+
+    /**
+     * \brief Constructs a ParallelFileSniffer.
+     *
+     * If the file can't be opened or it's not a pcap file, a pcap_error
+     * exception is thrown. If its link layer type is not supported, an
+     * unknown_link_type exception is thrown.
+     *
+     * \param file_name The pcap file to be read.
+     * \param thread_count The amount of decoder threads. If this is 0,
+     * one per hardware thread is used.
+     * \param order The order in which packets are delivered.
+     */
+    explicit ParallelFileSniffer(const std::string& file_name,
+                                 uint32_t thread_count = 0,
+                                 DeliveryOrder order = ORDERED);
+
+    /**
+     * \brief Destructor.
+     *
+     * Stops and joins every thread.
+     */
+    ~ParallelFileSniffer();
+
+    /**
+     * \brief Starts a loop which calls a functor for every packet in
+     * the file.
+     *
+     * The functor is called on the thread calling this method and can
+     * take the same arguments BaseSniffer::sniff_loop allows. The loop
+     * stops when max_packets packets are processed (if it is != 0), when
+     * the functor returns false or when the end of the file is reached.
+     *
+     * If a decoder thread fails with an exception other than
+     * malformed_packet, it's rethrown here.
+     *
+     * \param function The callback handler object which should process packets.
+     * \param max_packets The maximum amount of packets to process. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_loop(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Starts a loop which calls a functor for every batch of
+     * packets.
+     *
+     * The functor is called with a std::vector<Packet>& that it can
+     * modify, for example by moving packets out of it. The loop stops
+     * when the functor returns false or when the end of the file is
+     * reached.
+     *
+     * \param function The callback handler object which should process batches.
+     * \sa BaseSniffer::sniff_batches
+     */
+    template <typename Functor>
+    void sniff_batches(Functor function);
+
+    /**
+     * \brief Sets the amount of records in each batch.
+     *
+     * This must be called before the first loop is started.
+     *
+     * \param size The amount of records in each batch.
+     */
+    void set_batch_size(uint32_t size);
+
+    /**
+     * \brief Retrieves the amount of records in each batch.
+     */
+    uint32_t batch_size() const;
+
+    /**
+     * \brief Sets whether to extract RawPDUs or fully parsed packets.
+     *
+     * This must be called before the first loop is started.
+     *
+     * \param value Whether to extract RawPDUs or not.
+     * \sa BaseSniffer::set_extract_raw_pdus
+     */
+    void set_extract_raw_pdus(bool value);
+
+    /**
+     * \brief Sets the flags used when decoding packets.
+     *
+     * This must be called before the first loop is started.
+     *
+     * \param flags The decoding flags to be used.
+     * \sa BaseSniffer::set_decoding_flags
+     */
+    void set_decoding_flags(uint32_t flags);
+
+    /**
+     * \brief Retrieves the flags used when decoding packets.
+     */
+    uint32_t decoding_flags() const;
+
+    /**
+     * \brief Retrieves the amount of decoder threads.
+     */
+    uint32_t thread_count() const;
+
+    /**
+     * \brief Retrieves the order in which packets are delivered.
+     */
+    DeliveryOrder delivery_order() const;
+
+    /**
+     * \brief Retrieves the file's link layer type.
+     *
+     * This is a DLT_* value, as returned by BaseSniffer::link_type.
+     */
+    int link_type() const;
+private:
+    class pipeline;
+
+    ParallelFileSniffer(const ParallelFileSniffer&);
+    ParallelFileSniffer& operator=(const ParallelFileSniffer&);
+
+    bool next_batch(std::vector<Packet>& output);
+
+    PcapFileReader reader_;
+    pipeline* pipeline_;
+    Internals::frame_decoder frame_decoder_;
+    // The batch being consumed by sniff_loop, which can stop halfway
+    std::vector<Packet> current_batch_;
+    size_t current_index_;
+    uint32_t thread_count_;
+    uint32_t batch_size_;
+    uint32_t decoding_flags_;
+    DeliveryOrder order_;
+};
+
+template <typename Functor>
+void ParallelFileSniffer::sniff_loop(Functor function, uint32_t max_packets) {
+    while (true) {
+        if (current_index_ >= current_batch_.size()) {
+            current_index_ = 0;
+            if (!next_batch(current_batch_)) {
+                return;
+            }
+        }
+        Packet& packet = current_batch_[current_index_++];
+        try {
+            // If the functor returns false, we're done
+            #if !defined(_MSC_VER)
+            if (!Internals::invoke_loop_cb(function, packet)) {
+                return;
+            }
+            #else
+            if (!function(*packet.pdu())) {
+                return;
+            }
+            #endif
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+        if (max_packets && --max_packets == 0) {
+            return;
+        }
+    }
+}
+
+template <typename Functor>
+void ParallelFileSniffer::sniff_batches(Functor function) {
+    while (true) {
+        // Packets left by a previous sniff_loop go first
+        if (current_index_ >= current_batch_.size()) {
+            current_index_ = 0;
+            if (!next_batch(current_batch_)) {
+                return;
+            }
+        }
+        else if (current_index_ > 0) {
+            current_batch_.erase(current_batch_.begin(),
+                                 current_batch_.begin() + current_index_);
+        }
+        current_index_ = current_batch_.size();
+        bool keep_going = true;
+        try {
+            keep_going = function(current_batch_);
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+        // The functor may have changed the batch, it's consumed anyway
+        current_index_ = current_batch_.size();
+        // If the functor returns false, we're done
+        if (!keep_going) {
+            return;
+        }
+    }
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && !_WIN32 && TINS_IS_CXX11
+
+#endif // TINS_PARALLEL_FILE_SNIFFER_H
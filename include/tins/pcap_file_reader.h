@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+
+#ifndef TINS_PCAP_FILE_READER_H
+#define TINS_PCAP_FILE_READER_H
+
+#include <tins/config.h>
+
+#if defined(TINS_HAVE_PCAP) && !defined(_WIN32)
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+#include <tins/macros.h>
+#include <tins/packet.h>
+#include <tins/cxxstd.h>
+#include <tins/timestamp.h>
+#include <tins/exceptions.h>
+#include <tins/detail/type_traits.h>
+#include <tins/detail/pdu_helpers.h>
+
+namespace Tins {
+
+/**
+ * \class PcapFileReader
+ * \brief Reads pcap files by mapping them into memory.
+ *
+ * This is an alternative to FileSniffer which doesn't go through
+ * libpcap. The file is mapped into memory and its records are read in
+ * place, so each packet's data is never copied before being decoded.
+ * Both microsecond and nanosecond resolution files, using either byte
+ * order, can be read. Only the classic pcap format is supported.
+ *
+ * Records can be read without decoding them, which allows using
+ * PacketView or classify on them directly:
+ *
+ * \code
+ * PcapFileReader reader("capture.pcap");
+ * PcapFileReader::record record;
+ * while (reader.next_record(record)) {
+ *     PacketClassification layers = classify(record.buffer, record.size,
+ *                                            reader.link_type());
+ *     // ...
+ * }
+ * \endcode
+ *
+ * Since the whole file stays mapped while the reader exists, packets
+ * decoded using DecodingScope::LAZY_INNER_PDUS,
+ * DecodingScope::BORROWED_PAYLOADS or DecodingScope::LAZY_OPTIONS remain
+ * valid until the reader is destroyed, rather than only until the next
+ * packet is read as is the case for sniffers.
+ *
+ * A truncated record ends the file, as the bytes that follow it can't
+ * be trusted.
+ */
+class TINS_API PcapFileReader {
+public:
+    /**
+     * \brief A record in the file.
+     *
+     * The buffer points into the mapped file.
+     */
+    struct record {
+        const uint8_t* buffer;
+        uint32_t size;
+        uint32_t original_size;
+        Timestamp timestamp;
+
+        record()
+        : buffer(0), size(0), original_size(0) {
+
+        }
+    };
+
+    /**
+     * \brief Constructs a PcapFileReader.
+     *
+     * If the file can't be opened or it's not a pcap file, a pcap_error
+     * exception is thrown.
+     *
+     * \param file_name The pcap file to be read.
+     */
+    explicit PcapFileReader(const std::string& file_name);
+
+    /**
+     * \brief Destructor.
+     *
+     * Unmaps the file.
+     */
+    ~PcapFileReader();
+
+    /**
+     * \brief Reads the next record without decoding it.
+     *
+     * \param output The record in which the next record will be stored.
+     * \return false if there are no more records in the file.
+     */
+    bool next_record(record& output);
+
+    /**
+     * \brief Reads and decodes the next packet.
+     *
+     * Records that can't be decoded are skipped. The returned packet is
+     * empty once the end of the file is reached. Caller takes ownership
+     * of the PDU pointer stored in the PtrPacket.
+     *
+     * \sa BaseSniffer::next_packet
+     */
+    PtrPacket next_packet();
+
+    /**
+     * \brief Starts a loop which calls a functor for every packet in
+     * the file.
+     *
+     * The functor can take the same arguments BaseSniffer::sniff_loop
+     * allows. The loop stops when max_packets packets are read (if it is
+     * != 0), when the functor returns false or when the end of the file
+     * is reached.
+     *
+     * \param function The callback handler object which should process packets.
+     * \param max_packets The maximum amount of packets to read. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_loop(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Goes back to the file's first record.
+     */
+    void rewind();
+
+    /**
+     * \brief Sets whether to extract RawPDUs or fully parsed packets.
+     * \param value Whether to extract RawPDUs or not.
+     * \sa BaseSniffer::set_extract_raw_pdus
+     */
+    void set_extract_raw_pdus(bool value);
+
+    /**
+     * \brief Sets the flags used when decoding packets.
+     * \param flags The decoding flags to be used.
+     * \sa BaseSniffer::set_decoding_flags
+     */
+    void set_decoding_flags(uint32_t flags);
+
+    /**
+     * \brief Retrieves the flags used when decoding packets.
+     */
+    uint32_t decoding_flags() const;
+
+    /**
+     * \brief Retrieves the file's link layer type.
+     *
+     * This is a DLT_* value, as returned by BaseSniffer::link_type.
+     */
+    int link_type() const;
+
+    /**
+     * \brief Retrieves the file's snapshot length.
+     */
+    uint32_t snap_len() const;
+
+    /**
+     * \brief Indicates whether the file's timestamps have nanosecond
+     * resolution.
+     *
+     * Timestamps are truncated to microseconds when read.
+     */
+    bool nanosecond_precision() const;
+private:
+    PcapFileReader(const PcapFileReader&);
+    PcapFileReader& operator=(const PcapFileReader&);
+
+    void open(const std::string& file_name);
+    void close();
+    uint32_t read_field(const uint8_t* buffer) const;
+    Internals::frame_decoder resolve_frame_decoder();
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t offset_;
+    int link_type_;
+    uint32_t snap_len_;
+    bool nanosecond_precision_;
+    bool swapped_;
+    bool extract_raw_;
+    uint32_t decoding_flags_;
+    Internals::frame_decoder frame_decoder_;
+};
+
+template <typename Functor>
+void PcapFileReader::sniff_loop(Functor function, uint32_t max_packets) {
+    while (true) {
+        Packet packet(next_packet());
+        if (!packet) {
+            return;
+        }
+        try {
+            // If the functor returns false, we're done
+            #if TINS_IS_CXX11 && !defined(_MSC_VER)
+            if (!Internals::invoke_loop_cb(function, packet)) {
+                return;
+            }
+            #else
+            if (!function(*packet.pdu())) {
+                return;
+            }
+            #endif
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+        if (max_packets && --max_packets == 0) {
+            return;
+        }
+    }
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && !_WIN32
+
+#endif // TINS_PCAP_FILE_READER_H
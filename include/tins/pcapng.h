@@ -0,0 +1,481 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+
+#ifndef TINS_PCAPNG_H
+#define TINS_PCAPNG_H
+
+#include <tins/config.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <tins/macros.h>
+#include <tins/packet.h>
+#include <tins/cxxstd.h>
+#include <tins/timestamp.h>
+#include <tins/exceptions.h>
+#include <tins/data_link_type.h>
+#include <tins/detail/type_traits.h>
+#include <tins/detail/pdu_helpers.h>
+
+namespace Tins {
+
+/**
+ * \brief Describes an interface in a pcapng file.
+ */
+struct TINS_API PcapngInterface {
+    /**
+     * The interface's link layer type, as a DLT_* value.
+     */
+    int link_type;
+
+    /**
+     * The interface's snapshot length. 0 means no limit.
+     */
+    uint32_t snap_len;
+
+    /**
+     * \brief The resolution of the interface's timestamps.
+     *
+     * This uses the if_tsresol option's encoding: if the most significant
+     * bit is clear, timestamps are in units of 10^-value seconds,
+     * otherwise they're in units of 2^-(value & 0x7f) seconds. 6 means
+     * microseconds and 9 means nanoseconds.
+     */
+    uint8_t timestamp_resolution;
+
+    /**
+     * The interface's name. This is empty if it's not present.
+     */
+    std::string name;
+
+    /**
+     * The interface's comment. This is empty if it's not present.
+     */
+    std::string comment;
+
+    /**
+     * \brief Constructs a PcapngInterface.
+     *
+     * \param link_type The link layer type, as a DLT_* value.
+     * \param snap_len The snapshot length.
+     * \param timestamp_resolution The resolution of the timestamps, using
+     * the if_tsresol option's encoding.
+     */
+    PcapngInterface(int link_type = 0, uint32_t snap_len = 0,
+                    uint8_t timestamp_resolution = 9)
+    : link_type(link_type), snap_len(snap_len),
+      timestamp_resolution(timestamp_resolution) {
+
+    }
+};
+
+/**
+ * \brief A packet stored in a pcapng file.
+ */
+struct TINS_API PcapngRecord {
+    /**
+     * The packet's data.
+     */
+    const uint8_t* buffer;
+
+    /**
+     * The amount of bytes in the buffer.
+     */
+    uint32_t size;
+
+    /**
+     * The packet's size on the wire. If this is 0 when writing, size is used.
+     */
+    uint32_t original_size;
+
+    /**
+     * The index of the interface the packet was captured on.
+     */
+    uint32_t interface_id;
+
+    /**
+     * The packet's timestamp, in nanoseconds since the epoch.
+     */
+    uint64_t nanoseconds;
+
+    /**
+     * The packet's epb_flags option, which contains its direction,
+     * reception type and link layer errors. 0 if it's not present.
+     */
+    uint32_t flags;
+
+    /**
+     * The packet's comment. This is empty if it's not present.
+     */
+    std::string comment;
+
+    PcapngRecord()
+    : buffer(0), size(0), original_size(0), interface_id(0), nanoseconds(0), flags(0) {
+
+    }
+
+    /**
+     * \brief Constructs a PcapngRecord.
+     *
+     * \param buffer The packet's data.
+     * \param size The amount of bytes in the buffer.
+     * \param interface_id The index of the interface the packet was captured on.
+     * \param nanoseconds The packet's timestamp, in nanoseconds since the epoch.
+     */
+    PcapngRecord(const uint8_t* buffer, uint32_t size, uint32_t interface_id,
+                 uint64_t nanoseconds)
+    : buffer(buffer), size(size), original_size(size), interface_id(interface_id),
+      nanoseconds(nanoseconds), flags(0) {
+
+    }
+
+    /**
+     * \brief Returns the packet's timestamp.
+     *
+     * Timestamps only have microsecond resolution, so the nanoseconds
+     * are truncated.
+     */
+    Timestamp timestamp() const;
+};
+
+/**
+ * \class PcapngReader
+ * \brief Reads pcapng files.
+ *
+ * Section header, interface description, enhanced packet and simple
+ * packet blocks are understood. Any other block is skipped. Each
+ * interface keeps its own link layer type and timestamp resolution, and
+ * timestamps are provided with nanosecond resolution.
+ *
+ * The file is read sequentially through a buffer, so it can be of any
+ * size and doesn't need to be seekable. The data pointed to by records
+ * returned by PcapngReader::next_record, as well as packets decoded using
+ * the decoding flags described in BaseSniffer::set_decoding_flags, are
+ * only valid until the next block is read.
+ *
+ * \code
+ * PcapngReader reader("capture.pcapng");
+ * PcapngRecord record;
+ * while (reader.next_record(record)) {
+ *     const PcapngInterface& iface = reader.interfaces()[record.interface_id];
+ *     // ...
+ * }
+ * \endcode
+ *
+ * A truncated or corrupted block ends the file.
+ */
+class TINS_API PcapngReader {
+public:
+    /**
+     * \brief Constructs a PcapngReader.
+     *
+     * If the file can't be opened or it's not a pcapng file, a pcap_error
+     * exception is thrown.
+     *
+     * \param file_name The pcapng file to be read.
+     */
+    explicit PcapngReader(const std::string& file_name);
+
+    /**
+     * \brief Destructor.
+     *
+     * Closes the file.
+     */
+    ~PcapngReader();
+
+    /**
+     * \brief Reads the next packet without decoding it.
+     *
+     * \param output The record in which the packet will be stored.
+     * \return false if there are no more packets in the file.
+     */
+    bool next_record(PcapngRecord& output);
+
+    /**
+     * \brief Reads and decodes the next packet.
+     *
+     * Packets are decoded using the link layer type of the interface
+     * they were captured on. Packets captured on interfaces using an
+     * unsupported link layer type are provided as RawPDUs, while the ones
+     * that can't be decoded are skipped. The returned packet is empty once
+     * the end of the file is reached. Caller takes ownership of the PDU
+     * pointer stored in the PtrPacket.
+     *
+     * \sa BaseSniffer::next_packet
+     */
+    PtrPacket next_packet();
+
+    /**
+     * \brief Starts a loop which calls a functor for every packet in
+     * the file.
+     *
+     * The functor can take the same arguments BaseSniffer::sniff_loop
+     * allows. The loop stops when max_packets packets are read (if it is
+     * != 0), when the functor returns false or when the end of the file
+     * is reached.
+     *
+     * \param function The callback handler object which should process packets.
+     * \param max_packets The maximum amount of packets to read. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_loop(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Retrieves the interfaces described in the current section.
+     *
+     * Interfaces are added as their description blocks are read, so
+     * this contains at least the interface of every packet read so far.
+     */
+    const std::vector<PcapngInterface>& interfaces() const;
+
+    /**
+     * \brief Retrieves the current section's comment.
+     */
+    const std::string& section_comment() const;
+
+    /**
+     * \brief Sets whether to extract RawPDUs or fully parsed packets.
+     * \param value Whether to extract RawPDUs or not.
+     * \sa BaseSniffer::set_extract_raw_pdus
+     */
+    void set_extract_raw_pdus(bool value);
+
+    /**
+     * \brief Sets the flags used when decoding packets.
+     * \param flags The decoding flags to be used.
+     * \sa BaseSniffer::set_decoding_flags
+     */
+    void set_decoding_flags(uint32_t flags);
+
+    /**
+     * \brief Retrieves the flags used when decoding packets.
+     */
+    uint32_t decoding_flags() const;
+private:
+    PcapngReader(const PcapngReader&);
+    PcapngReader& operator=(const PcapngReader&);
+
+    bool read_block(uint32_t& type);
+    bool parse_section_header();
+    void parse_interface_description();
+    bool parse_enhanced_packet(PcapngRecord& output);
+    bool parse_simple_packet(PcapngRecord& output);
+    bool next_option(const uint8_t*& ptr, const uint8_t* end, uint16_t& code,
+                     const uint8_t*& value, uint16_t& length) const;
+    uint16_t read_16(const uint8_t* buffer) const;
+    uint32_t read_32(const uint8_t* buffer) const;
+
+    std::FILE* file_;
+    std::vector<uint8_t> block_;
+    std::vector<PcapngInterface> interfaces_;
+    std::vector<Internals::frame_decoder> decoders_;
+    std::vector<int64_t> timestamp_offsets_;
+    std::string section_comment_;
+    bool swapped_;
+    bool extract_raw_;
+    uint32_t decoding_flags_;
+};
+
+/**
+ * \class PcapngWriter
+ * \brief Writes packets to a pcapng file.
+ *
+ * Packets captured on several interfaces, each one having its own link
+ * layer type, can be written to the same file. Interfaces are added
+ * using PcapngWriter::add_interface and then referred to by the index
+ * it returns:
+ *
+ * \code
+ * PcapngWriter writer("merged.pcapng");
+ * uint32_t eth = writer.add_interface(DataLinkType<EthernetII>());
+ * uint32_t wifi = writer.add_interface(DataLinkType<RadioTap>());
+ * writer.write(eth, ethernet_packet);
+ * writer.write(wifi, radiotap_packet);
+ * \endcode
+ *
+ * Blocks are stored in a buffer and written to the file once it's full,
+ * when PcapngWriter::flush is called or when the writer is destroyed.
+ *
+ * Errors writing to the file are reported by throwing pcap_error.
+ */
+class TINS_API PcapngWriter {
+public:
+    /**
+     * \brief The default size of the buffer blocks are stored in.
+     *
+     * This is 1MB by default.
+     */
+    static const uint32_t DEFAULT_BUFFER_SIZE;
+
+    /**
+     * \brief Constructs a PcapngWriter.
+     *
+     * The section header block is buffered right away. If the file can't
+     * be opened, a pcap_error exception is thrown.
+     *
+     * \param file_name The file in which to store the packets.
+     * \param section_comment The section's comment. Nothing is stored if
+     * this is empty.
+     * \param buffer_size The size of the buffer blocks are stored in.
+     */
+    explicit PcapngWriter(const std::string& file_name,
+                          const std::string& section_comment = std::string(),
+                          uint32_t buffer_size = DEFAULT_BUFFER_SIZE);
+
+    /**
+     * \brief Destructor.
+     *
+     * Writes any buffered block and closes the file.
+     */
+    ~PcapngWriter();
+
+    /**
+     * \brief Adds an interface.
+     *
+     * \param iface The interface's description.
+     * \return The index of the interface, to be used when writing packets.
+     */
+    uint32_t add_interface(const PcapngInterface& iface);
+
+    /**
+     * \brief Adds an interface having the given link layer type.
+     *
+     * Timestamps are stored with nanosecond resolution and there's no
+     * snapshot length.
+     *
+     * \param lt A DataLinkType that represents the link layer protocol.
+     * \return The index of the interface, to be used when writing packets.
+     */
+    template <typename T>
+    uint32_t add_interface(const DataLinkType<T>& lt) {
+        return add_interface(PcapngInterface(lt.get_type()));
+    }
+
+    /**
+     * \brief Writes a packet as an enhanced packet block.
+     *
+     * If the record's interface hasn't been added, an invalid_interface
+     * exception is thrown.
+     *
+     * \param record The packet to be written.
+     */
+    void write(const PcapngRecord& record);
+
+    /**
+     * \brief Writes a Packet as an enhanced packet block.
+     *
+     * The timestamp used is the one associated with the packet.
+     *
+     * \param interface_id The index of the interface the packet was captured on.
+     * \param packet The packet to be written.
+     */
+    void write(uint32_t interface_id, Packet& packet);
+
+    /**
+     * \brief Writes a PDU as an enhanced packet block.
+     *
+     * The current time is used as the packet's timestamp.
+     *
+     * \param interface_id The index of the interface the packet was captured on.
+     * \param pdu The PDU to be written.
+     */
+    void write(uint32_t interface_id, PDU& pdu);
+
+    /**
+     * \brief Writes a packet as a simple packet block.
+     *
+     * Simple packet blocks don't store a timestamp and always belong to
+     * the first interface, which must have been added. This is the most
+     * compact way of storing packets.
+     *
+     * \param buffer The packet's data.
+     * \param size The amount of bytes in the buffer.
+     * \param original_size The packet's size on the wire. If this is 0,
+     * size is used.
+     */
+    void write_simple(const uint8_t* buffer, uint32_t size, uint32_t original_size = 0);
+
+    /**
+     * \brief Writes every buffered block to the file.
+     */
+    void flush();
+private:
+    PcapngWriter(const PcapngWriter&);
+    PcapngWriter& operator=(const PcapngWriter&);
+
+    void write(uint32_t interface_id, PDU& pdu, uint64_t nanoseconds);
+    size_t start_block(uint32_t type);
+    void finish_block(size_t start);
+
+    std::FILE* file_;
+    std::vector<uint8_t> buffer_;
+    uint32_t buffer_size_;
+    std::vector<uint8_t> timestamp_resolutions_;
+    std::vector<uint32_t> snap_lens_;
+    // Reused across writes so serializing doesn't allocate every time
+    std::vector<uint8_t> serialization_buffer_;
+};
+
+template <typename Functor>
+void PcapngReader::sniff_loop(Functor function, uint32_t max_packets) {
+    while (true) {
+        Packet packet(next_packet());
+        if (!packet) {
+            return;
+        }
+        try {
+            // If the functor returns false, we're done
+            #if TINS_IS_CXX11 && !defined(_MSC_VER)
+            if (!Internals::invoke_loop_cb(function, packet)) {
+                return;
+            }
+            #else
+            if (!function(*packet.pdu())) {
+                return;
+            }
+            #endif
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+        if (max_packets && --max_packets == 0) {
+            return;
+        }
+    }
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
+
+#endif // TINS_PCAPNG_H
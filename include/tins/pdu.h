@@ -32,10 +32,13 @@
 
 
 #include <stdint.h>
+#include <new>
 #include <vector>
 #include <tins/macros.h>
 #include <tins/cxxstd.h>
 #include <tins/exceptions.h>
+#include <tins/detail/pdu_pool.h>
+#include <tins/detail/ref_count.h>
 
 /** \brief The Tins namespace.
  */
@@ -44,6 +47,10 @@ namespace Tins {
 class PacketSender;
 class NetworkInterface;
 
+namespace Internals {
+    class LayerIndex;
+}
+
 /**
  * The type used to store several PDU option values.
  */
@@ -231,11 +238,13 @@ public:
          * \param rhs The PDU to be moved.
          */
         PDU(PDU &&rhs) TINS_NOEXCEPT 
-        : inner_pdu_(0), parent_pdu_(0) {
+        : inner_pdu_(0), parent_pdu_(0), lazy_inner_pdu_(), layer_index_(0) {
             std::swap(inner_pdu_, rhs.inner_pdu_);
+            std::swap(lazy_inner_pdu_, rhs.lazy_inner_pdu_);
             if (inner_pdu_) {
                 inner_pdu_->parent_pdu(this);
             }
+            rhs.invalidate_layer_index();
         }
         
         /**
@@ -246,10 +255,14 @@ public:
         PDU& operator=(PDU &&rhs) TINS_NOEXCEPT {
             delete inner_pdu_;
             inner_pdu_ = 0;
+            lazy_inner_pdu_ = lazy_inner_pdu();
             std::swap(inner_pdu_, rhs.inner_pdu_);
+            std::swap(lazy_inner_pdu_, rhs.lazy_inner_pdu_);
             if (inner_pdu_) {
                 inner_pdu_->parent_pdu(this);
             }
+            invalidate_layer_index();
+            rhs.invalidate_layer_index();
             return* this;
         }
     #endif
@@ -262,6 +275,62 @@ public:
      */
     virtual ~PDU();
 
+    #ifdef TINS_HAVE_PDU_POOL
+        /**
+         * \brief Allocates the memory used by a PDU object.
+         *
+         * PDUs are allocated from per thread pools, so decoding packets
+         * doesn't go through the general purpose allocator for every
+         * layer of every packet once the pools are warmed up.
+         */
+        static void* operator new(size_t size) {
+            return Internals::PDUPool::allocate(size);
+        }
+
+        /**
+         * \brief Non throwing new operator.
+         *
+         * Returns a null pointer if the memory can't be allocated.
+         */
+        static void* operator new(size_t size, const std::nothrow_t&) throw() {
+            try {
+                return Internals::PDUPool::allocate(size);
+            }
+            catch (std::bad_alloc&) {
+                return 0;
+            }
+        }
+
+        /**
+         * \brief Placement new operator.
+         */
+        static void* operator new(size_t, void* ptr) {
+            return ptr;
+        }
+
+        /**
+         * \brief Releases the memory used by a PDU object.
+         */
+        static void operator delete(void* ptr) {
+            Internals::PDUPool::deallocate(ptr);
+        }
+
+        /**
+         * \brief Releases memory allocated by the non throwing new operator.
+         *
+         * This is only used if a constructor throws.
+         */
+        static void operator delete(void* ptr, const std::nothrow_t&) throw() {
+            Internals::PDUPool::deallocate(ptr);
+        }
+
+        /**
+         * \brief Placement delete operator.
+         */
+        static void operator delete(void*, void*) {
+        }
+    #endif // TINS_HAVE_PDU_POOL
+
     /** \brief The header's size
      */
     virtual uint32_t header_size() const = 0;
@@ -282,9 +351,18 @@ public:
 
     /**
      * \brief Getter for the inner PDU.
+     *
+     * If this PDU was constructed using DecodingScope::LAZY_INNER_PDUS,
+     * the inner PDU is decoded the first time this method is called. 
+     * Since this modifies the PDU, concurrent calls on the same object
+     * must be synchronized.
+     *
      * \return The current inner PDU. Might be a null pointer.
      */
     PDU* inner_pdu() const {
+        if (TINS_UNLIKELY(lazy_inner_pdu_.decoder != 0)) {
+            decode_inner_pdu();
+        }
         return inner_pdu_;
     }
 
@@ -341,34 +419,63 @@ public:
      */
     serialization_type serialize();
 
+    /**
+     * \brief Serializes the whole chain of PDUs into the provided buffer.
+     *
+     * The buffer is only resized if it's smaller than size(), so reusing
+     * the same buffer across calls avoids allocating memory for every
+     * packet. Note that the buffer can be larger than the serialized
+     * PDU after this call, so the returned value should be used as its
+     * length.
+     *
+     * \param buffer The buffer in which to store the serialization.
+     * \return The amount of bytes written.
+     */
+    uint32_t serialize(serialization_type& buffer);
+
+    /**
+     * \brief Serializes the whole chain of PDUs into the provided buffer.
+     *
+     * If the buffer is smaller than size(), serialization_error is thrown.
+     *
+     * \param buffer The buffer in which to store the serialization.
+     * \param total_sz The size of the buffer.
+     * \return The amount of bytes written.
+     */
+    uint32_t serialize_into(uint8_t* buffer, uint32_t total_sz);
+
     /**
      * \brief Finds and returns the first PDU that matches the given flag.
      *
      * This method searches for the first PDU which has the same type flag as
      * the given one. If the first PDU matches that flag, it is returned.
      * If no PDU matches, 0 is returned.
+     *
+     * The first lookup builds an index of the layers below this PDU, so
+     * subsequent lookups take constant time. The index is rebuilt after
+     * the chain is modified. Since this modifies the PDU, it must not be
+     * called by several threads at once on the same PDU. Use the const
+     * overload for that, as Packets sharing a PDU do.
+     *
      * \param flag The flag which being searched.
      */
     template<typename T> 
     T* find_pdu(PDUType type = T::pdu_flag) {
-        PDU* pdu = this;
-        while (pdu) {
-            if (pdu->matches_flag(type)) {
-                return static_cast<T*>(pdu);
-            }
-            pdu = pdu->inner_pdu();
-        }
-        return 0;
+        return static_cast<T*>(find_layer(type));
     }
     
     /**
      * \brief Finds and returns the first PDU that matches the given flag.
      *
+     * This overload doesn't build the layer index, so it can be safely
+     * used by several threads at once. It will use the index if it was 
+     * already built by a previous lookup.
+     *
      * \param flag The flag which being searched.
      */
     template<typename T> 
     const T* find_pdu(PDUType type = T::pdu_flag) const {
-        return const_cast<PDU*>(this)->find_pdu<T>(type);
+        return static_cast<const T*>(find_layer(type));
     }
 
     /**
@@ -396,7 +503,11 @@ public:
      */
     template<typename T> 
     const T& rfind_pdu(PDUType type = T::pdu_flag) const {
-        return const_cast<PDU*>(this)->rfind_pdu<T>(type);
+        const T* ptr = find_pdu<T>(type);
+        if (!ptr) {
+            throw pdu_not_found();
+        }
+        return* ptr;
     }
 
     /**
@@ -485,6 +596,34 @@ protected:
      */
     void copy_inner_pdu(const PDU& pdu);
 
+    /**
+     * \brief The type of the functions used to decode inner PDUs.
+     *
+     * The identifier is the value which was used to determine the inner
+     * PDU's protocol, e.g. an Ethernet type or an IP protocol number.
+     */
+    typedef PDU* (*inner_pdu_decoder)(uint32_t identifier, const uint8_t* buffer,
+                                      uint32_t total_sz);
+
+    /**
+     * \brief Sets the child PDU, decoding it from the given buffer.
+     *
+     * The decoder is called right away unless the calling thread is 
+     * using the DecodingScope::LAZY_INNER_PDUS flag. In that case, 
+     * the buffer is only recorded and the decoder is called the first time
+     * the inner PDU is accessed.
+     *
+     * If the DecodingScope::MALFORMED_INNER_PDUS_AS_RAW flag is in use,
+     * an inner PDU which can't be decoded is stored as a RawPDU.
+     *
+     * \param decoder The function used to decode the inner PDU.
+     * \param identifier The identifier that will be passed to the decoder.
+     * \param buffer The buffer that contains the inner PDU.
+     * \param total_sz The size of the inner PDU's buffer.
+     */
+    void inner_pdu(inner_pdu_decoder decoder, uint32_t identifier,
+                   const uint8_t* buffer, uint32_t total_sz);
+
     /**
      * \brief Prepares this PDU for serialization.
      * 
@@ -498,6 +637,18 @@ protected:
      */
     virtual void prepare_for_serialize();
 
+    /**
+     * \brief Finishes any parsing that was deferred while decoding.
+     *
+     * This method is called before a PDU is shared by several Packets.
+     * Afterwards, const methods must neither modify the PDU nor refer
+     * to the buffer it was decoded from, since several threads may call
+     * them at once.
+     *
+     * By default, this method does nothing
+     */
+    virtual void finish_lazy_parsing() const;
+
     /** 
      * \brief Serializes this PDU and propagates this action to child PDUs.
      *
@@ -516,10 +667,44 @@ protected:
      */
     virtual void write_serialization(uint8_t* buffer, uint32_t total_sz) = 0;
 private:
-    void parent_pdu(PDU* parent);
+    #if TINS_IS_CXX11
+    // StaticStack serializes its layers without going through PDU::serialize
+    template <typename... Layers>
+    friend class StaticStack;
+    #endif // TINS_IS_CXX11
+    // Packets share PDUs using share_count_
+    friend class Packet;
+
+    struct lazy_inner_pdu {
+        lazy_inner_pdu()
+        : decoder(0), buffer(0), total_sz(0), identifier(0), flags(0) {
+
+        }
 
-    PDU* inner_pdu_;
+        inner_pdu_decoder decoder;
+        const uint8_t* buffer;
+        uint32_t total_sz;
+        uint16_t identifier;
+        uint16_t flags;
+    };
+
+    static PDU* decode_or_raw(inner_pdu_decoder decoder, uint32_t identifier,
+                              const uint8_t* buffer, uint32_t total_sz);
+
+    void parent_pdu(PDU* parent);
+    void decode_inner_pdu() const;
+    PDU* find_layer(PDUType type);
+    const PDU* find_layer(PDUType type) const;
+    static PDU* find_layer_in_chain(const PDU* pdu, PDUType type);
+    void build_layer_index() const;
+    void invalidate_layer_index() const;
+    void prepare_for_sharing() const;
+
+    mutable PDU* inner_pdu_;
     PDU* parent_pdu_;
+    mutable lazy_inner_pdu lazy_inner_pdu_;
+    mutable Internals::LayerIndex* layer_index_;
+    mutable Internals::ref_count share_count_;
 };
 
 /**
@@ -30,8 +30,12 @@
 #ifndef TINS_PDU_ALLOCATOR_H
 #define TINS_PDU_ALLOCATOR_H
 
-#include <map>
+#include <stddef.h>
 #include <tins/pdu.h>
+#include <tins/cxxstd.h>
+#if TINS_IS_CXX11
+    #include <atomic>
+#endif // TINS_IS_CXX11
 
 namespace Tins {
 /**
@@ -51,45 +55,102 @@ PDU* default_allocator(const uint8_t* buffer, uint32_t size) {
     return new PDUType(buffer, size);
 }
 
+/**
+ * Flat table which maps protocol identifiers to allocators.
+ *
+ * Identifiers are stored in an open addressed table, which for 8 bit 
+ * identifiers degenerates into a directly indexed array. Lookups don't
+ * take any locks, so allocators can be registered while other threads
+ * are decoding packets (when building using C++11).
+ */
+class TINS_API PDUAllocatorTable {
+public:
+    typedef PDU *(*allocator_type)(const uint8_t *, uint32_t);
+
+    /**
+     * The maximum amount of allocators that can be registered per table.
+     */
+    static const size_t max_allocators = 256;
+
+    /**
+     * Returns the table used for link layer protocol identifiers.
+     */
+    static PDUAllocatorTable& instance(uint16_t);
+
+    /**
+     * Returns the table used for IP protocol numbers.
+     */
+    static PDUAllocatorTable& instance(uint8_t);
+
+    void register_allocator(uint32_t identifier, allocator_type allocator, 
+                            PDU::PDUType type);
+
+    PDU* allocate(uint32_t identifier, const uint8_t* buffer, uint32_t size) const;
+    bool pdu_type_registered(PDU::PDUType type) const;
+    uint32_t pdu_type_to_id(PDU::PDUType type) const;
+private:
+    #if TINS_IS_CXX11
+        typedef std::atomic<uint32_t> uint32_storage;
+        typedef std::atomic<allocator_type> allocator_storage;
+    #else
+        typedef uint32_t uint32_storage;
+        typedef allocator_type allocator_storage;
+    #endif // TINS_IS_CXX11
+
+    struct allocator_entry {
+        // The identifier plus one, 0 means the entry is empty
+        uint32_storage key;
+        allocator_storage allocator;
+    };
+
+    struct pdu_type_entry {
+        uint32_storage type;
+        uint32_storage identifier;
+    };
+
+    PDUAllocatorTable();
+    PDUAllocatorTable(const PDUAllocatorTable&);
+    PDUAllocatorTable& operator=(const PDUAllocatorTable&);
+
+    static size_t slot_index(uint32_t identifier) {
+        return (identifier ^ (identifier >> 8)) & (max_allocators - 1);
+    }
+
+    allocator_entry allocators_[max_allocators];
+    pdu_type_entry pdu_types_[max_allocators];
+    uint32_storage allocator_count_;
+    uint32_storage pdu_type_count_;
+};
+
 template<typename Tag>
 class PDUAllocator {
 public:
     typedef typename Tag::identifier_type id_type;
-    typedef PDU *(*allocator_type)(const uint8_t *, uint32_t);
+    typedef PDUAllocatorTable::allocator_type allocator_type;
 
     template<typename PDUType>
     static void register_allocator(id_type identifier) {
-        allocators[identifier] = &default_allocator<PDUType>;
-        pdu_types[PDUType::pdu_flag] = identifier;
+        table().register_allocator(identifier, &default_allocator<PDUType>, 
+                                   PDUType::pdu_flag);
     }
 
     static PDU* allocate(id_type identifier, const uint8_t* buffer, uint32_t size) {
-        typename allocators_type::const_iterator it = allocators.find(identifier);
-        return (it == allocators.end()) ? 0 : (*it->second)(buffer, size);
+        return table().allocate(identifier, buffer, size);
     }
 
     static bool pdu_type_registered(PDU::PDUType type) {
-        return pdu_types.count(type) != 0;
+        return table().pdu_type_registered(type);
     }
 
     static id_type pdu_type_to_id(PDU::PDUType type) {
-        typename pdu_map_types::const_iterator it = pdu_types.find(type);
-        return it->second;
+        return static_cast<id_type>(table().pdu_type_to_id(type));
     }
 private:
-    typedef std::map<id_type, allocator_type> allocators_type;
-    typedef std::map<PDU::PDUType, id_type> pdu_map_types;
-
-    static allocators_type allocators;
-    static pdu_map_types pdu_types;
+    static PDUAllocatorTable& table() {
+        return PDUAllocatorTable::instance(id_type());
+    }
 };
 
-template<typename Tag>
-typename PDUAllocator<Tag>::allocators_type PDUAllocator<Tag>::allocators;
-
-template<typename Tag>
-typename PDUAllocator<Tag>::pdu_map_types PDUAllocator<Tag>::pdu_types;
-
 template<typename IDType>
 struct pdu_tag {
     typedef IDType identifier_type;
@@ -161,6 +222,10 @@ namespace Allocators {
  * registering an allocator for EthernetII will make it work for 
  * the rest of the link layer protocols, sine they should all work 
  * the same way.
+ *
+ * When using C++11, allocators can be registered while other threads
+ * are constructing PDUs. Up to 256 allocators can be registered for
+ * link layer protocols and another 256 for IP protocols.
  */
 template<typename PDUType, typename AllocatedType>
 void register_allocator(typename Internals::pdu_tag_mapper<PDUType>::type::identifier_type id) {
@@ -200,7 +200,9 @@ namespace Internals {
 template <typename OptionType, typename PDUType>
 class PDUOption {
 private:
-    static const int small_buffer_size = 8;
+    // Large enough for most options found on the wire (e.g. TCP timestamps,
+    // IPv6 addresses), so those don't need an allocation
+    static const int small_buffer_size = 16;
 public:
     typedef uint8_t data_type;
     typedef OptionType option_type;
@@ -32,6 +32,7 @@
 
 #include <vector>
 #include <string>
+#include <utility>
 #include <tins/pdu.h>
 #include <tins/macros.h>
 #include <tins/cxxstd.h>
@@ -78,6 +79,11 @@ public:
      *
      * The payload is copied, therefore the original payload's memory
      * must be freed by the user.
+     *
+     * If the calling thread is using DecodingScope::BORROWED_PAYLOADS,
+     * the payload is not copied. The RawPDU will instead point to it 
+     * until either RawPDU::materialize or RawPDU::payload are called.
+     *
      * \param pload The payload which the RawPDU will contain.
      * \param size The size of the payload.
      */
@@ -94,7 +100,7 @@ public:
      */
     template<typename ForwardIterator>
     RawPDU(ForwardIterator start, ForwardIterator end) 
-    : payload_(start, end) { }
+    : payload_(start, end), borrowed_payload_(0), borrowed_size_(0) { }
 
     /**
      * \brief Creates an instance of RawPDU from a payload_type.
@@ -104,7 +110,7 @@ public:
      * \param data The payload to use.
      */
     RawPDU(const payload_type & data)
-            : payload_(data) { }
+    : payload_(data), borrowed_payload_(0), borrowed_size_(0) { }
 
     #if TINS_IS_CXX11
         /** 
@@ -115,7 +121,37 @@ public:
          * \param data The payload to use.
          */
         RawPDU(payload_type&& data)
-        : payload_(move(data)) { }
+        : payload_(std::move(data)), borrowed_payload_(0), borrowed_size_(0) { }
+
+        /**
+         * \brief Move constructor.
+         *
+         * If the RawPDU being moved is borrowing its payload, the new
+         * object will borrow it as well.
+         *
+         * \param rhs The RawPDU to be moved.
+         */
+        RawPDU(RawPDU&& rhs) TINS_NOEXCEPT
+        : PDU(std::move(rhs)), payload_(std::move(rhs.payload_)),
+          borrowed_payload_(rhs.borrowed_payload_), borrowed_size_(rhs.borrowed_size_) {
+            rhs.borrowed_payload_ = 0;
+            rhs.borrowed_size_ = 0;
+        }
+
+        /**
+         * \brief Move assignment operator.
+         *
+         * \param rhs The RawPDU to be moved.
+         */
+        RawPDU& operator=(RawPDU&& rhs) TINS_NOEXCEPT {
+            PDU::operator=(std::move(rhs));
+            payload_ = std::move(rhs.payload_);
+            borrowed_payload_ = rhs.borrowed_payload_;
+            borrowed_size_ = rhs.borrowed_size_;
+            rhs.borrowed_payload_ = 0;
+            rhs.borrowed_size_ = 0;
+            return *this;
+        }
     #endif // TINS_IS_CXX11
 
     /** 
@@ -125,6 +161,23 @@ public:
      */
     RawPDU(const std::string& data);
 
+    /**
+     * \brief Copy constructor.
+     *
+     * The new object always owns its payload, even if the one being 
+     * copied is borrowing it.
+     *
+     * \param other The RawPDU to be copied.
+     */
+    RawPDU(const RawPDU& other);
+
+    /**
+     * \brief Copy assignment operator.
+     *
+     * \param other The RawPDU to be copied.
+     */
+    RawPDU& operator=(const RawPDU& other);
+
     /**
      * \brief Setter for the payload field
      * \param pload The payload to be set.
@@ -139,23 +192,74 @@ public:
     template<typename ForwardIterator>
     void payload(ForwardIterator start, ForwardIterator end) {
         payload_.assign(start, end);
+        borrowed_payload_ = 0;
+        borrowed_size_ = 0;
     }
 
     /** 
      * \brief Const getter for the payload.
+     *
+     * If the payload is borrowed, it is copied into this RawPDU's 
+     * internal buffer first. Use RawPDU::payload_data to access it
+     * without copying.
+     *
      * \return The RawPDU's payload.
      */
     const payload_type& payload() const {
+        if (TINS_UNLIKELY(borrowed_payload_ != 0)) {
+            materialize();
+        }
         return payload_;
     }
     
     /** 
      * \brief Non-const getter for the payload.
+     *
+     * If the payload is borrowed, it is copied into this RawPDU's 
+     * internal buffer first.
+     *
      * \return The RawPDU's payload.
      */
     payload_type& payload() {
+        if (TINS_UNLIKELY(borrowed_payload_ != 0)) {
+            materialize();
+        }
         return payload_;
     }
+
+    /**
+     * \brief Returns a pointer to the payload.
+     *
+     * This never copies the payload. The pointer is invalidated by any
+     * method that modifies the payload, including RawPDU::materialize.
+     *
+     * \return A pointer to the first byte of the payload. Might be a null
+     * pointer if the payload is empty.
+     */
+    const uint8_t* payload_data() const {
+        if (borrowed_payload_) {
+            return borrowed_payload_;
+        }
+        return payload_.empty() ? 0 : &payload_[0];
+    }
+
+    /**
+     * \brief Indicates whether the payload is borrowed.
+     *
+     * \return true if this RawPDU points to a buffer it doesn't own.
+     */
+    bool is_borrowed() const {
+        return borrowed_payload_ != 0;
+    }
+
+    /**
+     * \brief Copies a borrowed payload into this RawPDU's internal buffer.
+     *
+     * After calling this method, this RawPDU no longer refers to the
+     * buffer it was constructed from. If the payload is not borrowed, 
+     * this does nothing.
+     */
+    void materialize() const;
     
     /** 
      * \brief Returns the header size.
@@ -172,6 +276,9 @@ public:
      * \return uint32_t containing the payload size.
      */
     uint32_t payload_size() const {
+        if (borrowed_payload_) {
+            return borrowed_size_;
+        }
         return static_cast<uint32_t>(payload_.size());
     }
 
@@ -201,7 +308,7 @@ public:
      */
     template<typename T>
     T to() const {
-        return T(&payload_[0], static_cast<uint32_t>(payload_.size()));
+        return T(payload_data(), payload_size());
     }
     
     /**
@@ -212,8 +319,11 @@ public:
     }
 private:
     void write_serialization(uint8_t* buffer, uint32_t total_sz);
+    void finish_lazy_parsing() const;
 
-    payload_type payload_;
+    mutable payload_type payload_;
+    mutable const uint8_t* borrowed_payload_;
+    mutable uint32_t borrowed_size_;
 };
 
 } // Tins
@@ -0,0 +1,640 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+
+#ifndef TINS_RING_SNIFFER_H
+#define TINS_RING_SNIFFER_H
+
+#include <tins/config.h>
+
+#ifdef TINS_HAVE_PACKET_RING
+
+#include <vector>
+#include <stdint.h>
+#include <stddef.h>
+#include <tins/macros.h>
+#include <tins/packet.h>
+#include <tins/cxxstd.h>
+#include <tins/exceptions.h>
+#include <tins/network_interface.h>
+#include <tins/detail/type_traits.h>
+#include <tins/detail/pdu_helpers.h>
+#if TINS_IS_CXX11
+    #include <memory>
+    #include <thread>
+    #include <mutex>
+    #include <exception>
+#endif // TINS_IS_CXX11
+
+namespace Tins {
+
+/**
+ * \class RingSnifferConfiguration
+ * \brief Represents the configuration of a RingSniffer object.
+ *
+ * The ring is made of block_count blocks of block_size bytes each. The
+ * kernel fills a block with as many packets as fit in it and hands it
+ * over either once it's full or once block_timeout milliseconds have
+ * elapsed since the first packet was stored in it.
+ *
+ * \sa RingSniffer
+ */
+class TINS_API RingSnifferConfiguration {
+public:
+    /**
+     * The ways in which packets are spread across the sockets in a
+     * fanout group.
+     */
+    enum FanoutMode {
+        NO_FANOUT,
+        FANOUT_HASH,         ///< By flow, so each flow is always seen by the same ring.
+        FANOUT_LOAD_BALANCE, ///< Round robin.
+        FANOUT_CPU           ///< By the CPU which received the packet.
+    };
+
+    /**
+     * \brief The default block size.
+     *
+     * This is 1MB by default.
+     */
+    static const uint32_t DEFAULT_BLOCK_SIZE;
+
+    /**
+     * \brief The default amount of blocks.
+     *
+     * This is 16 by default.
+     */
+    static const uint32_t DEFAULT_BLOCK_COUNT;
+
+    /**
+     * \brief The default block timeout.
+     *
+     * This is 10 milliseconds by default.
+     */
+    static const uint32_t DEFAULT_BLOCK_TIMEOUT;
+
+    /**
+     * Default constructs a RingSnifferConfiguration.
+     */
+    RingSnifferConfiguration();
+
+    /**
+     * \brief Sets the size of each of the ring's blocks.
+     *
+     * This must be a multiple of the page size and large enough to
+     * hold the largest packet that can be captured.
+     *
+     * \param block_size The block size to be set.
+     */
+    void set_block_size(uint32_t block_size);
+
+    /**
+     * Sets the amount of blocks in the ring.
+     * \param block_count The amount of blocks to be set.
+     */
+    void set_block_count(uint32_t block_count);
+
+    /**
+     * \brief Sets the time after which partially filled blocks are
+     * handed over to the sniffer, in milliseconds.
+     *
+     * \param timeout The block timeout to be set.
+     */
+    void set_block_timeout(uint32_t timeout);
+
+    /**
+     * \brief Sets the read timeout, in milliseconds.
+     *
+     * If no packet is captured within this time, RingSniffer::next_packet
+     * returns an empty packet and RingSniffer::sniff_loop returns. If
+     * this is 0, which is the default, reading blocks until a packet is
+     * captured or RingSniffer::stop_sniff is called.
+     *
+     * \param timeout The timeout to be set.
+     */
+    void set_timeout(uint32_t timeout);
+
+    /**
+     * Sets the promiscuous mode option.
+     * \param enabled The promiscuous mode value.
+     */
+    void set_promisc_mode(bool enabled);
+
+    /**
+     * \brief Makes the sniffer join a fanout group.
+     *
+     * All sockets bound to the same interface which join the same group
+     * using the same mode share the interface's traffic, rather than each
+     * of them seeing every packet.
+     *
+     * \param mode The way packets are spread across the group.
+     * \param group_id The group's identifier.
+     */
+    void set_fanout(FanoutMode mode, uint16_t group_id);
+
+    /**
+     * Sets the flags used when decoding sniffed packets.
+     * \param flags The decoding flags to be used.
+     * \sa RingSniffer::set_decoding_flags
+     */
+    void set_decoding_flags(uint32_t flags);
+
+    /**
+     * Getter for the block size.
+     */
+    uint32_t block_size() const;
+
+    /**
+     * Getter for the amount of blocks.
+     */
+    uint32_t block_count() const;
+
+    /**
+     * Getter for the block timeout.
+     */
+    uint32_t block_timeout() const;
+
+    /**
+     * Getter for the read timeout.
+     */
+    uint32_t timeout() const;
+
+    /**
+     * Getter for the promiscuous mode option.
+     */
+    bool promisc_mode() const;
+
+    /**
+     * Getter for the fanout mode.
+     */
+    FanoutMode fanout_mode() const;
+
+    /**
+     * Getter for the fanout group identifier.
+     */
+    uint16_t fanout_group_id() const;
+
+    /**
+     * Getter for the decoding flags.
+     */
+    uint32_t decoding_flags() const;
+private:
+    uint32_t block_size_;
+    uint32_t block_count_;
+    uint32_t block_timeout_;
+    uint32_t timeout_;
+    bool promisc_;
+    FanoutMode fanout_mode_;
+    uint16_t fanout_group_id_;
+    uint32_t decoding_flags_;
+};
+
+/**
+ * \class RingSniffer
+ * \brief Sniffs packets using a memory mapped AF_PACKET ring.
+ *
+ * This is a Linux only alternative to Sniffer. Rather than copying each
+ * packet through libpcap, the kernel stores packets straight into a ring
+ * of TPACKET_V3 blocks which is shared with the process, so reading a
+ * packet doesn't require a system call unless the ring is empty.
+ *
+ * Opening a RingSniffer requires the CAP_NET_RAW capability.
+ *
+ * \code
+ * RingSniffer sniffer("eth0");
+ * sniffer.sniff_loop([](const PDU& pdu) {
+ *     // process pdu
+ *     return true;
+ * });
+ * \endcode
+ *
+ * Packets are decoded as EthernetII frames on ethernet and loopback
+ * interfaces, as RadioTap frames on monitor mode interfaces and as
+ * RawPDUs on anything else.
+ *
+ * A RingSniffer must only be read from one thread at a time. Use a
+ * RingSnifferGroup to capture an interface's traffic using several
+ * threads.
+ *
+ * \sa RingSnifferGroup
+ */
+class TINS_API RingSniffer {
+public:
+    /**
+     * \brief Capture statistics.
+     */
+    struct statistics {
+        uint64_t packets;   ///< Packets stored in the ring.
+        uint64_t drops;     ///< Packets dropped because the ring was full.
+
+        statistics()
+        : packets(0), drops(0) {
+
+        }
+    };
+
+    /**
+     * \brief Constructs a RingSniffer.
+     *
+     * If opening the socket or setting up the ring fails, a
+     * socket_open_error exception is thrown.
+     *
+     * \param iface The interface to capture on.
+     * \param configuration The sniffer's configuration.
+     */
+    RingSniffer(const NetworkInterface& iface,
+                const RingSnifferConfiguration& configuration = RingSnifferConfiguration());
+
+    /**
+     * \brief Destructor.
+     *
+     * Unmaps the ring and closes the socket.
+     */
+    ~RingSniffer();
+
+    /**
+     * \brief Captures one packet.
+     *
+     * Packets that can't be decoded are skipped. The returned packet is
+     * empty if the read timeout expired or RingSniffer::stop_sniff was
+     * called. Caller takes ownership of the PDU pointer stored in the
+     * PtrPacket.
+     *
+     * \sa BaseSniffer::next_packet
+     */
+    PtrPacket next_packet();
+
+    /**
+     * \brief Starts a sniffing loop, using a callback functor for every
+     * sniffed packet.
+     *
+     * The functor can take the same arguments BaseSniffer::sniff_loop
+     * allows. Sniffing stops when max_packets packets are sniffed (if
+     * it is != 0), when the functor returns false, when the read timeout
+     * expires or when RingSniffer::stop_sniff is called.
+     *
+     * \param function The callback handler object which should process packets.
+     * \param max_packets The maximum amount of packets to sniff. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_loop(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Starts a sniffing loop, using a callback functor for every
+     * batch of sniffed packets.
+     *
+     * Each batch contains the packets stored in one of the ring's blocks,
+     * which are handed over by the kernel all at once. The functor takes
+     * the same arguments BaseSniffer::sniff_batches allows.
+     *
+     * Sniffing stops when the functor returns false, when the read timeout
+     * expires or when RingSniffer::stop_sniff is called.
+     *
+     * \param function The callback handler object which should process batches.
+     * \param max_batch The maximum amount of packets in each batch. 0 == no
+     * limit, which means every packet in a block is provided at once.
+     * \sa BaseSniffer::sniff_batches
+     */
+    template <typename Functor>
+    void sniff_batches(Functor function, uint32_t max_batch = 0);
+
+    /**
+     * \brief Stops sniffing loops.
+     *
+     * Unlike BaseSniffer::stop_sniff, this can be called from any thread.
+     * A running loop stops before reading its next block or batch, even
+     * if packets keep arriving. If no thread is waiting for packets, the
+     * next one to do so will return immediately.
+     */
+    void stop_sniff();
+
+    /**
+     * \brief Sets whether to extract RawPDUs or fully parsed packets.
+     * \param value Whether to extract RawPDUs or not.
+     * \sa BaseSniffer::set_extract_raw_pdus
+     */
+    void set_extract_raw_pdus(bool value);
+
+    /**
+     * \brief Sets the flags used when decoding sniffed packets.
+     *
+     * When using flags that make packets point to the capture buffer,
+     * packets are only valid until the next one is read, as the ring's
+     * block they were stored in is handed back to the kernel then.
+     *
+     * \param flags The decoding flags to be used.
+     * \sa BaseSniffer::set_decoding_flags
+     */
+    void set_decoding_flags(uint32_t flags);
+
+    /**
+     * \brief Retrieves the flags used when decoding sniffed packets.
+     */
+    uint32_t decoding_flags() const;
+
+    /**
+     * \brief Retrieves the capture statistics.
+     *
+     * These are the totals since this sniffer was opened.
+     */
+    statistics stats();
+
+    /**
+     * \brief Gets the file descriptor associated with the sniffer.
+     */
+    int get_fd();
+private:
+    friend class RingSnifferGroup;
+
+    RingSniffer(const RingSniffer&);
+    RingSniffer& operator=(const RingSniffer&);
+
+    void open(const NetworkInterface& iface, const RingSnifferConfiguration& configuration);
+    void close();
+    const uint8_t* next_frame(uint32_t& size, Timestamp& timestamp);
+    bool read_batch(std::vector<Packet>& batch, uint32_t max_batch);
+    bool wait_for_block();
+    void release_block();
+    bool take_stop_request();
+    void clear_stop_request();
+
+    int fd_;
+    int stop_fd_;
+    // Set by stop_sniff. The eventfd only wakes up a blocked poll, as a
+    // busy ring always has a block ready and never polls
+    uint32_t stop_requested_;
+    uint8_t* ring_;
+    size_t ring_size_;
+    uint32_t block_size_;
+    uint32_t block_count_;
+    uint32_t block_index_;
+    uint8_t* current_block_;
+    const uint8_t* next_frame_;
+    uint32_t frames_left_;
+    int timeout_;
+    bool extract_raw_;
+    uint32_t decoding_flags_;
+    Internals::frame_decoder frame_decoder_;
+    Internals::frame_decoder link_decoder_;
+    statistics stats_;
+};
+
+#if TINS_IS_CXX11
+
+/**
+ * \class RingSnifferGroup
+ * \brief Captures an interface's traffic using several RingSniffers.
+ *
+ * Every sniffer in the group has its own ring and joins the same
+ * fanout group, so the kernel spreads the interface's packets across
+ * them. RingSnifferGroup::sniff_loop reads each ring on its own thread.
+ *
+ * \code
+ * RingSnifferConfiguration config;
+ * config.set_fanout(RingSnifferConfiguration::FANOUT_HASH, 42);
+ * RingSnifferGroup group("eth0", 4, config);
+ * // Called from 4 threads at once
+ * group.sniff_loop([&](const PDU& pdu) {
+ *     // process pdu
+ *     return true;
+ * });
+ * \endcode
+ *
+ * This class is only available in C++11 mode.
+ */
+class TINS_API RingSnifferGroup {
+public:
+    /**
+     * \brief Constructs a RingSnifferGroup.
+     *
+     * If the configuration doesn't use fanout, FANOUT_HASH is used.
+     * If its fanout group identifier is 0, one that isn't used by any
+     * other group in this process is picked.
+     *
+     * \param iface The interface to capture on.
+     * \param size The amount of sniffers. If this is 0, one per hardware
+     * thread is used.
+     * \param configuration The configuration used by every sniffer.
+     */
+    RingSnifferGroup(const NetworkInterface& iface, uint32_t size,
+                     RingSnifferConfiguration configuration = RingSnifferConfiguration());
+
+    /**
+     * \brief Starts a sniffing loop on every sniffer.
+     *
+     * Each ring is read on its own thread (the calling thread reads
+     * the first one) using a copy of the functor, so it must be safe
+     * to call from several threads at once. This returns once every
+     * ring's loop is done.
+     *
+     * If the functor returns false, every ring's loop is stopped. If it
+     * throws on any ring, every ring's loop is stopped as well and the
+     * first exception is rethrown on the calling thread.
+     *
+     * \param function The callback handler object which should process packets.
+     * \param max_packets The maximum amount of packets to sniff on each
+     * ring. 0 == infinite.
+     */
+    template <typename Functor>
+    void sniff_loop(Functor function, uint32_t max_packets = 0);
+
+    /**
+     * \brief Starts a batched sniffing loop on every sniffer.
+     *
+     * This works like RingSnifferGroup::sniff_loop, except that the
+     * functor is called with batches of packets.
+     *
+     * \param function The callback handler object which should process batches.
+     * \param max_batch The maximum amount of packets in each batch. 0 == no limit.
+     * \sa RingSniffer::sniff_batches
+     */
+    template <typename Functor>
+    void sniff_batches(Functor function, uint32_t max_batch = 0);
+
+    /**
+     * \brief Stops every sniffer's loop.
+     *
+     * This can be called from any thread.
+     */
+    void stop_sniff();
+
+    /**
+     * \brief Retrieves the capture statistics, summed across every sniffer.
+     */
+    RingSniffer::statistics stats();
+
+    /**
+     * Retrieves the amount of sniffers in this group.
+     */
+    size_t size() const;
+
+    /**
+     * Retrieves the sniffer at the given index.
+     */
+    RingSniffer& operator[](size_t index);
+
+    /**
+     * Retrieves the group's fanout identifier.
+     */
+    uint16_t fanout_group_id() const;
+private:
+    template <typename RingLoop>
+    void run_on_every_ring(RingLoop loop);
+
+    std::vector<std::unique_ptr<RingSniffer>> sniffers_;
+    uint16_t fanout_group_id_;
+};
+
+#endif // TINS_IS_CXX11
+
+template <typename Functor>
+void RingSniffer::sniff_loop(Functor function, uint32_t max_packets) {
+    while (true) {
+        Packet packet(next_packet());
+        if (!packet) {
+            return;
+        }
+        try {
+            // If the functor returns false, we're done
+            #if TINS_IS_CXX11 && !defined(_MSC_VER)
+            if (!Internals::invoke_loop_cb(function, packet)) {
+                return;
+            }
+            #else
+            if (!function(*packet.pdu())) {
+                return;
+            }
+            #endif
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+        if (max_packets && --max_packets == 0) {
+            return;
+        }
+    }
+}
+
+template <typename Functor>
+void RingSniffer::sniff_batches(Functor function, uint32_t max_batch) {
+    std::vector<Packet> batch;
+    while (read_batch(batch, max_batch)) {
+        try {
+            // If the functor returns false, we're done
+            if (!function(batch)) {
+                return;
+            }
+        }
+        catch(malformed_packet&) { }
+        catch(pdu_not_found&) { }
+    }
+}
+
+#if TINS_IS_CXX11
+
+template <typename Functor>
+void RingSnifferGroup::sniff_loop(Functor function, uint32_t max_packets) {
+    run_on_every_ring([this, function, max_packets](size_t index) mutable {
+        bool stopped = false;
+        sniffers_[index]->sniff_loop([&](Packet& packet) {
+            if (!Internals::invoke_loop_cb(function, packet)) {
+                stopped = true;
+            }
+            return !stopped;
+        }, max_packets);
+        if (stopped) {
+            stop_sniff();
+        }
+    });
+}
+
+template <typename Functor>
+void RingSnifferGroup::sniff_batches(Functor function, uint32_t max_batch) {
+    run_on_every_ring([this, function, max_batch](size_t index) mutable {
+        bool stopped = false;
+        sniffers_[index]->sniff_batches([&](std::vector<Packet>& batch) {
+            if (!function(batch)) {
+                stopped = true;
+            }
+            return !stopped;
+        }, max_batch);
+        if (stopped) {
+            stop_sniff();
+        }
+    });
+}
+
+template <typename RingLoop>
+void RingSnifferGroup::run_on_every_ring(RingLoop loop) {
+    // Stop requests that arrived after the previous loop was done
+    // shouldn't end this one
+    for (size_t i = 0; i < sniffers_.size(); ++i) {
+        sniffers_[i]->clear_stop_request();
+    }
+    // The first exception thrown on any ring stops every other one and is
+    // rethrown once they're all done
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto run_ring = [&](RingLoop& ring_loop, size_t index) {
+        try {
+            ring_loop(index);
+        }
+        catch (...) {
+            {
+                std::lock_guard<std::mutex> _(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            stop_sniff();
+        }
+    };
+    // Each thread gets its own copy of the loop, and so of the functor
+    std::vector<std::thread> threads;
+    threads.reserve(sniffers_.size());
+    for (size_t i = 1; i < sniffers_.size(); ++i) {
+        threads.emplace_back([&run_ring, loop, i]() mutable {
+            run_ring(loop, i);
+        });
+    }
+    run_ring(loop, 0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+#endif // TINS_IS_CXX11
+
+} // Tins
+
+#endif // TINS_HAVE_PACKET_RING
+
+#endif // TINS_RING_SNIFFER_H
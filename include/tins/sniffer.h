@@ -32,6 +32,7 @@
 #define TINS_SNIFFER_H
 
 #include <string>
+#include <vector>
 #include <memory>
 #include <iterator>
 #include <tins/pdu.h>
@@ -40,6 +41,7 @@
 #include <tins/macros.h>
 #include <tins/exceptions.h>
 #include <tins/detail/type_traits.h>
+#include <tins/detail/pdu_helpers.h>
 
 #ifdef TINS_HAVE_PCAP
 
@@ -74,7 +76,7 @@ public:
          */
         BaseSniffer(BaseSniffer &&rhs) TINS_NOEXCEPT
         : handle_(0), mask_(), extract_raw_(false),
-          pcap_sniffing_method_(pcap_loop) {
+          pcap_sniffing_method_(pcap_loop), decoding_flags_(0), frame_decoder_(0) {
             *this = std::move(rhs);
         }
 
@@ -88,6 +90,8 @@ public:
             swap(mask_, rhs.mask_);
             swap(extract_raw_, rhs.extract_raw_);
             swap(pcap_sniffing_method_, rhs.pcap_sniffing_method_);
+            swap(decoding_flags_, rhs.decoding_flags_);
+            swap(frame_decoder_, rhs.frame_decoder_);
             return* this;
         }
     #endif
@@ -188,6 +192,47 @@ public:
     template <typename Functor>
     void sniff_loop(Functor function, uint32_t max_packets = 0);
 
+    /**
+     * \brief Starts a sniffing loop, using a callback functor for every
+     * batch of sniffed packets.
+     *
+     * Rather than calling the functor once per packet, this gathers every
+     * packet a single call to the sniffing method returns and provides
+     * them all at once. This allows amortizing the work done on each
+     * call, such as taking locks or pushing packets into queues.
+     *
+     * The functor must implement an operator with the following signature:
+     *
+     * \code
+     * bool(std::vector<Packet>&);
+     * \endcode
+     *
+     * The same vector is reused for every batch, so the functor can move
+     * packets out of it. Packets that can't be decoded are not included.
+     *
+     * As pcap_loop only returns once it has read all the requested packets,
+     * batches are read using pcap_dispatch when the default sniffing method
+     * is used, so each batch contains the packets that were available in
+     * libpcap's buffer.
+     *
+     * Sniffing will stop when the functor returns false, when there are no
+     * more packets to be read or when BaseSniffer::stop_sniff is called.
+     *
+     * Batched packets outlive the libpcap buffer they were read from, so
+     * they're always fully decoded and can be kept after the functor
+     * returns. DecodingScope::LAZY_INNER_PDUS,
+     * DecodingScope::BORROWED_PAYLOADS and DecodingScope::LAZY_OPTIONS
+     * are therefore ignored here, while the rest of the flags set through
+     * BaseSniffer::set_decoding_flags still apply.
+     *
+     * \param function The callback handler object which should process batches.
+     * \param max_batch The maximum amount of packets in each batch. 0 == no
+     * limit, which when reading a pcap file means the whole file is read into
+     * a single batch.
+     */
+    template <typename Functor>
+    void sniff_batches(Functor function, uint32_t max_batch = 64);
+
     /**
      * \brief Sets a filter on this sniffer.
      * \param filter The filter to be set.
@@ -240,6 +285,32 @@ public:
      */
     void set_extract_raw_pdus(bool value);
 
+    /**
+     * \brief Sets the flags used when decoding sniffed packets.
+     *
+     * The flags are the bitwise OR of DecodingScope::Flags values. By
+     * default, no flags are set and packets are fully decoded as soon as
+     * they're sniffed.
+     *
+     * When DecodingScope::LAZY_INNER_PDUS, DecodingScope::BORROWED_PAYLOADS
+     * or DecodingScope::LAZY_OPTIONS are used, packets keep pointing to
+     * the capture buffer, which is only valid until the next packet
+     * is read. Packets returned by BaseSniffer::next_packet must therefore
+     * not be kept after calling it again, and the packets provided to the
+     * functor used in BaseSniffer::sniff_loop are only valid during that
+     * call. Use PDU::clone (or construct a Packet from the PDU) to
+     * obtain a copy that can be stored. These three flags don't apply to
+     * BaseSniffer::sniff_batches.
+     *
+     * \param flags The decoding flags to be used.
+     */
+    void set_decoding_flags(uint32_t flags);
+
+    /**
+     * \brief Retrieves the flags used when decoding sniffed packets.
+     */
+    uint32_t decoding_flags() const;
+
     /**
      * \brief function pointer for the sniffing method
      *
@@ -311,10 +382,15 @@ private:
     BaseSniffer(const BaseSniffer&);
     BaseSniffer& operator=(const BaseSniffer&);
 
+    Internals::frame_decoder resolve_frame_decoder();
+    bool read_batch(std::vector<Packet>& batch, uint32_t max_batch);
+
     pcap_t* handle_;
     bpf_u_int32 mask_;
     bool extract_raw_;
     PcapSniffingMethod pcap_sniffing_method_;
+    uint32_t decoding_flags_;
+    Internals::frame_decoder frame_decoder_;
 };
 
 /**
@@ -635,6 +711,13 @@ public:
      * \param value The timestamp option value.
      */
     void set_timestamp_precision(int value);
+
+    /**
+     * Sets the flags used when decoding sniffed packets.
+     * \param flags The decoding flags to be used.
+     * \sa BaseSniffer::set_decoding_flags
+     */
+    void set_decoding_flags(uint32_t flags);
 protected:
     friend class Sniffer;
     friend class FileSniffer;
@@ -666,6 +749,7 @@ protected:
     bool immediate_mode_;
     pcap_direction_t direction_;
     int timestamp_precision_;
+    uint32_t decoding_flags_;
 };
 
 template <typename Functor>
@@ -691,6 +775,27 @@ void Tins::BaseSniffer::sniff_loop(Functor function, uint32_t max_packets) {
     }
 }
 
+template <typename Functor>
+void Tins::BaseSniffer::sniff_batches(Functor function, uint32_t max_batch) {
+    std::vector<Packet> batch;
+    while (true) {
+        const bool more_packets = read_batch(batch, max_batch);
+        if (!batch.empty()) {
+            try {
+                // If the functor returns false, we're done
+                if (!function(batch)) {
+                    return;
+                }
+            }
+            catch(malformed_packet&) { }
+            catch(pdu_not_found&) { }
+        }
+        if (!more_packets) {
+            return;
+        }
+    }
+}
+
 } // Tins
 
 #endif // TINS_HAVE_PCAP
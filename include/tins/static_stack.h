@@ -0,0 +1,320 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+#ifndef TINS_STATIC_STACK_H
+#define TINS_STATIC_STACK_H
+
+#include <tins/cxxstd.h>
+
+#if TINS_IS_CXX11
+
+#include <tuple>
+#include <type_traits>
+#include <stdint.h>
+#include <stddef.h>
+#include <tins/pdu.h>
+#include <tins/exceptions.h>
+
+namespace Tins {
+namespace Internals {
+
+/**
+ * \cond
+ */
+template <typename T, typename... Layers>
+struct static_stack_index;
+
+template <typename T, typename... Layers>
+struct static_stack_index<T, T, Layers...> : std::integral_constant<size_t, 0> {
+
+};
+
+template <typename T, typename U, typename... Layers>
+struct static_stack_index<T, U, Layers...>
+: std::integral_constant<size_t, 1 + static_stack_index<T, Layers...>::value> {
+
+};
+/**
+ * \endcond
+ */
+
+} // Internals
+
+/**
+ * \class StaticStack
+ * \brief A packet whose layers are fixed at compile time.
+ *
+ * Building a packet using the PDU classes allocates every inner PDU
+ * separately and serializing it walks the chain through virtual calls.
+ * A StaticStack instead stores every layer inline, in a single object,
+ * and serializes them through code that's generated for that specific
+ * stack of layers. This is useful when the same kind of packet is
+ * crafted over and over again, e.g. when generating traffic:
+ *
+ * \code
+ * StaticStack<EthernetII, IP, TCP, RawPDU> packet(
+ *     EthernetII("00:01:02:03:04:05"),
+ *     IP("192.168.0.1"),
+ *     TCP(80),
+ *     RawPDU("payload")
+ * );
+ * PDU::serialization_type buffer;
+ * for (uint16_t port = 1024; port < 2048; ++port) {
+ *     packet.get<TCP>().sport(port);
+ *     packet.serialize(buffer);
+ *     // send buffer...
+ * }
+ * \endcode
+ *
+ * Layers are linked to each other just like in a regular PDU chain,
+ * so StaticStack::pdu can be used anywhere a PDU is expected, e.g. in 
+ * PacketSender::send or PDU::find_pdu. The chain is owned by the stack, so
+ * it must not be modified (e.g. by setting or releasing an inner PDU)
+ * through the PDU interface.
+ *
+ * This class is only available when using C++11.
+ */
+template <typename... Layers>
+class StaticStack {
+public:
+    static_assert(sizeof...(Layers) > 0, "A StaticStack must contain at least one layer");
+
+    /**
+     * The amount of layers in this stack.
+     */
+    static const size_t layer_count = sizeof...(Layers);
+
+    /**
+     * The type of the layer at the given index.
+     */
+    template <size_t Index>
+    using layer_type = typename std::tuple_element<Index, std::tuple<Layers...>>::type;
+
+    /**
+     * \brief Default constructs every layer.
+     *
+     * This can only be used if every layer is default constructible.
+     */
+    StaticStack() {
+        link(index_constant<0>());
+    }
+
+    /**
+     * \brief Constructs a StaticStack by copying the given layers.
+     *
+     * Any inner PDUs the layers contain are discarded.
+     */
+    explicit StaticStack(const Layers&... layers)
+    : layers_(layers...) {
+        link(index_constant<0>());
+    }
+
+    StaticStack(const StaticStack&) = delete;
+    StaticStack& operator=(const StaticStack&) = delete;
+
+    /**
+     * \brief Destructor.
+     */
+    ~StaticStack() {
+        // The layers are members of this object, don't let them delete each other
+        unlink(index_constant<0>());
+    }
+
+    /**
+     * \brief Getter for the layer at the given index.
+     */
+    template <size_t Index>
+    layer_type<Index>& get() {
+        return std::get<Index>(layers_);
+    }
+
+    /**
+     * \brief Getter for the layer at the given index.
+     */
+    template <size_t Index>
+    const layer_type<Index>& get() const {
+        return std::get<Index>(layers_);
+    }
+
+    /**
+     * \brief Getter for the first layer of the given type.
+     */
+    template <typename T>
+    T& get() {
+        return std::get<Internals::static_stack_index<T, Layers...>::value>(layers_);
+    }
+
+    /**
+     * \brief Getter for the first layer of the given type.
+     */
+    template <typename T>
+    const T& get() const {
+        return std::get<Internals::static_stack_index<T, Layers...>::value>(layers_);
+    }
+
+    /**
+     * \brief Getter for the outermost layer, as a PDU.
+     *
+     * The returned PDU contains the rest of the layers as its inner PDUs.
+     */
+    PDU& pdu() {
+        return std::get<0>(layers_);
+    }
+
+    /**
+     * \brief Getter for the outermost layer, as a PDU.
+     */
+    const PDU& pdu() const {
+        return std::get<0>(layers_);
+    }
+
+    /**
+     * \brief Returns the size of the whole packet.
+     */
+    uint32_t size() const {
+        return size_from(index_constant<0>());
+    }
+
+    /**
+     * \brief Serializes the packet into the given buffer.
+     *
+     * \sa PDU::serialize(serialization_type&)
+     *
+     * \param buffer The buffer in which the packet will be serialized.
+     * This is only resized if it's too small.
+     * \return The size of the serialized packet.
+     */
+    uint32_t serialize(PDU::serialization_type& buffer) {
+        const uint32_t sz = size();
+        if (buffer.size() < sz) {
+            buffer.resize(sz);
+        }
+        if (sz > 0) {
+            serialize_from(index_constant<0>(), &buffer[0], sz);
+        }
+        return sz;
+    }
+
+    /**
+     * \brief Serializes the packet into a caller provided buffer.
+     *
+     * If the buffer is too small, a serialization_error exception is thrown.
+     *
+     * \sa PDU::serialize_into
+     *
+     * \param buffer The buffer in which the packet will be serialized.
+     * \param total_sz The size of the buffer.
+     * \return The size of the serialized packet.
+     */
+    uint32_t serialize_into(uint8_t* buffer, uint32_t total_sz) {
+        const uint32_t sz = size();
+        if (total_sz < sz) {
+            throw serialization_error();
+        }
+        if (sz > 0) {
+            serialize_from(index_constant<0>(), buffer, sz);
+        }
+        return sz;
+    }
+
+    /**
+     * \brief Serializes the packet into a new buffer.
+     */
+    PDU::serialization_type serialize() {
+        PDU::serialization_type buffer;
+        serialize(buffer);
+        return buffer;
+    }
+private:
+    template <size_t Index>
+    using index_constant = std::integral_constant<size_t, Index>;
+    typedef index_constant<sizeof...(Layers)> end_index;
+
+    template <size_t Index>
+    void link(index_constant<Index>) {
+        get<Index>().inner_pdu(&get<Index + 1>());
+        link(index_constant<Index + 1>());
+    }
+
+    void link(index_constant<sizeof...(Layers) - 1>) {
+        get<sizeof...(Layers) - 1>().inner_pdu(0);
+    }
+
+    template <size_t Index>
+    void unlink(index_constant<Index>) {
+        get<Index>().release_inner_pdu();
+        unlink(index_constant<Index + 1>());
+    }
+
+    void unlink(index_constant<sizeof...(Layers) - 1>) {
+
+    }
+
+    // The layers' types are known, so header and trailer sizes are 
+    // resolved without going through the vtable
+    template <size_t Index>
+    uint32_t size_from(index_constant<Index>) const {
+        typedef layer_type<Index> type;
+        const type& layer = get<Index>();
+        return layer.type::header_size() + layer.type::trailer_size() +
+               size_from(index_constant<Index + 1>());
+    }
+
+    uint32_t size_from(end_index) const {
+        return 0;
+    }
+
+    // Same as PDU::serialize, unrolled for this stack
+    template <size_t Index>
+    void serialize_from(index_constant<Index>, uint8_t* buffer, uint32_t total_sz) {
+        typedef layer_type<Index> type;
+        type& layer = get<Index>();
+        const uint32_t header_size = layer.type::header_size();
+        PDU& pdu = layer;
+        pdu.prepare_for_serialize();
+        serialize_from(
+            index_constant<Index + 1>(),
+            buffer + header_size,
+            total_sz - header_size - layer.type::trailer_size()
+        );
+        pdu.write_serialization(buffer, total_sz);
+    }
+
+    void serialize_from(end_index, uint8_t*, uint32_t) {
+
+    }
+
+    std::tuple<Layers...> layers_;
+};
+
+} // Tins
+
+#endif // TINS_IS_CXX11
+
+#endif // TINS_STATIC_STACK_H
@@ -39,6 +39,7 @@
 #include <tins/small_uint.h>
 #include <tins/pdu_option.h>
 #include <tins/cxxstd.h>
+#include <tins/detail/option_index.h>
 
 namespace Tins {
 namespace Memory {
@@ -146,6 +147,32 @@ public:
      */
     static metadata extract_metadata(const uint8_t *buffer, uint32_t total_sz);
 
+    /**
+     * \brief Sets the source port of a serialized TCP segment.
+     *
+     * The checksum is updated incrementally, so this takes constant time.
+     * A malformed_packet exception is thrown if the buffer is too small
+     * to contain a TCP header.
+     *
+     * \param buffer Pointer to the start of the TCP header.
+     * \param total_sz Size of the buffer pointed by buffer.
+     * \param new_sport The new source port.
+     */
+    static void patch_sport(uint8_t* buffer, uint32_t total_sz, uint16_t new_sport);
+
+    /**
+     * \brief Sets the destination port of a serialized TCP segment.
+     *
+     * The checksum is updated incrementally, so this takes constant time.
+     * A malformed_packet exception is thrown if the buffer is too small
+     * to contain a TCP header.
+     *
+     * \param buffer Pointer to the start of the TCP header.
+     * \param total_sz Size of the buffer pointed by buffer.
+     * \param new_dport The new destination port.
+     */
+    static void patch_dport(uint8_t* buffer, uint32_t total_sz, uint16_t new_dport);
+
     /**
      * \brief TCP constructor.
      *
@@ -249,6 +276,7 @@ public:
      * \return The options list.
      */
     const options_type& options() const {
+        parse_pending_options();
         return options_;
     }
 
@@ -477,7 +505,9 @@ public:
          * \param option The option to be added.
          */
         void add_option(option &&opt) {
+            parse_pending_options();
             options_.push_back(std::move(opt));
+            option_index_.invalidate();
         }
 
         /**
@@ -490,7 +520,9 @@ public:
          */
         template <typename... Args>
         void add_option(Args&&... args) {
+            parse_pending_options();
             options_.emplace_back(std::forward<Args>(args)...);
+            option_index_.invalidate();
         }
     #endif
 
@@ -547,6 +579,9 @@ public:
         return new TCP(*this);
     }
 private:
+    static void patch_field(uint8_t* buffer, uint32_t total_sz, uint32_t offset,
+                            uint16_t value);
+
     #if TINS_IS_LITTLE_ENDIAN
         TINS_BEGIN_PACK
         struct flags_type {
@@ -606,6 +641,16 @@ private:
         return opt->to<T>();
     }
     
+    // Options are parsed on first access when using DecodingScope::LAZY_OPTIONS
+    void parse_pending_options() const {
+        if (TINS_UNLIKELY(!pending_options_.empty())) {
+            parse_options(pending_options_.data(), pending_options_.size(), true);
+            pending_options_.clear();
+        }
+    }
+
+    void parse_options(const uint8_t* buffer, uint32_t total_sz, bool store) const;
+    void finish_lazy_parsing() const;
     void write_serialization(uint8_t* buffer, uint32_t total_sz);
     void checksum(uint16_t new_check);
     uint32_t calculate_options_size() const;
@@ -615,7 +660,9 @@ private:
     
     void write_option(const option& opt, Memory::OutputMemoryStream& stream);
 
-    options_type options_;
+    mutable options_type options_;
+    mutable Internals::PendingOptions pending_options_;
+    Internals::OptionIndex<option> option_index_;
     tcp_header header_;
 };
 
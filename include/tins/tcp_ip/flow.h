@@ -45,6 +45,7 @@ namespace Tins {
 
 class PDU;
 class TCP;
+class RawPDU;
 class IPv4Address;
 class IPv6Address;
 
@@ -162,6 +163,17 @@ public:
      */
     void process_packet(PDU& pdu);
 
+    /**
+     * \brief Processes a packet that can't be modified.
+     *
+     * This behaves like the non-const overload, but the packet's payload
+     * is copied rather than moved into this flow. This can be used on
+     * PDUs shared between several Packets.
+     *
+     * \param pdu The packet to be processed
+     */
+    void process_packet(const PDU& pdu);
+
     /**
      * \brief Skip forward to a sequence number
      *
@@ -323,6 +335,8 @@ private:
     };
 
     void update_state(const TCP& tcp);
+    bool process_segment(const TCP* tcp, const RawPDU* raw);
+    void process_payload(uint32_t seq, payload_type payload);
     void initialize();
 
     DataTracker data_tracker_;
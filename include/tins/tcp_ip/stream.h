@@ -111,7 +111,7 @@ public:
      * \param initial_packet The first packet of the stream
      * \param ts The first packet's timestamp
      */
-    Stream(PDU& initial_packet, const timestamp_type& ts = timestamp_type());
+    Stream(const PDU& initial_packet, const timestamp_type& ts = timestamp_type());
 
     /**
      * \brief Processes this packet.
@@ -124,6 +124,17 @@ public:
      */
     void process_packet(PDU& packet, const timestamp_type& ts);
 
+    /**
+     * \brief Processes a packet that can't be modified.
+     *
+     * The packet's payload is copied rather than moved into the flows.
+     *
+     * \param packet The packet to be processed
+     * \param ts The packet's timestamp
+     * \sa Flow::process_packet
+     */
+    void process_packet(const PDU& packet, const timestamp_type& ts);
+
     /**
      * \brief Processes this packet.
      *
@@ -426,6 +437,8 @@ public:
 private:
     static Flow extract_client_flow(const PDU& packet);
     static Flow extract_server_flow(const PDU& packet);
+    Flow* packet_flow(const PDU& packet);
+    void check_stream_closed();
 
     void on_client_flow_data(const Flow& flow);
     void on_server_flow_data(const Flow& flow);
@@ -216,7 +216,9 @@ private:
     typedef std::map<stream_id, Stream> streams_type;
 
     Stream& find_stream(const stream_id& id);
-    void process_packet(PDU& packet, const timestamp_type& ts);
+    // PDUType is either PDU or const PDU, the latter for shared Packets
+    template <typename PDUType>
+    void process_packet(PDUType& packet, const timestamp_type& ts);
     void cleanup_streams(const timestamp_type& now);
 
     streams_type streams_;
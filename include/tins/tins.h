@@ -55,6 +55,11 @@
 #include <tins/rawpdu.h>
 #include <tins/snap.h>
 #include <tins/sniffer.h>
+#include <tins/batch_decoder.h>
+#include <tins/ring_sniffer.h>
+#include <tins/pcap_file_reader.h>
+#include <tins/pcapng.h>
+#include <tins/parallel_file_sniffer.h>
 #include <tins/tcp.h>
 #include <tins/udp.h>
 #include <tins/utils.h>
@@ -77,5 +82,9 @@
 #include <tins/ip_reassembler.h>
 #include <tins/ppi.h>
 #include <tins/pdu_iterator.h>
+#include <tins/packet_view.h>
+#include <tins/packet_editor.h>
+#include <tins/static_stack.h>
+#include <tins/decoding_scope.h>
 
 #endif // TINS_TINS_H
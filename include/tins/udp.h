@@ -75,6 +75,34 @@ public:
      */
     static metadata extract_metadata(const uint8_t *buffer, uint32_t total_sz);
 
+    /**
+     * \brief Sets the source port of a serialized UDP segment.
+     *
+     * The checksum is updated incrementally, so this takes constant time.
+     * Segments which don't use a checksum are left without one.
+     * A malformed_packet exception is thrown if the buffer is too small
+     * to contain a UDP header.
+     *
+     * \param buffer Pointer to the start of the UDP header.
+     * \param total_sz Size of the buffer pointed by buffer.
+     * \param new_sport The new source port.
+     */
+    static void patch_sport(uint8_t* buffer, uint32_t total_sz, uint16_t new_sport);
+
+    /**
+     * \brief Sets the destination port of a serialized UDP segment.
+     *
+     * The checksum is updated incrementally, so this takes constant time.
+     * Segments which don't use a checksum are left without one.
+     * A malformed_packet exception is thrown if the buffer is too small
+     * to contain a UDP header.
+     *
+     * \param buffer Pointer to the start of the UDP header.
+     * \param total_sz Size of the buffer pointed by buffer.
+     * \param new_dport The new destination port.
+     */
+    static void patch_dport(uint8_t* buffer, uint32_t total_sz, uint16_t new_dport);
+
     /** 
      * \brief UDP constructor.
      *
@@ -183,6 +211,9 @@ public:
         return new UDP(*this);
     }
 private:
+    static void patch_field(uint8_t* buffer, uint32_t total_sz, uint32_t offset,
+                            uint16_t value);
+
     TINS_BEGIN_PACK
     struct udp_header {
         uint16_t sport;
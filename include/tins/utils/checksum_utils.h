@@ -92,6 +92,36 @@ TINS_API uint32_t pseudoheader_checksum(IPv6Address source_ip,
                                         uint16_t len,
                                         uint16_t flag);
 
+/**
+ * \brief Updates a checksum after a 16 bit word it covers has changed.
+ *
+ * This uses the method described in RFC 1624, so the checksum can be
+ * updated without having to sum the whole buffer again. Every value,
+ * including the checksum, must be in host endian.
+ *
+ * \param checksum The current checksum.
+ * \param old_value The previous value of the modified word.
+ * \param new_value The new value of the modified word.
+ * \return The updated checksum.
+ */
+TINS_API uint16_t update_checksum(uint16_t checksum, uint16_t old_value,
+                                  uint16_t new_value);
+
+/**
+ * \brief Updates a checksum after a range of bytes it covers has changed.
+ *
+ * The modified range must start at an even offset from the start of the
+ * checksummed data, and its size must be even.
+ *
+ * \param checksum The current checksum, in host endian.
+ * \param old_data The previous contents of the modified range.
+ * \param new_data The new contents of the modified range.
+ * \param data_size The size of the modified range.
+ * \return The updated checksum.
+ */
+TINS_API uint16_t update_checksum(uint16_t checksum, const uint8_t* old_data,
+                                  const uint8_t* new_data, uint32_t data_size);
+
 /**
  * \brief Returns the 32 bit crc of the given buffer.
  *
@@ -100,6 +130,25 @@ TINS_API uint32_t pseudoheader_checksum(IPv6Address source_ip,
  */
 TINS_API uint32_t crc32(const uint8_t* data, uint32_t data_size);
 
+/**
+ * \brief Validates the frame check sequence of several frames.
+ *
+ * Each frame must end with its 4 byte FCS, which is the little endian
+ * CRC32 of the rest of the frame, as used by IEEE 802.3 and 802.11. Frames
+ * shorter than 4 bytes are considered invalid.
+ *
+ * \param frames Pointers to the start of each frame.
+ * \param frame_sizes The size of each frame, including its FCS.
+ * \param frame_count The amount of frames.
+ * \param results Output array where the result for each frame is stored.
+ * This can be a null pointer.
+ * \return The amount of frames that have a valid FCS.
+ */
+TINS_API uint32_t validate_fcs(const uint8_t* const* frames,
+                               const uint32_t* frame_sizes,
+                               uint32_t frame_count,
+                               bool* results);
+
 } // Utils
 } // Tins
 
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+#include <tins/batch_decoder.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <algorithm>
+#if TINS_IS_CXX11
+    #include <atomic>
+    #include <condition_variable>
+    #include <exception>
+    #include <mutex>
+    #include <thread>
+#endif // TINS_IS_CXX11
+#include <tins/decoding_scope.h>
+#include <tins/exceptions.h>
+
+using std::vector;
+using std::min;
+
+namespace Tins {
+
+// The amount of frames a thread takes from the batch at a time
+const size_t frames_per_chunk = 64;
+
+// Decodes frames [start, end). Malformed frames produce an empty Packet
+void decode_frames(Internals::frame_decoder decoder, const BatchDecoder::frame* frames,
+                   size_t start, size_t end, Packet* output) {
+    for (size_t i = start; i < end; ++i) {
+        PDU* pdu = 0;
+        try {
+            pdu = decoder(frames[i].buffer, frames[i].size);
+        }
+        catch (malformed_packet&) {
+        }
+        if (pdu) {
+            output[i] = Packet(pdu, frames[i].timestamp, Packet::own_pdu());
+        }
+        else {
+            output[i] = Packet();
+        }
+    }
+}
+
+#if TINS_IS_CXX11
+
+class BatchDecoder::worker_pool {
+public:
+    worker_pool(Internals::frame_decoder decoder, uint32_t worker_count)
+    : decoder_(decoder), frames_(nullptr), output_(nullptr), frame_count_(0),
+    next_frame_(0), flags_(0), generation_(0), pending_workers_(0), stopping_(false) {
+        for (uint32_t i = 0; i < worker_count; ++i) {
+            workers_.emplace_back(&worker_pool::worker_loop, this);
+        }
+    }
+
+    ~worker_pool() {
+        {
+            std::lock_guard<std::mutex> _(mutex_);
+            stopping_ = true;
+        }
+        work_available_.notify_all();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    uint32_t worker_count() const {
+        return static_cast<uint32_t>(workers_.size());
+    }
+
+    void decode(const frame* frames, size_t count, Packet* output) {
+        {
+            std::lock_guard<std::mutex> _(mutex_);
+            frames_ = frames;
+            output_ = output;
+            frame_count_ = count;
+            next_frame_ = 0;
+            flags_ = DecodingScope::current_flags();
+            error_ = nullptr;
+            pending_workers_ = workers_.size();
+            ++generation_;
+        }
+        work_available_.notify_all();
+        // The calling thread decodes frames as well
+        process_frames();
+        std::unique_lock<std::mutex> lock(mutex_);
+        work_done_.wait(lock, [&]() { return pending_workers_ == 0; });
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+private:
+    void worker_loop() {
+        uint64_t last_generation = 0;
+        while (true) {
+            uint32_t flags;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                work_available_.wait(lock, [&]() {
+                    return stopping_ || generation_ != last_generation;
+                });
+                if (stopping_) {
+                    return;
+                }
+                last_generation = generation_;
+                flags = flags_;
+            }
+            {
+                DecodingScope scope(flags);
+                process_frames();
+            }
+            {
+                std::lock_guard<std::mutex> _(mutex_);
+                --pending_workers_;
+            }
+            work_done_.notify_one();
+        }
+    }
+
+    void process_frames() {
+        try {
+            while (true) {
+                const size_t start = next_frame_.fetch_add(frames_per_chunk);
+                if (start >= frame_count_) {
+                    break;
+                }
+                const size_t end = min(start + frames_per_chunk, frame_count_);
+                decode_frames(decoder_, frames_, start, end, output_);
+            }
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> _(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            // Make every other thread stop as soon as possible
+            next_frame_ = frame_count_;
+        }
+    }
+
+    Internals::frame_decoder decoder_;
+    vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable work_available_;
+    std::condition_variable work_done_;
+    const frame* frames_;
+    Packet* output_;
+    size_t frame_count_;
+    std::atomic<size_t> next_frame_;
+    uint32_t flags_;
+    uint64_t generation_;
+    size_t pending_workers_;
+    std::exception_ptr error_;
+    bool stopping_;
+};
+
+uint32_t default_thread_count() {
+    const uint32_t count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+#else
+
+// Without C++11 there are no worker threads, frames are decoded on the calling thread
+class BatchDecoder::worker_pool {
+public:
+    worker_pool(Internals::frame_decoder decoder, uint32_t)
+    : decoder_(decoder) {
+
+    }
+
+    uint32_t worker_count() const {
+        return 0;
+    }
+
+    void decode(const frame* frames, size_t count, Packet* output) {
+        decode_frames(decoder_, frames, 0, count, output);
+    }
+private:
+    Internals::frame_decoder decoder_;
+};
+
+uint32_t default_thread_count() {
+    return 1;
+}
+
+#endif // TINS_IS_CXX11
+
+BatchDecoder::BatchDecoder(int link_type, uint32_t thread_count)
+: decoder_(Internals::frame_decoder_from_dlt_flag(link_type)), pool_(0) {
+    if (thread_count == 0) {
+        thread_count = default_thread_count();
+    }
+    pool_ = new worker_pool(decoder_, thread_count - 1);
+}
+
+BatchDecoder::~BatchDecoder() {
+    delete pool_;
+}
+
+void BatchDecoder::decode(const frame* frames, size_t count, Packet* output) {
+    if (count == 0) {
+        return;
+    }
+    // Small batches aren't worth waking up the workers for
+    if (count <= frames_per_chunk) {
+        decode_frames(decoder_, frames, 0, count, output);
+    }
+    else {
+        pool_->decode(frames, count, output);
+    }
+}
+
+void BatchDecoder::decode(const vector<frame>& frames, vector<Packet>& output) {
+    output.resize(frames.size());
+    if (!frames.empty()) {
+        decode(&frames[0], frames.size(), &output[0]);
+    }
+}
+
+uint32_t BatchDecoder::thread_count() const {
+    return pool_->worker_count() + 1;
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
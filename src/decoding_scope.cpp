@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+
+#include <tins/decoding_scope.h>
+#include <tins/cxxstd.h>
+
+namespace Tins {
+
+#if TINS_IS_CXX11
+static thread_local uint32_t decoding_flags = 0;
+static thread_local uint32_t malformed_layer_count = 0;
+#else
+// Without thread local storage, the flags are shared by every thread
+static uint32_t decoding_flags = 0;
+static uint32_t malformed_layer_count = 0;
+#endif // TINS_IS_CXX11
+
+DecodingScope::DecodingScope(uint32_t flags)
+: previous_flags_(decoding_flags), initial_malformed_layers_(malformed_layer_count) {
+    decoding_flags = flags;
+}
+
+DecodingScope::~DecodingScope() {
+    decoding_flags = previous_flags_;
+}
+
+uint32_t DecodingScope::current_flags() {
+    return decoding_flags;
+}
+
+uint32_t DecodingScope::malformed_layers() const {
+    return malformed_layer_count - initial_malformed_layers_;
+}
+
+void DecodingScope::record_malformed_layer() {
+    ++malformed_layer_count;
+}
+
+} // Tins
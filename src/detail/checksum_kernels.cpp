@@ -0,0 +1,389 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <tins/detail/checksum_kernels.h>
+#include <cstring>
+#include <stddef.h>
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+    #define TINS_CHECKSUM_SSE2
+    #include <emmintrin.h>
+    // AVX2 and PCLMULQDQ code is enabled per function and only used if
+    // the CPU supports it
+    #if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+        #define TINS_CHECKSUM_AVX2
+        #define TINS_CRC32_PCLMUL
+        #include <immintrin.h>
+    #endif
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_AMD64))
+    #define TINS_CHECKSUM_SSE2
+    #include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #define TINS_CHECKSUM_NEON
+    #include <arm_neon.h>
+#endif
+
+using std::memcpy;
+
+namespace Tins {
+namespace Internals {
+
+// Every kernel sums 32 bit words into a 64 bit accumulator. Folding that
+// into 16 bits yields the same value as summing 16 bit words, and it won't
+// overflow for any buffer that fits in memory
+uint16_t fold_sum(uint64_t sum) {
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    sum = (sum & 0xffffffff) + (sum >> 32);
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(sum);
+}
+
+uint64_t scalar_sum(const uint8_t* ptr, size_t size) {
+    uint64_t sum = 0;
+    uint32_t word32;
+    while (size >= sizeof(word32)) {
+        memcpy(&word32, ptr, sizeof(word32));
+        sum += word32;
+        ptr += sizeof(word32);
+        size -= sizeof(word32);
+    }
+    uint16_t word16;
+    if (size >= sizeof(word16)) {
+        memcpy(&word16, ptr, sizeof(word16));
+        sum += word16;
+        ptr += sizeof(word16);
+        size -= sizeof(word16);
+    }
+    // The last byte is padded with a zero
+    if (size > 0) {
+        const uint8_t padded[sizeof(word16)] = { *ptr, 0 };
+        memcpy(&word16, padded, sizeof(word16));
+        sum += word16;
+    }
+    return sum;
+}
+
+#ifdef TINS_CHECKSUM_SSE2
+
+uint64_t sse2_sum(const uint8_t* ptr, size_t size) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum1 = zero;
+    __m128i sum2 = zero;
+    while (size >= 32) {
+        const __m128i data1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+        const __m128i data2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr + 16));
+        sum1 = _mm_add_epi64(sum1, _mm_unpacklo_epi32(data1, zero));
+        sum2 = _mm_add_epi64(sum2, _mm_unpackhi_epi32(data1, zero));
+        sum1 = _mm_add_epi64(sum1, _mm_unpacklo_epi32(data2, zero));
+        sum2 = _mm_add_epi64(sum2, _mm_unpackhi_epi32(data2, zero));
+        ptr += 32;
+        size -= 32;
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi64(sum1, sum2));
+    return lanes[0] + lanes[1] + scalar_sum(ptr, size);
+}
+
+#endif // TINS_CHECKSUM_SSE2
+
+#ifdef TINS_CHECKSUM_AVX2
+
+__attribute__((target("avx2")))
+uint64_t avx2_sum(const uint8_t* ptr, size_t size) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum1 = zero;
+    __m256i sum2 = zero;
+    while (size >= 64) {
+        const __m256i data1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr));
+        const __m256i data2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(ptr + 32));
+        sum1 = _mm256_add_epi64(sum1, _mm256_unpacklo_epi32(data1, zero));
+        sum2 = _mm256_add_epi64(sum2, _mm256_unpackhi_epi32(data1, zero));
+        sum1 = _mm256_add_epi64(sum1, _mm256_unpacklo_epi32(data2, zero));
+        sum2 = _mm256_add_epi64(sum2, _mm256_unpackhi_epi32(data2, zero));
+        ptr += 64;
+        size -= 64;
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(sum1, sum2));
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sse2_sum(ptr, size);
+}
+
+#endif // TINS_CHECKSUM_AVX2
+
+#ifdef TINS_CHECKSUM_NEON
+
+uint64_t neon_sum(const uint8_t* ptr, size_t size) {
+    uint64x2_t sum1 = vdupq_n_u64(0);
+    uint64x2_t sum2 = vdupq_n_u64(0);
+    while (size >= 32) {
+        sum1 = vpadalq_u32(sum1, vreinterpretq_u32_u8(vld1q_u8(ptr)));
+        sum2 = vpadalq_u32(sum2, vreinterpretq_u32_u8(vld1q_u8(ptr + 16)));
+        ptr += 32;
+        size -= 32;
+    }
+    const uint64x2_t sum = vaddq_u64(sum1, sum2);
+    return vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1) + scalar_sum(ptr, size);
+}
+
+#endif // TINS_CHECKSUM_NEON
+
+bool checksum_kernel_supported(checksum_kernel kernel) {
+    switch (kernel) {
+        case CHECKSUM_KERNEL_SCALAR:
+            return true;
+        #ifdef TINS_CHECKSUM_SSE2
+        case CHECKSUM_KERNEL_SSE2:
+            return true;
+        #endif // TINS_CHECKSUM_SSE2
+        #ifdef TINS_CHECKSUM_AVX2
+        case CHECKSUM_KERNEL_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+        #endif // TINS_CHECKSUM_AVX2
+        #ifdef TINS_CHECKSUM_NEON
+        case CHECKSUM_KERNEL_NEON:
+            return true;
+        #endif // TINS_CHECKSUM_NEON
+        default:
+            return false;
+    }
+}
+
+checksum_kernel detect_checksum_kernel() {
+    const checksum_kernel kernels[] = {
+        CHECKSUM_KERNEL_AVX2,
+        CHECKSUM_KERNEL_SSE2,
+        CHECKSUM_KERNEL_NEON
+    };
+    for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); ++i) {
+        if (checksum_kernel_supported(kernels[i])) {
+            return kernels[i];
+        }
+    }
+    return CHECKSUM_KERNEL_SCALAR;
+}
+
+checksum_kernel best_checksum_kernel() {
+    static const checksum_kernel kernel = detect_checksum_kernel();
+    return kernel;
+}
+
+uint16_t checksum_sum_range(checksum_kernel kernel, const uint8_t* start,
+                            const uint8_t* end) {
+    const size_t size = end - start;
+    switch (kernel) {
+        #ifdef TINS_CHECKSUM_SSE2
+        case CHECKSUM_KERNEL_SSE2:
+            return fold_sum(sse2_sum(start, size));
+        #endif // TINS_CHECKSUM_SSE2
+        #ifdef TINS_CHECKSUM_AVX2
+        case CHECKSUM_KERNEL_AVX2:
+            return fold_sum(avx2_sum(start, size));
+        #endif // TINS_CHECKSUM_AVX2
+        #ifdef TINS_CHECKSUM_NEON
+        case CHECKSUM_KERNEL_NEON:
+            return fold_sum(neon_sum(start, size));
+        #endif // TINS_CHECKSUM_NEON
+        default:
+            return fold_sum(scalar_sum(start, size));
+    }
+}
+
+// CRC32
+
+struct crc32_tables {
+    crc32_tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc & 1) ? ((crc >> 1) ^ 0xedb88320) : (crc >> 1);
+            }
+            values[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int slice = 1; slice < 8; ++slice) {
+                const uint32_t previous = values[slice - 1][i];
+                values[slice][i] = (previous >> 8) ^ values[0][previous & 0xff];
+            }
+        }
+    }
+
+    uint32_t values[8][256];
+};
+
+const crc32_tables& get_crc32_tables() {
+    static const crc32_tables tables;
+    return tables;
+}
+
+uint32_t read_le32(const uint8_t* ptr) {
+    return ptr[0] | (static_cast<uint32_t>(ptr[1]) << 8) |
+           (static_cast<uint32_t>(ptr[2]) << 16) | (static_cast<uint32_t>(ptr[3]) << 24);
+}
+
+// Both of these take and return the CRC before its final inversion
+uint32_t slice_by_8_crc32(uint32_t crc, const uint8_t* data, size_t size) {
+    const uint32_t (&table)[8][256] = get_crc32_tables().values;
+    while (size >= 8) {
+        const uint32_t low = read_le32(data) ^ crc;
+        const uint32_t high = read_le32(data + 4);
+        crc = table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff] ^
+              table[5][(low >> 16) & 0xff] ^ table[4][low >> 24] ^
+              table[3][high & 0xff] ^ table[2][(high >> 8) & 0xff] ^
+              table[1][(high >> 16) & 0xff] ^ table[0][high >> 24];
+        data += 8;
+        size -= 8;
+    }
+    while (size--) {
+        crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xff];
+    }
+    return crc;
+}
+
+#ifdef TINS_CRC32_PCLMUL
+
+// Folds 64 bytes at a time using carry-less multiplications, as described
+// in Intel's "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+// Instruction". size must be at least 64 and a multiple of 16
+__attribute__((target("pclmul,sse4.1")))
+uint32_t pclmul_crc32_blocks(uint32_t crc, const uint8_t* data, size_t size) {
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+    const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+    __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32));
+    __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+    data += 64;
+    size -= 64;
+
+    // Fold 4 blocks of 16 bytes in parallel
+    while (size >= 64) {
+        const __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        const __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        const __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        const __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)));
+        data += 64;
+        size -= 64;
+    }
+
+    // Fold the 4 blocks into a single one
+    const __m128i folded[] = { x2, x3, x4 };
+    for (size_t i = 0; i < 3; ++i) {
+        const __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, folded[i]), x5);
+    }
+
+    // Fold any remaining blocks of 16 bytes
+    while (size >= 16) {
+        const __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data))), x5);
+        data += 16;
+        size -= 16;
+    }
+
+    // Fold 128 bits into 64 bits
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction into 32 bits
+    x2 = _mm_and_si128(x1, mask);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+#endif // TINS_CRC32_PCLMUL
+
+bool crc32_kernel_supported(crc32_kernel kernel) {
+    switch (kernel) {
+        case CRC32_KERNEL_SLICE_BY_8:
+            return true;
+        #ifdef TINS_CRC32_PCLMUL
+        case CRC32_KERNEL_PCLMUL:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("pclmul") != 0 &&
+                   __builtin_cpu_supports("sse4.1") != 0;
+        #endif // TINS_CRC32_PCLMUL
+        default:
+            return false;
+    }
+}
+
+crc32_kernel best_crc32_kernel() {
+    static const crc32_kernel kernel = crc32_kernel_supported(CRC32_KERNEL_PCLMUL) ?
+                                       CRC32_KERNEL_PCLMUL : CRC32_KERNEL_SLICE_BY_8;
+    return kernel;
+}
+
+uint32_t crc32_update(crc32_kernel kernel, uint32_t crc, const uint8_t* data,
+                      uint32_t data_size) {
+    crc = ~crc;
+    size_t size = data_size;
+    #ifdef TINS_CRC32_PCLMUL
+    if (kernel == CRC32_KERNEL_PCLMUL && size >= 64) {
+        const size_t blocks_size = size & ~static_cast<size_t>(15);
+        crc = pclmul_crc32_blocks(crc, data, blocks_size);
+        data += blocks_size;
+        size -= blocks_size;
+    }
+    #else
+    (void)kernel;
+    #endif // TINS_CRC32_PCLMUL
+    return ~slice_by_8_crc32(crc, data, size);
+}
+
+} // namespace Internals
+} // namespace Tins
@@ -28,12 +28,19 @@
  */
 
 #include <tins/detail/pdu_helpers.h>
+#include <cstring>
 #ifdef TINS_HAVE_PCAP
     #include <pcap.h>
 #endif // TINS_HAVE_PCAP
+#ifdef TINS_HAVE_PACKET_RING
+    #include <net/if_arp.h>
+#endif // TINS_HAVE_PACKET_RING
 #include <tins/ip.h>
 #include <tins/ethernetII.h>
 #include <tins/ieee802_3.h>
+#include <tins/dot3.h>
+#include <tins/pktap.h>
+#include <tins/exceptions.h>
 #include <tins/radiotap.h>
 #include <tins/dot11/dot11_base.h>
 #include <tins/ipv6.h>
@@ -52,6 +59,9 @@
 #include <tins/dot1q.h>
 #include <tins/pppoe.h>
 #include <tins/pdu_allocator.h>
+#include <tins/utils/checksum_utils.h>
+
+using std::memcpy;
 
 namespace Tins {
 namespace Internals {
@@ -115,6 +125,16 @@ Tins::PDU* pdu_from_flag(Constants::IP::e flag,
         case Constants::IP::PROTO_ESP:
             return new Tins::IPSecESP(buffer, size);
         default:
+            {
+                PDU* pdu = Internals::allocate<IP>(
+                    static_cast<uint8_t>(flag),
+                    buffer,
+                    size
+                );
+                if (pdu) {
+                    return pdu;
+                }
+            }
             break;
     }
     if (rawpdu_on_no_match) {
@@ -155,6 +175,130 @@ PDU* pdu_from_dlt_flag(int flag,
 }
 #endif // TINS_HAVE_PCAP
 
+template <typename T>
+PDU* decode_frame(const uint8_t* buffer, uint32_t size) {
+    return new T(buffer, size);
+}
+
+PDU* decode_raw_frame(const uint8_t* buffer, uint32_t size) {
+    return new RawPDU(buffer, size);
+}
+
+PDU* decode_ethernet_frame(const uint8_t* buffer, uint32_t size) {
+    if (is_dot3(buffer, size)) {
+        return new Dot3(buffer, size);
+    }
+    return new EthernetII(buffer, size);
+}
+
+PDU* decode_raw_ip_frame(const uint8_t* buffer, uint32_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    switch (buffer[0] >> 4) {
+        case 4:
+            return new IP(buffer, size);
+        case 6:
+            return new IPv6(buffer, size);
+        default:
+            return 0;
+    }
+}
+
+#ifdef TINS_HAVE_DOT11
+PDU* decode_dot11_frame(const uint8_t* buffer, uint32_t size) {
+    return Dot11::from_bytes(buffer, size);
+}
+#endif // TINS_HAVE_DOT11
+
+#ifdef TINS_HAVE_PCAP
+frame_decoder frame_decoder_from_dlt_flag(int flag) {
+    switch (flag) {
+        case DLT_EN10MB:
+            return &decode_ethernet_frame;
+        case DLT_NULL:
+            return &decode_frame<Loopback>;
+        case DLT_LINUX_SLL:
+            return &decode_frame<SLL>;
+        case DLT_PPI:
+            return &decode_frame<PPI>;
+        case DLT_RAW:
+            return &decode_raw_ip_frame;
+
+        #ifdef TINS_HAVE_DOT11
+        case DLT_IEEE802_11_RADIO:
+            return &decode_frame<RadioTap>;
+        case DLT_IEEE802_11:
+            return &decode_dot11_frame;
+        #else // TINS_HAVE_DOT11
+        case DLT_IEEE802_11_RADIO:
+        case DLT_IEEE802_11:
+            throw protocol_disabled();
+        #endif // TINS_HAVE_DOT11
+
+        #ifdef DLT_PKTAP
+        case DLT_PKTAP:
+            return &decode_frame<PKTAP>;
+        #endif // DLT_PKTAP
+        default:
+            throw unknown_link_type();
+    }
+}
+
+const uint32_t linktype_raw = 101;
+const uint32_t linktype_pktap = 258;
+
+int dlt_from_link_type(uint32_t link_type) {
+    switch (link_type) {
+        case linktype_raw:
+            return DLT_RAW;
+        #ifdef DLT_PKTAP
+        case linktype_pktap:
+            return DLT_PKTAP;
+        #endif // DLT_PKTAP
+        default:
+            return static_cast<int>(link_type);
+    }
+}
+
+uint32_t link_type_from_dlt(int dlt) {
+    switch (dlt) {
+        case DLT_RAW:
+            return linktype_raw;
+        #ifdef DLT_PKTAP
+        case DLT_PKTAP:
+            return linktype_pktap;
+        #endif // DLT_PKTAP
+        default:
+            return static_cast<uint32_t>(dlt);
+    }
+}
+#endif // TINS_HAVE_PCAP
+
+#ifdef TINS_HAVE_PACKET_RING
+frame_decoder frame_decoder_from_hardware_type(int type) {
+    switch (type) {
+        // The loopback interface uses ethernet headers with zeroed addresses
+        case ARPHRD_ETHER:
+        case ARPHRD_LOOPBACK:
+            return &decode_ethernet_frame;
+        // Interfaces such as tun ones don't have a link layer header
+        case ARPHRD_NONE:
+            return &decode_raw_ip_frame;
+
+        #ifdef TINS_HAVE_DOT11
+        case ARPHRD_IEEE80211_RADIOTAP:
+            return &decode_frame<RadioTap>;
+        case ARPHRD_IEEE80211:
+            return &decode_dot11_frame;
+        #endif // TINS_HAVE_DOT11
+
+        default:
+            return &decode_raw_frame;
+    }
+}
+#endif // TINS_HAVE_PACKET_RING
+
 Tins::PDU* pdu_from_flag(PDU::PDUType type, const uint8_t* buffer, uint32_t size) {
     switch(type) {
         case Tins::PDU::ETHERNET_II:
@@ -201,6 +345,137 @@ Tins::PDU* pdu_from_flag(PDU::PDUType type, const uint8_t* buffer, uint32_t size
     };
 }
 
+PDU* decode_ether_payload(uint32_t ether_type, const uint8_t* buffer, uint32_t size) {
+    return pdu_from_flag(static_cast<Constants::Ethernet::e>(ether_type), buffer, size);
+}
+
+PDU* decode_ip_payload(uint32_t protocol, const uint8_t* buffer, uint32_t size) {
+    return pdu_from_flag(static_cast<Constants::IP::e>(protocol), buffer, size);
+}
+
+PDU* decode_raw_payload(uint32_t, const uint8_t* buffer, uint32_t size) {
+    return new RawPDU(buffer, size);
+}
+
+#ifdef TINS_HAVE_DOT11
+PDU* decode_dot11_payload(uint32_t, const uint8_t* buffer, uint32_t size) {
+    return Dot11::from_bytes(buffer, size);
+}
+#endif // TINS_HAVE_DOT11
+
+// Minimum sizes of the headers checked by layer_fits
+const uint32_t ethernet_header_size = 14;
+const uint32_t ip_min_header_size = 20;
+const uint32_t ipv6_header_size = 40;
+const uint32_t tcp_min_header_size = 20;
+const uint32_t udp_header_size = 8;
+const uint32_t icmp_header_size = 8;
+const uint32_t arp_header_size = 28;
+const uint32_t dot1q_header_size = 4;
+
+bool inner_pdu_fits(PDU* (*decoder)(uint32_t, const uint8_t*, uint32_t),
+                    uint32_t identifier, const uint8_t* buffer, uint32_t size) {
+    PDU::PDUType type;
+    if (decoder == &decode_ether_payload) {
+        type = ether_type_to_pdu_flag(static_cast<Constants::Ethernet::e>(identifier));
+    }
+    else if (decoder == &decode_ip_payload) {
+        type = ip_type_to_pdu_flag(static_cast<Constants::IP::e>(identifier));
+    }
+    else if (decoder == &decode_payload_as<IP>) {
+        type = PDU::IP;
+    }
+    else if (decoder == &decode_payload_as<IPv6>) {
+        type = PDU::IPv6;
+    }
+    else if (decoder == &decode_payload_as<EthernetII>) {
+        type = PDU::ETHERNET_II;
+    }
+    else {
+        return true;
+    }
+    return layer_fits(type, buffer, size);
+}
+
+bool is_ipv6_extension_header(uint8_t header_id) {
+    switch (header_id) {
+        case IPv6::HOP_BY_HOP:
+        case IPv6::ROUTING:
+        case IPv6::FRAGMENT:
+        case IPv6::AUTHENTICATION:
+        case IPv6::SECURITY_ENCAPSULATION:
+        case IPv6::DESTINATION_OPTIONS:
+        case IPv6::MOBILITY:
+        case IPv6::NO_NEXT_HEADER:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Every extension header's next header and length fields must be there
+bool ipv6_headers_fit(const uint8_t* buffer, uint32_t size) {
+    if (size < ipv6_header_size) {
+        return false;
+    }
+    uint8_t next_header = buffer[6];
+    uint32_t offset = ipv6_header_size;
+    while (is_ipv6_extension_header(next_header)) {
+        if (size - offset < 2) {
+            return false;
+        }
+        next_header = buffer[offset];
+        offset += (static_cast<uint32_t>(buffer[offset + 1]) + 1) * 8;
+        if (offset > size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool layer_fits(PDU::PDUType type, const uint8_t* buffer, uint32_t size) {
+    uint32_t header_size;
+    switch (type) {
+        case PDU::ETHERNET_II:
+        case PDU::IEEE802_3:
+            return size >= ethernet_header_size;
+        case PDU::IP:
+            if (size < ip_min_header_size) {
+                return false;
+            }
+            header_size = (buffer[0] & 0x0f) * sizeof(uint32_t);
+            return header_size >= ip_min_header_size && header_size <= size;
+        case PDU::IPv6:
+            return ipv6_headers_fit(buffer, size);
+        case PDU::TCP:
+            if (size < tcp_min_header_size) {
+                return false;
+            }
+            header_size = (buffer[12] >> 4) * sizeof(uint32_t);
+            return header_size >= tcp_min_header_size && header_size <= size;
+        case PDU::UDP:
+            return size >= udp_header_size;
+        case PDU::ICMP:
+            return size >= icmp_header_size;
+        case PDU::ARP:
+            return size >= arp_header_size;
+        case PDU::DOT1Q:
+            return size >= dot1q_header_size;
+        default:
+            return true;
+    }
+}
+
+uint8_t ipv6_payload_protocol(const uint8_t* buffer) {
+    uint8_t next_header = buffer[6];
+    uint32_t offset = ipv6_header_size;
+    while (is_ipv6_extension_header(next_header) && next_header != IPv6::FRAGMENT) {
+        next_header = buffer[offset];
+        offset += (static_cast<uint32_t>(buffer[offset + 1]) + 1) * 8;
+    }
+    return next_header;
+}
+
 Constants::Ethernet::e pdu_flag_to_ether_type(PDU::PDUType flag) {
     switch (flag) {
         case PDU::IP:
@@ -294,5 +569,49 @@ PDU::PDUType ip_type_to_pdu_flag(Constants::IP::e flag) {
     };
 }
 
+void patch_checksummed_field(uint8_t* field, const uint8_t* new_data,
+                             uint32_t data_size, uint8_t* checksum) {
+    if (checksum) {
+        uint16_t value = static_cast<uint16_t>((checksum[0] << 8) | checksum[1]);
+        value = Utils::update_checksum(value, field, new_data, data_size);
+        checksum[0] = static_cast<uint8_t>(value >> 8);
+        checksum[1] = static_cast<uint8_t>(value & 0xff);
+    }
+    memcpy(field, new_data, data_size);
+}
+
+void patch_pseudoheader_checksum(Constants::IP::e protocol, uint8_t* buffer,
+                                 uint32_t total_sz, const uint8_t* old_data,
+                                 const uint8_t* new_data, uint32_t data_size) {
+    uint32_t checksum_offset;
+    if (protocol == Constants::IP::PROTO_TCP) {
+        checksum_offset = 16;
+    }
+    else if (protocol == Constants::IP::PROTO_UDP) {
+        checksum_offset = 6;
+    }
+    else if (protocol == Constants::IP::PROTO_ICMPV6) {
+        checksum_offset = 2;
+    }
+    else {
+        return;
+    }
+    if (total_sz < checksum_offset + sizeof(uint16_t)) {
+        return;
+    }
+    uint8_t* checksum = buffer + checksum_offset;
+    uint16_t value = static_cast<uint16_t>((checksum[0] << 8) | checksum[1]);
+    // A zero UDP checksum means there's no checksum at all
+    if (protocol == Constants::IP::PROTO_UDP && value == 0) {
+        return;
+    }
+    value = Utils::update_checksum(value, old_data, new_data, data_size);
+    if (protocol == Constants::IP::PROTO_UDP && value == 0) {
+        value = 0xffff;
+    }
+    checksum[0] = static_cast<uint8_t>(value >> 8);
+    checksum[1] = static_cast<uint8_t>(value & 0xff);
+}
+
 } // Internals
 } // Tins
\ No newline at end of file
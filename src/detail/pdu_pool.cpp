@@ -0,0 +1,270 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+#include <tins/detail/pdu_pool.h>
+#include <new>
+#include <cstddef>
+#include <tins/cxxstd.h>
+
+#ifdef TINS_HAVE_PDU_POOL
+
+#include <atomic>
+
+namespace Tins {
+namespace Internals {
+
+const size_t size_class_count = PDUPool::max_pooled_size / PDUPool::size_class_step;
+
+struct thread_cache;
+
+// Every block starts with this header, which is padded so the memory
+// handed out keeps the alignment operator new provides
+struct block_header {
+    // The cache the block belongs to, or null if it isn't pooled
+    thread_cache* owner;
+    size_t size_class;
+};
+
+const size_t header_size = (sizeof(block_header) + alignof(std::max_align_t) - 1) /
+                           alignof(std::max_align_t) * alignof(std::max_align_t);
+
+// Free blocks are linked through the memory that follows their header
+struct free_block {
+    free_block* next;
+};
+
+// The cache of a thread. This outlives the thread until every block
+// allocated by it has been freed, so other threads can still give
+// blocks back to it.
+struct thread_cache {
+    thread_cache()
+    : returned(0), references(1) {
+        for (size_t i = 0; i < size_class_count; ++i) {
+            blocks[i] = 0;
+            block_count[i] = 0;
+        }
+    }
+
+    free_block* blocks[size_class_count];
+    size_t block_count[size_class_count];
+    // Blocks released by other threads, collected by the owner thread
+    // once it runs out of blocks of some size class
+    std::atomic<free_block*> returned;
+    // One for the thread plus one per block allocated from operator new
+    std::atomic<size_t> references;
+};
+
+// Marks the returned list of a cache whose thread has exited
+free_block closed_list;
+
+// These are trivially destructible so they can still be used while
+// (or after) the thread's cleaner is destroyed.
+thread_local thread_cache* pdu_cache = 0;
+thread_local bool pdu_cache_disabled = false;
+
+block_header* header_of(void* ptr) {
+    return reinterpret_cast<block_header*>(static_cast<char*>(ptr) - header_size);
+}
+
+void* data_of(block_header* header) {
+    return reinterpret_cast<char*>(header) + header_size;
+}
+
+void release_references(thread_cache* cache, size_t count) {
+    if (count > 0 && cache->references.fetch_sub(count, std::memory_order_acq_rel) == count) {
+        delete cache;
+    }
+}
+
+size_t free_blocks(free_block* block) {
+    size_t count = 0;
+    while (block) {
+        free_block* next = block->next;
+        ::operator delete(header_of(block));
+        block = next;
+        ++count;
+    }
+    return count;
+}
+
+size_t release_cached_blocks(thread_cache* cache) {
+    size_t count = 0;
+    for (size_t i = 0; i < size_class_count; ++i) {
+        count += free_blocks(cache->blocks[i]);
+        cache->blocks[i] = 0;
+        cache->block_count[i] = 0;
+    }
+    return count;
+}
+
+// Moves the blocks other threads gave back into the local free lists
+void collect_returned_blocks(thread_cache* cache) {
+    free_block* block = cache->returned.exchange(0, std::memory_order_acquire);
+    size_t released = 0;
+    while (block) {
+        free_block* next = block->next;
+        const size_t index = header_of(block)->size_class;
+        if (cache->block_count[index] == PDUPool::max_cached_blocks) {
+            ::operator delete(header_of(block));
+            ++released;
+        }
+        else {
+            block->next = cache->blocks[index];
+            cache->blocks[index] = block;
+            ++cache->block_count[index];
+        }
+        block = next;
+    }
+    release_references(cache, released);
+}
+
+// Gives a block back to the thread that allocated it
+void return_block(thread_cache* owner, free_block* block) {
+    free_block* head = owner->returned.load(std::memory_order_relaxed);
+    do {
+        if (head == &closed_list) {
+            ::operator delete(header_of(block));
+            release_references(owner, 1);
+            return;
+        }
+        block->next = head;
+    } while (!owner->returned.compare_exchange_weak(head, block,
+                                                    std::memory_order_release,
+                                                    std::memory_order_relaxed));
+}
+
+struct thread_cache_cleaner {
+    ~thread_cache_cleaner() {
+        thread_cache* cache = pdu_cache;
+        // Anything released from now on goes straight to operator delete
+        // or back to the thread that allocated it
+        pdu_cache = 0;
+        pdu_cache_disabled = true;
+        if (cache) {
+            size_t released = release_cached_blocks(cache);
+            released += free_blocks(cache->returned.exchange(&closed_list,
+                                                             std::memory_order_acquire));
+            release_references(cache, released + 1);
+        }
+    }
+};
+
+thread_local thread_cache_cleaner pdu_cache_cleaner;
+
+thread_cache* local_cache() {
+    thread_cache* cache = pdu_cache;
+    if (TINS_UNLIKELY(cache == 0 && !pdu_cache_disabled)) {
+        // Make sure this thread's cache is released when it exits
+        (void)&pdu_cache_cleaner;
+        cache = new thread_cache();
+        pdu_cache = cache;
+    }
+    return cache;
+}
+
+size_t size_class(size_t size) {
+    return (size + PDUPool::size_class_step - 1) / PDUPool::size_class_step - 1;
+}
+
+void* PDUPool::allocate(size_t size) {
+    thread_cache* cache = local_cache();
+    if (TINS_UNLIKELY(size > max_pooled_size || size == 0 || cache == 0)) {
+        block_header* header = static_cast<block_header*>(::operator new(header_size + size));
+        header->owner = 0;
+        return data_of(header);
+    }
+    const size_t index = size_class(size);
+    free_block* block = cache->blocks[index];
+    if (TINS_UNLIKELY(block == 0)) {
+        collect_returned_blocks(cache);
+        block = cache->blocks[index];
+    }
+    if (TINS_LIKELY(block != 0)) {
+        cache->blocks[index] = block->next;
+        --cache->block_count[index];
+        return block;
+    }
+    block_header* header = static_cast<block_header*>(
+        ::operator new(header_size + (index + 1) * size_class_step)
+    );
+    header->owner = cache;
+    header->size_class = index;
+    cache->references.fetch_add(1, std::memory_order_relaxed);
+    return data_of(header);
+}
+
+void PDUPool::deallocate(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    block_header* header = header_of(ptr);
+    thread_cache* owner = header->owner;
+    if (TINS_UNLIKELY(owner == 0)) {
+        ::operator delete(header);
+        return;
+    }
+    free_block* block = static_cast<free_block*>(ptr);
+    if (TINS_UNLIKELY(owner != pdu_cache)) {
+        return_block(owner, block);
+        return;
+    }
+    const size_t index = header->size_class;
+    if (owner->block_count[index] == max_cached_blocks) {
+        ::operator delete(header);
+        release_references(owner, 1);
+        return;
+    }
+    block->next = owner->blocks[index];
+    owner->blocks[index] = block;
+    ++owner->block_count[index];
+}
+
+void PDUPool::trim() {
+    thread_cache* cache = pdu_cache;
+    if (cache) {
+        collect_returned_blocks(cache);
+        release_references(cache, release_cached_blocks(cache));
+    }
+}
+
+size_t PDUPool::cached_bytes() {
+    thread_cache* cache = pdu_cache;
+    size_t output = 0;
+    if (cache) {
+        for (size_t i = 0; i < size_class_count; ++i) {
+            output += cache->block_count[i] * (i + 1) * size_class_step;
+        }
+    }
+    return output;
+}
+
+} // Internals
+} // Tins
+
+#endif // TINS_HAVE_PDU_POOL
@@ -32,6 +32,7 @@
 #include <tins/dhcp.h>
 #include <tins/exceptions.h>
 #include <tins/memory_helpers.h>
+#include <tins/decoding_scope.h>
 
 using std::string;
 using std::vector;
@@ -65,6 +66,26 @@ DHCP::DHCP(const uint8_t* buffer, uint32_t total_sz)
     if (magic_number != Endian::host_to_be<uint32_t>(0x63825363)) {
         throw malformed_packet();
     }
+    const uint32_t options_size = static_cast<uint32_t>(stream.size());
+    if ((DecodingScope::current_flags() & DecodingScope::LAZY_OPTIONS) != 0) {
+        // Make sure they're valid, but only parse them on first access
+        size_ += parse_options(stream.pointer(), options_size, false);
+        pending_options_.assign(stream.pointer(), options_size);
+    }
+    else {
+        options_.reserve(count_options(stream.pointer(), options_size));
+        size_ += parse_options(stream.pointer(), options_size, true);
+    }
+}
+
+void DHCP::finish_lazy_parsing() const {
+    parse_pending_options();
+    option_index_.prepare(options_);
+}
+
+uint32_t DHCP::parse_options(const uint8_t* buffer, uint32_t total_sz, bool store) const {
+    InputMemoryStream stream(buffer, total_sz);
+    uint32_t options_size = 0;
     // While there's data left
     while (stream) {
         OptionTypes option_type;
@@ -78,14 +99,39 @@ DHCP::DHCP(const uint8_t* buffer, uint32_t total_sz)
         if (!stream.can_read(option_length)) {
             throw malformed_packet();
         }
-        add_option(option(option_type, option_length, stream.pointer()));
+        if (store) {
+            options_.push_back(option(option_type, option_length, stream.pointer()));
+        }
+        // This is what internal_add_option would add for this option
+        options_size += option_length + (sizeof(uint8_t) << 1);
         stream.skip(option_length);
     }
+    return options_size;
+}
+
+uint32_t DHCP::count_options(const uint8_t* buffer, uint32_t total_sz) {
+    uint32_t count = 0;
+    const uint8_t* end = buffer + total_sz;
+    while (buffer < end) {
+        ++count;
+        if (*buffer == END || *buffer == PAD) {
+            ++buffer;
+        }
+        else if (end - buffer < 2) {
+            break;
+        }
+        else {
+            buffer += buffer[1] + (sizeof(uint8_t) << 1);
+        }
+    }
+    return count;
 }
 
 void DHCP::add_option(const option& opt) {
+    parse_pending_options();
     internal_add_option(opt);
     options_.push_back(opt);
+    option_index_.invalidate();
 }
 
 void DHCP::internal_add_option(const option& opt) {
@@ -99,6 +145,7 @@ bool DHCP::remove_option(OptionTypes type) {
     }
     size_ -= static_cast<uint32_t>(iter->data_size() + (sizeof(uint8_t) << 1));
     options_.erase(iter);
+    option_index_.invalidate();
     return true;
 }
 
@@ -109,11 +156,13 @@ const DHCP::option* DHCP::search_option(OptionTypes opt) const {
 }
 
 DHCP::options_type::const_iterator DHCP::search_option_iterator(OptionTypes opt) const {
-    return Internals::find_option_const<option>(options_, opt);
+    parse_pending_options();
+    return option_index_.find(options_, opt);
 }
 
 DHCP::options_type::iterator DHCP::search_option_iterator(OptionTypes opt) {
-    return Internals::find_option<option>(options_, opt);
+    parse_pending_options();
+    return option_index_.find(options_, opt);
 }
 
 void DHCP::type(Flags type) {
@@ -241,6 +290,7 @@ uint32_t DHCP::header_size() const {
 }
 
 void DHCP::write_serialization(uint8_t* buffer, uint32_t total_sz) {
+    parse_pending_options();
     if (size_) {
         vend_type& result = BootP::vend();
         result.resize(size_);
@@ -117,6 +117,7 @@ DHCPv6::DHCPv6(const uint8_t* buffer, uint32_t total_sz)
         stream.read(link_addr_);
         stream.read(peer_addr_);
     }
+    options_.reserve(count_options(stream.pointer(), stream.size()));
     while (stream) {
         uint16_t opt = stream.read_be<uint16_t>();
         uint16_t data_size = stream.read_be<uint16_t>();
@@ -128,6 +129,16 @@ DHCPv6::DHCPv6(const uint8_t* buffer, uint32_t total_sz)
     }
 }
     
+uint32_t DHCPv6::count_options(const uint8_t* buffer, uint32_t total_sz) {
+    uint32_t count = 0;
+    const uint8_t* end = buffer + total_sz;
+    while (end - buffer >= 4) {
+        ++count;
+        buffer += ((buffer[2] << 8) | buffer[3]) + sizeof(uint16_t) * 2;
+    }
+    return count;
+}
+
 void DHCPv6::add_option(const option& opt) {
     options_.push_back(opt);
     options_size_ += opt.data_size() + sizeof(uint16_t) * 2;
@@ -48,6 +48,7 @@
 #include <tins/dot11.h>
 #include <tins/packet_sender.h>
 #include <tins/memory_helpers.h>
+#include <tins/decoding_scope.h>
 
 using std::vector;
 
@@ -81,22 +82,60 @@ void Dot11::write_fixed_parameters(Memory::OutputMemoryStream& /*stream*/) {
 
 void Dot11::parse_tagged_parameters(InputMemoryStream& stream) {
     if (stream) {
-        while (stream.size() >= 2) {
-            OptionTypes opcode = static_cast<OptionTypes>(stream.read<uint8_t>());
-            uint8_t length = stream.read<uint8_t>();
-            if (!stream.can_read(length)) {
-                throw malformed_packet();
+        const uint8_t* options_start = stream.pointer();
+        if ((DecodingScope::current_flags() & DecodingScope::LAZY_OPTIONS) != 0) {
+            // Make sure they're valid, but only parse them on first access
+            const uint32_t options_size = parse_options(stream.pointer(), stream.size(), false);
+            pending_options_.assign(options_start, options_size);
+            options_size_ += options_size;
+            stream.skip(options_size);
+        }
+        else {
+            // Counting the elements first is much cheaper than growing the options
+            // vector, beacons usually carry more than a dozen of them
+            uint32_t count = 0;
+            const uint8_t* ptr = stream.pointer();
+            const uint8_t* end = ptr + stream.size();
+            while (end - ptr >= 2) {
+                ++count;
+                ptr += ptr[1] + 2;
             }
-            add_tagged_option(opcode, length, stream.pointer());
-            stream.skip(length);
+            options_.reserve(options_.size() + count);
+            const uint32_t options_size = parse_options(stream.pointer(), stream.size(), true);
+            options_size_ += options_size;
+            stream.skip(options_size);
+        }
+    }
+}
+
+void Dot11::finish_lazy_parsing() const {
+    parse_pending_options();
+    option_index_.prepare(options_);
+}
+
+uint32_t Dot11::parse_options(const uint8_t* buffer, uint32_t total_sz, bool store) const {
+    InputMemoryStream stream(buffer, total_sz);
+    while (stream.size() >= 2) {
+        OptionTypes opcode = static_cast<OptionTypes>(stream.read<uint8_t>());
+        uint8_t length = stream.read<uint8_t>();
+        if (!stream.can_read(length)) {
+            throw malformed_packet();
+        }
+        if (store) {
+            options_.push_back(option((uint8_t)opcode, stream.pointer(), stream.pointer() + length));
         }
+        stream.skip(length);
     }
+    // A trailing byte that can't hold an element isn't part of the options
+    return total_sz - static_cast<uint32_t>(stream.size());
 }
 
 void Dot11::add_tagged_option(OptionTypes opt, uint8_t len, const uint8_t* val) {
+    parse_pending_options();
     uint32_t opt_size = len + sizeof(uint8_t) * 2;
     options_.push_back(option((uint8_t)opt, val, val + len));
     options_size_ += opt_size;
+    option_index_.invalidate();
 }
 
 void Dot11::internal_add_option(const option& opt) {
@@ -110,12 +149,15 @@ bool Dot11::remove_option(OptionTypes type) {
     }
     options_size_ -= static_cast<uint32_t>(iter->data_size() + sizeof(uint8_t) * 2);
     options_.erase(iter);
+    option_index_.invalidate();
     return true;
 }
 
 void Dot11::add_option(const option& opt) {
+    parse_pending_options();
     internal_add_option(opt);
     options_.push_back(opt);
+    option_index_.invalidate();
 }
 
 const Dot11::option* Dot11::search_option(OptionTypes type) const {
@@ -125,11 +167,13 @@ const Dot11::option* Dot11::search_option(OptionTypes type) const {
 }
 
 Dot11::options_type::const_iterator Dot11::search_option_iterator(OptionTypes type) const {
-    return Internals::find_option_const<option>(options_, type);
+    parse_pending_options();
+    return option_index_.find(options_, type);
 }
 
 Dot11::options_type::iterator Dot11::search_option_iterator(OptionTypes type) {
-    return Internals::find_option<option>(options_, type);
+    parse_pending_options();
+    return option_index_.find(options_, type);
 }
 
 void Dot11::protocol(small_uint<2> new_proto) {
@@ -216,6 +260,7 @@ void Dot11::write_serialization(uint8_t* buffer, uint32_t total_sz) {
     stream.write(header_);
     write_ext_header(stream);
     write_fixed_parameters(stream);
+    parse_pending_options();
     for (vector<option>::const_iterator it = options_.begin(); it != options_.end(); ++it) {
         stream.write<uint8_t>(it->option());
         stream.write<uint8_t>(it->length_field());
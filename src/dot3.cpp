@@ -43,6 +43,7 @@
 #include <tins/llc.h>
 #include <tins/exceptions.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 
 using std::copy;
 using std::equal;
@@ -71,7 +72,12 @@ Dot3::Dot3(const uint8_t* buffer, uint32_t total_sz) {
     InputMemoryStream stream(buffer, total_sz);
     stream.read(header_);
     if (stream) {
-        inner_pdu(new Tins::LLC(stream.pointer(), stream.size()));
+        inner_pdu(
+            Internals::decode_payload_as<Tins::LLC>,
+            0,
+            stream.pointer(),
+            static_cast<uint32_t>(stream.size())
+        );
     }
 }
 
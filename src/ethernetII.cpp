@@ -77,11 +77,10 @@ EthernetII::EthernetII(const uint8_t* buffer, uint32_t total_sz) {
     // If there's any size left
     if (stream) {
         inner_pdu(
-            Internals::pdu_from_flag(
-                (Constants::Ethernet::e)payload_type(), 
-                stream.pointer(), 
-                stream.size()
-            )
+            Internals::decode_ether_payload,
+            payload_type(),
+            stream.pointer(),
+            static_cast<uint32_t>(stream.size())
         );
     }
 }
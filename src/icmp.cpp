@@ -28,6 +28,7 @@
  */
 
 #include <cstring>
+#include <cstddef>
 #ifndef _WIN32
     #include <netinet/in.h>
 #endif
@@ -35,6 +36,7 @@
 #include <tins/exceptions.h>
 #include <tins/icmp.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 #include <tins/detail/icmp_extension_helpers.h>
 #include <tins/utils/checksum_utils.h>
 
@@ -52,6 +54,29 @@ PDU::metadata ICMP::extract_metadata(const uint8_t* /*buffer*/, uint32_t total_s
     return metadata(sizeof(icmp_header), pdu_flag, PDU::UNKNOWN);
 }
 
+void ICMP::patch_id(uint8_t* buffer, uint32_t total_sz, uint16_t new_id) {
+    patch_field(buffer, total_sz, offsetof(icmp_header, un.echo.id), new_id);
+}
+
+void ICMP::patch_sequence(uint8_t* buffer, uint32_t total_sz, uint16_t new_seq) {
+    patch_field(buffer, total_sz, offsetof(icmp_header, un.echo.sequence), new_seq);
+}
+
+void ICMP::patch_field(uint8_t* buffer, uint32_t total_sz, uint32_t offset,
+                       uint16_t value) {
+    extract_metadata(buffer, total_sz);
+    const uint8_t new_data[] = {
+        static_cast<uint8_t>(value >> 8),
+        static_cast<uint8_t>(value & 0xff)
+    };
+    Internals::patch_checksummed_field(
+        buffer + offset,
+        new_data,
+        sizeof(new_data),
+        buffer + offsetof(icmp_header, check)
+    );
+}
+
 ICMP::ICMP(Flags flag) 
 : orig_timestamp_or_address_mask_(), recv_timestamp_(), trans_timestamp_() {
     memset(&header_, 0, sizeof(icmp_header));
@@ -73,7 +98,12 @@ ICMP::ICMP(const uint8_t* buffer, uint32_t total_sz)
     // Attempt to parse ICMP extensions
     try_parse_extensions(stream);
     if (stream) {
-        inner_pdu(new RawPDU(stream.pointer(), stream.size()));
+        inner_pdu(
+            Internals::decode_raw_payload,
+            0,
+            stream.pointer(),
+            static_cast<uint32_t>(stream.size())
+        );
     }
 }
 
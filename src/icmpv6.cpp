@@ -101,6 +101,8 @@ ICMPv6::ICMPv6(const uint8_t* buffer, uint32_t total_sz)
 }
 
 void ICMPv6::parse_options(InputMemoryStream& stream) {
+    // Options take at least 8 bytes each
+    options_.reserve(stream.size() / 8);
     while (stream) {
         const uint8_t opt_type = stream.read<uint8_t>();
         const uint32_t opt_size = static_cast<uint32_t>(stream.read<uint8_t>()) * 8;
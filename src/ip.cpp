@@ -28,6 +28,7 @@
  */
 
 #include <cstring>
+#include <cstddef>
 #ifndef _WIN32
     #include <netdb.h>
     #include <sys/socket.h>
@@ -43,11 +44,13 @@
 #include <tins/exceptions.h>
 #include <tins/pdu_allocator.h>
 #include <tins/memory_helpers.h>
+#include <tins/decoding_scope.h>
 #include <tins/utils/checksum_utils.h>
 #include <tins/detail/pdu_helpers.h>
 #include <tins/pdu_allocator.h>
 
 using std::memcmp;
+using std::memcpy;
 using std::vector;
 
 using Tins::Memory::InputMemoryStream;
@@ -62,9 +65,66 @@ PDU::metadata IP::extract_metadata(const uint8_t *buffer, uint32_t total_sz) {
         throw malformed_packet();
     }
     const ip_header* header = (const ip_header*)buffer;
+    const uint32_t header_size = header->ihl * sizeof(uint32_t);
+    if (TINS_UNLIKELY(header_size < sizeof(ip_header) || header_size > total_sz)) {
+        throw malformed_packet();
+    }
+    // Fragmented payloads are always decoded as RawPDU
+    if ((Endian::be_to_host(header->frag_off) & 0x3fff) != 0) {
+        return metadata(header_size, pdu_flag, PDU::RAW);
+    }
     PDUType next_type = Internals::ip_type_to_pdu_flag(
         static_cast<Constants::IP::e>(header->protocol));
-    return metadata(header->ihl * 4, pdu_flag, next_type);
+    return metadata(header_size, pdu_flag, next_type);
+}
+
+void IP::patch_ttl(uint8_t* buffer, uint32_t total_sz, uint8_t new_ttl) {
+    extract_metadata(buffer, total_sz);
+    uint8_t* ttl = buffer + offsetof(ip_header, ttl);
+    // The TTL and protocol fields share a single checksum word
+    const uint8_t new_word[] = { new_ttl, ttl[1] };
+    Internals::patch_checksummed_field(
+        ttl,
+        new_word,
+        sizeof(new_word),
+        buffer + offsetof(ip_header, check)
+    );
+}
+
+void IP::patch_src_addr(uint8_t* buffer, uint32_t total_sz, address_type new_src_addr) {
+    patch_address(buffer, total_sz, offsetof(ip_header, saddr), new_src_addr);
+}
+
+void IP::patch_dst_addr(uint8_t* buffer, uint32_t total_sz, address_type new_dst_addr) {
+    patch_address(buffer, total_sz, offsetof(ip_header, daddr), new_dst_addr);
+}
+
+void IP::patch_address(uint8_t* buffer, uint32_t total_sz, uint32_t offset,
+                       address_type new_addr) {
+    const uint32_t header_size = extract_metadata(buffer, total_sz).header_size;
+    const uint32_t address = new_addr;
+    uint8_t new_data[sizeof(address)];
+    memcpy(new_data, &address, sizeof(address));
+    uint8_t old_data[sizeof(address)];
+    memcpy(old_data, buffer + offset, sizeof(old_data));
+    Internals::patch_checksummed_field(
+        buffer + offset,
+        new_data,
+        sizeof(new_data),
+        buffer + offsetof(ip_header, check)
+    );
+    const ip_header* header = (const ip_header*)buffer;
+    // Only the first fragment contains the transport layer header
+    if ((Endian::be_to_host(header->frag_off) & 0x1fff) == 0) {
+        Internals::patch_pseudoheader_checksum(
+            static_cast<Constants::IP::e>(header->protocol),
+            buffer + header_size,
+            total_sz - header_size,
+            old_data,
+            new_data,
+            sizeof(new_data)
+        );
+    }
 }
 
 IP::IP(address_type ip_dst, address_type ip_src) {
@@ -83,42 +143,19 @@ IP::IP(const uint8_t* buffer, uint32_t total_sz) {
         throw malformed_packet();
     }
     const uint8_t* options_end = buffer + head_len() * sizeof(uint32_t);
-    
-    // While the end of the options is not reached read an option
-    while (stream.pointer() < options_end) {
-        option_identifier opt_type = (option_identifier)stream.read<uint8_t>();
-        if (opt_type.number > NOOP) {
-            // Multibyte options with length as second byte
-            const uint32_t option_size = stream.read<uint8_t>();
-            if (TINS_UNLIKELY(option_size < (sizeof(uint8_t) << 1))) {
-                throw malformed_packet();
-            }
-            // The data size is the option size - the identifier and size fields
-            const uint32_t data_size = option_size - (sizeof(uint8_t) << 1);
-            if (data_size > 0) {
-                if (stream.pointer() + data_size > options_end) {
-                    throw malformed_packet();
-                }
-                options_.push_back(
-                    option(opt_type, stream.pointer(), stream.pointer() + data_size)
-                );
-                stream.skip(data_size);
-            }
-            else {
-                options_.push_back(option(opt_type));
-            }
-        }
-        else if (opt_type == END) {
-            // If the end option found, we're done
-            if (TINS_UNLIKELY(stream.pointer() != options_end)) {
-                // Make sure we found the END option at the end of the options list
-                throw malformed_packet();
-            }
-            break;
+    if (stream.pointer() < options_end) {
+        const uint32_t options_size = static_cast<uint32_t>(options_end - stream.pointer());
+        if ((DecodingScope::current_flags() & DecodingScope::LAZY_OPTIONS) != 0) {
+            // Make sure they're valid, but only parse them on first access
+            parse_options(stream.pointer(), options_size, false);
+            pending_options_.assign(stream.pointer(), options_size);
         }
         else {
-            options_.push_back(option(opt_type));
+            // Same estimate as TCP: about 4 bytes per option
+            options_.reserve(options_size / sizeof(uint32_t));
+            parse_options(stream.pointer(), options_size, true);
         }
+        stream.skip(options_size);
     }
     if (stream) {
         // Don't avoid consuming more than we should if tot_len is 0,
@@ -135,29 +172,15 @@ IP::IP(const uint8_t* buffer, uint32_t total_sz) {
         // Don't try to decode it if it's fragmented
         if (!is_fragmented()) {
             inner_pdu(
-                Internals::pdu_from_flag(
-                    static_cast<Constants::IP::e>(header_.protocol),
-                    stream.pointer(), 
-                    total_sz,
-                    false
-                )
+                Internals::decode_ip_payload,
+                header_.protocol,
+                stream.pointer(),
+                total_sz
             );
-            if (!inner_pdu()) {
-                inner_pdu(
-                    Internals::allocate<IP>(
-                        header_.protocol,
-                        stream.pointer(), 
-                        total_sz
-                    )
-                );
-                if (!inner_pdu()) {
-                    inner_pdu(new RawPDU(stream.pointer(), total_sz));
-                }
-            }
         }
         else {
             // It's fragmented, just use RawPDU
-            inner_pdu(new RawPDU(stream.pointer(), total_sz));
+            inner_pdu(Internals::decode_raw_payload, 0, stream.pointer(), total_sz);
         }
     }
 }
@@ -314,8 +337,57 @@ uint16_t IP::stream_identifier() const {
     return opt->to<uint16_t>();
 }
 
+void IP::finish_lazy_parsing() const {
+    parse_pending_options();
+    option_index_.prepare(options_);
+}
+
+void IP::parse_options(const uint8_t* buffer, uint32_t total_sz, bool store) const {
+    InputMemoryStream stream(buffer, total_sz);
+    // While the end of the options is not reached read an option
+    while (stream) {
+        option_identifier opt_type = (option_identifier)stream.read<uint8_t>();
+        if (opt_type.number > NOOP) {
+            // Multibyte options with length as second byte
+            const uint32_t option_size = stream.read<uint8_t>();
+            if (TINS_UNLIKELY(option_size < (sizeof(uint8_t) << 1))) {
+                throw malformed_packet();
+            }
+            // The data size is the option size - the identifier and size fields
+            const uint32_t data_size = option_size - (sizeof(uint8_t) << 1);
+            if (data_size > 0) {
+                if (!stream.can_read(data_size)) {
+                    throw malformed_packet();
+                }
+                if (store) {
+                    options_.push_back(
+                        option(opt_type, stream.pointer(), stream.pointer() + data_size)
+                    );
+                }
+                stream.skip(data_size);
+            }
+            else if (store) {
+                options_.push_back(option(opt_type));
+            }
+        }
+        else if (opt_type == END) {
+            // If the end option found, we're done
+            if (TINS_UNLIKELY(stream)) {
+                // Make sure we found the END option at the end of the options list
+                throw malformed_packet();
+            }
+            break;
+        }
+        else if (store) {
+            options_.push_back(option(opt_type));
+        }
+    }
+}
+
 void IP::add_option(const option& opt) {
+    parse_pending_options();
     options_.push_back(opt);
+    option_index_.invalidate();
 }
 
 uint32_t IP::calculate_options_size() const {
@@ -342,6 +414,7 @@ bool IP::remove_option(option_identifier id) {
         return false;
     }
     options_.erase(iter);
+    option_index_.invalidate();
     return true;
 }
 
@@ -351,11 +424,13 @@ const IP::option* IP::search_option(option_identifier id) const {
 }
 
 IP::options_type::const_iterator IP::search_option_iterator(option_identifier id) const {
-    return Internals::find_option_const<option>(options_, id);
+    parse_pending_options();
+    return option_index_.find(options_, id);
 }
 
 IP::options_type::iterator IP::search_option_iterator(option_identifier id) {
-    return Internals::find_option<option>(options_, id);
+    parse_pending_options();
+    return option_index_.find(options_, id);
 }
 
 void IP::write_option(const option& opt, OutputMemoryStream& stream) {
@@ -374,6 +449,7 @@ void IP::write_option(const option& opt, OutputMemoryStream& stream) {
 // Virtual method overriding
 
 uint32_t IP::header_size() const {
+    parse_pending_options();
     return sizeof(header_) + pad_options_size(calculate_options_size());
 }
 
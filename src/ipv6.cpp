@@ -59,15 +59,25 @@ PDU::metadata IPv6::extract_metadata(const uint8_t *buffer, uint32_t total_sz) {
     const ipv6_header* header = (const ipv6_header*)buffer;
     uint32_t header_size = sizeof(ipv6_header);
     uint8_t current_header = header->next_header;
+    bool is_payload_fragmented = false;
     stream.skip(sizeof(ipv6_header));
     while (is_extension_header(current_header)) {
+        if (current_header == FRAGMENT) {
+            is_payload_fragmented = true;
+        }
         current_header = stream.read<uint8_t>();
         const uint32_t ext_size = (static_cast<uint32_t>(stream.read<uint8_t>()) + 1) * 8;
         const uint32_t payload_size = ext_size - sizeof(uint8_t) * 2;
         header_size += ext_size;
         stream.skip(payload_size);
     }
-    return metadata(header_size, pdu_flag, PDU::UNKNOWN);
+    // Fragmented payloads are always decoded as RawPDU
+    if (is_payload_fragmented) {
+        return metadata(header_size, pdu_flag, PDU::RAW);
+    }
+    PDUType next_type = Internals::ip_type_to_pdu_flag(
+        static_cast<Constants::IP::e>(current_header));
+    return metadata(header_size, pdu_flag, next_type);
 }
 
 IPv6::hop_by_hop_header IPv6::hop_by_hop_header::from_extension_header(const ext_header& hdr) {
@@ -170,29 +180,20 @@ IPv6::IPv6(const uint8_t* buffer, uint32_t total_sz) {
                 throw malformed_packet();
             }
             if (is_payload_fragmented) {
-                inner_pdu(new Tins::RawPDU(stream.pointer(), actual_payload_length));
+                inner_pdu(
+                    Internals::decode_raw_payload,
+                    0,
+                    stream.pointer(),
+                    actual_payload_length
+                );
             }
             else {
                 inner_pdu(
-                    Internals::pdu_from_flag(
-                        static_cast<Constants::IP::e>(current_header),
-                        stream.pointer(), 
-                        actual_payload_length,
-                        false
-                    )
+                    Internals::decode_ip_payload,
+                    current_header,
+                    stream.pointer(),
+                    actual_payload_length
                 );
-                if (!inner_pdu()) {
-                    inner_pdu(
-                        Internals::allocate<IPv6>(
-                            current_header,
-                            stream.pointer(), 
-                            actual_payload_length
-                        )
-                    );
-                    if (!inner_pdu()) {
-                        inner_pdu(new Tins::RawPDU(stream.pointer(), actual_payload_length));
-                    }
-                }
             }
             // We got to an actual PDU, we're done
             break;
@@ -33,6 +33,7 @@
 #include <tins/rawpdu.h>
 #include <tins/exceptions.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 
 using Tins::Memory::InputMemoryStream;
 using Tins::Memory::OutputMemoryStream;
@@ -74,12 +75,10 @@ LLC::LLC(const uint8_t* buffer, uint32_t total_sz) {
 		stream.read(control_field.info);
 	}
     if (stream) {
-        if (dsap() == 0x42 && ssap() == 0x42) {
-            inner_pdu(new Tins::STP(stream.pointer(), stream.size()));
-        }
-        else {
-            inner_pdu(new Tins::RawPDU(stream.pointer(), stream.size()));
-        }
+        const inner_pdu_decoder decoder = (dsap() == 0x42 && ssap() == 0x42) ?
+                                          &Internals::decode_payload_as<Tins::STP> :
+                                          &Internals::decode_raw_payload;
+        inner_pdu(decoder, 0, stream.pointer(), static_cast<uint32_t>(stream.size()));
     }
 }
 
@@ -46,6 +46,7 @@
 #include <tins/rawpdu.h>
 #include <tins/exceptions.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 
 #if !defined(PF_LLC)
     // compilation fix, nasty but at least works on BSD
@@ -67,20 +68,22 @@ Loopback::Loopback(const uint8_t* buffer, uint32_t total_sz) {
     family_ = stream.read<uint32_t>();
 
     if (total_sz) {
+        inner_pdu_decoder decoder;
         switch (family_) {
             case PF_INET:
-                inner_pdu(new Tins::IP(stream.pointer(), stream.size()));
+                decoder = &Internals::decode_payload_as<Tins::IP>;
                 break;
             case PF_INET6:
-                inner_pdu(new Tins::IPv6(stream.pointer(), stream.size()));
+                decoder = &Internals::decode_payload_as<Tins::IPv6>;
                 break;
             case PF_LLC:
-                inner_pdu(new Tins::LLC(stream.pointer(), stream.size()));
+                decoder = &Internals::decode_payload_as<Tins::LLC>;
                 break;
             default:
-                inner_pdu(new Tins::RawPDU(stream.pointer(), stream.size()));
+                decoder = &Internals::decode_raw_payload;
                 break;
         };
+        inner_pdu(decoder, 0, stream.pointer(), static_cast<uint32_t>(stream.size()));
     }
 }
     
@@ -31,6 +31,7 @@
 #include <tins/offline_packet_filter.h>
 #include <tins/pdu.h>
 #include <tins/exceptions.h>
+#include <tins/cxxstd.h>
 
 using std::string;
 
@@ -72,8 +73,14 @@ bool OfflinePacketFilter::matches_filter(const uint8_t* buffer, uint32_t total_s
 }
 
 bool OfflinePacketFilter::matches_filter(PDU& pdu) const {
-    PDU::serialization_type buffer = pdu.serialize();
-    return matches_filter(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    #if TINS_IS_CXX11
+        // Filters can be shared between threads, so each one gets its own buffer
+        static thread_local PDU::serialization_type buffer;
+    #else
+        PDU::serialization_type buffer;
+    #endif // TINS_IS_CXX11
+    const uint32_t sz = pdu.serialize(buffer);
+    return matches_filter(buffer.empty() ? 0 : &buffer[0], sz);
 }
 
 } // Tins
@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+#include <tins/packet_editor.h>
+#include <cstring>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/ip.h>
+#include <tins/constants.h>
+#include <tins/exceptions.h>
+#include <tins/utils/checksum_utils.h>
+#include <tins/detail/pdu_helpers.h>
+
+using std::memcpy;
+using std::memset;
+
+namespace Tins {
+
+// Offsets of the fields modified by PacketEditor, relative to each header
+const uint32_t eth_dst_addr_offset = 0;
+const uint32_t eth_src_addr_offset = 6;
+const uint32_t dot3_length_offset = 12;
+const uint32_t dot3_header_size = 14;
+const uint32_t ip_tos_offset = 0;
+const uint32_t ip_tot_len_offset = 2;
+const uint32_t ip_id_offset = 4;
+const uint32_t ip_check_offset = 10;
+const uint32_t ipv6_payload_length_offset = 4;
+const uint32_t ipv6_hop_limit_offset = 7;
+const uint32_t ipv6_src_addr_offset = 8;
+const uint32_t ipv6_dst_addr_offset = 24;
+const uint32_t ipv6_fixed_header_size = 40;
+const uint32_t tcp_seq_offset = 4;
+const uint32_t tcp_ack_seq_offset = 8;
+const uint32_t tcp_window_offset = 14;
+const uint32_t tcp_check_offset = 16;
+const uint32_t udp_len_offset = 4;
+const uint32_t udp_check_offset = 6;
+const uint32_t icmp_check_offset = 2;
+
+void write_be16(uint8_t* buffer, uint16_t value) {
+    buffer[0] = static_cast<uint8_t>(value >> 8);
+    buffer[1] = static_cast<uint8_t>(value & 0xff);
+}
+
+void write_be32(uint8_t* buffer, uint32_t value) {
+    write_be16(buffer, static_cast<uint16_t>(value >> 16));
+    write_be16(buffer + 2, static_cast<uint16_t>(value & 0xffff));
+}
+
+// Stores the one's complement of a sum computed using Utils::sum_range
+void write_checksum(uint8_t* buffer, uint32_t checksum) {
+    while (checksum >> 16) {
+        checksum = (checksum & 0xffff) + (checksum >> 16);
+    }
+    const uint16_t value = static_cast<uint16_t>(~checksum);
+    memcpy(buffer, &value, sizeof(value));
+}
+
+// PacketView doesn't walk ICMPv6, so its messages are the RawPDU layer
+// following an IPv6 one. Fragmented messages can't be checksummed
+bool is_icmpv6_payload(const PacketView& view, uint32_t index) {
+    return index > 0 && view.layer(index).pdu_type() == PDU::RAW &&
+           view.layer(index - 1).pdu_type() == PDU::IPv6 &&
+           Internals::ipv6_payload_protocol(view.layer(index - 1).data()) ==
+           Constants::IP::PROTO_ICMPV6;
+}
+
+PacketEditor::PacketEditor(uint8_t* buffer, uint32_t total_sz, PDU::PDUType first_layer)
+: buffer_(buffer), first_layer_(first_layer), view_(buffer, total_sz, first_layer) {
+
+}
+
+void PacketEditor::eth_dst_addr(const HWAddress<6>& new_dst_addr) {
+    uint8_t* ptr = layer_data(find_layer(PDU::ETHERNET_II));
+    new_dst_addr.copy(ptr + eth_dst_addr_offset);
+}
+
+void PacketEditor::eth_src_addr(const HWAddress<6>& new_src_addr) {
+    uint8_t* ptr = layer_data(find_layer(PDU::ETHERNET_II));
+    new_src_addr.copy(ptr + eth_src_addr_offset);
+}
+
+void PacketEditor::vlan_id(small_uint<12> new_id) {
+    uint8_t* ptr = layer_data(find_layer(PDU::DOT1Q));
+    const uint16_t tci = Internals::view_read_be16(ptr);
+    write_be16(ptr, static_cast<uint16_t>((tci & 0xf000) | new_id));
+}
+
+void PacketEditor::vlan_priority(small_uint<3> new_priority) {
+    uint8_t* ptr = layer_data(find_layer(PDU::DOT1Q));
+    const uint16_t tci = Internals::view_read_be16(ptr);
+    write_be16(ptr, static_cast<uint16_t>((tci & 0x1fff) | (new_priority << 13)));
+}
+
+void PacketEditor::ip_tos(uint8_t new_tos) {
+    uint8_t* ptr = layer_data(find_layer(PDU::IP));
+    // The version/IHL and TOS fields share a single checksum word
+    const uint8_t new_word[] = { ptr[ip_tos_offset], new_tos };
+    Internals::patch_checksummed_field(
+        ptr + ip_tos_offset,
+        new_word,
+        sizeof(new_word),
+        ptr + ip_check_offset
+    );
+}
+
+void PacketEditor::ip_id(uint16_t new_id) {
+    uint8_t* ptr = layer_data(find_layer(PDU::IP));
+    uint8_t new_data[sizeof(new_id)];
+    write_be16(new_data, new_id);
+    Internals::patch_checksummed_field(
+        ptr + ip_id_offset,
+        new_data,
+        sizeof(new_data),
+        ptr + ip_check_offset
+    );
+}
+
+void PacketEditor::ip_ttl(uint8_t new_ttl) {
+    const uint32_t index = find_layer(PDU::IP);
+    IP::patch_ttl(layer_data(index), view_.layer(index).size(), new_ttl);
+}
+
+void PacketEditor::ip_src_addr(IPv4Address new_src_addr) {
+    const uint32_t index = find_layer(PDU::IP);
+    IP::patch_src_addr(layer_data(index), view_.layer(index).size(), new_src_addr);
+}
+
+void PacketEditor::ip_dst_addr(IPv4Address new_dst_addr) {
+    const uint32_t index = find_layer(PDU::IP);
+    IP::patch_dst_addr(layer_data(index), view_.layer(index).size(), new_dst_addr);
+}
+
+void PacketEditor::ipv6_hop_limit(uint8_t new_hop_limit) {
+    // IPv6 has no header checksum and the hop limit isn't part of the pseudo header
+    layer_data(find_layer(PDU::IPv6))[ipv6_hop_limit_offset] = new_hop_limit;
+}
+
+void PacketEditor::ipv6_src_addr(const IPv6Address& new_src_addr) {
+    patch_ipv6_address(ipv6_src_addr_offset, new_src_addr);
+}
+
+void PacketEditor::ipv6_dst_addr(const IPv6Address& new_dst_addr) {
+    patch_ipv6_address(ipv6_dst_addr_offset, new_dst_addr);
+}
+
+void PacketEditor::tcp_sport(uint16_t new_sport) {
+    const uint32_t index = find_layer(PDU::TCP);
+    TCP::patch_sport(layer_data(index), view_.layer(index).size(), new_sport);
+}
+
+void PacketEditor::tcp_dport(uint16_t new_dport) {
+    const uint32_t index = find_layer(PDU::TCP);
+    TCP::patch_dport(layer_data(index), view_.layer(index).size(), new_dport);
+}
+
+void PacketEditor::tcp_seq(uint32_t new_seq) {
+    uint8_t new_data[sizeof(new_seq)];
+    write_be32(new_data, new_seq);
+    patch_tcp_field(tcp_seq_offset, new_data, sizeof(new_data));
+}
+
+void PacketEditor::tcp_ack_seq(uint32_t new_ack_seq) {
+    uint8_t new_data[sizeof(new_ack_seq)];
+    write_be32(new_data, new_ack_seq);
+    patch_tcp_field(tcp_ack_seq_offset, new_data, sizeof(new_data));
+}
+
+void PacketEditor::tcp_window(uint16_t new_window) {
+    uint8_t new_data[sizeof(new_window)];
+    write_be16(new_data, new_window);
+    patch_tcp_field(tcp_window_offset, new_data, sizeof(new_data));
+}
+
+void PacketEditor::udp_sport(uint16_t new_sport) {
+    const uint32_t index = find_layer(PDU::UDP);
+    UDP::patch_sport(layer_data(index), view_.layer(index).size(), new_sport);
+}
+
+void PacketEditor::udp_dport(uint16_t new_dport) {
+    const uint32_t index = find_layer(PDU::UDP);
+    UDP::patch_dport(layer_data(index), view_.layer(index).size(), new_dport);
+}
+
+void PacketEditor::truncate(uint32_t new_size) {
+    if (new_size > size()) {
+        throw invalid_packet();
+    }
+    const uint32_t layer_count = view_.layer_count();
+    for (uint32_t i = 0; i < layer_count; ++i) {
+        const LayerView& layer = view_.layer(i);
+        const uint32_t offset = static_cast<uint32_t>(layer.data() - view_.data());
+        if (layer.pdu_type() != PDU::RAW && offset + layer.header_size() > new_size) {
+            throw invalid_packet();
+        }
+    }
+    bool resized[PacketView::max_layers] = { };
+    for (uint32_t i = 0; i < layer_count; ++i) {
+        const LayerView& layer = view_.layer(i);
+        const uint32_t offset = static_cast<uint32_t>(layer.data() - view_.data());
+        if (offset + layer.size() <= new_size) {
+            continue;
+        }
+        resized[i] = true;
+        const uint32_t layer_size = new_size - offset;
+        uint8_t* ptr = layer_data(i);
+        switch (layer.pdu_type()) {
+            case PDU::IEEE802_3:
+                write_be16(ptr + dot3_length_offset,
+                           static_cast<uint16_t>(layer_size - dot3_header_size));
+                break;
+            case PDU::IP:
+                write_be16(ptr + ip_tot_len_offset, static_cast<uint16_t>(layer_size));
+                break;
+            case PDU::IPv6:
+                write_be16(ptr + ipv6_payload_length_offset,
+                           static_cast<uint16_t>(layer_size - ipv6_fixed_header_size));
+                break;
+            case PDU::UDP:
+                write_be16(ptr + udp_len_offset, static_cast<uint16_t>(layer_size));
+                break;
+            default:
+                break;
+        }
+    }
+    view_ = PacketView(buffer_, new_size, first_layer_);
+    for (uint32_t i = 0; i < view_.layer_count() && i < layer_count; ++i) {
+        if (resized[i]) {
+            update_checksum(i);
+        }
+    }
+}
+
+void PacketEditor::update_checksums() {
+    for (uint32_t i = 0; i < view_.layer_count(); ++i) {
+        update_checksum(i);
+    }
+}
+
+uint32_t PacketEditor::find_layer(PDU::PDUType type) const {
+    for (uint32_t i = 0; i < view_.layer_count(); ++i) {
+        if (view_.layer(i).pdu_type() == type) {
+            return i;
+        }
+    }
+    throw pdu_not_found();
+}
+
+uint8_t* PacketEditor::layer_data(uint32_t index) {
+    return buffer_ + (view_.layer(index).data() - view_.data());
+}
+
+void PacketEditor::patch_ipv6_address(uint32_t offset, const IPv6Address& new_addr) {
+    const uint32_t index = find_layer(PDU::IPv6);
+    uint8_t* ptr = layer_data(index) + offset;
+    uint8_t old_data[IPv6Address::address_size];
+    uint8_t new_data[IPv6Address::address_size];
+    memcpy(old_data, ptr, sizeof(old_data));
+    new_addr.copy(new_data);
+    memcpy(ptr, new_data, sizeof(new_data));
+    // The view only contains a transport layer if the payload isn't fragmented
+    if (index + 1 < view_.layer_count()) {
+        const PDU::PDUType next_type = view_.layer(index + 1).pdu_type();
+        Constants::IP::e protocol = static_cast<Constants::IP::e>(0xff);
+        if (next_type == PDU::TCP || next_type == PDU::UDP) {
+            protocol = Internals::pdu_flag_to_ip_type(next_type);
+        }
+        else if (is_icmpv6_payload(view_, index + 1)) {
+            protocol = Constants::IP::PROTO_ICMPV6;
+        }
+        if (protocol != 0xff) {
+            Internals::patch_pseudoheader_checksum(
+                protocol,
+                layer_data(index + 1),
+                view_.layer(index + 1).size(),
+                old_data,
+                new_data,
+                sizeof(new_data)
+            );
+        }
+    }
+}
+
+void PacketEditor::patch_tcp_field(uint32_t offset, const uint8_t* new_data,
+                                   uint32_t data_size) {
+    uint8_t* ptr = layer_data(find_layer(PDU::TCP));
+    Internals::patch_checksummed_field(
+        ptr + offset,
+        new_data,
+        data_size,
+        ptr + tcp_check_offset
+    );
+}
+
+void PacketEditor::update_checksum(uint32_t index) {
+    const LayerView& layer = view_.layer(index);
+    uint8_t* ptr = layer_data(index);
+    switch (layer.pdu_type()) {
+        case PDU::IP:
+            memset(ptr + ip_check_offset, 0, sizeof(uint16_t));
+            write_checksum(
+                ptr + ip_check_offset,
+                Utils::sum_range(ptr, ptr + layer.header_size())
+            );
+            break;
+        case PDU::ICMP:
+            memset(ptr + icmp_check_offset, 0, sizeof(uint16_t));
+            write_checksum(ptr + icmp_check_offset, Utils::sum_range(ptr, ptr + layer.size()));
+            break;
+        case PDU::RAW:
+            if (is_icmpv6_payload(view_, index) && layer.size() >= icmp_check_offset + 2) {
+                const IPv6View ipv6(view_.layer(index - 1));
+                memset(ptr + icmp_check_offset, 0, sizeof(uint16_t));
+                const uint32_t sum = Utils::pseudoheader_checksum(
+                    ipv6.src_addr(),
+                    ipv6.dst_addr(),
+                    static_cast<uint16_t>(layer.size()),
+                    Constants::IP::PROTO_ICMPV6
+                );
+                write_checksum(ptr + icmp_check_offset,
+                               sum + Utils::sum_range(ptr, ptr + layer.size()));
+            }
+            break;
+        case PDU::TCP:
+        case PDU::UDP:
+            {
+                if (index == 0) {
+                    break;
+                }
+                const bool is_udp = layer.pdu_type() == PDU::UDP;
+                uint8_t* checksum = ptr + (is_udp ? udp_check_offset : tcp_check_offset);
+                const LayerView& parent = view_.layer(index - 1);
+                const Constants::IP::e protocol = Internals::pdu_flag_to_ip_type(layer.pdu_type());
+                uint32_t sum = 0;
+                if (parent.pdu_type() == PDU::IP) {
+                    // A zero checksum means the UDP datagram doesn't use one
+                    if (is_udp && checksum[0] == 0 && checksum[1] == 0) {
+                        break;
+                    }
+                    const IPView ip(parent);
+                    sum = Utils::pseudoheader_checksum(
+                        ip.src_addr(),
+                        ip.dst_addr(),
+                        static_cast<uint16_t>(layer.size()),
+                        protocol
+                    );
+                }
+                else if (parent.pdu_type() == PDU::IPv6) {
+                    const IPv6View ipv6(parent);
+                    sum = Utils::pseudoheader_checksum(
+                        ipv6.src_addr(),
+                        ipv6.dst_addr(),
+                        static_cast<uint16_t>(layer.size()),
+                        protocol
+                    );
+                }
+                else {
+                    break;
+                }
+                memset(checksum, 0, sizeof(uint16_t));
+                write_checksum(checksum, sum + Utils::sum_range(ptr, ptr + layer.size()));
+                if (is_udp && checksum[0] == 0 && checksum[1] == 0) {
+                    checksum[0] = checksum[1] = 0xff;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+} // Tins
@@ -355,26 +355,26 @@ void PacketSender::send_l2(PDU& pdu,
                            struct sockaddr* link_addr, 
                            uint32_t len_addr,
                            const NetworkInterface& iface) {
-    PDU::serialization_type buffer = pdu.serialize();
+    const uint32_t sz = pdu.serialize(send_buffer_);
 
     #ifdef TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
         Internals::unused(len_addr);
         Internals::unused(link_addr);
         open_l2_socket(iface);
         pcap_t* handle = pcap_handles_[iface];
-        const int buf_size = static_cast<int>(buffer.size());
-        if (pcap_sendpacket(handle, (u_char*)&buffer[0], buf_size) != 0) {
+        const int buf_size = static_cast<int>(sz);
+        if (pcap_sendpacket(handle, (u_char*)&send_buffer_[0], buf_size) != 0) {
             throw pcap_error("Failed to send packet: " + string(pcap_geterr(handle)));
         }
     #else // TINS_HAVE_PACKET_SENDER_PCAP_SENDPACKET
         int sock = get_ether_socket(iface);
-        if (!buffer.empty()) {
+        if (sz > 0) {
             #if defined(BSD) || defined(__FreeBSD_kernel__)
             Internals::unused(len_addr);
             Internals::unused(link_addr);
-            if (::write(sock, &buffer[0], buffer.size()) == -1) {
+            if (::write(sock, &send_buffer_[0], sz) == -1) {
             #else
-            if (::sendto(sock, &buffer[0], buffer.size(), 0, link_addr, len_addr) == -1) {
+            if (::sendto(sock, &send_buffer_[0], sz, 0, link_addr, len_addr) == -1) {
             #endif
                 throw socket_write_error(make_error_string());
             }
@@ -417,9 +417,8 @@ void PacketSender::send_l3(PDU& pdu,
                            SocketType type) {
     open_l3_socket(type);
     int sock = sockets_[type];
-    PDU::serialization_type buffer = pdu.serialize();
-    const int buf_size = static_cast<int>(buffer.size());
-    if (sendto(sock, (const char*)&buffer[0], buf_size, 0, link_addr, len_addr) == -1) {
+    const int buf_size = static_cast<int>(pdu.serialize(send_buffer_));
+    if (sendto(sock, (const char*)&send_buffer_[0], buf_size, 0, link_addr, len_addr) == -1) {
         throw socket_write_error(make_error_string());
     }
 }
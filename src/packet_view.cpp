@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+#include <tins/packet_view.h>
+#include <tins/ethernetII.h>
+#include <tins/dot3.h>
+#include <tins/dot1q.h>
+#include <tins/arp.h>
+#include <tins/ip.h>
+#include <tins/ipv6.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/icmp.h>
+#include <tins/exceptions.h>
+#include <tins/utils/checksum_utils.h>
+#include <tins/detail/pdu_helpers.h>
+#include <tins/detail/checksum_kernels.h>
+
+namespace Tins {
+
+PDU::metadata extract_layer_metadata(PDU::PDUType type,
+                                     const uint8_t* buffer,
+                                     uint32_t total_sz) {
+    switch (type) {
+        case PDU::ETHERNET_II:
+            if (Internals::is_dot3(buffer, total_sz)) {
+                return Dot3::extract_metadata(buffer, total_sz);
+            }
+            return EthernetII::extract_metadata(buffer, total_sz);
+        case PDU::IEEE802_3:
+            return Dot3::extract_metadata(buffer, total_sz);
+        case PDU::DOT1Q:
+            return Dot1Q::extract_metadata(buffer, total_sz);
+        case PDU::ARP:
+            return ARP::extract_metadata(buffer, total_sz);
+        case PDU::IP:
+            return IP::extract_metadata(buffer, total_sz);
+        case PDU::IPv6:
+            return IPv6::extract_metadata(buffer, total_sz);
+        case PDU::TCP:
+            return TCP::extract_metadata(buffer, total_sz);
+        case PDU::UDP:
+            return UDP::extract_metadata(buffer, total_sz);
+        case PDU::ICMP:
+            return ICMP::extract_metadata(buffer, total_sz);
+        default:
+            return PDU::metadata(total_sz, PDU::RAW, PDU::UNKNOWN);
+    }
+}
+
+// Returns the amount of bytes that belong to this layer, based on its length field
+uint32_t advertised_layer_size(PDU::PDUType type, const uint8_t* buffer, uint32_t total_sz) {
+    uint32_t advertised_size = 0;
+    if (type == PDU::IP) {
+        // A 0 total length is used when doing TCP segmentation offload
+        advertised_size = Internals::view_read_be16(buffer + 2);
+    }
+    else if (type == PDU::IPv6) {
+        const uint32_t payload_length = Internals::view_read_be16(buffer + 4);
+        if (payload_length != 0) {
+            advertised_size = payload_length + 40;
+        }
+    }
+    return (advertised_size != 0 && advertised_size < total_sz) ? advertised_size : total_sz;
+}
+
+// PacketView
+
+PacketView::PacketView(const uint8_t* buffer, uint32_t total_sz, PDU::PDUType first_layer)
+: buffer_(buffer), size_(total_sz), layer_count_(0) {
+    PDU::PDUType type = first_layer;
+    while (total_sz > 0) {
+        PDU::metadata metadata;
+        // Keep the last slot for the payload
+        if (layer_count_ + 1 == max_layers) {
+            type = PDU::RAW;
+        }
+        // Checking sizes first avoids throwing on truncated packets
+        if (Internals::layer_fits(type, buffer, total_sz)) {
+            metadata = extract_layer_metadata(type, buffer, total_sz);
+        }
+        else {
+            metadata = PDU::metadata(total_sz, PDU::RAW, PDU::UNKNOWN);
+        }
+        if (metadata.current_pdu_type == PDU::RAW || metadata.header_size > total_sz) {
+            layers_[layer_count_++] = LayerView(PDU::RAW, buffer, total_sz, total_sz);
+            break;
+        }
+        total_sz = advertised_layer_size(metadata.current_pdu_type, buffer, total_sz);
+        if (TINS_UNLIKELY(total_sz < metadata.header_size)) {
+            total_sz = metadata.header_size;
+        }
+        layers_[layer_count_++] = LayerView(
+            metadata.current_pdu_type,
+            buffer,
+            metadata.header_size,
+            total_sz
+        );
+        buffer += metadata.header_size;
+        total_sz -= metadata.header_size;
+        type = metadata.next_pdu_type == PDU::UNKNOWN ? PDU::RAW : metadata.next_pdu_type;
+    }
+}
+
+const LayerView* PacketView::find_layer(PDU::PDUType type) const {
+    for (uint32_t i = 0; i < layer_count_; ++i) {
+        if (layers_[i].pdu_type() == type) {
+            return &layers_[i];
+        }
+    }
+    return 0;
+}
+
+// classify
+
+// Link layer types, as defined in pcap's dlt.h. These are used instead of
+// the DLT_* macros so this works without libpcap
+const int link_type_null = 0;
+const int link_type_ethernet = 1;
+const int link_type_raw = 12;
+const int link_type_raw_openbsd = 14;
+const int link_type_raw_linktype = 101;
+const int link_type_loop = 108;
+const int link_type_linux_sll = 113;
+
+const uint32_t loopback_header_size = 4;
+const uint32_t sll_header_size = 16;
+
+PDU::PDUType ip_version_to_pdu_flag(const uint8_t* buffer, uint32_t total_sz) {
+    if (total_sz == 0) {
+        return PDU::RAW;
+    }
+    switch (buffer[0] >> 4) {
+        case 4:
+            return PDU::IP;
+        case 6:
+            return PDU::IPv6;
+        default:
+            return PDU::RAW;
+    }
+}
+
+PacketClassification classify(const uint8_t* buffer, uint32_t total_sz, int link_type) {
+    PacketClassification output;
+    output.layer_count = 0;
+    PDU::PDUType first_type = PDU::RAW;
+    uint32_t header_size = 0;
+    if (link_type == link_type_ethernet) {
+        first_type = PDU::ETHERNET_II;
+    }
+    else if (link_type == link_type_raw || link_type == link_type_raw_openbsd ||
+             link_type == link_type_raw_linktype) {
+        first_type = ip_version_to_pdu_flag(buffer, total_sz);
+    }
+    else if ((link_type == link_type_null || link_type == link_type_loop) &&
+             total_sz >= loopback_header_size) {
+        // The address family's value is platform dependent, use the IP version
+        header_size = loopback_header_size;
+        first_type = ip_version_to_pdu_flag(buffer + header_size, total_sz - header_size);
+        const PacketClassification::layer_info layer = { PDU::LOOPBACK, 0, total_sz };
+        output.layers[output.layer_count++] = layer;
+    }
+    else if (link_type == link_type_linux_sll && total_sz >= sll_header_size) {
+        header_size = sll_header_size;
+        const uint16_t protocol = Internals::view_read_be16(buffer + 14);
+        first_type = Internals::ether_type_to_pdu_flag(
+            static_cast<Constants::Ethernet::e>(protocol)
+        );
+        if (first_type == PDU::UNKNOWN) {
+            first_type = PDU::RAW;
+        }
+        const PacketClassification::layer_info layer = { PDU::SLL, 0, total_sz };
+        output.layers[output.layer_count++] = layer;
+    }
+    if (header_size == total_sz) {
+        return output;
+    }
+    const PacketView view(buffer + header_size, total_sz - header_size, first_type);
+    for (uint32_t i = 0; i < view.layer_count(); ++i) {
+        const LayerView& layer_view = view.layer(i);
+        const PacketClassification::layer_info layer = {
+            layer_view.pdu_type(),
+            static_cast<uint32_t>(layer_view.data() - buffer),
+            layer_view.size()
+        };
+        output.layers[output.layer_count++] = layer;
+    }
+    return output;
+}
+
+// verify_checksums
+
+const uint32_t ip_tot_len_offset = 2;
+const uint32_t ipv6_payload_length_offset = 4;
+const uint32_t ipv6_fixed_header_size = 40;
+const uint32_t udp_check_offset = 6;
+
+// Sums computed using sum_range are in memory order, so this works on any host
+bool is_valid_checksum(uint32_t sum) {
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return sum == 0xffff;
+}
+
+// Whether every byte the network layer advertises was captured. The transport
+// checksums cover them all, so they can't be verified otherwise
+bool is_complete_network_layer(const LayerView& layer) {
+    if (layer.pdu_type() == PDU::IP) {
+        return Internals::view_read_be16(layer.data() + ip_tot_len_offset) == layer.size();
+    }
+    const uint32_t payload_length = Internals::view_read_be16(
+        layer.data() + ipv6_payload_length_offset
+    );
+    return payload_length + ipv6_fixed_header_size == layer.size();
+}
+
+ChecksumReport verify_view_checksums(const PacketView& view,
+                                     Internals::checksum_kernel kernel) {
+    ChecksumReport report;
+    for (uint32_t i = 0; i < view.layer_count(); ++i) {
+        const LayerView& layer = view.layer(i);
+        const uint8_t* ptr = layer.data();
+        uint32_t flag = 0;
+        uint32_t sum = 0;
+        switch (layer.pdu_type()) {
+            case PDU::IP:
+                flag = ChecksumReport::IP_CHECKSUM;
+                sum = Internals::checksum_sum_range(kernel, ptr, ptr + layer.header_size());
+                break;
+            case PDU::ICMP:
+            case PDU::TCP:
+            case PDU::UDP:
+                {
+                    if (i == 0) {
+                        break;
+                    }
+                    const LayerView& parent = view.layer(i - 1);
+                    if ((parent.pdu_type() != PDU::IP && parent.pdu_type() != PDU::IPv6) ||
+                        !is_complete_network_layer(parent)) {
+                        break;
+                    }
+                    if (layer.pdu_type() == PDU::ICMP) {
+                        // ICMP over IPv6 is ICMPv6, which isn't walked by PacketView
+                        flag = ChecksumReport::ICMP_CHECKSUM;
+                        sum = Internals::checksum_sum_range(kernel, ptr, ptr + layer.size());
+                        break;
+                    }
+                    const Constants::IP::e protocol = Internals::pdu_flag_to_ip_type(
+                        layer.pdu_type()
+                    );
+                    if (parent.pdu_type() == PDU::IP) {
+                        // A zero checksum means the UDP datagram doesn't use one
+                        if (layer.pdu_type() == PDU::UDP && ptr[udp_check_offset] == 0 &&
+                            ptr[udp_check_offset + 1] == 0) {
+                            break;
+                        }
+                        const IPView ip(parent);
+                        sum = Utils::pseudoheader_checksum(
+                            ip.src_addr(),
+                            ip.dst_addr(),
+                            static_cast<uint16_t>(layer.size()),
+                            protocol
+                        );
+                    }
+                    else {
+                        const IPv6View ipv6(parent);
+                        sum = Utils::pseudoheader_checksum(
+                            ipv6.src_addr(),
+                            ipv6.dst_addr(),
+                            static_cast<uint16_t>(layer.size()),
+                            protocol
+                        );
+                    }
+                    flag = layer.pdu_type() == PDU::TCP ? ChecksumReport::TCP_CHECKSUM :
+                                                          ChecksumReport::UDP_CHECKSUM;
+                    sum += Internals::checksum_sum_range(kernel, ptr, ptr + layer.size());
+                }
+                break;
+            default:
+                break;
+        }
+        if (flag != 0) {
+            report.verified |= flag;
+            if (!is_valid_checksum(sum)) {
+                report.invalid |= flag;
+            }
+        }
+    }
+    return report;
+}
+
+ChecksumReport verify_checksums(const PacketView& view) {
+    return verify_view_checksums(view, Internals::best_checksum_kernel());
+}
+
+ChecksumReport verify_checksums(const uint8_t* buffer, uint32_t total_sz,
+                                PDU::PDUType first_layer) {
+    return verify_checksums(PacketView(buffer, total_sz, first_layer));
+}
+
+uint32_t verify_checksums(const uint8_t* const* packets,
+                          const uint32_t* packet_sizes,
+                          uint32_t packet_count,
+                          PDU::PDUType first_layer,
+                          ChecksumReport* results) {
+    const Internals::checksum_kernel kernel = Internals::best_checksum_kernel();
+    uint32_t valid_count = 0;
+    for (uint32_t i = 0; i < packet_count; ++i) {
+        const PacketView view(packets[i], packet_sizes[i], first_layer);
+        const ChecksumReport report = verify_view_checksums(view, kernel);
+        if (report.valid()) {
+            ++valid_count;
+        }
+        if (results) {
+            results[i] = report;
+        }
+    }
+    return valid_count;
+}
+
+} // Tins
@@ -66,17 +66,27 @@ void PacketWriter::write(Packet& packet) {
     timeval tv;
     tv.tv_sec = packet.timestamp().seconds();
     tv.tv_usec = packet.timestamp().microseconds();
-    write(*packet.pdu(), tv);
+    // Serializing updates checksums and lengths, so a shared PDU is
+    // serialized through a scratch copy rather than detached from the
+    // Packets sharing it
+    if (packet.is_shared()) {
+        const Packet& shared_packet = packet;
+        Packet scratch(*shared_packet.pdu(), packet.timestamp());
+        write(*scratch.pdu(), tv);
+    }
+    else {
+        write(*packet.pdu(), tv);
+    }
 }
 
 void PacketWriter::write(PDU& pdu, const struct timeval& tv) {
-    PDU::serialization_type buffer = pdu.serialize();
+    const uint32_t sz = pdu.serialize(buffer_);
     struct pcap_pkthdr header;
     memset(&header, 0, sizeof(header));
     header.ts = tv;
-    header.caplen = static_cast<bpf_u_int32>(buffer.size());
-    header.len = static_cast<bpf_u_int32>(buffer.size());
-    pcap_dump((u_char*)dumper_, &header, &buffer[0]);
+    header.caplen = static_cast<bpf_u_int32>(sz);
+    header.len = static_cast<bpf_u_int32>(sz);
+    pcap_dump((u_char*)dumper_, &header, buffer_.empty() ? 0 : &buffer_[0]);
 }
 
 void PacketWriter::init(const string& file_name, int link_type) {
@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+
+#include <tins/parallel_file_sniffer.h>
+
+#if defined(TINS_HAVE_PCAP) && !defined(_WIN32) && TINS_IS_CXX11
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <exception>
+#include <condition_variable>
+#include <tins/decoding_scope.h>
+
+using std::string;
+using std::vector;
+
+namespace Tins {
+
+// Reads batches of records on one thread and decodes them on a pool of
+// threads. Batches are numbered as they're read so the consumer can put
+// them back in order
+class ParallelFileSniffer::pipeline {
+public:
+    pipeline(PcapFileReader& reader, Internals::frame_decoder decoder,
+             uint32_t thread_count, uint32_t batch_size, uint32_t flags,
+             bool ordered)
+    : reader_(reader), decoder_(decoder), batch_size_(batch_size), flags_(flags),
+    // Enough batches to keep every thread busy while the consumer
+    // waits for the oldest one
+    max_pending_batches_(thread_count * 4), next_read_batch_(0),
+    next_delivered_batch_(0), pending_batches_(0), ordered_(ordered),
+    reading_done_(false), stopping_(false) {
+        reader_thread_ = std::thread(&pipeline::reader_loop, this);
+        for (uint32_t i = 0; i < thread_count; ++i) {
+            workers_.emplace_back(&pipeline::worker_loop, this);
+        }
+    }
+
+    ~pipeline() {
+        {
+            std::lock_guard<std::mutex> _(mutex_);
+            stopping_ = true;
+        }
+        space_available_.notify_all();
+        input_available_.notify_all();
+        reader_thread_.join();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    bool next_batch(vector<Packet>& output) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            output_available_.wait(lock, [&]() {
+                return error_ || batch_ready() || (reading_done_ && pending_batches_ == 0);
+            });
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+            if (!batch_ready()) {
+                return false;
+            }
+            std::map<uint64_t, vector<Packet>>::iterator iter = decoded_.begin();
+            output.swap(iter->second);
+            decoded_.erase(iter);
+            ++next_delivered_batch_;
+            --pending_batches_;
+            space_available_.notify_one();
+            // Batches in which every frame was malformed are empty
+            if (!output.empty()) {
+                return true;
+            }
+        }
+    }
+private:
+    typedef vector<PcapFileReader::record> record_batch;
+
+    bool batch_ready() const {
+        if (decoded_.empty()) {
+            return false;
+        }
+        return !ordered_ || decoded_.begin()->first == next_delivered_batch_;
+    }
+
+    void reader_loop() {
+        try {
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    space_available_.wait(lock, [&]() {
+                        return stopping_ || pending_batches_ < max_pending_batches_;
+                    });
+                    if (stopping_) {
+                        return;
+                    }
+                }
+                // The reader is only used by this thread, so records are
+                // read without holding the lock
+                record_batch records;
+                records.reserve(batch_size_);
+                PcapFileReader::record record;
+                while (records.size() < batch_size_ && reader_.next_record(record)) {
+                    records.push_back(record);
+                }
+                {
+                    std::lock_guard<std::mutex> _(mutex_);
+                    if (records.empty()) {
+                        reading_done_ = true;
+                    }
+                    else {
+                        input_.push_back(std::make_pair(next_read_batch_++, std::move(records)));
+                        ++pending_batches_;
+                    }
+                }
+                if (reading_done_) {
+                    input_available_.notify_all();
+                    output_available_.notify_all();
+                    return;
+                }
+                input_available_.notify_one();
+            }
+        }
+        catch (...) {
+            set_error(std::current_exception());
+        }
+    }
+
+    void worker_loop() {
+        DecodingScope scope(flags_);
+        try {
+            while (true) {
+                std::pair<uint64_t, record_batch> batch;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    input_available_.wait(lock, [&]() {
+                        return stopping_ || reading_done_ || !input_.empty();
+                    });
+                    if (stopping_ || input_.empty()) {
+                        return;
+                    }
+                    batch = std::move(input_.front());
+                    input_.pop_front();
+                }
+                vector<Packet> packets;
+                decode(batch.second, packets);
+                {
+                    std::lock_guard<std::mutex> _(mutex_);
+                    decoded_[batch.first].swap(packets);
+                }
+                output_available_.notify_one();
+            }
+        }
+        catch (...) {
+            set_error(std::current_exception());
+        }
+    }
+
+    // Malformed frames are skipped
+    void decode(const record_batch& records, vector<Packet>& output) const {
+        output.reserve(records.size());
+        for (size_t i = 0; i < records.size(); ++i) {
+            PDU* pdu = 0;
+            try {
+                pdu = decoder_(records[i].buffer, records[i].size);
+            }
+            catch (malformed_packet&) {
+            }
+            if (pdu) {
+                output.push_back(Packet(pdu, records[i].timestamp, Packet::own_pdu()));
+            }
+        }
+    }
+
+    void set_error(std::exception_ptr error) {
+        {
+            std::lock_guard<std::mutex> _(mutex_);
+            if (!error_) {
+                error_ = error;
+            }
+        }
+        output_available_.notify_all();
+    }
+
+    PcapFileReader& reader_;
+    Internals::frame_decoder decoder_;
+    std::thread reader_thread_;
+    vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable space_available_;
+    std::condition_variable input_available_;
+    std::condition_variable output_available_;
+    std::deque<std::pair<uint64_t, record_batch>> input_;
+    std::map<uint64_t, vector<Packet>> decoded_;
+    uint32_t batch_size_;
+    uint32_t flags_;
+    size_t max_pending_batches_;
+    uint64_t next_read_batch_;
+    uint64_t next_delivered_batch_;
+    size_t pending_batches_;
+    std::exception_ptr error_;
+    bool ordered_;
+    bool reading_done_;
+    bool stopping_;
+};
+
+const uint32_t ParallelFileSniffer::DEFAULT_BATCH_SIZE = 1024;
+
+ParallelFileSniffer::ParallelFileSniffer(const string& file_name, uint32_t thread_count,
+                                         DeliveryOrder order)
+: reader_(file_name), pipeline_(0),
+  // This throws if the link type is not supported
+  frame_decoder_(Internals::frame_decoder_from_dlt_flag(reader_.link_type())),
+  current_index_(0), thread_count_(thread_count), batch_size_(DEFAULT_BATCH_SIZE),
+  decoding_flags_(0), order_(order) {
+    if (thread_count_ == 0) {
+        thread_count_ = std::thread::hardware_concurrency();
+        if (thread_count_ == 0) {
+            thread_count_ = 1;
+        }
+    }
+}
+
+ParallelFileSniffer::~ParallelFileSniffer() {
+    delete pipeline_;
+}
+
+bool ParallelFileSniffer::next_batch(vector<Packet>& output) {
+    output.clear();
+    if (!pipeline_) {
+        pipeline_ = new pipeline(reader_, frame_decoder_, thread_count_, batch_size_,
+                                 decoding_flags_, order_ == ORDERED);
+    }
+    return pipeline_->next_batch(output);
+}
+
+void ParallelFileSniffer::set_batch_size(uint32_t size) {
+    batch_size_ = size == 0 ? 1 : size;
+}
+
+uint32_t ParallelFileSniffer::batch_size() const {
+    return batch_size_;
+}
+
+void ParallelFileSniffer::set_extract_raw_pdus(bool value) {
+    if (value) {
+        frame_decoder_ = &Internals::decode_raw_frame;
+    }
+    else {
+        frame_decoder_ = Internals::frame_decoder_from_dlt_flag(reader_.link_type());
+    }
+}
+
+void ParallelFileSniffer::set_decoding_flags(uint32_t flags) {
+    decoding_flags_ = flags;
+}
+
+uint32_t ParallelFileSniffer::decoding_flags() const {
+    return decoding_flags_;
+}
+
+uint32_t ParallelFileSniffer::thread_count() const {
+    return thread_count_;
+}
+
+ParallelFileSniffer::DeliveryOrder ParallelFileSniffer::delivery_order() const {
+    return order_;
+}
+
+int ParallelFileSniffer::link_type() const {
+    return reader_.link_type();
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && !_WIN32 && TINS_IS_CXX11
@@ -0,0 +1,213 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+
+#include <tins/pcap_file_reader.h>
+
+#if defined(TINS_HAVE_PCAP) && !defined(_WIN32)
+
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <tins/endianness.h>
+#include <tins/decoding_scope.h>
+
+using std::string;
+
+namespace Tins {
+
+const uint32_t microsecond_magic = 0xa1b2c3d4;
+const uint32_t nanosecond_magic = 0xa1b23c4d;
+const uint32_t file_header_size = 24;
+const uint32_t record_header_size = 16;
+
+PcapFileReader::PcapFileReader(const string& file_name)
+: data_(0), size_(0), offset_(file_header_size), link_type_(0), snap_len_(0),
+  nanosecond_precision_(false), swapped_(false), extract_raw_(false),
+  decoding_flags_(0), frame_decoder_(0) {
+    try {
+        open(file_name);
+    }
+    catch (...) {
+        close();
+        throw;
+    }
+}
+
+PcapFileReader::~PcapFileReader() {
+    close();
+}
+
+void PcapFileReader::open(const string& file_name) {
+    const int fd = ::open(file_name.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw pcap_error(file_name + ": " + strerror(errno));
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) < 0) {
+        const int error = errno;
+        ::close(fd);
+        throw pcap_error(file_name + ": " + strerror(error));
+    }
+    if (file_stat.st_size < static_cast<off_t>(file_header_size)) {
+        ::close(fd);
+        throw pcap_error(file_name + ": not a pcap file");
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    void* data = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    const int error = errno;
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        size_ = 0;
+        throw pcap_error(file_name + ": " + strerror(error));
+    }
+    data_ = static_cast<const uint8_t*>(data);
+    // Records are read front to back, so read ahead aggressively
+    madvise(data, size_, MADV_SEQUENTIAL);
+
+    uint32_t magic;
+    memcpy(&magic, data_, sizeof(magic));
+    swapped_ = magic != microsecond_magic && magic != nanosecond_magic;
+    if (swapped_) {
+        magic = Endian::change_endian(magic);
+    }
+    if (magic != microsecond_magic && magic != nanosecond_magic) {
+        throw pcap_error(file_name + ": not a pcap file");
+    }
+    nanosecond_precision_ = magic == nanosecond_magic;
+    snap_len_ = read_field(data_ + 16);
+    // The upper bits may contain the FCS length
+    link_type_ = Internals::dlt_from_link_type(read_field(data_ + 20) & 0xffff);
+}
+
+void PcapFileReader::close() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+        data_ = 0;
+    }
+}
+
+uint32_t PcapFileReader::read_field(const uint8_t* buffer) const {
+    uint32_t value;
+    memcpy(&value, buffer, sizeof(value));
+    return swapped_ ? Endian::change_endian(value) : value;
+}
+
+bool PcapFileReader::next_record(record& output) {
+    if (size_ - offset_ < record_header_size) {
+        return false;
+    }
+    const uint8_t* header = data_ + offset_;
+    const uint32_t captured_size = read_field(header + 8);
+    if (size_ - offset_ - record_header_size < captured_size) {
+        // Don't try to read anything past a truncated record
+        offset_ = size_;
+        return false;
+    }
+    struct timeval tv;
+    tv.tv_sec = read_field(header);
+    tv.tv_usec = read_field(header + 4);
+    if (nanosecond_precision_) {
+        tv.tv_usec /= 1000;
+    }
+    output.buffer = header + record_header_size;
+    output.size = captured_size;
+    output.original_size = read_field(header + 12);
+    output.timestamp = tv;
+    offset_ += record_header_size + captured_size;
+    return true;
+}
+
+Internals::frame_decoder PcapFileReader::resolve_frame_decoder() {
+    if (extract_raw_) {
+        frame_decoder_ = &Internals::decode_raw_frame;
+    }
+    else {
+        // This throws if the link type is not supported
+        frame_decoder_ = Internals::frame_decoder_from_dlt_flag(link_type_);
+    }
+    return frame_decoder_;
+}
+
+PtrPacket PcapFileReader::next_packet() {
+    const Internals::frame_decoder decoder = frame_decoder_ ? frame_decoder_ :
+                                             resolve_frame_decoder();
+    DecodingScope decoding_scope(decoding_flags_);
+    record current;
+    while (next_record(current)) {
+        PDU* pdu = 0;
+        try {
+            pdu = decoder(current.buffer, current.size);
+        }
+        catch (malformed_packet&) {
+        }
+        if (pdu) {
+            return PtrPacket(pdu, current.timestamp);
+        }
+    }
+    return PtrPacket(0, Timestamp());
+}
+
+void PcapFileReader::rewind() {
+    offset_ = file_header_size;
+}
+
+void PcapFileReader::set_extract_raw_pdus(bool value) {
+    extract_raw_ = value;
+    frame_decoder_ = 0;
+}
+
+void PcapFileReader::set_decoding_flags(uint32_t flags) {
+    decoding_flags_ = flags;
+}
+
+uint32_t PcapFileReader::decoding_flags() const {
+    return decoding_flags_;
+}
+
+int PcapFileReader::link_type() const {
+    return link_type_;
+}
+
+uint32_t PcapFileReader::snap_len() const {
+    return snap_len_;
+}
+
+bool PcapFileReader::nanosecond_precision() const {
+    return nanosecond_precision_;
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP && !_WIN32
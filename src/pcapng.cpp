@@ -0,0 +1,619 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+
+#include <tins/pcapng.h>
+
+#ifdef TINS_HAVE_PCAP
+
+#include <cstring>
+#include <cmath>
+#include <errno.h>
+#include <sys/time.h>
+#include <tins/pdu.h>
+#include <tins/endianness.h>
+#include <tins/decoding_scope.h>
+
+using std::string;
+using std::vector;
+
+namespace Tins {
+
+const uint32_t section_header_block = 0x0a0d0d0a;
+const uint32_t interface_description_block = 1;
+const uint32_t simple_packet_block = 3;
+const uint32_t enhanced_packet_block = 6;
+const uint32_t byte_order_magic = 0x1a2b3c4d;
+
+const uint16_t opt_endofopt = 0;
+const uint16_t opt_comment = 1;
+const uint16_t shb_userappl = 4;
+const uint16_t if_name = 2;
+const uint16_t if_tsresol = 9;
+const uint16_t if_tsoffset = 14;
+const uint16_t epb_flags = 2;
+
+// Blocks larger than this are considered corrupted, same as libpcap does
+const uint32_t max_block_size = 16 * 1024 * 1024;
+const uint64_t nanoseconds_per_second = 1000000000ULL;
+
+const uint64_t powers_of_ten[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL,
+    10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+    10000000000000000000ULL
+};
+const uint8_t max_power_of_ten = sizeof(powers_of_ten) / sizeof(powers_of_ten[0]) - 1;
+
+// Converts a timestamp in units of the given if_tsresol resolution into
+// nanoseconds and back
+uint64_t ticks_to_nanoseconds(uint64_t ticks, uint8_t resolution) {
+    if (resolution & 0x80) {
+        return static_cast<uint64_t>(std::ldexp(static_cast<long double>(ticks),
+                                                -(resolution & 0x7f)) *
+                                     nanoseconds_per_second);
+    }
+    if (resolution > max_power_of_ten) {
+        return 0;
+    }
+    if (resolution >= 9) {
+        return ticks / powers_of_ten[resolution - 9];
+    }
+    return ticks * powers_of_ten[9 - resolution];
+}
+
+uint64_t nanoseconds_to_ticks(uint64_t nanoseconds, uint8_t resolution) {
+    if (resolution & 0x80) {
+        return static_cast<uint64_t>(std::ldexp(static_cast<long double>(nanoseconds) /
+                                                nanoseconds_per_second,
+                                                resolution & 0x7f));
+    }
+    if (resolution > max_power_of_ten) {
+        return 0;
+    }
+    if (resolution >= 9) {
+        return nanoseconds * powers_of_ten[resolution - 9];
+    }
+    return nanoseconds / powers_of_ten[9 - resolution];
+}
+
+uint32_t padded_size(uint32_t size) {
+    return (size + 3) & ~3U;
+}
+
+// PcapngRecord
+
+Timestamp PcapngRecord::timestamp() const {
+    struct timeval tv;
+    tv.tv_sec = static_cast<time_t>(nanoseconds / nanoseconds_per_second);
+    tv.tv_usec = static_cast<suseconds_t>((nanoseconds % nanoseconds_per_second) / 1000);
+    return tv;
+}
+
+// PcapngReader
+
+PcapngReader::PcapngReader(const string& file_name)
+: file_(0), swapped_(false), extract_raw_(false), decoding_flags_(0) {
+    file_ = std::fopen(file_name.c_str(), "rb");
+    if (!file_) {
+        throw pcap_error(file_name + ": " + strerror(errno));
+    }
+    // Blocks are read one by one, so read ahead in large chunks
+    std::setvbuf(file_, 0, _IOFBF, 1 << 20);
+    uint32_t type = 0;
+    if (!read_block(type) || type != section_header_block || !parse_section_header()) {
+        std::fclose(file_);
+        throw pcap_error(file_name + ": not a pcapng file");
+    }
+}
+
+PcapngReader::~PcapngReader() {
+    std::fclose(file_);
+}
+
+uint16_t PcapngReader::read_16(const uint8_t* buffer) const {
+    uint16_t value;
+    memcpy(&value, buffer, sizeof(value));
+    return swapped_ ? Endian::change_endian(value) : value;
+}
+
+uint32_t PcapngReader::read_32(const uint8_t* buffer) const {
+    uint32_t value;
+    memcpy(&value, buffer, sizeof(value));
+    return swapped_ ? Endian::change_endian(value) : value;
+}
+
+bool PcapngReader::read_block(uint32_t& type) {
+    uint8_t header[12];
+    if (std::fread(header, 1, 8, file_) != 8) {
+        return false;
+    }
+    uint32_t header_size = 8;
+    memcpy(&type, header, sizeof(type));
+    // The byte order can only be known after reading a section's header,
+    // but its type is the same using either byte order
+    if (type == section_header_block) {
+        if (std::fread(header + 8, 1, 4, file_) != 4) {
+            return false;
+        }
+        uint32_t magic;
+        memcpy(&magic, header + 8, sizeof(magic));
+        if (magic == byte_order_magic) {
+            swapped_ = false;
+        }
+        else if (magic == Endian::change_endian(byte_order_magic)) {
+            swapped_ = true;
+        }
+        else {
+            return false;
+        }
+        header_size = 12;
+    }
+    else {
+        type = read_32(header);
+    }
+    const uint32_t length = read_32(header + 4);
+    if (length < header_size + sizeof(uint32_t) || length % 4 != 0 ||
+        length > max_block_size) {
+        return false;
+    }
+    // The block's body, followed by its trailing length
+    block_.resize(length - header_size);
+    if (std::fread(&block_[0], 1, block_.size(), file_) != block_.size()) {
+        return false;
+    }
+    return read_32(&block_[block_.size() - sizeof(uint32_t)]) == length;
+}
+
+bool PcapngReader::next_option(const uint8_t*& ptr, const uint8_t* end, uint16_t& code,
+                               const uint8_t*& value, uint16_t& length) const {
+    if (end - ptr < 4) {
+        return false;
+    }
+    code = read_16(ptr);
+    length = read_16(ptr + 2);
+    if (code == opt_endofopt || static_cast<uint32_t>(end - ptr - 4) < length) {
+        return false;
+    }
+    value = ptr + 4;
+    ptr += 4 + padded_size(length);
+    if (ptr > end) {
+        ptr = end;
+    }
+    return true;
+}
+
+bool PcapngReader::parse_section_header() {
+    // Version (4 bytes) and section length (8 bytes)
+    const uint32_t fixed_size = 12;
+    const uint32_t body_size = static_cast<uint32_t>(block_.size() - sizeof(uint32_t));
+    if (body_size < fixed_size || read_16(&block_[0]) != 1) {
+        return false;
+    }
+    // Interfaces are local to each section
+    interfaces_.clear();
+    decoders_.clear();
+    timestamp_offsets_.clear();
+    section_comment_.clear();
+    const uint8_t* ptr = &block_[0] + fixed_size;
+    const uint8_t* end = &block_[0] + body_size;
+    uint16_t code, length;
+    const uint8_t* value;
+    while (next_option(ptr, end, code, value, length)) {
+        if (code == opt_comment) {
+            section_comment_.assign((const char*)value, length);
+        }
+    }
+    return true;
+}
+
+void PcapngReader::parse_interface_description() {
+    // Link type, reserved and snapshot length
+    const uint32_t fixed_size = 8;
+    const uint32_t body_size = static_cast<uint32_t>(block_.size() - sizeof(uint32_t));
+    if (body_size < fixed_size) {
+        return;
+    }
+    // Timestamps are in microseconds unless stated otherwise
+    PcapngInterface iface(Internals::dlt_from_link_type(read_16(&block_[0])),
+                          read_32(&block_[4]), 6);
+    int64_t timestamp_offset = 0;
+    const uint8_t* ptr = &block_[0] + fixed_size;
+    const uint8_t* end = &block_[0] + body_size;
+    uint16_t code, length;
+    const uint8_t* value;
+    while (next_option(ptr, end, code, value, length)) {
+        if (code == if_name) {
+            iface.name.assign((const char*)value, length);
+        }
+        else if (code == opt_comment) {
+            iface.comment.assign((const char*)value, length);
+        }
+        else if (code == if_tsresol && length >= 1) {
+            iface.timestamp_resolution = value[0];
+        }
+        else if (code == if_tsoffset && length >= 8) {
+            uint64_t offset;
+            memcpy(&offset, value, sizeof(offset));
+            timestamp_offset = static_cast<int64_t>(swapped_ ? Endian::change_endian(offset)
+                                                             : offset);
+        }
+    }
+    Internals::frame_decoder decoder = &Internals::decode_raw_frame;
+    try {
+        decoder = Internals::frame_decoder_from_dlt_flag(iface.link_type);
+    }
+    catch (exception_base&) {
+        // Packets on unsupported link types are provided as RawPDUs
+    }
+    interfaces_.push_back(iface);
+    decoders_.push_back(decoder);
+    timestamp_offsets_.push_back(timestamp_offset);
+}
+
+bool PcapngReader::parse_enhanced_packet(PcapngRecord& output) {
+    // Interface id, timestamp (8 bytes), captured and original length
+    const uint32_t fixed_size = 20;
+    const uint32_t body_size = static_cast<uint32_t>(block_.size() - sizeof(uint32_t));
+    if (body_size < fixed_size) {
+        return false;
+    }
+    const uint32_t interface_id = read_32(&block_[0]);
+    const uint32_t captured_size = read_32(&block_[12]);
+    if (interface_id >= interfaces_.size() || body_size - fixed_size < captured_size) {
+        return false;
+    }
+    const uint64_t ticks = (static_cast<uint64_t>(read_32(&block_[4])) << 32) |
+                           read_32(&block_[8]);
+    output.buffer = &block_[0] + fixed_size;
+    output.size = captured_size;
+    output.original_size = read_32(&block_[16]);
+    output.interface_id = interface_id;
+    output.nanoseconds = ticks_to_nanoseconds(ticks,
+                                              interfaces_[interface_id].timestamp_resolution) +
+                         timestamp_offsets_[interface_id] * nanoseconds_per_second;
+    output.flags = 0;
+    output.comment.clear();
+    const uint8_t* ptr = output.buffer + std::min(padded_size(captured_size),
+                                                  body_size - fixed_size);
+    const uint8_t* end = &block_[0] + body_size;
+    uint16_t code, length;
+    const uint8_t* value;
+    while (next_option(ptr, end, code, value, length)) {
+        if (code == opt_comment) {
+            output.comment.assign((const char*)value, length);
+        }
+        else if (code == epb_flags && length >= 4) {
+            output.flags = read_32(value);
+        }
+    }
+    return true;
+}
+
+bool PcapngReader::parse_simple_packet(PcapngRecord& output) {
+    const uint32_t body_size = static_cast<uint32_t>(block_.size() - sizeof(uint32_t));
+    // Simple packets always belong to the first interface
+    if (body_size < sizeof(uint32_t) || interfaces_.empty()) {
+        return false;
+    }
+    const uint32_t original_size = read_32(&block_[0]);
+    // The captured length is the original one, truncated to the snapshot
+    // length, and the block is padded after it
+    uint32_t captured_size = std::min(original_size,
+                                      body_size - static_cast<uint32_t>(sizeof(uint32_t)));
+    if (interfaces_[0].snap_len) {
+        captured_size = std::min(captured_size, interfaces_[0].snap_len);
+    }
+    output.buffer = &block_[0] + sizeof(uint32_t);
+    output.size = captured_size;
+    output.original_size = original_size;
+    output.interface_id = 0;
+    output.nanoseconds = 0;
+    output.flags = 0;
+    output.comment.clear();
+    return true;
+}
+
+bool PcapngReader::next_record(PcapngRecord& output) {
+    uint32_t type;
+    while (read_block(type)) {
+        switch (type) {
+            case section_header_block:
+                if (!parse_section_header()) {
+                    return false;
+                }
+                break;
+            case interface_description_block:
+                parse_interface_description();
+                break;
+            case enhanced_packet_block:
+                if (parse_enhanced_packet(output)) {
+                    return true;
+                }
+                break;
+            case simple_packet_block:
+                if (parse_simple_packet(output)) {
+                    return true;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+PtrPacket PcapngReader::next_packet() {
+    DecodingScope decoding_scope(decoding_flags_);
+    PcapngRecord record;
+    while (next_record(record)) {
+        const Internals::frame_decoder decoder = extract_raw_ ? &Internals::decode_raw_frame :
+                                                 decoders_[record.interface_id];
+        PDU* pdu = 0;
+        try {
+            pdu = decoder(record.buffer, record.size);
+        }
+        catch (malformed_packet&) {
+        }
+        if (pdu) {
+            return PtrPacket(pdu, record.timestamp());
+        }
+    }
+    return PtrPacket(0, Timestamp());
+}
+
+const vector<PcapngInterface>& PcapngReader::interfaces() const {
+    return interfaces_;
+}
+
+const string& PcapngReader::section_comment() const {
+    return section_comment_;
+}
+
+void PcapngReader::set_extract_raw_pdus(bool value) {
+    extract_raw_ = value;
+}
+
+void PcapngReader::set_decoding_flags(uint32_t flags) {
+    decoding_flags_ = flags;
+}
+
+uint32_t PcapngReader::decoding_flags() const {
+    return decoding_flags_;
+}
+
+// PcapngWriter
+
+const uint32_t PcapngWriter::DEFAULT_BUFFER_SIZE = 1 << 20;
+
+void append(vector<uint8_t>& buffer, const void* data, size_t size) {
+    const uint8_t* ptr = static_cast<const uint8_t*>(data);
+    buffer.insert(buffer.end(), ptr, ptr + size);
+}
+
+void append_16(vector<uint8_t>& buffer, uint16_t value) {
+    append(buffer, &value, sizeof(value));
+}
+
+void append_32(vector<uint8_t>& buffer, uint32_t value) {
+    append(buffer, &value, sizeof(value));
+}
+
+void append_padding(vector<uint8_t>& buffer, uint32_t size) {
+    buffer.resize(buffer.size() + padded_size(size) - size);
+}
+
+void append_option(vector<uint8_t>& buffer, uint16_t code, const void* data,
+                   uint16_t size) {
+    append_16(buffer, code);
+    append_16(buffer, size);
+    append(buffer, data, size);
+    append_padding(buffer, size);
+}
+
+void append_option(vector<uint8_t>& buffer, uint16_t code, const string& value) {
+    // Options can't be longer than this
+    const size_t size = std::min<size_t>(value.size(), 0xfffc);
+    append_option(buffer, code, value.data(), static_cast<uint16_t>(size));
+}
+
+void append_end_of_options(vector<uint8_t>& buffer) {
+    append_16(buffer, opt_endofopt);
+    append_16(buffer, 0);
+}
+
+PcapngWriter::PcapngWriter(const string& file_name, const string& section_comment,
+                           uint32_t buffer_size)
+: file_(0), buffer_size_(buffer_size) {
+    file_ = std::fopen(file_name.c_str(), "wb");
+    if (!file_) {
+        throw pcap_error(file_name + ": " + strerror(errno));
+    }
+    // Blocks are already buffered
+    std::setvbuf(file_, 0, _IONBF, 0);
+    buffer_.reserve(buffer_size_);
+
+    // Blocks are written using the host's byte order, which is allowed
+    // as readers use the byte order magic to find it out
+    const size_t start = start_block(section_header_block);
+    append_32(buffer_, byte_order_magic);
+    // Version 1.0
+    append_16(buffer_, 1);
+    append_16(buffer_, 0);
+    // The section's length is unknown
+    const uint64_t section_length = ~0ULL;
+    append(buffer_, &section_length, sizeof(section_length));
+    if (!section_comment.empty()) {
+        append_option(buffer_, opt_comment, section_comment);
+    }
+    append_option(buffer_, shb_userappl, string("libtins"));
+    append_end_of_options(buffer_);
+    finish_block(start);
+}
+
+PcapngWriter::~PcapngWriter() {
+    try {
+        flush();
+    }
+    catch (pcap_error&) {
+    }
+    std::fclose(file_);
+}
+
+size_t PcapngWriter::start_block(uint32_t type) {
+    const size_t start = buffer_.size();
+    append_32(buffer_, type);
+    // The length is filled in once the block is finished
+    append_32(buffer_, 0);
+    return start;
+}
+
+void PcapngWriter::finish_block(size_t start) {
+    const uint32_t length = static_cast<uint32_t>(buffer_.size() - start + sizeof(uint32_t));
+    memcpy(&buffer_[start + sizeof(uint32_t)], &length, sizeof(length));
+    append_32(buffer_, length);
+    if (buffer_.size() >= buffer_size_) {
+        flush();
+    }
+}
+
+uint32_t PcapngWriter::add_interface(const PcapngInterface& iface) {
+    const size_t start = start_block(interface_description_block);
+    append_16(buffer_, static_cast<uint16_t>(Internals::link_type_from_dlt(iface.link_type)));
+    append_16(buffer_, 0);
+    append_32(buffer_, iface.snap_len);
+    if (!iface.name.empty()) {
+        append_option(buffer_, if_name, iface.name);
+    }
+    if (!iface.comment.empty()) {
+        append_option(buffer_, opt_comment, iface.comment);
+    }
+    // Microseconds are the default resolution
+    if (iface.timestamp_resolution != 6) {
+        append_option(buffer_, if_tsresol, &iface.timestamp_resolution, 1);
+    }
+    append_end_of_options(buffer_);
+    finish_block(start);
+    timestamp_resolutions_.push_back(iface.timestamp_resolution);
+    snap_lens_.push_back(iface.snap_len);
+    return static_cast<uint32_t>(timestamp_resolutions_.size() - 1);
+}
+
+void PcapngWriter::write(const PcapngRecord& record) {
+    if (record.interface_id >= timestamp_resolutions_.size()) {
+        throw invalid_interface();
+    }
+    uint32_t captured_size = record.size;
+    if (snap_lens_[record.interface_id]) {
+        captured_size = std::min(captured_size, snap_lens_[record.interface_id]);
+    }
+    const uint64_t ticks = nanoseconds_to_ticks(record.nanoseconds,
+                                                timestamp_resolutions_[record.interface_id]);
+    const size_t start = start_block(enhanced_packet_block);
+    append_32(buffer_, record.interface_id);
+    append_32(buffer_, static_cast<uint32_t>(ticks >> 32));
+    append_32(buffer_, static_cast<uint32_t>(ticks));
+    append_32(buffer_, captured_size);
+    append_32(buffer_, record.original_size ? record.original_size : record.size);
+    append(buffer_, record.buffer, captured_size);
+    append_padding(buffer_, captured_size);
+    if (!record.comment.empty() || record.flags) {
+        if (!record.comment.empty()) {
+            append_option(buffer_, opt_comment, record.comment);
+        }
+        if (record.flags) {
+            append_option(buffer_, epb_flags, &record.flags, sizeof(record.flags));
+        }
+        append_end_of_options(buffer_);
+    }
+    finish_block(start);
+}
+
+void PcapngWriter::write(uint32_t interface_id, Packet& packet) {
+    const Timestamp& timestamp = packet.timestamp();
+    const uint64_t nanoseconds = static_cast<uint64_t>(timestamp.seconds()) *
+                                 nanoseconds_per_second +
+                                 static_cast<uint64_t>(timestamp.microseconds()) * 1000;
+    // See PacketWriter::write(Packet&)
+    if (packet.is_shared()) {
+        const Packet& shared_packet = packet;
+        Packet scratch(*shared_packet.pdu(), timestamp);
+        write(interface_id, *scratch.pdu(), nanoseconds);
+    }
+    else {
+        write(interface_id, *packet.pdu(), nanoseconds);
+    }
+}
+
+void PcapngWriter::write(uint32_t interface_id, PDU& pdu) {
+    const Timestamp timestamp = Timestamp::current_time();
+    const uint64_t nanoseconds = static_cast<uint64_t>(timestamp.seconds()) *
+                                 nanoseconds_per_second +
+                                 static_cast<uint64_t>(timestamp.microseconds()) * 1000;
+    write(interface_id, pdu, nanoseconds);
+}
+
+void PcapngWriter::write(uint32_t interface_id, PDU& pdu, uint64_t nanoseconds) {
+    const uint32_t size = pdu.serialize(serialization_buffer_);
+    write(PcapngRecord(size ? &serialization_buffer_[0] : 0, size, interface_id,
+                       nanoseconds));
+}
+
+void PcapngWriter::write_simple(const uint8_t* buffer, uint32_t size,
+                                uint32_t original_size) {
+    if (timestamp_resolutions_.empty()) {
+        throw invalid_interface();
+    }
+    uint32_t captured_size = size;
+    if (snap_lens_[0]) {
+        captured_size = std::min(captured_size, snap_lens_[0]);
+    }
+    const size_t start = start_block(simple_packet_block);
+    append_32(buffer_, original_size ? original_size : size);
+    append(buffer_, buffer, captured_size);
+    append_padding(buffer_, captured_size);
+    finish_block(start);
+}
+
+void PcapngWriter::flush() {
+    if (buffer_.empty()) {
+        return;
+    }
+    const size_t written = std::fwrite(&buffer_[0], 1, buffer_.size(), file_);
+    const size_t size = buffer_.size();
+    buffer_.clear();
+    if (written != size) {
+        throw pcap_error(strerror(errno));
+    }
+}
+
+} // Tins
+
+#endif // TINS_HAVE_PCAP
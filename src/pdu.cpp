@@ -28,7 +28,12 @@
  */
  
 #include <tins/pdu.h>
+#include <tins/rawpdu.h>
 #include <tins/packet_sender.h>
+#include <tins/decoding_scope.h>
+#include <tins/detail/layer_index.h>
+#include <tins/detail/pdu_helpers.h>
+#include <tins/exceptions.h>
 
 using std::swap;
 using std::vector;
@@ -48,12 +53,12 @@ PDU::metadata::metadata(uint32_t header_size, PDUType current_type, PDUType next
 // PDU
 
 PDU::PDU()
-: inner_pdu_(), parent_pdu_() {
+: inner_pdu_(), parent_pdu_(), lazy_inner_pdu_(), layer_index_() {
 
 }
 
 PDU::PDU(const PDU& other) 
-: inner_pdu_(), parent_pdu_() {
+: inner_pdu_(), parent_pdu_(), lazy_inner_pdu_(), layer_index_() {
     copy_inner_pdu(other);
 }
 
@@ -64,6 +69,7 @@ PDU& PDU::operator=(const PDU& other) {
 
 PDU::~PDU() {
     delete inner_pdu_;
+    delete layer_index_;
 }
 
 void PDU::copy_inner_pdu(const PDU& pdu) {
@@ -75,9 +81,12 @@ void PDU::copy_inner_pdu(const PDU& pdu) {
 void PDU::prepare_for_serialize() {
 }
 
+void PDU::finish_lazy_parsing() const {
+}
+
 uint32_t PDU::size() const {
     uint32_t sz = header_size() + trailer_size();
-    const PDU* ptr(inner_pdu_);
+    const PDU* ptr(inner_pdu());
     while (ptr) {
         sz += ptr->header_size() + ptr->trailer_size();
         ptr = ptr->inner_pdu();
@@ -99,22 +108,77 @@ bool PDU::matches_response(const uint8_t* /*ptr*/, uint32_t /*total_sz*/) const
 
 void PDU::inner_pdu(PDU* next_pdu) {
     delete inner_pdu_;
+    lazy_inner_pdu_ = lazy_inner_pdu();
     inner_pdu_ = next_pdu;
     if (inner_pdu_) {
         inner_pdu_->parent_pdu(this);
     }
+    invalidate_layer_index();
 }
 
 void PDU::inner_pdu(const PDU& next_pdu) {
     inner_pdu(next_pdu.clone());
 }
 
+void PDU::inner_pdu(inner_pdu_decoder decoder, uint32_t identifier,
+                    const uint8_t* buffer, uint32_t total_sz) {
+    const uint32_t flags = DecodingScope::current_flags();
+    if ((flags & DecodingScope::LAZY_INNER_PDUS) == 0) {
+        if ((flags & DecodingScope::MALFORMED_INNER_PDUS_AS_RAW) == 0) {
+            inner_pdu(decoder(identifier, buffer, total_sz));
+        }
+        else {
+            inner_pdu(decode_or_raw(decoder, identifier, buffer, total_sz));
+        }
+        return;
+    }
+    delete inner_pdu_;
+    inner_pdu_ = 0;
+    lazy_inner_pdu_.decoder = decoder;
+    lazy_inner_pdu_.buffer = buffer;
+    lazy_inner_pdu_.total_sz = total_sz;
+    lazy_inner_pdu_.identifier = static_cast<uint16_t>(identifier);
+    lazy_inner_pdu_.flags = static_cast<uint16_t>(flags);
+    invalidate_layer_index();
+}
+
+void PDU::decode_inner_pdu() const {
+    const lazy_inner_pdu pending = lazy_inner_pdu_;
+    lazy_inner_pdu_ = lazy_inner_pdu();
+    // Decode using the same options that were in use when this PDU was built
+    DecodingScope scope(pending.flags);
+    // There's no way to report an error from here, keep the bytes instead
+    inner_pdu_ = decode_or_raw(pending.decoder, pending.identifier, pending.buffer,
+                               pending.total_sz);
+    if (inner_pdu_) {
+        inner_pdu_->parent_pdu_ = const_cast<PDU*>(this);
+    }
+    invalidate_layer_index();
+}
+
+PDU* PDU::decode_or_raw(inner_pdu_decoder decoder, uint32_t identifier,
+                        const uint8_t* buffer, uint32_t total_sz) {
+    // Truncated headers are by far the most common case, catch them
+    // without going through an exception
+    if (Internals::inner_pdu_fits(decoder, identifier, buffer, total_sz)) {
+        try {
+            return decoder(identifier, buffer, total_sz);
+        }
+        catch (malformed_packet&) {
+        }
+    }
+    DecodingScope::record_malformed_layer();
+    return new RawPDU(buffer, total_sz);
+}
+
 PDU* PDU::release_inner_pdu() {
+    inner_pdu();
     PDU* result = 0;
     swap(result, inner_pdu_);
     if (result) {
         result->parent_pdu(0);
     }
+    invalidate_layer_index();
     return result;
 }
 
@@ -124,6 +188,29 @@ PDU::serialization_type PDU::serialize() {
     return buffer;
 }
 
+uint32_t PDU::serialize(serialization_type& buffer) {
+    const uint32_t sz = size();
+    // Growing is the only case in which the buffer's contents are touched
+    if (buffer.size() < sz) {
+        buffer.resize(sz);
+    }
+    if (sz > 0) {
+        serialize(&buffer[0], sz);
+    }
+    return sz;
+}
+
+uint32_t PDU::serialize_into(uint8_t* buffer, uint32_t total_sz) {
+    const uint32_t sz = size();
+    if (total_sz < sz) {
+        throw serialization_error();
+    }
+    if (sz > 0) {
+        serialize(buffer, sz);
+    }
+    return sz;
+}
+
 void PDU::serialize(uint8_t* buffer, uint32_t total_sz) {
     uint32_t sz = header_size() + trailer_size();
     // Must not happen...
@@ -131,7 +218,7 @@ void PDU::serialize(uint8_t* buffer, uint32_t total_sz) {
     assert(total_sz >= sz);
     #endif
     prepare_for_serialize();
-    if (inner_pdu_) {
+    if (inner_pdu()) {
         inner_pdu_->serialize(buffer + header_size(), total_sz - sz);
     }
     write_serialization(buffer, total_sz);
@@ -141,4 +228,100 @@ void PDU::parent_pdu(PDU* parent) {
     parent_pdu_ = parent;
 }
 
+// These flags are matched by several PDU types (e.g. Dot11Data matches
+// DOT11), so they can't be looked up using the PDUs' exact type
+bool is_indexed_pdu_flag(PDU::PDUType flag) {
+    switch (flag) {
+        case PDU::DOT11:
+        case PDU::DOT11_CONTROL:
+        case PDU::DOT11_DATA:
+        case PDU::DOT11_MANAGEMENT:
+        case PDU::EAPOL:
+            return false;
+        default:
+            return static_cast<uint32_t>(flag) < Internals::LayerIndex::max_indexed_type;
+    }
+}
+
+PDU* PDU::find_layer(PDUType type) {
+    if (!is_indexed_pdu_flag(type)) {
+        return find_layer_in_chain(this, type);
+    }
+    if (!layer_index_) {
+        layer_index_ = new Internals::LayerIndex();
+    }
+    if (!layer_index_->valid()) {
+        build_layer_index();
+    }
+    return const_cast<PDU*>(static_cast<const PDU*>(this)->find_layer(type));
+}
+
+const PDU* PDU::find_layer(PDUType type) const {
+    if (!layer_index_ || !layer_index_->valid() || !layer_index_->indexable() ||
+        !is_indexed_pdu_flag(type)) {
+        return find_layer_in_chain(this, type);
+    }
+    PDU* pdu = layer_index_->find(type);
+    if (pdu || !layer_index_->has_pending_layers()) {
+        return pdu;
+    }
+    // Layers below the last indexed one haven't been decoded yet
+    return find_layer_in_chain(layer_index_->last_layer()->inner_pdu(), type);
+}
+
+PDU* PDU::find_layer_in_chain(const PDU* pdu, PDUType type) {
+    while (pdu) {
+        if (pdu->matches_flag(type)) {
+            return const_cast<PDU*>(pdu);
+        }
+        pdu = pdu->inner_pdu();
+    }
+    return 0;
+}
+
+void PDU::build_layer_index() const {
+    layer_index_->clear();
+    const PDU* pdu = this;
+    while (pdu) {
+        if (!layer_index_->add(const_cast<PDU*>(pdu), pdu->pdu_type())) {
+            break;
+        }
+        // Don't decode lazy layers just to index them
+        if (pdu->lazy_inner_pdu_.decoder) {
+            layer_index_->has_pending_layers(true);
+            break;
+        }
+        pdu = pdu->inner_pdu_;
+    }
+    layer_index_->valid(true);
+}
+
+void PDU::prepare_for_sharing() const {
+    // Shared PDUs are only read, so nothing can be left to be decoded or
+    // copied lazily. Otherwise reading them from several threads would race
+    const PDU* pdu = this;
+    while (pdu) {
+        pdu->finish_lazy_parsing();
+        pdu = pdu->inner_pdu();
+    }
+    // Const lookups only use the index, they never build it
+    if (!layer_index_) {
+        layer_index_ = new Internals::LayerIndex();
+    }
+    if (!layer_index_->valid()) {
+        build_layer_index();
+    }
+}
+
+void PDU::invalidate_layer_index() const {
+    // Any index built on this PDU or its parents contains this chain
+    const PDU* pdu = this;
+    while (pdu) {
+        if (pdu->layer_index_) {
+            pdu->layer_index_->valid(false);
+        }
+        pdu = pdu->parent_pdu_;
+    }
+}
+
 } // Tins
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+
+#include <stdexcept>
+#include <tins/pdu_allocator.h>
+#if TINS_IS_CXX11
+    #include <mutex>
+#endif // TINS_IS_CXX11
+
+namespace Tins {
+namespace Internals {
+
+#if TINS_IS_CXX11
+
+template<typename T>
+T load_entry(const std::atomic<T>& value) {
+    return value.load(std::memory_order_acquire);
+}
+
+template<typename T>
+void store_entry(std::atomic<T>& value, T new_value) {
+    value.store(new_value, std::memory_order_release);
+}
+
+// Serializes registrations. Lookups don't use it
+std::mutex allocator_registration_mutex;
+
+#else
+
+template<typename T>
+T load_entry(const T& value) {
+    return value;
+}
+
+template<typename T>
+void store_entry(T& value, T new_value) {
+    value = new_value;
+}
+
+#endif // TINS_IS_CXX11
+
+PDUAllocatorTable& PDUAllocatorTable::instance(uint16_t) {
+    static PDUAllocatorTable table;
+    return table;
+}
+
+PDUAllocatorTable& PDUAllocatorTable::instance(uint8_t) {
+    static PDUAllocatorTable table;
+    return table;
+}
+
+PDUAllocatorTable::PDUAllocatorTable() {
+    for (size_t i = 0; i < max_allocators; ++i) {
+        store_entry(allocators_[i].key, 0U);
+        store_entry(allocators_[i].allocator, static_cast<allocator_type>(0));
+        store_entry(pdu_types_[i].type, 0U);
+        store_entry(pdu_types_[i].identifier, 0U);
+    }
+    store_entry(allocator_count_, 0U);
+    store_entry(pdu_type_count_, 0U);
+}
+
+void PDUAllocatorTable::register_allocator(uint32_t identifier,
+                                           allocator_type allocator,
+                                           PDU::PDUType type) {
+    #if TINS_IS_CXX11
+    std::lock_guard<std::mutex> lock(allocator_registration_mutex);
+    #endif // TINS_IS_CXX11
+
+    const uint32_t key = identifier + 1;
+    size_t index = slot_index(identifier);
+    size_t probes = 0;
+    while (probes < max_allocators) {
+        const uint32_t current_key = load_entry(allocators_[index].key);
+        if (current_key == key) {
+            store_entry(allocators_[index].allocator, allocator);
+            break;
+        }
+        if (current_key == 0) {
+            // Publish the allocator before the key so lookups never see
+            // a matching key without its allocator
+            store_entry(allocators_[index].allocator, allocator);
+            store_entry(allocators_[index].key, key);
+            store_entry(allocator_count_, load_entry(allocator_count_) + 1);
+            break;
+        }
+        index = (index + 1) & (max_allocators - 1);
+        ++probes;
+    }
+    if (probes == max_allocators) {
+        throw std::runtime_error("Too many PDU allocators registered");
+    }
+
+    const uint32_t type_count = load_entry(pdu_type_count_);
+    for (uint32_t i = 0; i < type_count; ++i) {
+        if (load_entry(pdu_types_[i].type) == static_cast<uint32_t>(type)) {
+            store_entry(pdu_types_[i].identifier, identifier);
+            return;
+        }
+    }
+    if (type_count < max_allocators) {
+        store_entry(pdu_types_[type_count].type, static_cast<uint32_t>(type));
+        store_entry(pdu_types_[type_count].identifier, identifier);
+        store_entry(pdu_type_count_, type_count + 1);
+    }
+}
+
+PDU* PDUAllocatorTable::allocate(uint32_t identifier,
+                                 const uint8_t* buffer,
+                                 uint32_t size) const {
+    // Most of the time nothing is registered at all
+    if (load_entry(allocator_count_) == 0) {
+        return 0;
+    }
+    const uint32_t key = identifier + 1;
+    size_t index = slot_index(identifier);
+    for (size_t probes = 0; probes < max_allocators; ++probes) {
+        const uint32_t current_key = load_entry(allocators_[index].key);
+        if (current_key == key) {
+            return (*load_entry(allocators_[index].allocator))(buffer, size);
+        }
+        if (current_key == 0) {
+            break;
+        }
+        index = (index + 1) & (max_allocators - 1);
+    }
+    return 0;
+}
+
+bool PDUAllocatorTable::pdu_type_registered(PDU::PDUType type) const {
+    const uint32_t type_count = load_entry(pdu_type_count_);
+    for (uint32_t i = 0; i < type_count; ++i) {
+        if (load_entry(pdu_types_[i].type) == static_cast<uint32_t>(type)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t PDUAllocatorTable::pdu_type_to_id(PDU::PDUType type) const {
+    const uint32_t type_count = load_entry(pdu_type_count_);
+    for (uint32_t i = 0; i < type_count; ++i) {
+        if (load_entry(pdu_types_[i].type) == static_cast<uint32_t>(type)) {
+            return load_entry(pdu_types_[i].identifier);
+        }
+    }
+    return 0;
+}
+
+} // Internals
+} // Tins
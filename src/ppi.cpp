@@ -56,6 +56,7 @@ PPI::PPI(const uint8_t* buffer, uint32_t total_sz) {
         stream.read(data_, options_length);
     }
     if (stream) {
+        inner_pdu_decoder decoder = 0;
         switch (dlt()) {
             case DLT_IEEE802_11:
                 #ifdef TINS_HAVE_DOT11
@@ -66,26 +67,29 @@ PPI::PPI(const uint8_t* buffer, uint32_t total_sz) {
                 break;
             case DLT_EN10MB:
                 if (Internals::is_dot3(stream.pointer(), stream.size())) {
-                    inner_pdu(new Dot3(stream.pointer(), stream.size()));
+                    decoder = &Internals::decode_payload_as<Dot3>;
                 }
                 else {
-                    inner_pdu(new EthernetII(stream.pointer(), stream.size()));
+                    decoder = &Internals::decode_payload_as<EthernetII>;
                 }
                 break;
             case DLT_IEEE802_11_RADIO:
                 #ifdef TINS_HAVE_DOT11
-                    inner_pdu(new RadioTap(stream.pointer(), stream.size()));
+                    decoder = &Internals::decode_payload_as<RadioTap>;
                 #else
                     throw protocol_disabled();
                 #endif
                 break;
             case DLT_NULL:
-                inner_pdu(new Loopback(stream.pointer(), stream.size()));
+                decoder = &Internals::decode_payload_as<Loopback>;
                 break;
             case DLT_LINUX_SLL:
-                inner_pdu(new Tins::SLL(stream.pointer(), stream.size()));
+                decoder = &Internals::decode_payload_as<Tins::SLL>;
                 break;
         }
+        if (decoder) {
+            inner_pdu(decoder, 0, stream.pointer(), static_cast<uint32_t>(stream.size()));
+        }
     }
 }
 
@@ -109,7 +113,7 @@ void PPI::parse_80211(const uint8_t* buffer, uint32_t total_sz) {
             total_sz -= sizeof(uint32_t);
         }
     }
-    inner_pdu(Dot11::from_bytes(buffer, total_sz));
+    inner_pdu(Internals::decode_dot11_payload, 0, buffer, total_sz);
     #endif // TINS_HAVE_DOT11
 }
 
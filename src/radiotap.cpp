@@ -46,6 +46,7 @@
 #include <tins/packet_sender.h>
 #include <tins/exceptions.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 #include <tins/utils/checksum_utils.h>
 #include <tins/utils/frequency_utils.h>
 #include <tins/utils/radiotap_parser.h>
@@ -111,7 +112,7 @@ RadioTap::RadioTap(const uint8_t* buffer, uint32_t total_sz) {
     }
 
     if (TINS_LIKELY(total_sz)) {
-        inner_pdu(Dot11::from_bytes(input.pointer(), total_sz));
+        inner_pdu(Internals::decode_dot11_payload, 0, input.pointer(), total_sz);
     }
 }
 
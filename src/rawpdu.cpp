@@ -29,31 +29,68 @@
 
 #include <tins/rawpdu.h>
 #include <tins/memory_helpers.h>
+#include <tins/decoding_scope.h>
 
 using Tins::Memory::OutputMemoryStream;
 
 namespace Tins {
 RawPDU::RawPDU(const uint8_t* pload, uint32_t size) 
-: payload_(pload, pload + size) {
-    
+: borrowed_payload_(0), borrowed_size_(0) {
+    if ((DecodingScope::current_flags() & DecodingScope::BORROWED_PAYLOADS) != 0 && size > 0) {
+        borrowed_payload_ = pload;
+        borrowed_size_ = size;
+    }
+    else {
+        payload_.assign(pload, pload + size);
+    }
 }
 
 RawPDU::RawPDU(const std::string& data) 
-: payload_(data.begin(), data.end()) {
+: payload_(data.begin(), data.end()), borrowed_payload_(0), borrowed_size_(0) {
     
 }
 
+RawPDU::RawPDU(const RawPDU& other)
+: PDU(other), payload_(other.payload_data(), other.payload_data() + other.payload_size()),
+  borrowed_payload_(0), borrowed_size_(0) {
+
+}
+
+RawPDU& RawPDU::operator=(const RawPDU& other) {
+    if (this != &other) {
+        PDU::operator=(other);
+        payload_.assign(other.payload_data(), other.payload_data() + other.payload_size());
+        borrowed_payload_ = 0;
+        borrowed_size_ = 0;
+    }
+    return *this;
+}
+
 uint32_t RawPDU::header_size() const {
-    return static_cast<uint32_t>(payload_.size());
+    return payload_size();
 }
 
 void RawPDU::write_serialization(uint8_t* buffer, uint32_t total_sz) {
     OutputMemoryStream stream(buffer, total_sz);
-    stream.write(payload_.begin(), payload_.end());
+    stream.write(payload_data(), payload_size());
 }
 
 void RawPDU::payload(const payload_type& pload) {
     payload_ = pload;
+    borrowed_payload_ = 0;
+    borrowed_size_ = 0;
+}
+
+void RawPDU::materialize() const {
+    if (borrowed_payload_) {
+        payload_.assign(borrowed_payload_, borrowed_payload_ + borrowed_size_);
+        borrowed_payload_ = 0;
+        borrowed_size_ = 0;
+    }
+}
+
+void RawPDU::finish_lazy_parsing() const {
+    materialize();
 }
 
 bool RawPDU::matches_response(const uint8_t* /*ptr*/, uint32_t /*total_sz*/) const {
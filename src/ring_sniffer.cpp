@@ -0,0 +1,511 @@
+/*
+ * Copyright (c) 2017, Matias Fontanini
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ * 
+ * * Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ *   copyright notice, this list of conditions and the following disclaimer
+ *   in the documentation and/or other materials provided with the
+ *   distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+ 
+
+#include <tins/ring_sniffer.h>
+
+#ifdef TINS_HAVE_PACKET_RING
+
+#include <algorithm>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <sys/time.h>
+#include <net/if.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#if TINS_IS_CXX11
+    #include <atomic>
+#endif // TINS_IS_CXX11
+#include <tins/timestamp.h>
+#include <tins/decoding_scope.h>
+
+using std::string;
+using std::vector;
+
+namespace Tins {
+
+// RingSnifferConfiguration
+
+const uint32_t RingSnifferConfiguration::DEFAULT_BLOCK_SIZE = 1 << 20;
+const uint32_t RingSnifferConfiguration::DEFAULT_BLOCK_COUNT = 16;
+const uint32_t RingSnifferConfiguration::DEFAULT_BLOCK_TIMEOUT = 10;
+
+RingSnifferConfiguration::RingSnifferConfiguration()
+: block_size_(DEFAULT_BLOCK_SIZE), block_count_(DEFAULT_BLOCK_COUNT),
+  block_timeout_(DEFAULT_BLOCK_TIMEOUT), timeout_(0), promisc_(false),
+  fanout_mode_(NO_FANOUT), fanout_group_id_(0), decoding_flags_(0) {
+
+}
+
+void RingSnifferConfiguration::set_block_size(uint32_t block_size) {
+    block_size_ = block_size;
+}
+
+void RingSnifferConfiguration::set_block_count(uint32_t block_count) {
+    block_count_ = block_count;
+}
+
+void RingSnifferConfiguration::set_block_timeout(uint32_t timeout) {
+    block_timeout_ = timeout;
+}
+
+void RingSnifferConfiguration::set_timeout(uint32_t timeout) {
+    timeout_ = timeout;
+}
+
+void RingSnifferConfiguration::set_promisc_mode(bool enabled) {
+    promisc_ = enabled;
+}
+
+void RingSnifferConfiguration::set_fanout(FanoutMode mode, uint16_t group_id) {
+    fanout_mode_ = mode;
+    fanout_group_id_ = group_id;
+}
+
+void RingSnifferConfiguration::set_decoding_flags(uint32_t flags) {
+    decoding_flags_ = flags;
+}
+
+uint32_t RingSnifferConfiguration::block_size() const {
+    return block_size_;
+}
+
+uint32_t RingSnifferConfiguration::block_count() const {
+    return block_count_;
+}
+
+uint32_t RingSnifferConfiguration::block_timeout() const {
+    return block_timeout_;
+}
+
+uint32_t RingSnifferConfiguration::timeout() const {
+    return timeout_;
+}
+
+bool RingSnifferConfiguration::promisc_mode() const {
+    return promisc_;
+}
+
+RingSnifferConfiguration::FanoutMode RingSnifferConfiguration::fanout_mode() const {
+    return fanout_mode_;
+}
+
+uint16_t RingSnifferConfiguration::fanout_group_id() const {
+    return fanout_group_id_;
+}
+
+uint32_t RingSnifferConfiguration::decoding_flags() const {
+    return decoding_flags_;
+}
+
+// RingSniffer
+
+// Every block is split into frames of this size when setting up the ring.
+// TPACKET_V3 stores packets back to back regardless, but the kernel still
+// validates the frame layout
+const uint32_t ring_frame_size = 2048;
+
+uint32_t fanout_argument(RingSnifferConfiguration::FanoutMode mode, uint16_t group_id) {
+    uint32_t type = 0;
+    switch (mode) {
+        case RingSnifferConfiguration::FANOUT_HASH:
+            // Keep fragments together, otherwise they'd be hashed
+            // differently than the datagram's first fragment
+            type = PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG;
+            break;
+        case RingSnifferConfiguration::FANOUT_LOAD_BALANCE:
+            type = PACKET_FANOUT_LB;
+            break;
+        case RingSnifferConfiguration::FANOUT_CPU:
+            type = PACKET_FANOUT_CPU;
+            break;
+        default:
+            break;
+    }
+    return group_id | (type << 16);
+}
+
+RingSniffer::RingSniffer(const NetworkInterface& iface,
+                         const RingSnifferConfiguration& configuration)
+: fd_(-1), stop_fd_(-1), stop_requested_(0), ring_(0), ring_size_(0), block_size_(0), block_count_(0),
+  block_index_(0), current_block_(0), next_frame_(0), frames_left_(0),
+  timeout_(configuration.timeout() ? static_cast<int>(configuration.timeout()) : -1),
+  extract_raw_(false), decoding_flags_(configuration.decoding_flags()),
+  frame_decoder_(0), link_decoder_(0) {
+    try {
+        open(iface, configuration);
+    }
+    catch (...) {
+        close();
+        throw;
+    }
+}
+
+RingSniffer::~RingSniffer() {
+    close();
+}
+
+void RingSniffer::open(const NetworkInterface& iface,
+                       const RingSnifferConfiguration& configuration) {
+    // Don't capture anything until the socket is bound, otherwise packets
+    // from every interface could be queued before the ring is set up
+    fd_ = socket(AF_PACKET, SOCK_RAW | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        throw socket_open_error(strerror(errno));
+    }
+    stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd_ < 0) {
+        throw socket_open_error(strerror(errno));
+    }
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    const string name = iface.name();
+    strncpy(ifr.ifr_name, name.c_str(), sizeof(ifr.ifr_name) - 1);
+    if (ioctl(fd_, SIOCGIFHWADDR, &ifr) < 0) {
+        throw socket_open_error(strerror(errno));
+    }
+    link_decoder_ = Internals::frame_decoder_from_hardware_type(ifr.ifr_hwaddr.sa_family);
+    frame_decoder_ = link_decoder_;
+
+    int version = TPACKET_V3;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+        throw socket_open_error(strerror(errno));
+    }
+    struct tpacket_req3 request;
+    memset(&request, 0, sizeof(request));
+    request.tp_block_size = configuration.block_size();
+    request.tp_block_nr = configuration.block_count();
+    request.tp_frame_size = ring_frame_size;
+    request.tp_frame_nr = (configuration.block_size() / ring_frame_size) *
+                          configuration.block_count();
+    request.tp_retire_blk_tov = configuration.block_timeout();
+    if (setsockopt(fd_, SOL_PACKET, PACKET_RX_RING, &request, sizeof(request)) < 0) {
+        throw socket_open_error(strerror(errno));
+    }
+    block_size_ = request.tp_block_size;
+    block_count_ = request.tp_block_nr;
+    ring_size_ = static_cast<size_t>(block_size_) * block_count_;
+    void* ring = mmap(0, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (ring == MAP_FAILED) {
+        throw socket_open_error(strerror(errno));
+    }
+    ring_ = static_cast<uint8_t*>(ring);
+
+    struct sockaddr_ll address;
+    memset(&address, 0, sizeof(address));
+    address.sll_family = AF_PACKET;
+    address.sll_protocol = htons(ETH_P_ALL);
+    address.sll_ifindex = iface.id();
+    if (bind(fd_, (const struct sockaddr*)&address, sizeof(address)) < 0) {
+        throw socket_open_error(strerror(errno));
+    }
+    if (configuration.promisc_mode()) {
+        struct packet_mreq request;
+        memset(&request, 0, sizeof(request));
+        request.mr_ifindex = iface.id();
+        request.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(fd_, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &request,
+                       sizeof(request)) < 0) {
+            throw socket_open_error(strerror(errno));
+        }
+    }
+    // Sockets can only join a fanout group once they're bound
+    if (configuration.fanout_mode() != RingSnifferConfiguration::NO_FANOUT) {
+        uint32_t argument = fanout_argument(configuration.fanout_mode(),
+                                            configuration.fanout_group_id());
+        if (setsockopt(fd_, SOL_PACKET, PACKET_FANOUT, &argument, sizeof(argument)) < 0) {
+            throw socket_open_error(strerror(errno));
+        }
+    }
+}
+
+void RingSniffer::close() {
+    if (ring_) {
+        munmap(ring_, ring_size_);
+        ring_ = 0;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (stop_fd_ >= 0) {
+        ::close(stop_fd_);
+        stop_fd_ = -1;
+    }
+}
+
+PtrPacket RingSniffer::next_packet() {
+    DecodingScope decoding_scope(decoding_flags_);
+    uint32_t size = 0;
+    Timestamp timestamp;
+    while (const uint8_t* frame = next_frame(size, timestamp)) {
+        PDU* pdu = 0;
+        try {
+            pdu = frame_decoder_(frame, size);
+        }
+        catch (malformed_packet&) {
+        }
+        if (pdu) {
+            return PtrPacket(pdu, timestamp);
+        }
+    }
+    return PtrPacket(0, Timestamp());
+}
+
+bool RingSniffer::read_batch(vector<Packet>& batch, uint32_t max_batch) {
+    batch.clear();
+    // Batches can end in the middle of a block, where next_frame doesn't
+    // look for stop requests
+    if (take_stop_request()) {
+        return false;
+    }
+    DecodingScope decoding_scope(decoding_flags_);
+    uint32_t size = 0;
+    Timestamp timestamp;
+    while (batch.empty()) {
+        // This only waits if the current block has been consumed
+        const uint8_t* frame = next_frame(size, timestamp);
+        if (!frame) {
+            return false;
+        }
+        if (max_batch == 0) {
+            batch.reserve(frames_left_ + 1);
+        }
+        while (true) {
+            PDU* pdu = 0;
+            try {
+                pdu = frame_decoder_(frame, size);
+            }
+            catch (malformed_packet&) {
+            }
+            if (pdu) {
+                batch.push_back(Packet(pdu, timestamp, Packet::own_pdu()));
+            }
+            // Don't move on to the next block, as that would release this one
+            if (frames_left_ == 0 || (max_batch && batch.size() >= max_batch)) {
+                break;
+            }
+            frame = next_frame(size, timestamp);
+        }
+    }
+    return true;
+}
+
+const uint8_t* RingSniffer::next_frame(uint32_t& size, Timestamp& timestamp) {
+    while (frames_left_ == 0) {
+        // The previous frame belongs to this block, which can only be
+        // handed back to the kernel once that frame is no longer used
+        if (current_block_) {
+            release_block();
+        }
+        if (take_stop_request()) {
+            return 0;
+        }
+        uint8_t* block = ring_ + static_cast<size_t>(block_index_) * block_size_;
+        const tpacket_block_desc* descriptor = (const tpacket_block_desc*)block;
+        if ((__atomic_load_n(&descriptor->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+             TP_STATUS_USER) == 0) {
+            if (!wait_for_block()) {
+                return 0;
+            }
+            continue;
+        }
+        current_block_ = block;
+        frames_left_ = descriptor->hdr.bh1.num_pkts;
+        next_frame_ = block + descriptor->hdr.bh1.offset_to_first_pkt;
+    }
+    const tpacket3_hdr* header = (const tpacket3_hdr*)next_frame_;
+    struct timeval tv;
+    tv.tv_sec = header->tp_sec;
+    tv.tv_usec = header->tp_nsec / 1000;
+    timestamp = tv;
+    size = header->tp_snaplen;
+    next_frame_ += header->tp_next_offset;
+    --frames_left_;
+    return (const uint8_t*)header + header->tp_mac;
+}
+
+bool RingSniffer::wait_for_block() {
+    struct pollfd fds[2];
+    memset(fds, 0, sizeof(fds));
+    fds[0].fd = fd_;
+    fds[0].events = POLLIN | POLLERR;
+    fds[1].fd = stop_fd_;
+    fds[1].events = POLLIN;
+    while (true) {
+        const int result = poll(fds, 2, timeout_);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            return false;
+        }
+        // The stop request itself is taken by next_frame. This may also
+        // be a leftover wake up from a request that was already taken
+        if (fds[1].revents & POLLIN) {
+            uint64_t value;
+            ssize_t result = read(stop_fd_, &value, sizeof(value));
+            (void)result;
+            return true;
+        }
+        // Errors such as the interface going down are reported this way
+        return (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) == 0;
+    }
+}
+
+void RingSniffer::release_block() {
+    tpacket_block_desc* descriptor = (tpacket_block_desc*)current_block_;
+    __atomic_store_n(&descriptor->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    current_block_ = 0;
+    block_index_ = (block_index_ + 1) % block_count_;
+}
+
+void RingSniffer::stop_sniff() {
+    __atomic_store_n(&stop_requested_, 1, __ATOMIC_RELEASE);
+    const uint64_t value = 1;
+    // This can only fail if the counter overflows, which still wakes up readers
+    ssize_t result = write(stop_fd_, &value, sizeof(value));
+    (void)result;
+}
+
+bool RingSniffer::take_stop_request() {
+    return __atomic_exchange_n(&stop_requested_, 0, __ATOMIC_ACQ_REL) != 0;
+}
+
+void RingSniffer::clear_stop_request() {
+    __atomic_store_n(&stop_requested_, 0, __ATOMIC_RELEASE);
+    uint64_t value;
+    ssize_t result = read(stop_fd_, &value, sizeof(value));
+    (void)result;
+}
+
+void RingSniffer::set_extract_raw_pdus(bool value) {
+    extract_raw_ = value;
+    frame_decoder_ = extract_raw_ ? &Internals::decode_raw_frame : link_decoder_;
+}
+
+void RingSniffer::set_decoding_flags(uint32_t flags) {
+    decoding_flags_ = flags;
+}
+
+uint32_t RingSniffer::decoding_flags() const {
+    return decoding_flags_;
+}
+
+RingSniffer::statistics RingSniffer::stats() {
+    // The kernel resets its counters every time they're read
+    struct tpacket_stats_v3 kernel_stats;
+    memset(&kernel_stats, 0, sizeof(kernel_stats));
+    socklen_t length = sizeof(kernel_stats);
+    if (getsockopt(fd_, SOL_PACKET, PACKET_STATISTICS, &kernel_stats, &length) == 0) {
+        // Dropped packets are included in tp_packets
+        stats_.packets += kernel_stats.tp_packets - kernel_stats.tp_drops;
+        stats_.drops += kernel_stats.tp_drops;
+    }
+    return stats_;
+}
+
+int RingSniffer::get_fd() {
+    return fd_;
+}
+
+#if TINS_IS_CXX11
+
+// RingSnifferGroup
+
+uint16_t next_fanout_group_id() {
+    // Fanout groups are per network namespace, so start from the pid to
+    // avoid clashing with other processes using this same scheme
+    static std::atomic<uint16_t> next_id(static_cast<uint16_t>(getpid()));
+    uint16_t id = next_id++;
+    // 0 means "pick one"
+    return id ? id : next_id++;
+}
+
+RingSnifferGroup::RingSnifferGroup(const NetworkInterface& iface, uint32_t size,
+                                   RingSnifferConfiguration configuration) {
+    if (size == 0) {
+        size = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    RingSnifferConfiguration::FanoutMode mode = configuration.fanout_mode();
+    if (mode == RingSnifferConfiguration::NO_FANOUT) {
+        mode = RingSnifferConfiguration::FANOUT_HASH;
+    }
+    fanout_group_id_ = configuration.fanout_group_id();
+    if (fanout_group_id_ == 0) {
+        fanout_group_id_ = next_fanout_group_id();
+    }
+    configuration.set_fanout(mode, fanout_group_id_);
+    sniffers_.reserve(size);
+    for (uint32_t i = 0; i < size; ++i) {
+        sniffers_.emplace_back(new RingSniffer(iface, configuration));
+    }
+}
+
+void RingSnifferGroup::stop_sniff() {
+    for (size_t i = 0; i < sniffers_.size(); ++i) {
+        sniffers_[i]->stop_sniff();
+    }
+}
+
+RingSniffer::statistics RingSnifferGroup::stats() {
+    RingSniffer::statistics output;
+    for (size_t i = 0; i < sniffers_.size(); ++i) {
+        const RingSniffer::statistics ring_stats = sniffers_[i]->stats();
+        output.packets += ring_stats.packets;
+        output.drops += ring_stats.drops;
+    }
+    return output;
+}
+
+size_t RingSnifferGroup::size() const {
+    return sniffers_.size();
+}
+
+RingSniffer& RingSnifferGroup::operator[](size_t index) {
+    return *sniffers_[index];
+}
+
+uint16_t RingSnifferGroup::fanout_group_id() const {
+    return fanout_group_id_;
+}
+
+#endif // TINS_IS_CXX11
+
+} // Tins
+
+#endif // TINS_HAVE_PACKET_RING
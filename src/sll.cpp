@@ -47,11 +47,10 @@ SLL::SLL(const uint8_t* buffer, uint32_t total_sz) {
     stream.read(header_);
     if (stream) {
         inner_pdu(
-            Internals::pdu_from_flag(
-                (Constants::Ethernet::e)protocol(), 
-                stream.pointer(), 
-                stream.size()
-            )
+            Internals::decode_ether_payload,
+            protocol(),
+            stream.pointer(),
+            static_cast<uint32_t>(stream.size())
         );
     }
 }
@@ -54,11 +54,10 @@ SNAP::SNAP(const uint8_t* buffer, uint32_t total_sz) {
     stream.read(snap_);
     if (stream) {
         inner_pdu(
-            Internals::pdu_from_flag(
-                (Constants::Ethernet::e)eth_type(), 
-                stream.pointer(), 
-                stream.size()
-            )
+            Internals::decode_ether_payload,
+            eth_type(),
+            stream.pointer(),
+            static_cast<uint32_t>(stream.size())
         );
     }
 }
@@ -34,25 +34,18 @@
 #endif // _WIN32
 
 #include <tins/sniffer.h>
-#include <tins/dot11/dot11_base.h>
-#include <tins/ethernetII.h>
-#include <tins/radiotap.h>
-#include <tins/loopback.h>
 #include <tins/rawpdu.h>
-#include <tins/dot3.h>
-#include <tins/pktap.h>
-#include <tins/sll.h>
-#include <tins/ppi.h>
-#include <tins/ip.h>
-#include <tins/ipv6.h>
+#include <tins/exceptions.h>
+#include <tins/decoding_scope.h>
 #include <tins/detail/pdu_helpers.h>
 
 using std::string;
+using std::vector;
 
 namespace Tins {
 
 BaseSniffer::BaseSniffer() 
-: handle_(0), mask_(0), extract_raw_(false) {
+: handle_(0), mask_(0), extract_raw_(false), decoding_flags_(0), frame_decoder_(0) {
     
 }
     
@@ -64,6 +57,7 @@ BaseSniffer::~BaseSniffer() {
 
 void BaseSniffer::set_pcap_handle(pcap_t* pcap_handle) {
     handle_ = pcap_handle;
+    frame_decoder_ = 0;
 }
 
 pcap_t* BaseSniffer::get_pcap_handle() {
@@ -85,142 +79,119 @@ bpf_u_int32 BaseSniffer::get_if_mask() const {
 struct sniff_data {
     struct timeval tv;
     PDU* pdu;
+    Internals::frame_decoder decoder;
     bool packet_processed;
 
-sniff_data() : tv(), pdu(0), packet_processed(true) { }
+sniff_data(Internals::frame_decoder decoder)
+: tv(), pdu(0), decoder(decoder), packet_processed(true) { }
 };
 
-template<typename T>
-T* safe_alloc(const u_char* bytes, bpf_u_int32 len) {
-    try {
-        return new T((const uint8_t*)bytes, len);
-    }
-    catch (malformed_packet&) {
-        return 0;
-    }
-}
-
-template<typename T>
 void sniff_loop_handler(u_char* user, const struct pcap_pkthdr* h, const u_char* bytes) {
     sniff_data* data = (sniff_data*)user;
     data->packet_processed = true;
     data->tv = h->ts;
-    data->pdu = safe_alloc<T>(bytes, h->caplen);
+    try {
+        data->pdu = data->decoder((const uint8_t*)bytes, h->caplen);
+    }
+    catch (malformed_packet&) {
+        data->pdu = 0;
+    }
 }
 
-void sniff_loop_eth_handler(u_char* user, const struct pcap_pkthdr* h, const u_char* bytes) {
-    sniff_data* data = (sniff_data*)user;
-    data->packet_processed = true;
-    data->tv = h->ts;
-    if (Internals::is_dot3((const uint8_t*)bytes, h->caplen)) {
-        data->pdu = safe_alloc<Dot3>((const uint8_t*)bytes, h->caplen);
+Internals::frame_decoder BaseSniffer::resolve_frame_decoder() {
+    if (extract_raw_) {
+        frame_decoder_ = &Internals::decode_raw_frame;
     }
     else {
-        data->pdu = safe_alloc<EthernetII>((const uint8_t*)bytes, h->caplen);
+        // This throws if the link type is not supported, so it's retried
+        // on the next call instead of being cached
+        frame_decoder_ = Internals::frame_decoder_from_dlt_flag(pcap_datalink(handle_));
     }
+    return frame_decoder_;
 }
 
-void sniff_loop_raw_handler(u_char* user, const struct pcap_pkthdr* h, const u_char* bytes) {
-    TINS_BEGIN_PACK
-    struct base_ip_header {
-    #if TINS_IS_LITTLE_ENDIAN
-        uint8_t ihl:4,
-                version:4;
-    #else
-        uint8_t version:4,
-                ihl:4;
-    #endif
-    } TINS_END_PACK;
+PtrPacket BaseSniffer::next_packet() {
+    // The link type is resolved once, the first time a packet is read
+    // after the handle or the raw extraction setting change
+    sniff_data data(frame_decoder_ ? frame_decoder_ : resolve_frame_decoder());
+    DecodingScope decoding_scope(decoding_flags_);
+    // keep calling pcap_loop until a well-formed packet is found.
+    while (data.pdu == 0 && data.packet_processed) {
+        data.packet_processed = false;
+        if (pcap_sniffing_method_(handle_, 1, &sniff_loop_handler, (u_char*)&data) < 0) {
+            return PtrPacket(0, Timestamp());
+        }
+    }
+    return PtrPacket(data.pdu, data.tv);
+}
 
-    sniff_data* data = (sniff_data*)user;
-    const base_ip_header* header = (const base_ip_header*)bytes;
-    data->packet_processed = true;
-    data->tv = h->ts;
-    switch (header->version) {
-        case 4:
-            data->pdu = safe_alloc<IP>((const uint8_t*)bytes, h->caplen);
-            break;
-        case 6:
-            data->pdu = safe_alloc<IPv6>((const uint8_t*)bytes, h->caplen);
-            break;
-    };
-}
-
-#ifdef TINS_HAVE_DOT11
-void sniff_loop_dot11_handler(u_char* user, const struct pcap_pkthdr* h, const u_char* bytes) {
-    sniff_data* data = (sniff_data*)user;
-    data->packet_processed = true;
-    data->tv = h->ts;
+struct batch_data {
+    vector<Packet>* batch;
+    Internals::frame_decoder decoder;
+
+batch_data(vector<Packet>* batch, Internals::frame_decoder decoder)
+: batch(batch), decoder(decoder) { }
+};
+
+void sniff_batch_handler(u_char* user, const struct pcap_pkthdr* h, const u_char* bytes) {
+    batch_data* data = (batch_data*)user;
+    PDU* pdu = 0;
     try {
-        data->pdu = Dot11::from_bytes(bytes, h->caplen);
+        pdu = data->decoder((const uint8_t*)bytes, h->caplen);
+    }
+    catch (malformed_packet&) {
     }
-    catch(malformed_packet&) {
-        
+    if (pdu) {
+        data->batch->push_back(Packet(pdu, h->ts, Packet::own_pdu()));
     }
 }
-#endif
 
-PtrPacket BaseSniffer::next_packet() {
-    sniff_data data;
-    const int iface_type = pcap_datalink(handle_);
-    pcap_handler handler = 0;
-    if (extract_raw_) {
-        handler = &sniff_loop_handler<RawPDU>;
+bool BaseSniffer::read_batch(vector<Packet>& batch, uint32_t max_batch) {
+    batch.clear();
+    if (max_batch) {
+        batch.reserve(max_batch);
     }
-    else {
-        switch (iface_type) {
-            case DLT_EN10MB:
-                handler = &sniff_loop_eth_handler;
-                break;
-            case DLT_NULL:
-                handler = &sniff_loop_handler<Tins::Loopback>;
-                break;
-            case DLT_LINUX_SLL:
-                handler = &sniff_loop_handler<SLL>;
-                break; 
-            case DLT_PPI:
-                handler = &sniff_loop_handler<PPI>;
-                break;
-            case DLT_RAW:
-                handler = &sniff_loop_raw_handler;
-                break;
-
-            // Dot11 related protocols
-            #ifdef TINS_HAVE_DOT11
-            case DLT_IEEE802_11_RADIO:
-                handler = &sniff_loop_handler<RadioTap>;
-                break;
-            case DLT_IEEE802_11:
-                handler = &sniff_loop_dot11_handler;
-                break;
-            #else
-            case DLT_IEEE802_11_RADIO:
-            case DLT_IEEE802_11:
-                throw protocol_disabled();
-            #endif // TINS_HAVE_DOT11
-
-            #ifdef DLT_PKTAP
-            case DLT_PKTAP:
-                handler = &sniff_loop_handler<PKTAP>;
-                break;
-            #endif // DLT_PKTAP
-
-            default:
-                throw unknown_link_type();
+    batch_data data(&batch, frame_decoder_ ? frame_decoder_ : resolve_frame_decoder());
+    // Packets are handed out once pcap_dispatch returns, at which point
+    // libpcap may have reused its buffer, so they can't point into it
+    const uint32_t buffer_flags = DecodingScope::LAZY_INNER_PDUS |
+                                  DecodingScope::BORROWED_PAYLOADS |
+                                  DecodingScope::LAZY_OPTIONS;
+    DecodingScope decoding_scope(decoding_flags_ & ~buffer_flags);
+    // pcap_loop would block until the whole batch is read
+    const bool default_method = pcap_sniffing_method_ == pcap_loop;
+    const PcapSniffingMethod method = default_method ? pcap_dispatch : pcap_sniffing_method_;
+    const bool live_capture = pcap_file(handle_) == 0;
+    const int count = max_batch ? static_cast<int>(max_batch) : -1;
+    while (true) {
+        const int result = method(handle_, count, &sniff_batch_handler, (u_char*)&data);
+        // Either an error happened or BaseSniffer::stop_sniff was called
+        if (result < 0) {
+            return false;
         }
-    }
-    // keep calling pcap_loop until a well-formed packet is found.
-    while (data.pdu == 0 && data.packet_processed) {
-        data.packet_processed = false;
-        if (pcap_sniffing_method_(handle_, 1, handler, (u_char*)&data) < 0) {
-            return PtrPacket(0, Timestamp());
+        // This is the end of the file or, if the sniffing method was set by
+        // the user, a timeout, which ends the loop as it does on next_packet
+        if (result == 0 && (!live_capture || !default_method)) {
+            return false;
+        }
+        // Otherwise, pcap_dispatch timed out or every packet was malformed
+        if (!batch.empty()) {
+            return true;
         }
     }
-    return PtrPacket(data.pdu, data.tv);
 }
 
 void BaseSniffer::set_extract_raw_pdus(bool value) {
     extract_raw_ = value;
+    frame_decoder_ = 0;
+}
+
+void BaseSniffer::set_decoding_flags(uint32_t flags) {
+    decoding_flags_ = flags;
+}
+
+uint32_t BaseSniffer::decoding_flags() const {
+    return decoding_flags_;
 }
 
 void BaseSniffer::set_pcap_sniffing_method(PcapSniffingMethod method) {
@@ -429,7 +400,7 @@ SnifferConfiguration::SnifferConfiguration()
 : flags_(0), snap_len_(DEFAULT_SNAP_LEN), buffer_size_(0),
   pcap_sniffing_method_(pcap_loop), timeout_(DEFAULT_TIMEOUT), promisc_(false),
   rfmon_(false), immediate_mode_(false), direction_(PCAP_D_INOUT),
-  timestamp_precision_(0) {
+  timestamp_precision_(0), decoding_flags_(0) {
 
 }
 
@@ -437,6 +408,7 @@ void SnifferConfiguration::configure_sniffer_pre_activation(Sniffer& sniffer) co
     sniffer.set_snap_len(snap_len_);
     sniffer.set_timeout(timeout_);
     sniffer.set_pcap_sniffing_method(pcap_sniffing_method_);
+    sniffer.set_decoding_flags(decoding_flags_);
     if ((flags_ & BUFFER_SIZE) != 0) {
         sniffer.set_buffer_size(buffer_size_);
     }
@@ -461,6 +433,7 @@ void SnifferConfiguration::configure_sniffer_pre_activation(FileSniffer& sniffer
         }
     }
     sniffer.set_pcap_sniffing_method(pcap_sniffing_method_);
+    sniffer.set_decoding_flags(decoding_flags_);
 }
 
 void SnifferConfiguration::configure_sniffer_post_activation(Sniffer& sniffer) const {
@@ -527,4 +500,8 @@ void SnifferConfiguration::set_direction(pcap_direction_t direction) {
     flags_ |= DIRECTION;
 }
 
+void SnifferConfiguration::set_decoding_flags(uint32_t flags) {
+    decoding_flags_ = flags;
+}
+
 } // Tins
@@ -28,6 +28,7 @@
  */
 
 #include <cstring>
+#include <cstddef>
 #include <tins/tcp.h>
 #include <tins/ip.h>
 #include <tins/ipv6.h>
@@ -35,6 +36,8 @@
 #include <tins/rawpdu.h>
 #include <tins/exceptions.h>
 #include <tins/memory_helpers.h>
+#include <tins/decoding_scope.h>
+#include <tins/detail/pdu_helpers.h>
 #include <tins/utils/checksum_utils.h>
 
 using std::vector;
@@ -52,7 +55,34 @@ PDU::metadata TCP::extract_metadata(const uint8_t *buffer, uint32_t total_sz) {
         throw malformed_packet();
     }
     const tcp_header* header = (const tcp_header*)buffer;
-    return metadata(header->doff * 4, pdu_flag, PDU::UNKNOWN);
+    const uint32_t header_size = header->doff * sizeof(uint32_t);
+    if (TINS_UNLIKELY(header_size < sizeof(tcp_header) || header_size > total_sz)) {
+        throw malformed_packet();
+    }
+    return metadata(header_size, pdu_flag, PDU::UNKNOWN);
+}
+
+void TCP::patch_sport(uint8_t* buffer, uint32_t total_sz, uint16_t new_sport) {
+    patch_field(buffer, total_sz, offsetof(tcp_header, sport), new_sport);
+}
+
+void TCP::patch_dport(uint8_t* buffer, uint32_t total_sz, uint16_t new_dport) {
+    patch_field(buffer, total_sz, offsetof(tcp_header, dport), new_dport);
+}
+
+void TCP::patch_field(uint8_t* buffer, uint32_t total_sz, uint32_t offset,
+                      uint16_t value) {
+    extract_metadata(buffer, total_sz);
+    const uint8_t new_data[] = {
+        static_cast<uint8_t>(value >> 8),
+        static_cast<uint8_t>(value & 0xff)
+    };
+    Internals::patch_checksummed_field(
+        buffer + offset,
+        new_data,
+        sizeof(new_data),
+        buffer + offsetof(tcp_header, check)
+    );
 }
 
 TCP::TCP(uint16_t dport, uint16_t sport) 
@@ -72,53 +102,29 @@ TCP::TCP(const uint8_t* buffer, uint32_t total_sz) {
         throw malformed_packet();
     }
     const uint8_t* header_end = buffer + (data_offset() * sizeof(uint32_t));
-
     if (stream.pointer() < header_end) {
-        // Estimate about 4 bytes per option and reserver that so we avoid doing 
-        // multiple reallocations on the vector
-        options_.reserve((header_end - stream.pointer()) / sizeof(uint32_t));
-    }
-
-    while (stream.pointer() < header_end) {
-        const OptionTypes option_type = (OptionTypes)stream.read<uint8_t>();
-        if (option_type == EOL) {
-            stream.skip(header_end - stream.pointer());
-            break;
-        }
-        else if (option_type == NOP) {
-            #if TINS_IS_CXX11
-            add_option(option_type, 0);
-            #else
-            add_option(option(option_type, 0));
-            #endif // TINS_IS_CXX11
+        const uint32_t options_size = static_cast<uint32_t>(header_end - stream.pointer());
+        if ((DecodingScope::current_flags() & DecodingScope::LAZY_OPTIONS) != 0) {
+            // Make sure they're valid, but only parse them on first access
+            parse_options(stream.pointer(), options_size, false);
+            pending_options_.assign(stream.pointer(), options_size);
         }
         else {
-            // Extract the length
-            uint32_t len = stream.read<uint8_t>();
-            const uint8_t* data_start = stream.pointer();
-
-            // We need to subtract the option type and length from the size
-            if (TINS_UNLIKELY(len < sizeof(uint8_t) << 1)) {
-                throw malformed_packet();
-            }
-            len -= (sizeof(uint8_t) << 1);
-            // Make sure we have enough bytes for the advertised option payload length
-            if (TINS_UNLIKELY(data_start + len > header_end)) {
-                throw malformed_packet(); 
-            }
-            // If we're using C++11, use the variadic template overload
-            #if TINS_IS_CXX11
-            add_option(option_type, data_start, data_start + len);
-            #else
-            add_option(option(option_type, data_start, data_start + len));
-            #endif // TINS_IS_CXX11
-            // Skip the option's payload
-            stream.skip(len);
+            // Estimate about 4 bytes per option and reserver that so we avoid doing 
+            // multiple reallocations on the vector
+            options_.reserve(options_size / sizeof(uint32_t));
+            parse_options(stream.pointer(), options_size, true);
         }
+        stream.skip(options_size);
     }
     // If we still have any bytes left
     if (stream) {
-        inner_pdu(new RawPDU(stream.pointer(), stream.size()));
+        inner_pdu(
+            Internals::decode_raw_payload,
+            0,
+            stream.pointer(),
+            static_cast<uint32_t>(stream.size())
+        );
     }
 }
 
@@ -291,16 +297,68 @@ void TCP::flags(small_uint<12> value) {
     header_.flags_8 = value & 0xff;
 }
 
+void TCP::finish_lazy_parsing() const {
+    parse_pending_options();
+    option_index_.prepare(options_);
+}
+
+void TCP::parse_options(const uint8_t* buffer, uint32_t total_sz, bool store) const {
+    InputMemoryStream stream(buffer, total_sz);
+    while (stream) {
+        const OptionTypes option_type = (OptionTypes)stream.read<uint8_t>();
+        if (option_type == EOL) {
+            break;
+        }
+        else if (option_type == NOP) {
+            if (store) {
+                #if TINS_IS_CXX11
+                options_.emplace_back(option_type, 0);
+                #else
+                options_.push_back(option(option_type, 0));
+                #endif // TINS_IS_CXX11
+            }
+        }
+        else {
+            // Extract the length
+            uint32_t len = stream.read<uint8_t>();
+            const uint8_t* data_start = stream.pointer();
+
+            // We need to subtract the option type and length from the size
+            if (TINS_UNLIKELY(len < sizeof(uint8_t) << 1)) {
+                throw malformed_packet();
+            }
+            len -= (sizeof(uint8_t) << 1);
+            // Make sure we have enough bytes for the advertised option payload length
+            if (TINS_UNLIKELY(!stream.can_read(len))) {
+                throw malformed_packet(); 
+            }
+            if (store) {
+                #if TINS_IS_CXX11
+                options_.emplace_back(option_type, data_start, data_start + len);
+                #else
+                options_.push_back(option(option_type, data_start, data_start + len));
+                #endif // TINS_IS_CXX11
+            }
+            // Skip the option's payload
+            stream.skip(len);
+        }
+    }
+}
+
 void TCP::add_option(const option& opt) {
+    parse_pending_options();
     options_.push_back(opt);
+    option_index_.invalidate();
 }
 
 uint32_t TCP::header_size() const {
+    parse_pending_options();
     return sizeof(header_) + pad_options_size(calculate_options_size());
 }
 
 void TCP::write_serialization(uint8_t* buffer, uint32_t total_sz) {
     OutputMemoryStream stream(buffer, total_sz);
+    parse_pending_options();
     const uint32_t options_size = calculate_options_size();
     const uint32_t total_options_size = pad_options_size(options_size);
     // Set checksum to 0, we'll calculate it at the end
@@ -352,11 +410,13 @@ const TCP::option* TCP::search_option(OptionTypes type) const {
 }
 
 TCP::options_type::const_iterator TCP::search_option_iterator(OptionTypes type) const {
-    return Internals::find_option_const<option>(options_, type);
+    parse_pending_options();
+    return option_index_.find(options_, type);
 }
 
 TCP::options_type::iterator TCP::search_option_iterator(OptionTypes type) {
-    return Internals::find_option<option>(options_, type);
+    parse_pending_options();
+    return option_index_.find(options_, type);
 }
 
 /* options */
@@ -401,6 +461,7 @@ bool TCP::remove_option(OptionTypes type) {
         return false;
     }
     options_.erase(iter);
+    option_index_.invalidate();
     return true;
 }
 
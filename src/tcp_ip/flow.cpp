@@ -88,6 +88,21 @@ void Flow::out_of_order_callback(const flow_packet_callback_type& callback) {
 void Flow::process_packet(PDU& pdu) {
     TCP* tcp = pdu.find_pdu<TCP>();
     RawPDU* raw = pdu.find_pdu<RawPDU>(); 
+    if (process_segment(tcp, raw)) {
+        // The packet can be modified, so its payload is moved rather than copied
+        process_payload(tcp->seq(), move(raw->payload()));
+    }
+}
+
+void Flow::process_packet(const PDU& pdu) {
+    const TCP* tcp = pdu.find_pdu<TCP>();
+    const RawPDU* raw = pdu.find_pdu<RawPDU>(); 
+    if (process_segment(tcp, raw)) {
+        process_payload(tcp->seq(), raw->payload());
+    }
+}
+
+bool Flow::process_segment(const TCP* tcp, const RawPDU* raw) {
     // Update the internal state first
     if (tcp) {
         update_state(*tcp);
@@ -98,10 +113,10 @@ void Flow::process_packet(PDU& pdu) {
         #endif // TINS_HAVE_ACK_TRACKER
     }
     if (flags_.ignore_data_packets) {
-        return;
+        return false;
     }
     if (!tcp || !raw) {
-        return;
+        return false;
     }
     const uint32_t chunk_end = tcp->seq() + raw->payload_size();
     const uint32_t current_seq = data_tracker_.sequence_number();
@@ -113,9 +128,12 @@ void Flow::process_packet(PDU& pdu) {
             on_out_of_order_callback_(*this, tcp->seq(), raw->payload());
         }
     }
+    return true;
+}
 
+void Flow::process_payload(uint32_t seq, payload_type payload) {
     // can process either way, since it will abort immediately if not needed
-    if (data_tracker_.process_payload(tcp->seq(), move(raw->payload()))) {
+    if (data_tracker_.process_payload(seq, move(payload))) {
         if (on_data_callback_) {
             on_data_callback_(*this);
         }
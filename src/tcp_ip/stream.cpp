@@ -49,7 +49,7 @@ using std::numeric_limits;
 namespace Tins {
 namespace TCPIP {
 
-Stream::Stream(PDU& packet, const timestamp_type& ts) 
+Stream::Stream(const PDU& packet, const timestamp_type& ts) 
 : client_flow_(extract_client_flow(packet)),
   server_flow_(extract_server_flow(packet)), create_time_(ts), 
   last_seen_(ts), auto_cleanup_client_(true), auto_cleanup_server_(true),
@@ -66,15 +66,18 @@ Stream::Stream(PDU& packet, const timestamp_type& ts)
 
 void Stream::process_packet(PDU& packet, const timestamp_type& ts) {
     last_seen_ = ts;
-    if (client_flow_.packet_belongs(packet)) {
-        client_flow_.process_packet(packet);
-    }
-    else if (server_flow_.packet_belongs(packet)) {
-        server_flow_.process_packet(packet);
+    if (Flow* flow = packet_flow(packet)) {
+        flow->process_packet(packet);
     }
-    if (is_finished() && on_stream_closed_) {
-        on_stream_closed_(*this);
+    check_stream_closed();
+}
+
+void Stream::process_packet(const PDU& packet, const timestamp_type& ts) {
+    last_seen_ = ts;
+    if (Flow* flow = packet_flow(packet)) {
+        flow->process_packet(packet);
     }
+    check_stream_closed();
 }
 
 void Stream::process_packet(PDU& packet) {
@@ -198,6 +201,22 @@ const Stream::timestamp_type& Stream::last_seen() const {
     return last_seen_;
 }
 
+Flow* Stream::packet_flow(const PDU& packet) {
+    if (client_flow_.packet_belongs(packet)) {
+        return &client_flow_;
+    }
+    else if (server_flow_.packet_belongs(packet)) {
+        return &server_flow_;
+    }
+    return 0;
+}
+
+void Stream::check_stream_closed() {
+    if (is_finished() && on_stream_closed_) {
+        on_stream_closed_(*this);
+    }
+}
+
 Flow Stream::extract_client_flow(const PDU& packet) {
     const TCP* tcp = packet.find_pdu<TCP>();
     if (!tcp) {
@@ -71,11 +71,19 @@ void StreamFollower::process_packet(PDU& packet) {
 }
 
 void StreamFollower::process_packet(Packet& packet) {
-    process_packet(*packet.pdu(), packet.timestamp());
+    // A shared PDU is only read, so that it's not copied by Packet::pdu
+    if (packet.is_shared()) {
+        const Packet& shared_packet = packet;
+        process_packet(*shared_packet.pdu(), packet.timestamp());
+    }
+    else {
+        process_packet(*packet.pdu(), packet.timestamp());
+    }
 }
 
-void StreamFollower::process_packet(PDU& packet, const timestamp_type& ts) {
-    const TCP* tcp = packet.find_pdu<TCP>();
+template <typename PDUType>
+void StreamFollower::process_packet(PDUType& packet, const timestamp_type& ts) {
+    const TCP* tcp = packet.template find_pdu<TCP>();
     if (!tcp) {
         return;
     }
@@ -28,6 +28,7 @@
  */
 
 #include <cstring>
+#include <cstddef>
 #include <tins/udp.h>
 #include <tins/constants.h>
 #include <tins/ip.h>
@@ -35,6 +36,7 @@
 #include <tins/rawpdu.h>
 #include <tins/exceptions.h>
 #include <tins/memory_helpers.h>
+#include <tins/detail/pdu_helpers.h>
 #include <tins/utils/checksum_utils.h>
 
 using Tins::Memory::InputMemoryStream;
@@ -49,6 +51,35 @@ PDU::metadata UDP::extract_metadata(const uint8_t* /*buffer*/, uint32_t total_sz
     return metadata(sizeof(udp_header), pdu_flag, PDU::UNKNOWN);
 }
 
+void UDP::patch_sport(uint8_t* buffer, uint32_t total_sz, uint16_t new_sport) {
+    patch_field(buffer, total_sz, offsetof(udp_header, sport), new_sport);
+}
+
+void UDP::patch_dport(uint8_t* buffer, uint32_t total_sz, uint16_t new_dport) {
+    patch_field(buffer, total_sz, offsetof(udp_header, dport), new_dport);
+}
+
+void UDP::patch_field(uint8_t* buffer, uint32_t total_sz, uint32_t offset,
+                      uint16_t value) {
+    extract_metadata(buffer, total_sz);
+    const uint8_t new_data[] = {
+        static_cast<uint8_t>(value >> 8),
+        static_cast<uint8_t>(value & 0xff)
+    };
+    uint8_t* checksum = buffer + offsetof(udp_header, check);
+    // A zero checksum means the segment doesn't use one
+    const bool has_checksum = checksum[0] != 0 || checksum[1] != 0;
+    Internals::patch_checksummed_field(
+        buffer + offset,
+        new_data,
+        sizeof(new_data),
+        has_checksum ? checksum : 0
+    );
+    if (has_checksum && checksum[0] == 0 && checksum[1] == 0) {
+        checksum[0] = checksum[1] = 0xff;
+    }
+}
+
 UDP::UDP(uint16_t dport, uint16_t sport)
 : header_() {
     this->dport(dport);
@@ -59,7 +90,12 @@ UDP::UDP(const uint8_t* buffer, uint32_t total_sz)  {
     InputMemoryStream stream(buffer, total_sz);
     stream.read(header_);
     if (stream) {
-        inner_pdu(new RawPDU(stream.pointer(), stream.size()));
+        inner_pdu(
+            Internals::decode_raw_payload,
+            0,
+            stream.pointer(),
+            static_cast<uint32_t>(stream.size())
+        );
     }
 }
 
@@ -33,8 +33,7 @@
 #include <tins/ipv6_address.h>
 #include <tins/endianness.h>
 #include <tins/memory_helpers.h>
-
-using std::memcpy;
+#include <tins/detail/checksum_kernels.h>
 
 using Tins::Memory::InputMemoryStream;
 using Tins::Memory::OutputMemoryStream;
@@ -47,28 +46,7 @@ uint32_t do_checksum(const uint8_t* start, const uint8_t* end) {
 }
 
 uint16_t sum_range(const uint8_t* start, const uint8_t* end) {
-    uint32_t checksum(0);
-    const uint8_t* last = end;
-    uint16_t buffer = 0;
-    uint16_t padding = 0;
-    const uint8_t* ptr = start;
-
-    if (((end - start) & 1) == 1) {
-        last = end - 1;
-        padding = Endian::host_to_le<uint16_t>(*(end - 1));
-    }
-
-    while (ptr < last) {
-        memcpy(&buffer, ptr, sizeof(uint16_t));
-        checksum += buffer;
-        ptr += sizeof(uint16_t);
-    }
-
-    checksum += padding;
-    while (checksum >> 16) {
-        checksum = (checksum & 0xffff) + (checksum >> 16);
-    }
-    return checksum;  
+    return Internals::checksum_sum_range(Internals::best_checksum_kernel(), start, end);
 }
 
 template <size_t buffer_size, typename AddressType>
@@ -109,21 +87,54 @@ uint32_t pseudoheader_checksum(IPv6Address source_ip,
     );
 }
 
-uint32_t crc32(const uint8_t* data, uint32_t data_size) {
-    uint32_t i, crc = 0;
-    static uint32_t crc_table[] = {
-        0x4DBDF21C, 0x500AE278, 0x76D3D2D4, 0x6B64C2B0,
-        0x3B61B38C, 0x26D6A3E8, 0x000F9344, 0x1DB88320,
-        0xA005713C, 0xBDB26158, 0x9B6B51F4, 0x86DC4190,
-        0xD6D930AC, 0xCB6E20C8, 0xEDB71064, 0xF0000000
-    };
+uint16_t update_checksum(uint16_t checksum, uint16_t old_value, uint16_t new_value) {
+    // HC' = ~(~HC + ~m + m'), see RFC 1624 section 3
+    uint32_t sum = static_cast<uint16_t>(~checksum);
+    sum += static_cast<uint16_t>(~old_value);
+    sum += new_value;
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(~sum);
+}
 
-    for (i = 0; i < data_size; ++i) {
-        crc = (crc >> 4) ^ crc_table[(crc ^ data[i]) & 0x0F];
-        crc = (crc >> 4) ^ crc_table[(crc ^ (data[i] >> 4)) & 0x0F];
+uint16_t update_checksum(uint16_t checksum, const uint8_t* old_data,
+                         const uint8_t* new_data, uint32_t data_size) {
+    for (uint32_t i = 0; i + 1 < data_size; i += 2) {
+        const uint16_t old_value = static_cast<uint16_t>((old_data[i] << 8) | old_data[i + 1]);
+        const uint16_t new_value = static_cast<uint16_t>((new_data[i] << 8) | new_data[i + 1]);
+        checksum = update_checksum(checksum, old_value, new_value);
     }
+    return checksum;
+}
 
-    return crc;
+uint32_t crc32(const uint8_t* data, uint32_t data_size) {
+    return Internals::crc32_update(Internals::best_crc32_kernel(), 0, data, data_size);
+}
+
+uint32_t validate_fcs(const uint8_t* const* frames,
+                      const uint32_t* frame_sizes,
+                      uint32_t frame_count,
+                      bool* results) {
+    const Internals::crc32_kernel kernel = Internals::best_crc32_kernel();
+    uint32_t valid_count = 0;
+    for (uint32_t i = 0; i < frame_count; ++i) {
+        bool valid = false;
+        if (frame_sizes[i] >= sizeof(uint32_t)) {
+            const uint32_t data_size = frame_sizes[i] - sizeof(uint32_t);
+            const uint8_t* fcs = frames[i] + data_size;
+            const uint32_t expected = fcs[0] | (fcs[1] << 8) | (fcs[2] << 16) |
+                                      (static_cast<uint32_t>(fcs[3]) << 24);
+            valid = Internals::crc32_update(kernel, 0, frames[i], data_size) == expected;
+        }
+        if (valid) {
+            ++valid_count;
+        }
+        if (results) {
+            results[i] = valid;
+        }
+    }
+    return valid_count;
 }
 
 
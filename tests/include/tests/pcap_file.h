@@ -0,0 +1,93 @@
+#ifndef TINS_TEST_PCAP_FILE_H
+#define TINS_TEST_PCAP_FILE_H
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+#include <unistd.h>
+#include <tins/pdu.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+#include <tins/endianness.h>
+
+// Builds pcap files in memory and writes them to temporary files which
+// are removed when the test ends
+class PcapFileTest : public testing::Test {
+public:
+    typedef Tins::PDU::serialization_type buffer_type;
+
+    static const uint32_t microsecond_magic = 0xa1b2c3d4;
+    static const uint32_t nanosecond_magic = 0xa1b23c4d;
+
+    void TearDown() {
+        for (size_t i = 0; i < files_.size(); ++i) {
+            unlink(files_[i].c_str());
+        }
+    }
+
+    // Packet number i is an EthernetII / IP / UDP packet having sport i
+    static buffer_type make_packet(uint16_t index) {
+        using namespace Tins;
+        EthernetII eth = EthernetII() / IP("1.2.3.4", "5.6.7.8") /
+                         UDP(53, index) / RawPDU("payload");
+        return eth.serialize();
+    }
+
+    static void append(buffer_type& buffer, uint32_t value, bool swapped = false) {
+        if (swapped) {
+            value = Tins::Endian::change_endian(value);
+        }
+        const uint8_t* ptr = (const uint8_t*)&value;
+        buffer.insert(buffer.end(), ptr, ptr + sizeof(value));
+    }
+
+    static void append_header(buffer_type& buffer, uint32_t magic, uint32_t link_type,
+                              bool swapped = false) {
+        append(buffer, magic, swapped);
+        // Version 2.4
+        append(buffer, 2 | (4 << 16), swapped);
+        append(buffer, 0, swapped);
+        append(buffer, 0, swapped);
+        append(buffer, 65535, swapped);
+        append(buffer, link_type, swapped);
+    }
+
+    static void append_record(buffer_type& buffer, const buffer_type& packet,
+                              uint32_t seconds, uint32_t fraction,
+                              bool swapped = false) {
+        append(buffer, seconds, swapped);
+        append(buffer, fraction, swapped);
+        append(buffer, static_cast<uint32_t>(packet.size()), swapped);
+        append(buffer, static_cast<uint32_t>(packet.size()), swapped);
+        buffer.insert(buffer.end(), packet.begin(), packet.end());
+    }
+
+    // Creates an empty temporary file
+    std::string make_file_name() {
+        char name[] = "/tmp/libtins_pcap_file_XXXXXX";
+        const int fd = mkstemp(name);
+        EXPECT_GE(fd, 0);
+        close(fd);
+        files_.push_back(name);
+        return name;
+    }
+
+    std::string write_file(const buffer_type& contents) {
+        const std::string name = make_file_name();
+        std::FILE* file = std::fopen(name.c_str(), "wb");
+        if (!contents.empty()) {
+            EXPECT_EQ(contents.size(), std::fwrite(&contents[0], 1, contents.size(), file));
+        }
+        std::fclose(file);
+        return name;
+    }
+private:
+    std::vector<std::string> files_;
+};
+
+#endif // TINS_TEST_PCAP_FILE_H
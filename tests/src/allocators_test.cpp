@@ -9,7 +9,11 @@
 #include <tins/dot1q.h>
 #include <tins/ip.h>
 #include <tins/ipv6.h>
-
+#include <tins/rawpdu.h>
+#if TINS_IS_CXX11
+    #include <thread>
+    #include <atomic>
+#endif // TINS_IS_CXX11
 
 using namespace Tins;
 
@@ -120,3 +124,60 @@ TEST_F(AllocatorsTest, IPv6) {
         EXPECT_EQ(pkt.serialize(), ipv6_data);
     }
 }
+
+TEST_F(AllocatorsTest, CollidingLinkLayerIdentifiers) {
+    // Both of these identifiers map to the same table slot
+    Allocators::register_allocator<EthernetII, DummyPDU<4> >(0x1234);
+    Allocators::register_allocator<EthernetII, DummyPDU<5> >(0x3412);
+    std::vector<uint8_t> link_layer_data(
+        link_layer_data_buffer,
+        link_layer_data_buffer + sizeof(link_layer_data_buffer)
+    );
+    link_layer_data[12] = 0x12;
+    link_layer_data[13] = 0x34;
+    {
+        EthernetII pkt(&link_layer_data[0], (uint32_t)link_layer_data.size());
+        EXPECT_TRUE(pkt.find_pdu<DummyPDU<4> >() != NULL);
+    }
+    link_layer_data[12] = 0x34;
+    link_layer_data[13] = 0x12;
+    {
+        EthernetII pkt(&link_layer_data[0], (uint32_t)link_layer_data.size());
+        EXPECT_TRUE(pkt.find_pdu<DummyPDU<5> >() != NULL);
+        EXPECT_EQ(pkt.serialize(), link_layer_data);
+    }
+    link_layer_data[13] = 0x13;
+    {
+        EthernetII pkt(&link_layer_data[0], (uint32_t)link_layer_data.size());
+        EXPECT_TRUE(pkt.find_pdu<RawPDU>() != NULL);
+    }
+}
+
+#if TINS_IS_CXX11
+TEST_F(AllocatorsTest, RegisterWhileDecoding) {
+    std::vector<uint8_t> ipv4_data(
+        ipv4_data_buffer,
+        ipv4_data_buffer + sizeof(ipv4_data_buffer)
+    );
+    // Use a protocol number no other test registers
+    ipv4_data[23] = 253;
+    std::atomic<bool> registered(false);
+    std::atomic<bool> failed(false);
+    std::thread decoder([&]() {
+        bool done = false;
+        while (!done) {
+            done = registered;
+            EthernetII pkt(&ipv4_data[0], (uint32_t)ipv4_data.size());
+            if (!pkt.find_pdu<RawPDU>() && !pkt.find_pdu<DummyPDU<6> >()) {
+                failed = true;
+            }
+        }
+    });
+    Allocators::register_allocator<IP, DummyPDU<6> >(253);
+    registered = true;
+    decoder.join();
+    EXPECT_FALSE(failed);
+    EthernetII pkt(&ipv4_data[0], (uint32_t)ipv4_data.size());
+    EXPECT_TRUE(pkt.find_pdu<DummyPDU<6> >() != NULL);
+}
+#endif // TINS_IS_CXX11
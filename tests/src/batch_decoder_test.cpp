@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <new>
+#include <cstdlib>
+#include <stdint.h>
+#include <pcap.h>
+#include <tins/batch_decoder.h>
+#include <tins/ethernetII.h>
+#include <tins/dot3.h>
+#include <tins/ip.h>
+#include <tins/ipv6.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+#include <tins/exceptions.h>
+
+using namespace Tins;
+
+#ifdef TINS_HAVE_PDU_POOL
+
+#include <atomic>
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+    // GCC doesn't match the replacements of operator new and operator delete
+    #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+// Counts the allocations that go through the general purpose allocator
+std::atomic<size_t> allocation_count(0);
+
+void* operator new(size_t size) {
+    ++allocation_count;
+    void* ptr = std::malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+#endif // TINS_HAVE_PDU_POOL
+
+class BatchDecoderTest : public testing::Test {
+public:
+    typedef PDU::serialization_type buffer_type;
+
+    // Frame number i is an EthernetII / IP / UDP packet having sport i,
+    // except for every tenth one, which is truncated
+    static void make_frames(size_t count, std::vector<buffer_type>& buffers,
+                            std::vector<BatchDecoder::frame>& frames) {
+        buffers.resize(count);
+        frames.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            EthernetII eth = EthernetII() / IP("1.2.3.4", "5.6.7.8") /
+                             UDP(53, static_cast<uint16_t>(i)) / RawPDU("payload");
+            buffers[i] = eth.serialize();
+            if (i % 10 == 9) {
+                buffers[i].resize(5);
+            }
+            timeval tv;
+            tv.tv_sec = static_cast<long>(i);
+            tv.tv_usec = 0;
+            frames[i] = BatchDecoder::frame(
+                &buffers[i][0],
+                static_cast<uint32_t>(buffers[i].size()),
+                tv
+            );
+        }
+    }
+
+    static void check_packets(const std::vector<Packet>& packets) {
+        for (size_t i = 0; i < packets.size(); ++i) {
+            if (i % 10 == 9) {
+                EXPECT_TRUE(packets[i].pdu() == 0);
+                continue;
+            }
+            ASSERT_TRUE(packets[i].pdu() != 0);
+            EXPECT_EQ(PDU::ETHERNET_II, packets[i].pdu()->pdu_type());
+            EXPECT_EQ(i, packets[i].pdu()->rfind_pdu<UDP>().sport());
+            EXPECT_EQ(static_cast<long>(i), packets[i].timestamp().seconds());
+        }
+    }
+};
+
+TEST_F(BatchDecoderTest, DecodeInOrder) {
+    std::vector<buffer_type> buffers;
+    std::vector<BatchDecoder::frame> frames;
+    make_frames(2000, buffers, frames);
+    BatchDecoder decoder(DLT_EN10MB, 4);
+    EXPECT_EQ(4U, decoder.thread_count());
+
+    std::vector<Packet> packets;
+    decoder.decode(frames, packets);
+    ASSERT_EQ(frames.size(), packets.size());
+    check_packets(packets);
+
+    // The worker threads are reused for the next batch
+    make_frames(1500, buffers, frames);
+    decoder.decode(frames, packets);
+    ASSERT_EQ(frames.size(), packets.size());
+    check_packets(packets);
+}
+
+TEST_F(BatchDecoderTest, SingleThread) {
+    std::vector<buffer_type> buffers;
+    std::vector<BatchDecoder::frame> frames;
+    make_frames(300, buffers, frames);
+    BatchDecoder decoder(DLT_EN10MB, 1);
+    EXPECT_EQ(1U, decoder.thread_count());
+
+    std::vector<Packet> packets;
+    decoder.decode(frames, packets);
+    ASSERT_EQ(frames.size(), packets.size());
+    check_packets(packets);
+}
+
+TEST_F(BatchDecoderTest, EmptyBatch) {
+    BatchDecoder decoder(DLT_EN10MB, 2);
+    std::vector<BatchDecoder::frame> frames;
+    std::vector<Packet> packets(3);
+    decoder.decode(frames, packets);
+    EXPECT_TRUE(packets.empty());
+}
+
+TEST_F(BatchDecoderTest, LinkTypes) {
+    const buffer_type ip_buffer = (IP("1.2.3.4", "5.6.7.8") / UDP(1, 2)).serialize();
+    const buffer_type ipv6_buffer = (IPv6("::1", "::2") / UDP(1, 2)).serialize();
+    const buffer_type dot3_buffer = Dot3().serialize();
+    std::vector<BatchDecoder::frame> frames;
+    frames.push_back(BatchDecoder::frame(&ip_buffer[0], ip_buffer.size(), Timestamp()));
+    frames.push_back(BatchDecoder::frame(&ipv6_buffer[0], ipv6_buffer.size(), Timestamp()));
+
+    std::vector<Packet> packets;
+    BatchDecoder(DLT_RAW).decode(frames, packets);
+    ASSERT_EQ(2U, packets.size());
+    ASSERT_TRUE(packets[0].pdu() != 0);
+    ASSERT_TRUE(packets[1].pdu() != 0);
+    EXPECT_EQ(PDU::IP, packets[0].pdu()->pdu_type());
+    EXPECT_EQ(PDU::IPv6, packets[1].pdu()->pdu_type());
+
+    frames.assign(1, BatchDecoder::frame(&dot3_buffer[0], dot3_buffer.size(), Timestamp()));
+    BatchDecoder(DLT_EN10MB).decode(frames, packets);
+    ASSERT_EQ(1U, packets.size());
+    ASSERT_TRUE(packets[0].pdu() != 0);
+    EXPECT_EQ(PDU::IEEE802_3, packets[0].pdu()->pdu_type());
+}
+
+TEST_F(BatchDecoderTest, UnknownLinkType) {
+    EXPECT_THROW(BatchDecoder(-1), unknown_link_type);
+}
+
+#ifdef TINS_HAVE_PDU_POOL
+TEST_F(BatchDecoderTest, BatchesReuseWorkerPools) {
+    std::vector<buffer_type> buffers;
+    std::vector<BatchDecoder::frame> frames;
+    // Every thread decodes at most 256 packets, so none of them caches
+    // more than PDUPool::max_cached_blocks blocks of any size class
+    make_frames(256, buffers, frames);
+    std::vector<Packet> packets;
+    packets.reserve(frames.size());
+
+    // After its first batch, a single threaded decoder only allocates
+    // what isn't a PDU
+    BatchDecoder single_thread(DLT_EN10MB, 1);
+    single_thread.decode(frames, packets);
+    packets.clear();
+    allocation_count = 0;
+    single_thread.decode(frames, packets);
+    packets.clear();
+    const size_t other_allocations = allocation_count;
+
+    BatchDecoder decoder(DLT_EN10MB, 4);
+    decoder.decode(frames, packets);
+    check_packets(packets);
+    packets.clear();
+    const size_t batch_count = 20;
+    allocation_count = 0;
+    for (size_t i = 0; i < batch_count; ++i) {
+        decoder.decode(frames, packets);
+        // The packets decoded by the workers are destroyed on this thread
+        packets.clear();
+    }
+    // Each thread only allocates PDUs until its pool can hold the
+    // largest share of a batch it has decoded
+    const size_t pdu_count = frames.size() * 4;
+    EXPECT_LE(allocation_count.load(),
+              batch_count * other_allocations + decoder.thread_count() * pdu_count);
+}
+#endif // TINS_HAVE_PDU_POOL
@@ -9,6 +9,7 @@
 #include <tins/ethernetII.h>
 #include <tins/hw_address.h>
 #include <tins/ip_address.h>
+#include <tins/decoding_scope.h>
 
 using namespace std;
 using namespace Tins;
@@ -317,3 +318,46 @@ TEST_F(DHCPTest, RemoveOption) {
     PDU::serialization_type new_buffer = dhcp.serialize();
     EXPECT_EQ(old_buffer, new_buffer);
 }
+
+TEST_F(DHCPTest, LazyOptions) {
+    const DHCP eager(expected_packet, sizeof(expected_packet));
+    vector<uint8_t> buffer(expected_packet, expected_packet + sizeof(expected_packet));
+    DecodingScope scope(DecodingScope::LAZY_OPTIONS);
+    DHCP dhcp(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_EQ(eager.header_size(), dhcp.header_size());
+    const DHCP copy = dhcp;
+    std::fill(buffer.begin(), buffer.end(), 0);
+    test_equals(eager, copy);
+    EXPECT_EQ(IPv4Address("192.168.4.2"), copy.server_identifier());
+
+    DHCP serialized = copy;
+    PDU::serialization_type serialized_buffer = serialized.serialize();
+    ASSERT_EQ(sizeof(expected_packet), serialized_buffer.size());
+    EXPECT_TRUE(std::equal(serialized_buffer.begin(), serialized_buffer.end(), expected_packet));
+}
+
+TEST_F(DHCPTest, IndexedOptionLookups) {
+    DHCP dhcp;
+    dhcp.type(DHCP::REQUEST);
+    dhcp.server_identifier("192.168.0.1");
+    dhcp.lease_time(100);
+    dhcp.renewal_time(200);
+    dhcp.rebind_time(300);
+    dhcp.subnet_mask("255.255.255.0");
+    dhcp.broadcast("192.168.0.255");
+    dhcp.requested_ip("192.168.0.10");
+    dhcp.domain_name("libtins.github.io");
+    dhcp.hostname("libtins");
+    dhcp.end();
+    EXPECT_EQ(DHCP::REQUEST, dhcp.type());
+    EXPECT_EQ(300U, dhcp.rebind_time());
+    EXPECT_EQ("libtins", dhcp.hostname());
+    EXPECT_EQ(IPv4Address("192.168.0.10"), dhcp.requested_ip());
+
+    EXPECT_TRUE(dhcp.remove_option(DHCP::DHCP_LEASE_TIME));
+    EXPECT_THROW(dhcp.lease_time(), option_not_found);
+    EXPECT_EQ(200U, dhcp.renewal_time());
+    dhcp.lease_time(400);
+    EXPECT_EQ(400U, dhcp.lease_time());
+    EXPECT_EQ(IPv4Address("255.255.255.0"), dhcp.subnet_mask());
+}
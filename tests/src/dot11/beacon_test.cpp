@@ -5,6 +5,7 @@
 #include <gtest/gtest.h>
 #include <tins/rsn_information.h>
 #include <tins/detail/smart_ptr.h>
+#include <tins/decoding_scope.h>
 #include "tests/dot11_mgmt.h"
 
 using namespace std;
@@ -479,4 +480,35 @@ TEST_F(Dot11BeaconTest, RemoveOption) {
     EXPECT_EQ(old_buffer, new_buffer);
 }
 
+TEST_F(Dot11BeaconTest, LazyOptions) {
+    Dot11Beacon beacon;
+    Dot11Beacon::rates_type rates;
+    rates.push_back(1.0f);
+    rates.push_back(5.5f);
+    beacon.ssid("libtins");
+    beacon.supported_rates(rates);
+    beacon.ds_parameter_set(6);
+    beacon.power_constraint(0x1e);
+    beacon.erp_information(3);
+    beacon.qos_capability(0x2f);
+    beacon.challenge_text("libtins ftw");
+    // A second SSID, lookups must return the first one
+    beacon.ssid("other");
+    PDU::serialization_type buffer = beacon.serialize();
+
+    DecodingScope scope(DecodingScope::LAZY_OPTIONS);
+    Dot11Beacon decoded(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_EQ(beacon.header_size(), decoded.header_size());
+    const Dot11Beacon copy = decoded;
+    std::fill(buffer.begin(), buffer.end(), 0);
+    // There are enough options for these to go through the option index
+    ASSERT_EQ(beacon.options().size(), copy.options().size());
+    EXPECT_EQ("libtins", copy.ssid());
+    EXPECT_EQ(rates, copy.supported_rates());
+    EXPECT_EQ(6, copy.ds_parameter_set());
+    EXPECT_EQ("libtins ftw", copy.challenge_text());
+    EXPECT_EQ(0x2f, copy.qos_capability());
+    test_equals(beacon, copy);
+}
+
 #endif // TINS_HAVE_DOT11
@@ -372,3 +372,18 @@ TEST_F(ICMPTest, ExtensionsParsingWithALengthField) {
                                 packet_with_extensions_and_length + sizeof(packet_with_extensions_and_length))
     );
 }
+
+TEST_F(ICMPTest, PatchEchoFieldsUpdatesChecksum) {
+    ICMP icmp(ICMP::ECHO_REQUEST);
+    icmp.id(0x1234);
+    icmp.sequence(7);
+    icmp.inner_pdu(RawPDU("Test"));
+    PDU::serialization_type buffer = icmp.serialize();
+    const uint32_t buffer_size = static_cast<uint32_t>(buffer.size());
+    ICMP::patch_id(&buffer[0], buffer_size, 0xbeef);
+    ICMP::patch_sequence(&buffer[0], buffer_size, 8);
+
+    icmp.id(0xbeef);
+    icmp.sequence(8);
+    EXPECT_EQ(icmp.serialize(), buffer);
+}
@@ -10,6 +10,7 @@
 #include <tins/rawpdu.h>
 #include <tins/ip_address.h>
 #include <tins/ethernetII.h>
+#include <tins/decoding_scope.h>
 
 using namespace std;
 using namespace Tins;
@@ -883,3 +884,58 @@ TEST_F(IPTest, ParseSerializeOptions) {
     const vector<uint8_t> buffer(options_packet, options_packet + sizeof(options_packet));
     EXPECT_EQ(buffer, serialized);
 }
+
+TEST_F(IPTest, PatchFieldsUpdatesChecksums) {
+    IP ip = IP("192.168.0.1", "10.0.0.1") / TCP(22, 52) / RawPDU("Test");
+    PDU::serialization_type buffer = ip.serialize();
+    const uint32_t buffer_size = static_cast<uint32_t>(buffer.size());
+    IP::patch_ttl(&buffer[0], buffer_size, 12);
+    IP::patch_src_addr(&buffer[0], buffer_size, "172.16.0.5");
+    IP::patch_dst_addr(&buffer[0], buffer_size, "8.8.8.8");
+
+    ip.ttl(12);
+    ip.src_addr("172.16.0.5");
+    ip.dst_addr("8.8.8.8");
+    EXPECT_EQ(ip.serialize(), buffer);
+
+    uint8_t short_buffer[10] = { 0 };
+    EXPECT_THROW(IP::patch_ttl(short_buffer, sizeof(short_buffer), 1), malformed_packet);
+}
+
+TEST_F(IPTest, PatchAddressUpdatesUDPChecksum) {
+    IP ip = IP("192.168.0.1", "10.0.0.1") / UDP(53, 1000) / RawPDU("Test");
+    PDU::serialization_type buffer = ip.serialize();
+    IP::patch_dst_addr(&buffer[0], static_cast<uint32_t>(buffer.size()), "1.1.1.1");
+    ip.dst_addr("1.1.1.1");
+    EXPECT_EQ(ip.serialize(), buffer);
+}
+
+TEST_F(IPTest, LazyOptions) {
+    const IP eager(expected_packet, sizeof(expected_packet));
+    vector<uint8_t> buffer(expected_packet, expected_packet + sizeof(expected_packet));
+    DecodingScope scope(DecodingScope::LAZY_OPTIONS);
+    IP ip(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    const IP copy = ip;
+    std::fill(buffer.begin(), buffer.end(), 0);
+    EXPECT_EQ(eager.options().size(), copy.options().size());
+    EXPECT_EQ(eager.header_size(), copy.header_size());
+    EXPECT_EQ(eager.security().compartments, copy.security().compartments);
+}
+
+TEST_F(IPTest, IndexedOptionLookups) {
+    IP ip;
+    // Enough options for lookups to go through the option index
+    for (uint8_t i = 0; i < 10; ++i) {
+        ip.add_option(IP::option(IP::option_identifier(IP::NOOP, IP::CONTROL, 0)));
+    }
+    ip.stream_identifier(0x1234);
+    EXPECT_EQ(0x1234, ip.stream_identifier());
+    // Lookups return the first option of each type
+    ip.stream_identifier(0x5678);
+    EXPECT_EQ(0x1234, ip.stream_identifier());
+    EXPECT_TRUE(ip.remove_option(IP::option_identifier(IP::SID, IP::CONTROL, 1)));
+    EXPECT_EQ(0x5678, ip.stream_identifier());
+    EXPECT_TRUE(ip.remove_option(IP::option_identifier(IP::SID, IP::CONTROL, 1)));
+    EXPECT_THROW(ip.stream_identifier(), option_not_found);
+    EXPECT_EQ(10U, ip.options().size());
+}
@@ -14,6 +14,9 @@
 #include <tins/loopback.h>
 #include <tins/ip.h>
 #include <tins/tcp.h>
+#include <tins/rawpdu.h>
+#include <tins/exceptions.h>
+#include <tins/decoding_scope.h>
 
 using namespace std;
 using namespace Tins;
@@ -32,4 +35,21 @@ TEST_F(LoopbackTest, MatchesResponse) {
     PDU::serialization_type buffer = loop2.serialize();
     EXPECT_TRUE(loop1.matches_response(&buffer[0], buffer.size()));
 }
+
+TEST_F(LoopbackTest, MalformedInnerPDUAsRaw) {
+    Loopback loop = Loopback() / IP("192.168.0.1", "192.168.0.2") / TCP(22, 21);
+    loop.family(PF_INET);
+    PDU::serialization_type buffer = loop.serialize();
+    // Truncated in the middle of the IP header
+    const uint32_t truncated_size = 4 + 10;
+    EXPECT_THROW(Loopback(&buffer[0], truncated_size), malformed_packet);
+
+    DecodingScope scope(DecodingScope::MALFORMED_INNER_PDUS_AS_RAW);
+    Loopback truncated(&buffer[0], truncated_size);
+    EXPECT_TRUE(truncated.find_pdu<IP>() == 0);
+    const RawPDU* raw = truncated.find_pdu<RawPDU>();
+    ASSERT_TRUE(raw != 0);
+    EXPECT_EQ(10U, raw->payload_size());
+    EXPECT_EQ(1U, scope.malformed_layers());
+}
 #endif // _WIN32
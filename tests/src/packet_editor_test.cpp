@@ -0,0 +1,210 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <tins/packet_editor.h>
+#include <tins/ethernetII.h>
+#include <tins/dot1q.h>
+#include <tins/ip.h>
+#include <tins/ipv6.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/icmp.h>
+#include <tins/icmpv6.h>
+#include <tins/rawpdu.h>
+#include <tins/exceptions.h>
+
+using namespace Tins;
+
+class PacketEditorTest : public testing::Test {
+public:
+    typedef PDU::serialization_type buffer_type;
+
+    static EthernetII make_tcp_packet() {
+        EthernetII eth = EthernetII("00:01:02:03:04:05", "06:07:08:09:0a:0b") /
+                         IP("192.168.0.1", "10.0.0.1") /
+                         TCP(80, 12345) /
+                         RawPDU("some tcp payload");
+        eth.rfind_pdu<IP>().id(0x1234);
+        eth.rfind_pdu<IP>().ttl(64);
+        TCP& tcp = eth.rfind_pdu<TCP>();
+        tcp.seq(1000);
+        tcp.ack_seq(2000);
+        tcp.window(512);
+        return eth;
+    }
+
+    static EthernetII make_vlan_udp_packet() {
+        return EthernetII() / Dot1Q(10) /
+               IPv6("fe80::1", "fe80::2") /
+               UDP(53, 4321) /
+               RawPDU("some udp payload");
+    }
+};
+
+TEST_F(PacketEditorTest, EthernetAndDot1Q) {
+    EthernetII expected = make_vlan_udp_packet();
+    buffer_type buffer = expected.serialize();
+    PacketEditor editor(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    editor.eth_dst_addr("aa:bb:cc:dd:ee:ff");
+    editor.eth_src_addr("11:22:33:44:55:66");
+    editor.vlan_id(1234);
+    editor.vlan_priority(5);
+
+    expected.dst_addr("aa:bb:cc:dd:ee:ff");
+    expected.src_addr("11:22:33:44:55:66");
+    expected.rfind_pdu<Dot1Q>().id(1234);
+    expected.rfind_pdu<Dot1Q>().priority(5);
+    EXPECT_EQ(expected.serialize(), buffer);
+}
+
+TEST_F(PacketEditorTest, IPFields) {
+    EthernetII expected = make_tcp_packet();
+    buffer_type buffer = expected.serialize();
+    PacketEditor editor(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    editor.ip_tos(0x28);
+    editor.ip_id(0xbeef);
+    editor.ip_ttl(3);
+    editor.ip_src_addr("172.16.5.4");
+    editor.ip_dst_addr("8.8.4.4");
+
+    IP& ip = expected.rfind_pdu<IP>();
+    ip.tos(0x28);
+    ip.id(0xbeef);
+    ip.ttl(3);
+    ip.src_addr("172.16.5.4");
+    ip.dst_addr("8.8.4.4");
+    EXPECT_EQ(expected.serialize(), buffer);
+}
+
+TEST_F(PacketEditorTest, TCPFields) {
+    EthernetII expected = make_tcp_packet();
+    buffer_type buffer = expected.serialize();
+    PacketEditor editor(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    editor.tcp_sport(443);
+    editor.tcp_dport(8080);
+    editor.tcp_seq(0xdeadbeef);
+    editor.tcp_ack_seq(0x01020304);
+    editor.tcp_window(65000);
+
+    TCP& tcp = expected.rfind_pdu<TCP>();
+    tcp.sport(443);
+    tcp.dport(8080);
+    tcp.seq(0xdeadbeef);
+    tcp.ack_seq(0x01020304);
+    tcp.window(65000);
+    EXPECT_EQ(expected.serialize(), buffer);
+}
+
+TEST_F(PacketEditorTest, IPv6AndUDPFields) {
+    EthernetII expected = make_vlan_udp_packet();
+    buffer_type buffer = expected.serialize();
+    PacketEditor editor(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    editor.ipv6_hop_limit(7);
+    editor.ipv6_src_addr("2001:db8::dead:beef");
+    editor.ipv6_dst_addr("2001:db8::1");
+    editor.udp_sport(5353);
+    editor.udp_dport(1);
+
+    IPv6& ipv6 = expected.rfind_pdu<IPv6>();
+    ipv6.hop_limit(7);
+    ipv6.src_addr("2001:db8::dead:beef");
+    ipv6.dst_addr("2001:db8::1");
+    expected.rfind_pdu<UDP>().sport(5353);
+    expected.rfind_pdu<UDP>().dport(1);
+    EXPECT_EQ(expected.serialize(), buffer);
+}
+
+TEST_F(PacketEditorTest, IPv6AddressesUpdateICMPv6Checksum) {
+    EthernetII expected = EthernetII() / IPv6("fe80::1", "fe80::2") /
+                          ICMPv6(ICMPv6::ECHO_REQUEST);
+    expected.rfind_pdu<ICMPv6>().identifier(0x1234);
+    expected.rfind_pdu<ICMPv6>().sequence(7);
+    buffer_type buffer = expected.serialize();
+    PacketEditor editor(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    editor.ipv6_src_addr("2001:db8::dead:beef");
+    editor.ipv6_dst_addr("2001:db8::1");
+
+    IPv6& ipv6 = expected.rfind_pdu<IPv6>();
+    ipv6.src_addr("2001:db8::dead:beef");
+    ipv6.dst_addr("2001:db8::1");
+    const buffer_type expected_buffer = expected.serialize();
+    EXPECT_EQ(expected_buffer, buffer);
+
+    // Breaking the checksum and recomputing it yields the same packet
+    buffer[buffer.size() - 6] ^= 0xff;
+    editor.update_checksums();
+    EXPECT_EQ(expected_buffer, buffer);
+}
+
+TEST_F(PacketEditorTest, MissingLayer) {
+    EthernetII packet = make_tcp_packet();
+    buffer_type buffer = packet.serialize();
+    const buffer_type original = buffer;
+    PacketEditor editor(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_THROW(editor.udp_sport(1), pdu_not_found);
+    EXPECT_THROW(editor.ipv6_hop_limit(1), pdu_not_found);
+    EXPECT_THROW(editor.vlan_id(1), pdu_not_found);
+    EXPECT_EQ(original, buffer);
+}
+
+TEST_F(PacketEditorTest, TruncateTCP) {
+    EthernetII expected = make_tcp_packet();
+    buffer_type buffer = expected.serialize();
+    PacketEditor editor(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    const uint32_t new_size = static_cast<uint32_t>(buffer.size()) - 6;
+    editor.truncate(new_size);
+    EXPECT_EQ(new_size, editor.size());
+    EXPECT_EQ(editor.view().find_layer<RawPDU>()->size(), 10U);
+
+    expected.rfind_pdu<RawPDU>().payload(RawPDU::payload_type(
+        expected.rfind_pdu<RawPDU>().payload().begin(),
+        expected.rfind_pdu<RawPDU>().payload().begin() + 10
+    ));
+    EXPECT_EQ(expected.serialize(), buffer_type(buffer.begin(), buffer.begin() + new_size));
+}
+
+TEST_F(PacketEditorTest, TruncateUDP) {
+    EthernetII expected = make_vlan_udp_packet();
+    buffer_type buffer = expected.serialize();
+    PacketEditor editor(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    const uint32_t new_size = static_cast<uint32_t>(buffer.size()) - 12;
+    editor.truncate(new_size);
+
+    expected.rfind_pdu<RawPDU>().payload(RawPDU::payload_type(
+        expected.rfind_pdu<RawPDU>().payload().begin(),
+        expected.rfind_pdu<RawPDU>().payload().begin() + 4
+    ));
+    EXPECT_EQ(expected.serialize(), buffer_type(buffer.begin(), buffer.begin() + new_size));
+}
+
+TEST_F(PacketEditorTest, TruncateKeepsPadding) {
+    // EthernetII / IP / ICMP, plus ethernet padding after the IP layer
+    EthernetII expected = EthernetII() / IP("1.2.3.4", "5.6.7.8") / ICMP();
+    buffer_type buffer = expected.serialize();
+    buffer.resize(60);
+    PacketEditor editor(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    editor.truncate(static_cast<uint32_t>(expected.size()));
+    EXPECT_EQ(expected.serialize(), buffer_type(buffer.begin(), buffer.begin() + expected.size()));
+}
+
+TEST_F(PacketEditorTest, TruncateInvalidSize) {
+    EthernetII packet = make_tcp_packet();
+    buffer_type buffer = packet.serialize();
+    PacketEditor editor(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_THROW(editor.truncate(static_cast<uint32_t>(buffer.size()) + 1), invalid_packet);
+    // Cuts through the TCP header
+    EXPECT_THROW(editor.truncate(14 + 20 + 10), invalid_packet);
+    EXPECT_EQ(buffer.size(), editor.size());
+}
+
+TEST_F(PacketEditorTest, UpdateChecksums) {
+    EthernetII expected = make_tcp_packet();
+    buffer_type buffer = expected.serialize();
+    PacketEditor editor(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    const std::string payload = "SOME TCP PAYLOAD";
+    std::copy(payload.begin(), payload.end(), editor.data() + buffer.size() - payload.size());
+    editor.update_checksums();
+
+    expected.rfind_pdu<RawPDU>().payload(RawPDU::payload_type(payload.begin(), payload.end()));
+    EXPECT_EQ(expected.serialize(), buffer);
+}
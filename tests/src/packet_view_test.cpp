@@ -0,0 +1,331 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <tins/packet_view.h>
+#include <tins/ethernetII.h>
+#include <tins/dot1q.h>
+#include <tins/ip.h>
+#include <tins/ipv6.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/icmp.h>
+#include <tins/arp.h>
+#include <tins/rawpdu.h>
+
+using namespace Tins;
+
+class PacketViewTest : public testing::Test {
+public:
+    static const uint8_t smallip_packet[], vlan_udp_packet[];
+};
+
+// EthernetII / IP / TCP, plus 6 bytes of ethernet padding
+const uint8_t PacketViewTest::smallip_packet[] = {
+    64, 97, 134, 43, 174, 3, 0, 36, 1, 254, 210, 68, 8, 0, 69, 0, 0, 40,
+    53, 163, 64, 0, 127, 6, 44, 53, 192, 168, 1, 120, 173, 194, 42, 21,
+    163, 42, 1, 187, 162, 113, 212, 162, 132, 15, 66, 219, 80, 16, 16,
+    194, 34, 54, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+// EthernetII / Dot1Q / IP / UDP / "abcd"
+const uint8_t PacketViewTest::vlan_udp_packet[] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 129, 0, 0, 22, 8, 0, 69, 0, 0,
+    32, 0, 1, 0, 0, 128, 17, 0, 0, 10, 0, 0, 1, 10, 0, 0, 2, 0, 53, 4, 210,
+    0, 12, 0, 0, 97, 98, 99, 100
+};
+
+TEST_F(PacketViewTest, EthernetIPTCP) {
+    PacketView view(smallip_packet, sizeof(smallip_packet));
+    ASSERT_EQ(3U, view.layer_count());
+    EXPECT_EQ(PDU::ETHERNET_II, view.layer(0).pdu_type());
+    EXPECT_EQ(PDU::IP, view.layer(1).pdu_type());
+    EXPECT_EQ(PDU::TCP, view.layer(2).pdu_type());
+
+    EXPECT_EQ(sizeof(smallip_packet), view.layer(0).size());
+    EXPECT_EQ(14U, view.layer(0).header_size());
+    // The ethernet padding is not part of the IP layer
+    EXPECT_EQ(40U, view.layer(1).size());
+    EXPECT_EQ(20U, view.layer(1).header_size());
+    EXPECT_EQ(20U, view.layer(2).size());
+    EXPECT_EQ(0U, view.layer(2).payload_size());
+    EXPECT_EQ(smallip_packet + 14, view.layer(1).data());
+}
+
+TEST_F(PacketViewTest, TypedAccessors) {
+    PacketView view(smallip_packet, sizeof(smallip_packet));
+    EthernetII eth(smallip_packet, sizeof(smallip_packet));
+    const IP& ip = eth.rfind_pdu<IP>();
+    const TCP& tcp = eth.rfind_pdu<TCP>();
+
+    ASSERT_TRUE(view.find_layer<EthernetII>() != 0);
+    ASSERT_TRUE(view.find_layer<IP>() != 0);
+    ASSERT_TRUE(view.find_layer<TCP>() != 0);
+
+    EthernetIIView eth_view(*view.find_layer<EthernetII>());
+    EXPECT_EQ(eth.dst_addr(), eth_view.dst_addr());
+    EXPECT_EQ(eth.src_addr(), eth_view.src_addr());
+    EXPECT_EQ(eth.payload_type(), eth_view.payload_type());
+
+    IPView ip_view(*view.find_layer<IP>());
+    EXPECT_EQ(ip.head_len(), ip_view.head_len());
+    EXPECT_EQ(ip.tos(), ip_view.tos());
+    EXPECT_EQ(ip.tot_len(), ip_view.tot_len());
+    EXPECT_EQ(ip.id(), ip_view.id());
+    EXPECT_EQ(ip.fragment_offset(), ip_view.fragment_offset());
+    EXPECT_EQ(ip.flags(), ip_view.flags());
+    EXPECT_EQ(ip.ttl(), ip_view.ttl());
+    EXPECT_EQ(ip.protocol(), ip_view.protocol());
+    EXPECT_EQ(ip.checksum(), ip_view.checksum());
+    EXPECT_EQ(ip.src_addr(), ip_view.src_addr());
+    EXPECT_EQ(ip.dst_addr(), ip_view.dst_addr());
+
+    TCPView tcp_view(*view.find_layer<TCP>());
+    EXPECT_EQ(tcp.sport(), tcp_view.sport());
+    EXPECT_EQ(tcp.dport(), tcp_view.dport());
+    EXPECT_EQ(tcp.seq(), tcp_view.seq());
+    EXPECT_EQ(tcp.ack_seq(), tcp_view.ack_seq());
+    EXPECT_EQ(tcp.data_offset(), tcp_view.data_offset());
+    EXPECT_EQ(tcp.flags(), tcp_view.flags());
+    EXPECT_TRUE(tcp_view.has_flags(TCP::ACK));
+    EXPECT_FALSE(tcp_view.has_flags(TCP::SYN | TCP::ACK));
+    EXPECT_EQ(tcp.window(), tcp_view.window());
+    EXPECT_EQ(tcp.checksum(), tcp_view.checksum());
+    EXPECT_EQ(tcp.urg_ptr(), tcp_view.urg_ptr());
+}
+
+TEST_F(PacketViewTest, VLANAndUDP) {
+    PacketView view(vlan_udp_packet, sizeof(vlan_udp_packet));
+    ASSERT_EQ(5U, view.layer_count());
+    EXPECT_EQ(PDU::ETHERNET_II, view.layer(0).pdu_type());
+    EXPECT_EQ(PDU::DOT1Q, view.layer(1).pdu_type());
+    EXPECT_EQ(PDU::IP, view.layer(2).pdu_type());
+    EXPECT_EQ(PDU::UDP, view.layer(3).pdu_type());
+    EXPECT_EQ(PDU::RAW, view.layer(4).pdu_type());
+
+    UDPView udp(view.layer(3));
+    EXPECT_EQ(53, udp.sport());
+    EXPECT_EQ(1234, udp.dport());
+    EXPECT_EQ(12, udp.length());
+
+    const LayerView& raw = view.layer(4);
+    EXPECT_EQ("abcd", std::string(raw.data(), raw.data() + raw.size()));
+    EXPECT_EQ(0x6162, view.layer(4).read_be<uint16_t>(0));
+    EXPECT_THROW(view.layer(4).read_be<uint32_t>(1), malformed_packet);
+}
+
+TEST_F(PacketViewTest, IPv6) {
+    EthernetII eth = EthernetII() / IPv6("::1", "f00::1") / UDP(1, 2) / RawPDU("hello");
+    PDU::serialization_type buffer = eth.serialize();
+    PacketView view(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    ASSERT_EQ(4U, view.layer_count());
+    ASSERT_TRUE(view.find_layer<IPv6>() != 0);
+    IPv6View ipv6(*view.find_layer<IPv6>());
+    EXPECT_EQ(IPv6Address("::1"), ipv6.dst_addr());
+    EXPECT_EQ(IPv6Address("f00::1"), ipv6.src_addr());
+    EXPECT_EQ(13, ipv6.payload_length());
+    EXPECT_EQ(5U, view.find_layer(PDU::RAW)->size());
+}
+
+TEST_F(PacketViewTest, FirstLayer) {
+    IP ip = IP("1.2.3.4", "4.3.2.1") / TCP(80, 1024);
+    PDU::serialization_type buffer = ip.serialize();
+    PacketView view(&buffer[0], static_cast<uint32_t>(buffer.size()), PDU::IP);
+    ASSERT_EQ(2U, view.layer_count());
+    EXPECT_EQ(80, TCPView(*view.find_layer<TCP>()).dport());
+    EXPECT_TRUE(view.find_layer<UDP>() == 0);
+}
+
+TEST_F(PacketViewTest, MalformedLayerIsRaw) {
+    // Truncate the TCP header
+    PacketView view(smallip_packet, 14 + 20 + 10);
+    ASSERT_EQ(3U, view.layer_count());
+    EXPECT_EQ(PDU::IP, view.layer(1).pdu_type());
+    EXPECT_EQ(PDU::RAW, view.layer(2).pdu_type());
+    EXPECT_EQ(10U, view.layer(2).size());
+}
+
+TEST_F(PacketViewTest, FragmentedIPPayloadIsRaw) {
+    IP ip = IP("1.2.3.4", "4.3.2.1") / TCP(80, 1024);
+    ip.flags(IP::MORE_FRAGMENTS);
+    PDU::serialization_type buffer = ip.serialize();
+    PacketView view(&buffer[0], static_cast<uint32_t>(buffer.size()), PDU::IP);
+    ASSERT_EQ(2U, view.layer_count());
+    EXPECT_EQ(PDU::RAW, view.layer(1).pdu_type());
+}
+
+TEST_F(PacketViewTest, EmptyBuffer) {
+    PacketView view(smallip_packet, 0);
+    EXPECT_EQ(0U, view.layer_count());
+    EXPECT_TRUE(view.find_layer<EthernetII>() == 0);
+}
+
+TEST_F(PacketViewTest, ClassifyEthernet) {
+    // 1 is DLT_EN10MB
+    PacketClassification output = classify(vlan_udp_packet, sizeof(vlan_udp_packet), 1);
+    ASSERT_EQ(5U, output.layer_count);
+    const PDU::PDUType types[] = {
+        PDU::ETHERNET_II, PDU::DOT1Q, PDU::IP, PDU::UDP, PDU::RAW
+    };
+    const uint32_t offsets[] = { 0, 14, 18, 38, 46 };
+    for (uint32_t i = 0; i < output.layer_count; ++i) {
+        EXPECT_EQ(types[i], output.layers[i].type);
+        EXPECT_EQ(offsets[i], output.layers[i].offset);
+        EXPECT_EQ(sizeof(vlan_udp_packet) - offsets[i], output.layers[i].length);
+    }
+}
+
+TEST_F(PacketViewTest, ClassifyLinkTypes) {
+    const uint8_t* ip_packet = smallip_packet + 14;
+    const uint32_t ip_size = 40;
+    // 12 is DLT_RAW
+    PacketClassification output = classify(ip_packet, ip_size, 12);
+    ASSERT_EQ(2U, output.layer_count);
+    EXPECT_EQ(PDU::IP, output.layers[0].type);
+    EXPECT_EQ(PDU::TCP, output.layers[1].type);
+    EXPECT_EQ(20U, output.layers[1].offset);
+
+    // 113 is DLT_LINUX_SLL
+    std::vector<uint8_t> sll_packet(16, 0);
+    sll_packet[14] = 0x08;
+    sll_packet.insert(sll_packet.end(), ip_packet, ip_packet + ip_size);
+    output = classify(&sll_packet[0], static_cast<uint32_t>(sll_packet.size()), 113);
+    ASSERT_EQ(3U, output.layer_count);
+    EXPECT_EQ(PDU::SLL, output.layers[0].type);
+    EXPECT_EQ(PDU::IP, output.layers[1].type);
+    EXPECT_EQ(16U, output.layers[1].offset);
+    EXPECT_EQ(PDU::TCP, output.layers[2].type);
+
+    // 0 is DLT_NULL
+    std::vector<uint8_t> loopback_packet(4, 0);
+    loopback_packet.insert(loopback_packet.end(), ip_packet, ip_packet + ip_size);
+    output = classify(&loopback_packet[0], static_cast<uint32_t>(loopback_packet.size()), 0);
+    ASSERT_EQ(3U, output.layer_count);
+    EXPECT_EQ(PDU::LOOPBACK, output.layers[0].type);
+    EXPECT_EQ(PDU::IP, output.layers[1].type);
+    EXPECT_EQ(PDU::TCP, output.layers[2].type);
+
+    // Unknown link types are classified as raw
+    output = classify(ip_packet, ip_size, 9999);
+    ASSERT_EQ(1U, output.layer_count);
+    EXPECT_EQ(PDU::RAW, output.layers[0].type);
+}
+
+TEST_F(PacketViewTest, ClassifyMalformed) {
+    // The IP header claims to be larger than the buffer
+    std::vector<uint8_t> packet(smallip_packet, smallip_packet + 40);
+    packet[14] = 0x4f;
+    PacketClassification output = classify(&packet[0], static_cast<uint32_t>(packet.size()), 1);
+    ASSERT_EQ(2U, output.layer_count);
+    EXPECT_EQ(PDU::ETHERNET_II, output.layers[0].type);
+    EXPECT_EQ(PDU::RAW, output.layers[1].type);
+    EXPECT_EQ(0U, classify(&packet[0], 0, 1).layer_count);
+}
+
+TEST_F(PacketViewTest, ClassifyTruncatedPacketsDoesNotThrow) {
+    IPv6 ipv6("::1", "f00::1");
+    ipv6.add_header(IPv6::ext_header(IPv6::HOP_BY_HOP));
+    EthernetII ipv6_eth = EthernetII() / ipv6 / UDP(1, 2) / RawPDU("hello");
+    EthernetII arp_eth = EthernetII() / ARP();
+    const PDU::serialization_type ipv6_packet = ipv6_eth.serialize();
+    const PDU::serialization_type arp_packet = arp_eth.serialize();
+    std::vector<PDU::serialization_type> packets;
+    packets.push_back(PDU::serialization_type(smallip_packet,
+                                              smallip_packet + sizeof(smallip_packet)));
+    packets.push_back(PDU::serialization_type(vlan_udp_packet,
+                                              vlan_udp_packet + sizeof(vlan_udp_packet)));
+    packets.push_back(ipv6_packet);
+    packets.push_back(arp_packet);
+    for (size_t i = 0; i < packets.size(); ++i) {
+        // 1 is DLT_EN10MB
+        for (uint32_t size = 0; size <= packets[i].size(); ++size) {
+            EXPECT_NO_THROW(classify(&packets[i][0], size, 1));
+        }
+    }
+}
+
+TEST_F(PacketViewTest, VerifyChecksums) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4", "5.6.7.8") / TCP(22, 52) / RawPDU("Test");
+    PDU::serialization_type buffer = eth.serialize();
+    ChecksumReport report = verify_checksums(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_EQ(static_cast<uint32_t>(ChecksumReport::IP_CHECKSUM | ChecksumReport::TCP_CHECKSUM),
+              report.verified);
+    EXPECT_TRUE(report.valid());
+
+    // Corrupt the TCP payload. The frame is padded, so this isn't the last byte
+    buffer[14 + 20 + 20] ^= 0xff;
+    report = verify_checksums(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_EQ(static_cast<uint32_t>(ChecksumReport::TCP_CHECKSUM), report.invalid);
+
+    // Corrupt the IP TTL
+    buffer[14 + 8] ^= 0xff;
+    report = verify_checksums(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_EQ(static_cast<uint32_t>(ChecksumReport::IP_CHECKSUM | ChecksumReport::TCP_CHECKSUM),
+              report.invalid);
+    EXPECT_FALSE(report.valid());
+}
+
+TEST_F(PacketViewTest, VerifyChecksumsUDPAndICMP) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4", "5.6.7.8") / UDP(53, 1234) / RawPDU("abcde");
+    PDU::serialization_type buffer = eth.serialize();
+    PacketView view(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    ChecksumReport report = verify_checksums(view);
+    EXPECT_EQ(static_cast<uint32_t>(ChecksumReport::IP_CHECKSUM | ChecksumReport::UDP_CHECKSUM),
+              report.verified);
+    EXPECT_TRUE(report.valid());
+
+    // Trailing bytes after the IP datagram aren't part of the ICMP checksum
+    eth = EthernetII() / IP("1.2.3.4", "5.6.7.8") / ICMP(ICMP::ECHO_REQUEST) / RawPDU("ping");
+    buffer = eth.serialize();
+    buffer.resize(buffer.size() + 6);
+    report = verify_checksums(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_EQ(static_cast<uint32_t>(ChecksumReport::IP_CHECKSUM | ChecksumReport::ICMP_CHECKSUM),
+              report.verified);
+    EXPECT_TRUE(report.valid());
+}
+
+TEST_F(PacketViewTest, VerifyChecksumsIPv6) {
+    EthernetII eth = EthernetII() / IPv6("::1", "f00::1") / TCP(22, 52) / RawPDU("Test");
+    PDU::serialization_type buffer = eth.serialize();
+    ChecksumReport report = verify_checksums(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_EQ(static_cast<uint32_t>(ChecksumReport::TCP_CHECKSUM), report.verified);
+    EXPECT_TRUE(report.valid());
+
+    eth = EthernetII() / IPv6("::1", "f00::1") / UDP(53, 1234) / RawPDU("Test");
+    buffer = eth.serialize();
+    // Corrupt the source address, which is part of the pseudo header
+    buffer[14 + 8] ^= 0xff;
+    report = verify_checksums(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_EQ(static_cast<uint32_t>(ChecksumReport::UDP_CHECKSUM), report.invalid);
+}
+
+TEST_F(PacketViewTest, VerifyChecksumsSkipsUnverifiable) {
+    // The UDP checksum is 0, which means it's not used
+    ChecksumReport report = verify_checksums(vlan_udp_packet, sizeof(vlan_udp_packet));
+    EXPECT_EQ(static_cast<uint32_t>(ChecksumReport::IP_CHECKSUM), report.verified);
+
+    // A truncated capture can't have its transport checksum verified
+    EthernetII eth = EthernetII() / IP("1.2.3.4", "5.6.7.8") / TCP(22, 52) / RawPDU("Test");
+    PDU::serialization_type buffer = eth.serialize();
+    report = verify_checksums(&buffer[0], 14 + 20 + 20 + 2);
+    EXPECT_EQ(static_cast<uint32_t>(ChecksumReport::IP_CHECKSUM), report.verified);
+    EXPECT_TRUE(report.valid());
+}
+
+TEST_F(PacketViewTest, VerifyChecksumsBatch) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4", "5.6.7.8") / TCP(22, 52) / RawPDU("Test");
+    PDU::serialization_type good = eth.serialize();
+    PDU::serialization_type bad = good;
+    bad[14 + 20 + 20] ^= 0xff;
+    const uint8_t* packets[] = { &good[0], &bad[0], smallip_packet };
+    const uint32_t sizes[] = {
+        static_cast<uint32_t>(good.size()),
+        static_cast<uint32_t>(bad.size()),
+        sizeof(smallip_packet)
+    };
+    ChecksumReport reports[3];
+    EXPECT_EQ(2U, verify_checksums(packets, sizes, 3, PDU::ETHERNET_II, reports));
+    EXPECT_TRUE(reports[0].valid());
+    EXPECT_EQ(static_cast<uint32_t>(ChecksumReport::TCP_CHECKSUM), reports[1].invalid);
+    EXPECT_TRUE(reports[2].valid());
+    EXPECT_EQ(2U, verify_checksums(packets, sizes, 3, PDU::ETHERNET_II, 0));
+}
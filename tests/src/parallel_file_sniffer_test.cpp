@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <pcap.h>
+#include <tins/parallel_file_sniffer.h>
+#include <tins/udp.h>
+#include <tins/exceptions.h>
+#include "tests/pcap_file.h"
+
+using std::set;
+using std::string;
+using std::vector;
+
+using namespace Tins;
+
+class ParallelFileSnifferTest : public PcapFileTest {
+public:
+    // Builds a file containing count packets, packet i's timestamp being
+    // i seconds. Every malformed_every-th record is a truncated frame
+    static buffer_type make_file(size_t count, size_t malformed_every = 0) {
+        buffer_type buffer;
+        append_header(buffer, microsecond_magic, DLT_EN10MB);
+        for (size_t i = 0; i < count; ++i) {
+            if (malformed_every && i % malformed_every == 0) {
+                append_record(buffer, buffer_type(3, 0), 0, 0);
+            }
+            append_record(buffer, make_packet(static_cast<uint16_t>(i)),
+                          static_cast<uint32_t>(i), 0);
+        }
+        return buffer;
+    }
+};
+
+TEST_F(ParallelFileSnifferTest, OrderedDelivery) {
+    const size_t packet_count = 5000;
+    ParallelFileSniffer sniffer(write_file(make_file(packet_count)), 4);
+    sniffer.set_batch_size(64);
+    EXPECT_EQ(4U, sniffer.thread_count());
+    EXPECT_EQ(ParallelFileSniffer::ORDERED, sniffer.delivery_order());
+    EXPECT_EQ(DLT_EN10MB, sniffer.link_type());
+    size_t count = 0;
+    sniffer.sniff_loop([&](Packet& packet) {
+        EXPECT_EQ(count, packet.pdu()->rfind_pdu<UDP>().sport());
+        EXPECT_EQ(static_cast<long>(count), packet.timestamp().seconds());
+        ++count;
+        return true;
+    });
+    EXPECT_EQ(packet_count, count);
+}
+
+TEST_F(ParallelFileSnifferTest, UnorderedDelivery) {
+    const size_t packet_count = 5000;
+    ParallelFileSniffer sniffer(write_file(make_file(packet_count)), 4,
+                                ParallelFileSniffer::UNORDERED);
+    sniffer.set_batch_size(50);
+    set<uint16_t> ports;
+    sniffer.sniff_loop([&](PDU& pdu) {
+        ports.insert(pdu.rfind_pdu<UDP>().sport());
+        return true;
+    });
+    EXPECT_EQ(packet_count, ports.size());
+}
+
+TEST_F(ParallelFileSnifferTest, StopAndResume) {
+    ParallelFileSniffer sniffer(write_file(make_file(1000)), 2);
+    sniffer.set_batch_size(100);
+    size_t count = 0;
+    sniffer.sniff_loop([&](Packet& packet) {
+        EXPECT_EQ(count++, packet.pdu()->rfind_pdu<UDP>().sport());
+        return true;
+    }, 150);
+    EXPECT_EQ(150U, count);
+    sniffer.sniff_loop([&](Packet& packet) {
+        EXPECT_EQ(count++, packet.pdu()->rfind_pdu<UDP>().sport());
+        return count < 520;
+    });
+    EXPECT_EQ(520U, count);
+    // The rest of the current batch is delivered first
+    size_t batch_count = 0;
+    sniffer.sniff_batches([&](vector<Packet>& batch) {
+        for (size_t i = 0; i < batch.size(); ++i) {
+            EXPECT_EQ(count++, batch[i].pdu()->rfind_pdu<UDP>().sport());
+        }
+        ++batch_count;
+        return true;
+    });
+    EXPECT_EQ(1000U, count);
+    EXPECT_EQ(5U, batch_count);
+}
+
+TEST_F(ParallelFileSnifferTest, SniffBatches) {
+    ParallelFileSniffer sniffer(write_file(make_file(1000)), 3);
+    sniffer.set_batch_size(64);
+    size_t count = 0;
+    sniffer.sniff_batches([&](vector<Packet>& batch) {
+        EXPECT_FALSE(batch.empty());
+        EXPECT_LE(batch.size(), 64U);
+        count += batch.size();
+        return true;
+    });
+    EXPECT_EQ(1000U, count);
+}
+
+TEST_F(ParallelFileSnifferTest, StopBatches) {
+    ParallelFileSniffer sniffer(write_file(make_file(1000)), 2);
+    sniffer.set_batch_size(10);
+    size_t batch_count = 0;
+    sniffer.sniff_batches([&](vector<Packet>&) {
+        return ++batch_count < 3;
+    });
+    EXPECT_EQ(3U, batch_count);
+}
+
+TEST_F(ParallelFileSnifferTest, MalformedFramesAreSkipped) {
+    ParallelFileSniffer sniffer(write_file(make_file(100, 7)), 2);
+    sniffer.set_batch_size(4);
+    size_t count = 0;
+    sniffer.sniff_loop([&](Packet& packet) {
+        EXPECT_EQ(count++, packet.pdu()->rfind_pdu<UDP>().sport());
+        return true;
+    });
+    EXPECT_EQ(100U, count);
+}
+
+TEST_F(ParallelFileSnifferTest, ExtractRawPDUs) {
+    ParallelFileSniffer sniffer(write_file(make_file(10)), 2);
+    sniffer.set_extract_raw_pdus(true);
+    size_t count = 0;
+    sniffer.sniff_loop([&](Packet& packet) {
+        EXPECT_EQ(PDU::RAW, packet.pdu()->pdu_type());
+        EXPECT_EQ(make_packet(static_cast<uint16_t>(count++)), packet.pdu()->serialize());
+        return true;
+    });
+    EXPECT_EQ(10U, count);
+}
+
+TEST_F(ParallelFileSnifferTest, EmptyFile) {
+    ParallelFileSniffer sniffer(write_file(make_file(0)), 2);
+    size_t count = 0;
+    sniffer.sniff_loop([&](PDU&) {
+        ++count;
+        return true;
+    });
+    EXPECT_EQ(0U, count);
+}
+
+TEST_F(ParallelFileSnifferTest, DestroyWhileReading) {
+    // Threads are blocked waiting for the consumer when the sniffer is destroyed
+    ParallelFileSniffer sniffer(write_file(make_file(2000)), 2);
+    sniffer.set_batch_size(16);
+    sniffer.sniff_loop([&](PDU&) {
+        return true;
+    }, 1);
+}
+
+TEST_F(ParallelFileSnifferTest, InvalidFile) {
+    const string file_name = write_file(buffer_type(24, 0xab));
+    EXPECT_THROW(ParallelFileSniffer sniffer(file_name), pcap_error);
+}
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <stdint.h>
+#include <pcap.h>
+#include <tins/pcap_file_reader.h>
+#include <tins/packet_view.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+#include <tins/endianness.h>
+#include <tins/exceptions.h>
+#include <tins/decoding_scope.h>
+#include "tests/pcap_file.h"
+
+using std::string;
+using std::vector;
+
+using namespace Tins;
+
+class PcapFileReaderTest : public PcapFileTest {
+public:
+    // Builds a file containing count packets. Packet i's timestamp is i
+    // seconds and i * 1000 microseconds (or nanoseconds)
+    static buffer_type make_file(size_t count, uint32_t magic = microsecond_magic,
+                                 bool swapped = false) {
+        buffer_type buffer;
+        append_header(buffer, magic, DLT_EN10MB, swapped);
+        for (size_t i = 0; i < count; ++i) {
+            append_record(buffer, make_packet(static_cast<uint16_t>(i)),
+                          static_cast<uint32_t>(i), static_cast<uint32_t>(i * 1000),
+                          swapped);
+        }
+        return buffer;
+    }
+
+    void check_packets(PcapFileReader& reader, size_t count, uint32_t microseconds_scale) {
+        for (size_t i = 0; i < count; ++i) {
+            Packet packet(reader.next_packet());
+            ASSERT_TRUE(packet);
+            EXPECT_EQ(i, packet.pdu()->rfind_pdu<UDP>().sport());
+            EXPECT_EQ(static_cast<long>(i), packet.timestamp().seconds());
+            EXPECT_EQ(static_cast<long>(i * microseconds_scale),
+                      packet.timestamp().microseconds());
+        }
+        EXPECT_FALSE(reader.next_packet());
+    }
+};
+
+TEST_F(PcapFileReaderTest, MicrosecondFile) {
+    PcapFileReader reader(write_file(make_file(10)));
+    EXPECT_EQ(DLT_EN10MB, reader.link_type());
+    EXPECT_EQ(65535U, reader.snap_len());
+    EXPECT_FALSE(reader.nanosecond_precision());
+    check_packets(reader, 10, 1000);
+}
+
+TEST_F(PcapFileReaderTest, NanosecondFile) {
+    PcapFileReader reader(write_file(make_file(10, nanosecond_magic)));
+    EXPECT_TRUE(reader.nanosecond_precision());
+    check_packets(reader, 10, 1);
+}
+
+TEST_F(PcapFileReaderTest, SwappedByteOrder) {
+    PcapFileReader reader(write_file(make_file(10, microsecond_magic, true)));
+    EXPECT_EQ(DLT_EN10MB, reader.link_type());
+    check_packets(reader, 10, 1000);
+}
+
+TEST_F(PcapFileReaderTest, RecordsAreReadInPlace) {
+    const buffer_type contents = make_file(3);
+    PcapFileReader reader(write_file(contents));
+    PcapFileReader::record first, second;
+    ASSERT_TRUE(reader.next_record(first));
+    ASSERT_TRUE(reader.next_record(second));
+    const buffer_type packet = make_packet(1);
+    EXPECT_EQ(packet.size(), second.size);
+    EXPECT_EQ(packet.size(), second.original_size);
+    EXPECT_EQ(packet, buffer_type(second.buffer, second.buffer + second.size));
+    // Records are consecutive in the mapped file
+    EXPECT_EQ(first.buffer + first.size + 16, second.buffer);
+    PacketView view(second.buffer, second.size);
+    EXPECT_TRUE(view.find_layer(PDU::UDP) != 0);
+}
+
+TEST_F(PcapFileReaderTest, Rewind) {
+    PcapFileReader reader(write_file(make_file(5)));
+    check_packets(reader, 5, 1000);
+    reader.rewind();
+    check_packets(reader, 5, 1000);
+}
+
+TEST_F(PcapFileReaderTest, SniffLoop) {
+    PcapFileReader reader(write_file(make_file(10)));
+    size_t count = 0;
+    reader.sniff_loop([&](const PDU& pdu) {
+        EXPECT_EQ(count, pdu.rfind_pdu<UDP>().sport());
+        ++count;
+        return true;
+    });
+    EXPECT_EQ(10U, count);
+    reader.rewind();
+    count = 0;
+    reader.sniff_loop([&](const PDU&) {
+        ++count;
+        return true;
+    }, 4);
+    EXPECT_EQ(4U, count);
+}
+
+TEST_F(PcapFileReaderTest, LazyPacketsOutliveNextPacket) {
+    PcapFileReader reader(write_file(make_file(3)));
+    reader.set_decoding_flags(DecodingScope::LAZY_INNER_PDUS | DecodingScope::BORROWED_PAYLOADS);
+    Packet first(reader.next_packet());
+    Packet second(reader.next_packet());
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    EXPECT_EQ(0, first.pdu()->rfind_pdu<UDP>().sport());
+    EXPECT_EQ(1, second.pdu()->rfind_pdu<UDP>().sport());
+}
+
+TEST_F(PcapFileReaderTest, ExtractRawPDUs) {
+    PcapFileReader reader(write_file(make_file(1)));
+    reader.set_extract_raw_pdus(true);
+    Packet packet(reader.next_packet());
+    ASSERT_TRUE(packet);
+    EXPECT_EQ(PDU::RAW, packet.pdu()->pdu_type());
+}
+
+TEST_F(PcapFileReaderTest, TruncatedRecordEndsFile) {
+    buffer_type contents = make_file(3);
+    contents.resize(contents.size() - 5);
+    PcapFileReader reader(write_file(contents));
+    PcapFileReader::record record;
+    EXPECT_TRUE(reader.next_record(record));
+    EXPECT_TRUE(reader.next_record(record));
+    EXPECT_FALSE(reader.next_record(record));
+    EXPECT_FALSE(reader.next_record(record));
+}
+
+TEST_F(PcapFileReaderTest, RawLinkType) {
+    buffer_type contents;
+    // LINKTYPE_RAW
+    append_header(contents, microsecond_magic, 101, false);
+    append_record(contents, IP("1.2.3.4", "5.6.7.8").serialize(), 0, 0, false);
+    PcapFileReader reader(write_file(contents));
+    EXPECT_EQ(DLT_RAW, reader.link_type());
+    Packet packet(reader.next_packet());
+    ASSERT_TRUE(packet);
+    EXPECT_EQ(PDU::IP, packet.pdu()->pdu_type());
+}
+
+TEST_F(PcapFileReaderTest, InvalidFiles) {
+    EXPECT_THROW(PcapFileReader("/tmp/libtins_pcap_reader_missing"), pcap_error);
+    const string empty_file = write_file(buffer_type());
+    EXPECT_THROW(PcapFileReader reader(empty_file), pcap_error);
+    buffer_type contents = make_file(1);
+    contents[0] = 0;
+    const string invalid_file = write_file(contents);
+    EXPECT_THROW(PcapFileReader reader(invalid_file), pcap_error);
+}
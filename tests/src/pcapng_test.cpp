@@ -0,0 +1,327 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/stat.h>
+#include <pcap.h>
+#include <tins/pcapng.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+#include <tins/exceptions.h>
+#include "tests/pcap_file.h"
+
+using std::string;
+using std::vector;
+
+using namespace Tins;
+
+class PcapngTest : public PcapFileTest {
+public:
+    static long file_size(const string& name) {
+        struct stat info;
+        if (stat(name.c_str(), &info) != 0) {
+            return -1;
+        }
+        return static_cast<long>(info.st_size);
+    }
+};
+
+TEST_F(PcapngTest, WriteAndReadRecords) {
+    const string name = make_file_name();
+    const buffer_type packet = make_packet(1);
+    {
+        PcapngWriter writer(name, "section comment");
+        PcapngInterface iface(DLT_EN10MB, 0, 9);
+        iface.name = "eth0";
+        iface.comment = "interface comment";
+        EXPECT_EQ(0U, writer.add_interface(iface));
+        PcapngRecord record(&packet[0], static_cast<uint32_t>(packet.size()), 0,
+                            1500000000123456789ULL);
+        record.original_size = 1500;
+        record.flags = 1;
+        record.comment = "packet comment";
+        writer.write(record);
+    }
+    PcapngReader reader(name);
+    EXPECT_EQ("section comment", reader.section_comment());
+    PcapngRecord record;
+    ASSERT_TRUE(reader.next_record(record));
+    ASSERT_EQ(1U, reader.interfaces().size());
+    const PcapngInterface& iface = reader.interfaces()[0];
+    EXPECT_EQ(DLT_EN10MB, iface.link_type);
+    EXPECT_EQ(0U, iface.snap_len);
+    EXPECT_EQ(9, iface.timestamp_resolution);
+    EXPECT_EQ("eth0", iface.name);
+    EXPECT_EQ("interface comment", iface.comment);
+
+    EXPECT_EQ(buffer_type(packet), buffer_type(record.buffer, record.buffer + record.size));
+    EXPECT_EQ(1500U, record.original_size);
+    EXPECT_EQ(0U, record.interface_id);
+    EXPECT_EQ(1500000000123456789ULL, record.nanoseconds);
+    EXPECT_EQ(1U, record.flags);
+    EXPECT_EQ("packet comment", record.comment);
+    EXPECT_EQ(1500000000, record.timestamp().seconds());
+    EXPECT_EQ(123456, record.timestamp().microseconds());
+    EXPECT_FALSE(reader.next_record(record));
+}
+
+TEST_F(PcapngTest, MultipleInterfaces) {
+    const string name = make_file_name();
+    {
+        PcapngWriter writer(name);
+        EXPECT_EQ(0U, writer.add_interface(DataLinkType<EthernetII>()));
+        EXPECT_EQ(1U, writer.add_interface(PcapngInterface(DLT_RAW)));
+        for (uint16_t i = 0; i < 10; ++i) {
+            EthernetII eth = EthernetII() / IP("1.2.3.4", "5.6.7.8") / UDP(53, i);
+            if (i % 2 == 0) {
+                writer.write(0, eth);
+            }
+            else {
+                writer.write(1, eth.rfind_pdu<IP>());
+            }
+        }
+    }
+    PcapngReader reader(name);
+    for (uint16_t i = 0; i < 10; ++i) {
+        Packet packet(reader.next_packet());
+        ASSERT_TRUE(packet);
+        EXPECT_EQ(i % 2 == 0 ? PDU::ETHERNET_II : PDU::IP, packet.pdu()->pdu_type());
+        EXPECT_EQ(i, packet.pdu()->rfind_pdu<UDP>().sport());
+    }
+    Packet last(reader.next_packet());
+    EXPECT_FALSE(last);
+    ASSERT_EQ(2U, reader.interfaces().size());
+    EXPECT_EQ(DLT_EN10MB, reader.interfaces()[0].link_type);
+    EXPECT_EQ(DLT_RAW, reader.interfaces()[1].link_type);
+}
+
+TEST_F(PcapngTest, TimestampResolutions) {
+    const string name = make_file_name();
+    const buffer_type packet = make_packet(1);
+    {
+        PcapngWriter writer(name);
+        // Microseconds, nanoseconds and 2^-20 seconds
+        writer.add_interface(PcapngInterface(DLT_EN10MB, 0, 6));
+        writer.add_interface(PcapngInterface(DLT_EN10MB, 0, 9));
+        writer.add_interface(PcapngInterface(DLT_EN10MB, 0, 0x80 | 20));
+        for (uint32_t i = 0; i < 3; ++i) {
+            writer.write(PcapngRecord(&packet[0], static_cast<uint32_t>(packet.size()), i,
+                                      1500000000123456789ULL));
+        }
+    }
+    PcapngReader reader(name);
+    PcapngRecord record;
+    ASSERT_TRUE(reader.next_record(record));
+    EXPECT_EQ(1500000000123456000ULL, record.nanoseconds);
+    ASSERT_TRUE(reader.next_record(record));
+    EXPECT_EQ(1500000000123456789ULL, record.nanoseconds);
+    ASSERT_TRUE(reader.next_record(record));
+    // 2^-20 seconds is slightly less than a microsecond
+    EXPECT_NEAR(1500000000123456789.0, static_cast<double>(record.nanoseconds), 1000.0);
+    EXPECT_EQ(1500000000, record.timestamp().seconds());
+    EXPECT_FALSE(reader.next_record(record));
+}
+
+TEST_F(PcapngTest, PacketTimestamp) {
+    const string name = make_file_name();
+    {
+        PcapngWriter writer(name);
+        writer.add_interface(DataLinkType<EthernetII>());
+        EthernetII eth = EthernetII() / IP("1.2.3.4", "5.6.7.8") / UDP(53, 1);
+        struct timeval tv;
+        tv.tv_sec = 1234;
+        tv.tv_usec = 5678;
+        Packet packet(eth, tv);
+        writer.write(0, packet);
+    }
+    PcapngReader reader(name);
+    Packet packet(reader.next_packet());
+    ASSERT_TRUE(packet);
+    EXPECT_EQ(1234, packet.timestamp().seconds());
+    EXPECT_EQ(5678, packet.timestamp().microseconds());
+}
+
+TEST_F(PcapngTest, SnapshotLength) {
+    const string name = make_file_name();
+    const buffer_type packet = make_packet(1);
+    {
+        PcapngWriter writer(name);
+        writer.add_interface(PcapngInterface(DLT_EN10MB, 20));
+        writer.write(PcapngRecord(&packet[0], static_cast<uint32_t>(packet.size()), 0, 0));
+        writer.write_simple(&packet[0], static_cast<uint32_t>(packet.size()));
+    }
+    PcapngReader reader(name);
+    PcapngRecord record;
+    for (size_t i = 0; i < 2; ++i) {
+        ASSERT_TRUE(reader.next_record(record));
+        EXPECT_EQ(20U, record.size);
+        EXPECT_EQ(packet.size(), record.original_size);
+        EXPECT_EQ(buffer_type(packet.begin(), packet.begin() + 20),
+                  buffer_type(record.buffer, record.buffer + record.size));
+    }
+    EXPECT_FALSE(reader.next_record(record));
+}
+
+TEST_F(PcapngTest, SimplePackets) {
+    const string name = make_file_name();
+    {
+        PcapngWriter writer(name);
+        writer.add_interface(DataLinkType<EthernetII>());
+        for (uint16_t i = 0; i < 5; ++i) {
+            const buffer_type packet = make_packet(i);
+            writer.write_simple(&packet[0], static_cast<uint32_t>(packet.size()));
+        }
+    }
+    PcapngReader reader(name);
+    uint16_t count = 0;
+    reader.sniff_loop([&](PDU& pdu) {
+        EXPECT_EQ(count++, pdu.rfind_pdu<UDP>().sport());
+        return true;
+    });
+    EXPECT_EQ(5, count);
+}
+
+TEST_F(PcapngTest, SniffLoopMaxPackets) {
+    const string name = make_file_name();
+    {
+        PcapngWriter writer(name);
+        writer.add_interface(DataLinkType<EthernetII>());
+        for (uint16_t i = 0; i < 10; ++i) {
+            const buffer_type packet = make_packet(i);
+            writer.write(PcapngRecord(&packet[0], static_cast<uint32_t>(packet.size()), 0, i));
+        }
+    }
+    PcapngReader reader(name);
+    size_t count = 0;
+    reader.sniff_loop([&](Packet&) {
+        ++count;
+        return true;
+    }, 4);
+    EXPECT_EQ(4U, count);
+}
+
+TEST_F(PcapngTest, ExtractRawPDUs) {
+    const string name = make_file_name();
+    const buffer_type packet = make_packet(1);
+    {
+        PcapngWriter writer(name);
+        writer.add_interface(DataLinkType<EthernetII>());
+        writer.write(PcapngRecord(&packet[0], static_cast<uint32_t>(packet.size()), 0, 0));
+    }
+    PcapngReader reader(name);
+    reader.set_extract_raw_pdus(true);
+    Packet output(reader.next_packet());
+    ASSERT_TRUE(output);
+    EXPECT_EQ(PDU::RAW, output.pdu()->pdu_type());
+    EXPECT_EQ(packet, output.pdu()->serialize());
+}
+
+TEST_F(PcapngTest, UnknownInterface) {
+    const string name = make_file_name();
+    PcapngWriter writer(name);
+    const uint8_t data[4] = { 0 };
+    EXPECT_THROW(writer.write(PcapngRecord(data, sizeof(data), 0, 0)), invalid_interface);
+    EXPECT_THROW(writer.write_simple(data, sizeof(data)), invalid_interface);
+    writer.add_interface(DataLinkType<EthernetII>());
+    EXPECT_THROW(writer.write(PcapngRecord(data, sizeof(data), 1, 0)), invalid_interface);
+}
+
+TEST_F(PcapngTest, Buffering) {
+    const string name = make_file_name();
+    const buffer_type packet = make_packet(1);
+    PcapngWriter writer(name, "", 256);
+    writer.add_interface(DataLinkType<EthernetII>());
+    // The section header and interface blocks fit in the buffer
+    EXPECT_EQ(0, file_size(name));
+    for (size_t i = 0; i < 4; ++i) {
+        writer.write(PcapngRecord(&packet[0], static_cast<uint32_t>(packet.size()), 0, 0));
+    }
+    const long flushed_size = file_size(name);
+    EXPECT_GT(flushed_size, 0);
+    writer.write(PcapngRecord(&packet[0], static_cast<uint32_t>(packet.size()), 0, 0));
+    writer.flush();
+    EXPECT_GT(file_size(name), flushed_size);
+
+    PcapngReader reader(name);
+    size_t count = 0;
+    while (Packet(reader.next_packet())) {
+        ++count;
+    }
+    EXPECT_EQ(5U, count);
+}
+
+TEST_F(PcapngTest, SwappedByteOrder) {
+    const buffer_type packet = make_packet(7);
+    buffer_type buffer;
+    // Section header block
+    append(buffer, 0x0a0d0d0a, true);
+    append(buffer, 28, true);
+    append(buffer, 0x1a2b3c4d, true);
+    // Version 1.0
+    append(buffer, 1 << 16, true);
+    append(buffer, 0xffffffff, true);
+    append(buffer, 0xffffffff, true);
+    append(buffer, 28, true);
+    // Interface description block, using the default resolution
+    append(buffer, 1, true);
+    append(buffer, 20, true);
+    append(buffer, DLT_EN10MB << 16, true);
+    append(buffer, 0, true);
+    append(buffer, 20, true);
+    // An unknown block, which is skipped
+    append(buffer, 0x1234, true);
+    append(buffer, 16, true);
+    append(buffer, 0, true);
+    append(buffer, 16, true);
+    // Enhanced packet block
+    const uint32_t padded_size = (packet.size() + 3) & ~3U;
+    append(buffer, 6, true);
+    append(buffer, 32 + padded_size, true);
+    append(buffer, 0, true);
+    append(buffer, 0, true);
+    append(buffer, 3000005, true);
+    append(buffer, static_cast<uint32_t>(packet.size()), true);
+    append(buffer, static_cast<uint32_t>(packet.size()), true);
+    buffer.insert(buffer.end(), packet.begin(), packet.end());
+    buffer.resize(buffer.size() + padded_size - packet.size());
+    append(buffer, 32 + padded_size, true);
+
+    PcapngReader reader(write_file(buffer));
+    Packet output(reader.next_packet());
+    ASSERT_TRUE(output);
+    EXPECT_EQ(7, output.pdu()->rfind_pdu<UDP>().sport());
+    EXPECT_EQ(3, output.timestamp().seconds());
+    EXPECT_EQ(5, output.timestamp().microseconds());
+    ASSERT_EQ(1U, reader.interfaces().size());
+    EXPECT_EQ(6, reader.interfaces()[0].timestamp_resolution);
+    Packet last(reader.next_packet());
+    EXPECT_FALSE(last);
+}
+
+TEST_F(PcapngTest, TruncatedFile) {
+    const string name = make_file_name();
+    const buffer_type packet = make_packet(1);
+    {
+        PcapngWriter writer(name);
+        writer.add_interface(DataLinkType<EthernetII>());
+        writer.write(PcapngRecord(&packet[0], static_cast<uint32_t>(packet.size()), 0, 0));
+        writer.write(PcapngRecord(&packet[0], static_cast<uint32_t>(packet.size()), 0, 0));
+    }
+    ASSERT_EQ(0, truncate(name.c_str(), file_size(name) - 10));
+    PcapngReader reader(name);
+    Packet first(reader.next_packet());
+    EXPECT_TRUE(first);
+    Packet second(reader.next_packet());
+    EXPECT_FALSE(second);
+}
+
+TEST_F(PcapngTest, InvalidFile) {
+    const string empty_file = write_file(buffer_type());
+    EXPECT_THROW(PcapngReader reader(empty_file), pcap_error);
+    const string invalid_file = write_file(buffer_type(64, 0xab));
+    EXPECT_THROW(PcapngReader reader(invalid_file), pcap_error);
+    EXPECT_THROW(PcapngReader reader("/non/existent/file.pcapng"), pcap_error);
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <algorithm>
+#include <new>
 #include <string>
 #include <stdint.h>
 #include <tins/ip.h>
@@ -8,6 +9,13 @@
 #include <tins/rawpdu.h>
 #include <tins/pdu.h>
 #include <tins/packet.h>
+#include <tins/ethernetII.h>
+#include <tins/decoding_scope.h>
+#if TINS_IS_CXX11
+    #include <thread>
+    #include <future>
+    #include <vector>
+#endif // TINS_IS_CXX11
 
 using namespace std;
 using namespace Tins;
@@ -83,7 +91,146 @@ TEST_F(PDUTest, OperatorConcatOnPacket) {
     EXPECT_TRUE(std::equal(raw->payload().begin(), raw->payload().end(), raw_payload.begin()));
 }
 
+TEST_F(PDUTest, PacketCopiesShareThePDU) {
+    Packet packet = IP("192.168.0.1") / TCP(22, 52);
+    EXPECT_FALSE(packet.is_shared());
+    Packet copy = packet;
+    const Packet& const_packet = packet;
+    const Packet& const_copy = copy;
+    EXPECT_TRUE(packet.is_shared());
+    EXPECT_TRUE(copy.is_shared());
+    EXPECT_EQ(const_packet.pdu(), const_copy.pdu());
+
+    Packet other;
+    other = copy;
+    EXPECT_EQ(const_packet.pdu(), static_cast<const Packet&>(other).pdu());
+}
+
+TEST_F(PDUTest, PacketDetachesOnMutation) {
+    Packet packet = IP("192.168.0.1") / TCP(22, 52);
+    Packet copy = packet;
+    const PDU* shared = static_cast<const Packet&>(packet).pdu();
+    copy.pdu()->rfind_pdu<TCP>().dport(80);
+    EXPECT_NE(shared, static_cast<const Packet&>(copy).pdu());
+    EXPECT_FALSE(packet.is_shared());
+    EXPECT_FALSE(copy.is_shared());
+    EXPECT_EQ(22, packet.pdu()->rfind_pdu<TCP>().dport());
+    EXPECT_EQ(80, copy.pdu()->rfind_pdu<TCP>().dport());
+    // The original packet got back exclusive ownership, so it keeps its PDU
+    EXPECT_EQ(shared, packet.pdu());
+}
+
+TEST_F(PDUTest, PacketReleaseSharedPDU) {
+    Packet packet = IP("192.168.0.1") / TCP(22, 52);
+    Packet copy = packet;
+    PDU* released = copy.release_pdu();
+    ASSERT_TRUE(released != 0);
+    EXPECT_TRUE(copy.pdu() == 0);
+    EXPECT_NE(static_cast<const Packet&>(packet).pdu(), released);
+    EXPECT_FALSE(packet.is_shared());
+    EXPECT_EQ(packet.pdu()->size(), released->size());
+    delete released;
+}
+
+TEST_F(PDUTest, PacketSharingDecodesLazyLayers) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4") / TCP(22, 52) / RawPDU("Test");
+    PDU::serialization_type buffer = eth.serialize();
+    PDU* decoded;
+    {
+        DecodingScope scope(DecodingScope::LAZY_INNER_PDUS | 
+                            DecodingScope::BORROWED_PAYLOADS);
+        decoded = new EthernetII(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    }
+    Packet packet(decoded, Timestamp(), Packet::own_pdu());
+    Packet copy = packet;
+    // Nothing may point into the original buffer anymore
+    std::fill(buffer.begin(), buffer.end(), 0);
+    const Packet& const_copy = copy;
+    const RawPDU* raw = const_copy.pdu()->find_pdu<RawPDU>();
+    ASSERT_TRUE(raw != 0);
+    EXPECT_FALSE(raw->is_borrowed());
+    const std::string expected_payload = "Test";
+    ASSERT_EQ(expected_payload.size(), raw->payload_size());
+    EXPECT_TRUE(std::equal(expected_payload.begin(), expected_payload.end(),
+                           raw->payload().begin()));
+    EXPECT_EQ(22, const_copy.pdu()->find_pdu<TCP>()->dport());
+}
+
 #if TINS_IS_CXX11
+TEST_F(PDUTest, PacketCopiesOnSeveralThreads) {
+    Packet packet = IP("192.168.0.1") / TCP(22, 52) / RawPDU("Test");
+    const uint32_t expected_size = packet.pdu()->size();
+    vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        Packet copy = packet;
+        threads.push_back(std::thread([copy, expected_size]() {
+            for (int j = 0; j < 1000; ++j) {
+                const Packet inner_copy = copy;
+                EXPECT_EQ(expected_size, inner_copy.pdu()->size());
+            }
+        }));
+    }
+    packet = Packet();
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+}
+
+TEST_F(PDUTest, SharedPacketLookupsOnSeveralThreads) {
+    Packet packet = EthernetII() / IP("192.168.0.1") / TCP(22, 52) / RawPDU("Test");
+    Packet copy = packet;
+    vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.push_back(std::thread([&copy]() {
+            const Packet& const_copy = copy;
+            for (int j = 0; j < 1000; ++j) {
+                EXPECT_EQ(22, const_copy.pdu()->rfind_pdu<TCP>().dport());
+                EXPECT_TRUE(const_copy.pdu()->find_pdu<UDP>() == 0);
+            }
+        }));
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+}
+
+TEST_F(PDUTest, SharedPacketLazyOptionsOnSeveralThreads) {
+    TCP tcp(22, 52);
+    for (int i = 0; i < 4; ++i) {
+        tcp.add_option(TCP::option(TCP::NOP));
+    }
+    tcp.mss(1460);
+    tcp.winscale(7);
+    tcp.sack_permitted();
+    tcp.timestamp(1, 2);
+    EthernetII eth = EthernetII() / IP("192.168.0.1") / tcp;
+    PDU::serialization_type buffer = eth.serialize();
+    PDU* decoded;
+    {
+        DecodingScope scope(DecodingScope::LAZY_OPTIONS);
+        decoded = new EthernetII(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    }
+    Packet packet(decoded, Timestamp(), Packet::own_pdu());
+    Packet copy = packet;
+    // Options must have been parsed before the packet was shared
+    std::fill(buffer.begin(), buffer.end(), 0);
+    vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.push_back(std::thread([&copy]() {
+            const Packet& const_copy = copy;
+            for (int j = 0; j < 1000; ++j) {
+                const TCP& shared_tcp = const_copy.pdu()->rfind_pdu<TCP>();
+                EXPECT_EQ(1460, shared_tcp.mss());
+                EXPECT_EQ(7, shared_tcp.winscale());
+                EXPECT_TRUE(shared_tcp.search_option(TCP::ALTCHK) == 0);
+            }
+        }));
+    }
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+}
+
 TEST_F(PDUTest, MoveAssignment) {
     IP packet = IP("192.168.0.1") / TCP(22, 52);
     packet = IP("1.2.3.4");
@@ -102,3 +249,248 @@ TEST_F(PDUTest, TinsCast) {
     EXPECT_THROW(tins_cast<UDP>(*pdu), bad_tins_cast);
 }
 
+
+#ifdef TINS_HAVE_PDU_POOL
+TEST_F(PDUTest, PoolReusesReleasedMemory) {
+    Internals::PDUPool::trim();
+    EXPECT_EQ(0U, Internals::PDUPool::cached_bytes());
+    IP* first = new IP("1.2.3.4");
+    *first /= TCP(22, 52);
+    delete first;
+    EXPECT_GE(Internals::PDUPool::cached_bytes(), sizeof(IP) + sizeof(TCP));
+
+    IP* second = new IP("1.2.3.4");
+    EXPECT_EQ(first, second);
+    delete second;
+    Internals::PDUPool::trim();
+    EXPECT_EQ(0U, Internals::PDUPool::cached_bytes());
+}
+
+TEST_F(PDUTest, PoolReleaseOnAnotherThread) {
+    IP* pdu = new IP("1.2.3.4");
+    *pdu /= TCP(22, 52);
+    *pdu /= RawPDU("Test");
+    std::thread thread([&]() {
+        delete pdu;
+        // The blocks are given back to the thread that allocated them
+        EXPECT_EQ(0U, Internals::PDUPool::cached_bytes());
+    });
+    thread.join();
+
+    IP ip = IP("192.168.0.1") / TCP(22, 52);
+    PDU* clone = ip.clone();
+    EXPECT_EQ(ip.size(), clone->size());
+    delete clone;
+}
+
+TEST_F(PDUTest, PoolReturnsBlocksToAllocatingThread) {
+    const size_t block_count = 32;
+    std::vector<void*> first(block_count);
+    std::vector<void*> second(block_count);
+    std::promise<void> allocated;
+    std::promise<void> released;
+    std::thread thread([&]() {
+        for (size_t i = 0; i < block_count; ++i) {
+            first[i] = Internals::PDUPool::allocate(64);
+        }
+        allocated.set_value();
+        released.get_future().wait();
+        // Every block comes from the ones released by the other thread
+        for (size_t i = 0; i < block_count; ++i) {
+            second[i] = Internals::PDUPool::allocate(64);
+        }
+        for (size_t i = 0; i < block_count; ++i) {
+            Internals::PDUPool::deallocate(second[i]);
+        }
+    });
+    allocated.get_future().wait();
+    const size_t cached = Internals::PDUPool::cached_bytes();
+    for (size_t i = 0; i < block_count; ++i) {
+        Internals::PDUPool::deallocate(first[i]);
+    }
+    // Nothing is kept by the releasing thread
+    EXPECT_EQ(cached, Internals::PDUPool::cached_bytes());
+    released.set_value();
+    thread.join();
+
+    std::sort(first.begin(), first.end());
+    std::sort(second.begin(), second.end());
+    EXPECT_TRUE(first == second);
+}
+#endif // TINS_HAVE_PDU_POOL
+
+TEST_F(PDUTest, NothrowNew) {
+    IP* ip = new (std::nothrow) IP("1.2.3.4");
+    ASSERT_TRUE(ip != 0);
+    EXPECT_EQ(IPv4Address("1.2.3.4"), ip->dst_addr());
+    delete ip;
+}
+
+TEST_F(PDUTest, LazyDecodingDefersInnerPDUs) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4") / TCP(22, 52) / RawPDU("Test");
+    PDU::serialization_type buffer = eth.serialize();
+    PDU* pdu = 0;
+    {
+        DecodingScope scope(DecodingScope::LAZY_INNER_PDUS);
+        pdu = new EthernetII(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    }
+    EXPECT_EQ(IP("1.2.3.4").dst_addr(), pdu->rfind_pdu<IP>().dst_addr());
+    // The TCP header is still undecoded, so modifying the buffer is visible
+    buffer[14 + 20 + 2] = 0;
+    buffer[14 + 20 + 3] = 80;
+    EXPECT_EQ(80, pdu->rfind_pdu<TCP>().dport());
+    const RawPDU& raw = pdu->rfind_pdu<RawPDU>();
+    ASSERT_LE(4U, raw.payload_size());
+    EXPECT_EQ("Test", string(raw.payload().begin(), raw.payload().begin() + 4));
+    delete pdu;
+}
+
+TEST_F(PDUTest, LazyDecodingEagerByDefault) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4") / TCP(22, 52);
+    PDU::serialization_type buffer = eth.serialize();
+    EthernetII decoded(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    buffer[14 + 20 + 3] = 80;
+    EXPECT_EQ(22, decoded.rfind_pdu<TCP>().dport());
+}
+
+TEST_F(PDUTest, LazyDecodingCloneDecodesEveryLayer) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4") / TCP(22, 52) / RawPDU("Test");
+    PDU::serialization_type buffer = eth.serialize();
+    PDU* cloned = 0;
+    {
+        DecodingScope scope(DecodingScope::LAZY_INNER_PDUS);
+        EthernetII decoded(&buffer[0], static_cast<uint32_t>(buffer.size()));
+        cloned = decoded.clone();
+        EXPECT_EQ(buffer, decoded.serialize());
+    }
+    fill(buffer.begin(), buffer.end(), 0);
+    EXPECT_EQ(22, cloned->rfind_pdu<TCP>().dport());
+    EXPECT_EQ(eth.serialize(), cloned->serialize());
+    delete cloned;
+}
+
+TEST_F(PDUTest, LazyDecodingMalformedInnerPDU) {
+    IP ip = IP("1.2.3.4") / TCP(22, 52);
+    PDU::serialization_type buffer = ip.serialize();
+    // Set a data offset larger than the segment
+    buffer[20 + 12] = 0xf0;
+    EXPECT_THROW(IP(&buffer[0], static_cast<uint32_t>(buffer.size())), malformed_packet);
+
+    DecodingScope scope(DecodingScope::LAZY_INNER_PDUS);
+    IP decoded(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_TRUE(decoded.find_pdu<TCP>() == 0);
+    const RawPDU* raw = decoded.find_pdu<RawPDU>();
+    ASSERT_TRUE(raw != 0);
+    EXPECT_EQ(20U, raw->payload_size());
+}
+
+TEST_F(PDUTest, MalformedInnerPDUsAsRaw) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4") / TCP(22, 52) / RawPDU("payload");
+    PDU::serialization_type buffer = eth.serialize();
+    // Truncated in the middle of the TCP header
+    const uint32_t truncated_size = 14 + 20 + 10;
+    EXPECT_THROW(EthernetII(&buffer[0], truncated_size), malformed_packet);
+
+    DecodingScope scope(DecodingScope::MALFORMED_INNER_PDUS_AS_RAW);
+    EthernetII truncated(&buffer[0], truncated_size);
+    EXPECT_TRUE(truncated.find_pdu<IP>() != 0);
+    EXPECT_TRUE(truncated.find_pdu<TCP>() == 0);
+    const RawPDU* raw = truncated.find_pdu<RawPDU>();
+    ASSERT_TRUE(raw != 0);
+    EXPECT_EQ(10U, raw->payload_size());
+    EXPECT_EQ(1U, scope.malformed_layers());
+
+    // A data offset larger than the segment
+    buffer[14 + 20 + 12] = 0xf0;
+    EthernetII bad_offset(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_TRUE(bad_offset.find_pdu<TCP>() == 0);
+    EXPECT_TRUE(bad_offset.find_pdu<RawPDU>() != 0);
+    EXPECT_EQ(2U, scope.malformed_layers());
+
+    // Well formed packets are decoded as usual
+    const PDU::serialization_type valid_buffer = eth.serialize();
+    EthernetII valid(&valid_buffer[0], static_cast<uint32_t>(valid_buffer.size()));
+    EXPECT_TRUE(valid.find_pdu<TCP>() != 0);
+    EXPECT_EQ(2U, scope.malformed_layers());
+}
+
+TEST_F(PDUTest, MalformedInnerPDUsAsRawCountsNestedScopes) {
+    const PDU::serialization_type buffer = (IP("1.2.3.4") / UDP(1, 2)).serialize();
+    DecodingScope outer(DecodingScope::MALFORMED_INNER_PDUS_AS_RAW);
+    {
+        DecodingScope inner(DecodingScope::MALFORMED_INNER_PDUS_AS_RAW |
+                            DecodingScope::LAZY_INNER_PDUS);
+        IP ip(&buffer[0], 20 + 4);
+        EXPECT_TRUE(ip.find_pdu<UDP>() == 0);
+        EXPECT_EQ(1U, inner.malformed_layers());
+    }
+    EXPECT_EQ(1U, outer.malformed_layers());
+}
+
+TEST_F(PDUTest, FindPDUAfterChangingChain) {
+    IP ip = IP("1.2.3.4") / TCP(22, 52);
+    EXPECT_TRUE(ip.find_pdu<TCP>() != 0);
+    EXPECT_TRUE(ip.find_pdu<RawPDU>() == 0);
+
+    ip.rfind_pdu<TCP>() /= RawPDU("Test");
+    EXPECT_TRUE(ip.find_pdu<RawPDU>() != 0);
+
+    delete ip.release_inner_pdu();
+    EXPECT_TRUE(ip.find_pdu<TCP>() == 0);
+    EXPECT_TRUE(ip.find_pdu<RawPDU>() == 0);
+
+    ip.inner_pdu(UDP(53, 1000));
+    EXPECT_EQ(ip.inner_pdu(), ip.find_pdu<UDP>());
+    EXPECT_TRUE(ip.find_pdu<TCP>() == 0);
+}
+
+TEST_F(PDUTest, FindPDUReturnsOutermostLayer) {
+    IP ip = IP("1.2.3.4") / IP("5.6.7.8") / UDP(53, 1000);
+    EXPECT_EQ(&ip, ip.find_pdu<IP>());
+    IP* inner = static_cast<IP*>(ip.inner_pdu());
+    EXPECT_EQ(inner, inner->find_pdu<IP>());
+    EXPECT_EQ(inner->inner_pdu(), ip.find_pdu<UDP>());
+
+    const IP& const_ip = ip;
+    EXPECT_EQ(&ip, const_ip.find_pdu<IP>());
+    EXPECT_EQ(inner->inner_pdu(), const_ip.find_pdu<UDP>());
+}
+
+TEST_F(PDUTest, FindPDUOnLazyPacket) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4") / TCP(22, 52) / RawPDU("Test");
+    PDU::serialization_type buffer = eth.serialize();
+    DecodingScope scope(DecodingScope::LAZY_INNER_PDUS);
+    EthernetII decoded(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_TRUE(decoded.find_pdu<EthernetII>() != 0);
+    EXPECT_TRUE(decoded.find_pdu<UDP>() == 0);
+    TCP* tcp = decoded.find_pdu<TCP>();
+    ASSERT_TRUE(tcp != 0);
+    EXPECT_EQ(22, tcp->dport());
+    EXPECT_EQ(tcp, decoded.find_pdu<TCP>());
+    EXPECT_EQ(tcp->inner_pdu(), decoded.find_pdu<RawPDU>());
+}
+
+TEST_F(PDUTest, SerializeIntoReusedBuffer) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4") / TCP(22, 52) / RawPDU("Test");
+    const PDU::serialization_type expected = eth.serialize();
+
+    // Stale contents must be overwritten and a larger buffer kept as is
+    PDU::serialization_type buffer(expected.size() + 10, 0xaa);
+    EXPECT_EQ(expected.size(), eth.serialize(buffer));
+    EXPECT_EQ(expected.size() + 10, buffer.size());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), buffer.begin()));
+
+    PDU::serialization_type small_buffer;
+    EXPECT_EQ(expected.size(), eth.serialize(small_buffer));
+    EXPECT_EQ(expected, small_buffer);
+}
+
+TEST_F(PDUTest, SerializeIntoRawBuffer) {
+    EthernetII eth = EthernetII() / IP("1.2.3.4") / TCP(22, 52) / RawPDU("Test");
+    const PDU::serialization_type expected = eth.serialize();
+    uint8_t buffer[128];
+    const uint32_t sz = eth.serialize_into(buffer, sizeof(buffer));
+    ASSERT_EQ(expected.size(), sz);
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), buffer));
+    EXPECT_THROW(eth.serialize_into(buffer, sz - 1), serialization_error);
+}
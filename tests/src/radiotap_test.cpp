@@ -14,6 +14,8 @@
 #include <tins/utils.h>
 #include <tins/utils/radiotap_parser.h>
 #include <tins/utils/radiotap_writer.h>
+#include <tins/rawpdu.h>
+#include <tins/decoding_scope.h>
 
 using namespace std;
 using namespace Tins;
@@ -759,4 +761,21 @@ TEST_F(RadioTapTest, RadioTapWritingEmptyBuffer) {
 
 }
 
+TEST_F(RadioTapTest, MalformedDot11AsRaw) {
+    RadioTap radio = RadioTap() / Dot11Data();
+    PDU::serialization_type buffer = radio.serialize();
+    // Truncated in the middle of the 802.11 header
+    const uint32_t truncated_size = radio.header_size() + 10;
+    EXPECT_THROW(RadioTap(&buffer[0], truncated_size), malformed_packet);
+
+    DecodingScope scope(DecodingScope::MALFORMED_INNER_PDUS_AS_RAW);
+    RadioTap truncated(&buffer[0], truncated_size);
+    EXPECT_TRUE(truncated.find_pdu<Dot11>() == 0);
+    const RawPDU* raw = truncated.find_pdu<RawPDU>();
+    ASSERT_TRUE(raw != 0);
+    // The default flags indicate there's an FCS, which isn't part of the payload
+    EXPECT_EQ(10U - sizeof(uint32_t), raw->payload_size());
+    EXPECT_EQ(1U, scope.malformed_layers());
+}
+
 #endif // TINS_HAVE_DOT11
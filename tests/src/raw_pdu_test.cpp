@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 #include <tins/rawpdu.h>
+#include <tins/tcp.h>
+#include <tins/decoding_scope.h>
 
 using namespace Tins;
 
@@ -18,4 +20,63 @@ TEST_F(RawPDUTest, ConstructFromPayloadType) {
     // The payload should have been copied
     payload.push_back(0x03);
     EXPECT_NE(payload, raw.payload());
-}
\ No newline at end of file
+}
+TEST_F(RawPDUTest, BorrowedPayload) {
+    uint8_t buffer[] = { 1, 2, 3, 4 };
+    DecodingScope scope(DecodingScope::BORROWED_PAYLOADS);
+    RawPDU raw(buffer, sizeof(buffer));
+    EXPECT_TRUE(raw.is_borrowed());
+    EXPECT_EQ(buffer, raw.payload_data());
+    EXPECT_EQ(sizeof(buffer), raw.payload_size());
+    EXPECT_EQ(sizeof(buffer), raw.size());
+
+    buffer[0] = 5;
+    EXPECT_EQ(5, raw.payload_data()[0]);
+    EXPECT_EQ(RawPDU::payload_type(buffer, buffer + sizeof(buffer)), raw.serialize());
+}
+
+TEST_F(RawPDUTest, BorrowedPayloadMaterialize) {
+    uint8_t buffer[] = { 1, 2, 3, 4 };
+    DecodingScope scope(DecodingScope::BORROWED_PAYLOADS);
+    RawPDU raw(buffer, sizeof(buffer));
+    raw.materialize();
+    EXPECT_FALSE(raw.is_borrowed());
+    buffer[0] = 5;
+    EXPECT_EQ(RawPDU::payload_type(buffer + 1, buffer + sizeof(buffer)),
+              RawPDU::payload_type(raw.payload().begin() + 1, raw.payload().end()));
+    EXPECT_EQ(1, raw.payload()[0]);
+}
+
+TEST_F(RawPDUTest, BorrowedPayloadGetterMaterializes) {
+    uint8_t buffer[] = { 1, 2, 3, 4 };
+    DecodingScope scope(DecodingScope::BORROWED_PAYLOADS);
+    const RawPDU raw(buffer, sizeof(buffer));
+    EXPECT_EQ(RawPDU::payload_type(buffer, buffer + sizeof(buffer)), raw.payload());
+    EXPECT_FALSE(raw.is_borrowed());
+}
+
+TEST_F(RawPDUTest, BorrowedPayloadCopyOwnsPayload) {
+    uint8_t buffer[] = { 1, 2, 3, 4 };
+    DecodingScope scope(DecodingScope::BORROWED_PAYLOADS);
+    RawPDU raw(buffer, sizeof(buffer));
+    RawPDU copied(raw);
+    RawPDU* cloned = raw.clone();
+    EXPECT_FALSE(copied.is_borrowed());
+    EXPECT_FALSE(cloned->is_borrowed());
+    EXPECT_TRUE(raw.is_borrowed());
+    buffer[0] = 5;
+    EXPECT_EQ(1, copied.payload()[0]);
+    EXPECT_EQ(1, cloned->payload()[0]);
+    delete cloned;
+}
+
+TEST_F(RawPDUTest, BorrowedPayloadInsideTCP) {
+    TCP tcp = TCP(22, 52) / RawPDU("Test");
+    PDU::serialization_type buffer = tcp.serialize();
+    DecodingScope scope(DecodingScope::BORROWED_PAYLOADS);
+    TCP decoded(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    const RawPDU& raw = decoded.rfind_pdu<RawPDU>();
+    EXPECT_TRUE(raw.is_borrowed());
+    EXPECT_EQ(&buffer[20], raw.payload_data());
+    EXPECT_EQ(buffer, decoded.serialize());
+}
@@ -0,0 +1,383 @@
+#include <gtest/gtest.h>
+#include <set>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <tins/ring_sniffer.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+
+using std::set;
+using std::map;
+using std::mutex;
+using std::lock_guard;
+using std::string;
+
+using namespace Tins;
+
+class RingSnifferTest : public testing::Test {
+public:
+    static const char* payload_prefix;
+
+    RingSnifferTest()
+    : receiver_(-1), port_(0) {
+
+    }
+
+    void SetUp() {
+        // Capturing requires CAP_NET_RAW
+        int fd = socket(AF_PACKET, SOCK_RAW, 0);
+        if (fd < 0) {
+            GTEST_SKIP() << "AF_PACKET sockets can't be opened: " << strerror(errno);
+        }
+        close(fd);
+        // Keep a socket bound to the destination port so it's not reused
+        receiver_ = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_GE(receiver_, 0);
+        sockaddr_in address = loopback_address(0);
+        ASSERT_EQ(0, bind(receiver_, (const sockaddr*)&address, sizeof(address)));
+        socklen_t length = sizeof(address);
+        ASSERT_EQ(0, getsockname(receiver_, (sockaddr*)&address, &length));
+        port_ = ntohs(address.sin_port);
+    }
+
+    void TearDown() {
+        if (receiver_ >= 0) {
+            close(receiver_);
+        }
+    }
+
+    static sockaddr_in loopback_address(uint16_t port) {
+        sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        return address;
+    }
+
+    // Sends count datagrams to the test's port, each one from a different
+    // socket so they belong to different flows
+    void send_datagrams(int count) {
+        const sockaddr_in address = loopback_address(port_);
+        for (int i = 0; i < count; ++i) {
+            int fd = socket(AF_INET, SOCK_DGRAM, 0);
+            ASSERT_GE(fd, 0);
+            const string payload = payload_prefix + std::to_string(i);
+            EXPECT_EQ(static_cast<ssize_t>(payload.size()),
+                      sendto(fd, payload.data(), payload.size(), 0,
+                             (const sockaddr*)&address, sizeof(address)));
+            close(fd);
+        }
+    }
+
+    // Keeps sending datagrams to the test's port until running is false
+    void send_steady_traffic(const std::atomic<bool>& running) {
+        const sockaddr_in address = loopback_address(port_);
+        int fd = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_GE(fd, 0);
+        const string payload = payload_prefix + std::to_string(0);
+        while (running) {
+            sendto(fd, payload.data(), payload.size(), 0,
+                   (const sockaddr*)&address, sizeof(address));
+        }
+        close(fd);
+    }
+
+    // Returns the index of the datagram contained in this packet, or -1
+    // if it's not one sent by this test
+    int datagram_index(const PDU& pdu) const {
+        const UDP* udp = pdu.find_pdu<UDP>();
+        const RawPDU* raw = pdu.find_pdu<RawPDU>();
+        if (!udp || !raw || udp->dport() != port_) {
+            return -1;
+        }
+        const string payload(raw->payload().begin(), raw->payload().end());
+        const string prefix(payload_prefix);
+        if (payload.compare(0, prefix.size(), prefix) != 0) {
+            return -1;
+        }
+        return std::stoi(payload.substr(prefix.size()));
+    }
+
+    static RingSnifferConfiguration make_configuration(uint32_t timeout) {
+        RingSnifferConfiguration config;
+        config.set_block_size(1 << 16);
+        config.set_block_count(4);
+        config.set_timeout(timeout);
+        return config;
+    }
+
+    int receiver_;
+    uint16_t port_;
+};
+
+const char* RingSnifferTest::payload_prefix = "ring-sniffer-test-";
+
+TEST_F(RingSnifferTest, CapturesLoopbackTraffic) {
+    RingSniffer sniffer("lo", make_configuration(2000));
+    send_datagrams(10);
+    set<int> indexes;
+    while (indexes.size() < 10) {
+        Packet packet(sniffer.next_packet());
+        ASSERT_TRUE(packet);
+        EXPECT_EQ(PDU::ETHERNET_II, packet.pdu()->pdu_type());
+        EXPECT_NE(0, packet.timestamp().seconds());
+        const int index = datagram_index(*packet.pdu());
+        if (index >= 0) {
+            indexes.insert(index);
+        }
+    }
+    EXPECT_EQ(0, *indexes.begin());
+    EXPECT_EQ(9, *indexes.rbegin());
+    RingSniffer::statistics stats = sniffer.stats();
+    EXPECT_GE(stats.packets, 10U);
+    EXPECT_EQ(0U, stats.drops);
+}
+
+TEST_F(RingSnifferTest, SniffLoop) {
+    RingSniffer sniffer("lo", make_configuration(2000));
+    send_datagrams(5);
+    set<int> indexes;
+    sniffer.sniff_loop([&](const PDU& pdu) {
+        const int index = datagram_index(pdu);
+        if (index >= 0) {
+            indexes.insert(index);
+        }
+        return indexes.size() < 5;
+    });
+    EXPECT_EQ(5U, indexes.size());
+}
+
+TEST_F(RingSnifferTest, SniffBatches) {
+    RingSniffer sniffer("lo", make_configuration(2000));
+    send_datagrams(10);
+    set<int> indexes;
+    size_t batches = 0;
+    size_t packets = 0;
+    std::vector<Packet> kept;
+    sniffer.sniff_batches([&](std::vector<Packet>& batch) {
+        ++batches;
+        packets += batch.size();
+        for (Packet& packet : batch) {
+            const int index = datagram_index(*packet.pdu());
+            if (index >= 0) {
+                indexes.insert(index);
+                kept.push_back(std::move(packet));
+            }
+        }
+        return indexes.size() < 10;
+    });
+    EXPECT_EQ(10U, indexes.size());
+    // Packets can be moved out of the batch and kept
+    ASSERT_FALSE(kept.empty());
+    EXPECT_EQ(port_, kept.front().pdu()->rfind_pdu<UDP>().dport());
+    EXPECT_LT(batches, packets);
+}
+
+TEST_F(RingSnifferTest, SniffBatchesLimitsBatchSize) {
+    RingSniffer sniffer("lo", make_configuration(2000));
+    send_datagrams(10);
+    set<int> indexes;
+    size_t largest_batch = 0;
+    sniffer.sniff_batches([&](std::vector<Packet>& batch) {
+        largest_batch = std::max(largest_batch, batch.size());
+        for (const Packet& packet : batch) {
+            const int index = datagram_index(*packet.pdu());
+            if (index >= 0) {
+                indexes.insert(index);
+            }
+        }
+        return indexes.size() < 10;
+    }, 3);
+    EXPECT_EQ(10U, indexes.size());
+    EXPECT_LE(largest_batch, 3U);
+    EXPECT_GT(largest_batch, 0U);
+}
+
+TEST_F(RingSnifferTest, ExtractRawPDUs) {
+    RingSniffer sniffer("lo", make_configuration(2000));
+    sniffer.set_extract_raw_pdus(true);
+    send_datagrams(1);
+    Packet packet(sniffer.next_packet());
+    ASSERT_TRUE(packet);
+    EXPECT_EQ(PDU::RAW, packet.pdu()->pdu_type());
+}
+
+TEST_F(RingSnifferTest, StopSniffFromAnotherThread) {
+    RingSniffer sniffer("lo", make_configuration(10000));
+    const auto start = std::chrono::steady_clock::now();
+    std::thread stopper([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        sniffer.stop_sniff();
+    });
+    sniffer.sniff_loop([](const PDU&) {
+        return true;
+    });
+    stopper.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST_F(RingSnifferTest, StopSniffUnderLoad) {
+    RingSnifferConfiguration config = make_configuration(10000);
+    config.set_block_timeout(1);
+    RingSniffer sniffer("lo", config);
+    std::atomic<bool> running(true);
+    std::thread sender([&]() {
+        send_steady_traffic(running);
+    });
+    const auto start = std::chrono::steady_clock::now();
+    std::thread stopper([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        sniffer.stop_sniff();
+    });
+    size_t packets = 0;
+    // Packets are processed slower than they're sent, so there's always
+    // a block ready to be read
+    sniffer.sniff_loop([&](const PDU&) {
+        ++packets;
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        return true;
+    });
+    stopper.join();
+    running = false;
+    sender.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    EXPECT_GT(packets, 0U);
+}
+
+TEST_F(RingSnifferTest, InvalidRing) {
+    RingSnifferConfiguration config;
+    // Blocks must be a multiple of the page size
+    config.set_block_size(1000);
+    EXPECT_THROW(RingSniffer("lo", config), socket_open_error);
+}
+
+TEST_F(RingSnifferTest, GroupLoadBalancesAcrossRings) {
+    RingSnifferConfiguration config = make_configuration(2000);
+    config.set_fanout(RingSnifferConfiguration::FANOUT_LOAD_BALANCE, 0);
+    RingSnifferGroup group("lo", 2, config);
+    ASSERT_EQ(2U, group.size());
+    EXPECT_NE(0, group.fanout_group_id());
+    send_datagrams(20);
+    mutex lock;
+    set<int> indexes;
+    set<std::thread::id> threads;
+    // Both the outgoing and incoming copies of each datagram are captured
+    size_t copies = 0;
+    group.sniff_loop([&](const PDU& pdu) {
+        const int index = datagram_index(pdu);
+        lock_guard<mutex> _(lock);
+        if (index >= 0) {
+            indexes.insert(index);
+            threads.insert(std::this_thread::get_id());
+            ++copies;
+        }
+        return copies < 40;
+    });
+    EXPECT_EQ(20U, indexes.size());
+    EXPECT_EQ(2U, threads.size());
+    EXPECT_GE(group.stats().packets, 20U);
+}
+
+TEST_F(RingSnifferTest, GroupHashesFlowsToTheSameRing) {
+    RingSnifferConfiguration config = make_configuration(2000);
+    config.set_fanout(RingSnifferConfiguration::FANOUT_HASH, 0);
+    RingSnifferGroup group("lo", 2, config);
+    send_datagrams(20);
+    mutex lock;
+    // Both the outgoing and incoming copies of each datagram are captured
+    map<int, set<std::thread::id> > threads;
+    size_t copies = 0;
+    group.sniff_loop([&](const PDU& pdu) {
+        const int index = datagram_index(pdu);
+        lock_guard<mutex> _(lock);
+        if (index >= 0) {
+            threads[index].insert(std::this_thread::get_id());
+            ++copies;
+        }
+        return copies < 40;
+    });
+    EXPECT_EQ(20U, threads.size());
+    for (const auto& entry : threads) {
+        EXPECT_EQ(1U, entry.second.size());
+    }
+}
+
+TEST_F(RingSnifferTest, GroupSniffBatches) {
+    RingSnifferConfiguration config = make_configuration(2000);
+    RingSnifferGroup group("lo", 2, config);
+    send_datagrams(20);
+    mutex lock;
+    set<int> indexes;
+    group.sniff_batches([&](std::vector<Packet>& batch) {
+        lock_guard<mutex> _(lock);
+        for (const Packet& packet : batch) {
+            const int index = datagram_index(*packet.pdu());
+            if (index >= 0) {
+                indexes.insert(index);
+            }
+        }
+        return indexes.size() < 20;
+    });
+    EXPECT_EQ(20U, indexes.size());
+}
+
+TEST_F(RingSnifferTest, GroupStopsEveryRingUnderLoad) {
+    RingSnifferConfiguration config = make_configuration(10000);
+    config.set_block_timeout(1);
+    config.set_fanout(RingSnifferConfiguration::FANOUT_LOAD_BALANCE, 0);
+    RingSnifferGroup group("lo", 2, config);
+    std::atomic<bool> running(true);
+    std::thread sender([&]() {
+        send_steady_traffic(running);
+    });
+    const auto start = std::chrono::steady_clock::now();
+    std::atomic<size_t> batches(0);
+    // Once a functor returns false, the other ring must stop as well
+    group.sniff_batches([&](std::vector<Packet>&) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return ++batches < 50;
+    }, 16);
+    running = false;
+    sender.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    EXPECT_GE(batches, 50U);
+}
+
+TEST_F(RingSnifferTest, GroupRethrowsExceptionsFromEveryRing) {
+    RingSnifferConfiguration config = make_configuration(10000);
+    config.set_block_timeout(1);
+    config.set_fanout(RingSnifferConfiguration::FANOUT_LOAD_BALANCE, 0);
+    RingSnifferGroup group("lo", 2, config);
+    std::atomic<bool> running(true);
+    std::thread sender([&]() {
+        send_steady_traffic(running);
+    });
+    // Only the ring that's not read by the calling thread throws
+    const std::thread::id caller = std::this_thread::get_id();
+    EXPECT_THROW(
+        group.sniff_loop([&](const PDU&) {
+            if (std::this_thread::get_id() != caller) {
+                throw std::runtime_error("functor failed");
+            }
+            return true;
+        }),
+        std::runtime_error
+    );
+    running = false;
+    sender.join();
+}
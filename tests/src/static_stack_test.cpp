@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <stdint.h>
+#include <tins/static_stack.h>
+#include <tins/ethernetII.h>
+#include <tins/ip.h>
+#include <tins/ipv6.h>
+#include <tins/tcp.h>
+#include <tins/udp.h>
+#include <tins/rawpdu.h>
+
+#if TINS_IS_CXX11
+
+using namespace Tins;
+
+class StaticStackTest : public testing::Test {
+public:
+    typedef StaticStack<EthernetII, IP, TCP, RawPDU> tcp_stack;
+};
+
+TEST_F(StaticStackTest, SerializeMatchesDynamicStack) {
+    EthernetII expected = EthernetII("00:01:02:03:04:05", "06:07:08:09:0a:0b") /
+                          IP("192.168.0.1", "10.0.0.1") /
+                          TCP(80, 12345) /
+                          RawPDU("some payload");
+    tcp_stack packet(
+        EthernetII("00:01:02:03:04:05", "06:07:08:09:0a:0b"),
+        IP("192.168.0.1", "10.0.0.1"),
+        TCP(80, 12345),
+        RawPDU("some payload")
+    );
+    EXPECT_EQ(expected.size(), packet.size());
+    EXPECT_EQ(expected.serialize(), packet.serialize());
+    // Going through the PDU interface produces the same result
+    EXPECT_EQ(expected.serialize(), packet.pdu().serialize());
+}
+
+TEST_F(StaticStackTest, ModifyLayers) {
+    tcp_stack packet(EthernetII(), IP(), TCP(), RawPDU(""));
+    packet.get<IP>().dst_addr("1.2.3.4");
+    packet.get<IP>().src_addr("5.6.7.8");
+    packet.get<RawPDU>().payload(RawPDU::payload_type(10, 'a'));
+    PDU::serialization_type buffer;
+    for (uint16_t port = 1000; port < 1010; ++port) {
+        packet.get<2>().dport(port);
+        const uint32_t sz = packet.serialize(buffer);
+        ASSERT_EQ(packet.size(), sz);
+
+        EthernetII decoded(&buffer[0], sz);
+        EXPECT_EQ(port, decoded.rfind_pdu<TCP>().dport());
+        EXPECT_EQ(IPv4Address("1.2.3.4"), decoded.rfind_pdu<IP>().dst_addr());
+        EXPECT_EQ(10U, decoded.rfind_pdu<RawPDU>().payload_size());
+
+        EthernetII expected = EthernetII() / IP("1.2.3.4", "5.6.7.8") /
+                              TCP(port) / RawPDU(std::string(10, 'a'));
+        EXPECT_EQ(expected.serialize(), PDU::serialization_type(buffer.begin(),
+                                                                buffer.begin() + sz));
+    }
+}
+
+TEST_F(StaticStackTest, PDUInterface) {
+    StaticStack<IPv6, UDP> packet(IPv6("::1", "::2"), UDP(53, 1024));
+    PDU& pdu = packet.pdu();
+    EXPECT_EQ(PDU::IPv6, pdu.pdu_type());
+    EXPECT_EQ(&packet.get<UDP>(), pdu.find_pdu<UDP>());
+    EXPECT_EQ(&packet.get<IPv6>(), packet.get<UDP>().parent_pdu());
+    EXPECT_TRUE(packet.get<UDP>().inner_pdu() == 0);
+    EXPECT_EQ(48U, pdu.size());
+}
+
+TEST_F(StaticStackTest, SerializeInto) {
+    StaticStack<EthernetII, IP, UDP> packet;
+    uint8_t buffer[128];
+    EXPECT_THROW(packet.serialize_into(buffer, packet.size() - 1), serialization_error);
+    const uint32_t sz = packet.serialize_into(buffer, sizeof(buffer));
+    EXPECT_EQ(packet.size(), sz);
+    EXPECT_EQ(packet.pdu().serialize(), PDU::serialization_type(buffer, buffer + sz));
+}
+
+TEST_F(StaticStackTest, LayersWithInnerPDUs) {
+    // The inner PDUs of the given layers are replaced by the next layers
+    StaticStack<IP, UDP> packet(IP() / TCP(), UDP(1, 2) / RawPDU("abc"));
+    EXPECT_TRUE(packet.pdu().find_pdu<TCP>() == 0);
+    EXPECT_TRUE(packet.pdu().find_pdu<RawPDU>() == 0);
+    EXPECT_EQ(28U, packet.size());
+}
+
+#endif // TINS_IS_CXX11
@@ -514,6 +514,30 @@ TEST_F(FlowTest, StreamFollower_FollowStream) {
     EXPECT_EQ(payload, merge_chunks(stream_client_payload_chunks));
 }
 
+TEST_F(FlowTest, StreamFollower_FollowSharedPackets) {
+    using std::placeholders::_1;
+
+    vector<EthernetII> packets = three_way_handshake(29, 60, "1.2.3.4", 22, "4.3.2.1", 25);
+    ordering_info_type chunks = split_payload(payload, 5);
+    vector<EthernetII> chunk_packets = chunks_to_packets(30 /*initial_seq*/, chunks, payload);
+    set_endpoints(chunk_packets, "1.2.3.4", 22, "4.3.2.1", 25);
+    packets.insert(packets.end(), chunk_packets.begin(), chunk_packets.end());
+    StreamFollower follower;
+    follower.new_stream_callback(bind(&FlowTest::on_new_stream, this, _1));
+    for (size_t i = 0; i < packets.size(); ++i) {
+        Packet packet(packets[i], Timestamp());
+        Packet copy(packet);
+        const PDU* pdu = static_cast<const Packet&>(packet).pdu();
+        follower.process_packet(packet);
+        // The PDU is only read, so it's neither copied nor modified
+        EXPECT_TRUE(packet.is_shared());
+        EXPECT_EQ(pdu, static_cast<const Packet&>(packet).pdu());
+        EXPECT_EQ(packets[i].serialize(), copy.pdu()->serialize());
+    }
+    EXPECT_EQ(chunk_packets.size(), stream_client_payload_chunks.size());
+    EXPECT_EQ(payload, merge_chunks(stream_client_payload_chunks));
+}
+
 TEST_F(FlowTest, StreamFollower_AttachToStreams) {
     using std::placeholders::_1;
 
@@ -6,6 +6,8 @@
 #include <tins/tcp.h>
 #include <tins/ip.h>
 #include <tins/ethernetII.h>
+#include <tins/rawpdu.h>
+#include <tins/decoding_scope.h>
 
 using namespace std;
 using namespace Tins;
@@ -277,6 +279,30 @@ TEST_F(TCPTest, SpoofedOptions) {
     EXPECT_EQ(pdu.serialize().size(), pdu.size());
 }
 
+TEST_F(TCPTest, CopyOptionsAroundInlineStorageSize) {
+    TCP pdu;
+    // Payloads up to 16 bytes are stored inline, larger ones on the heap
+    for (uint8_t size = 14; size <= 18; ++size) {
+        std::vector<uint8_t> data(size);
+        for (uint8_t i = 0; i < size; ++i) {
+            data[i] = static_cast<uint8_t>(size + i);
+        }
+        pdu.add_option(TCP::option(TCP::SACK, data.begin(), data.end()));
+    }
+    TCP copy = pdu;
+    TCP assigned;
+    assigned = copy;
+    ASSERT_EQ(5U, assigned.options().size());
+    for (size_t i = 0; i < assigned.options().size(); ++i) {
+        const TCP::option& original = pdu.options()[i];
+        const TCP::option& option = assigned.options()[i];
+        ASSERT_EQ(original.data_size(), option.data_size());
+        EXPECT_NE(original.data_ptr(), option.data_ptr());
+        EXPECT_TRUE(std::equal(original.data_ptr(), original.data_ptr() + original.data_size(),
+                               option.data_ptr()));
+    }
+}
+
 TEST_F(TCPTest, MalformedOptionAfterEOL) {
     TCP tcp(malformed_option_after_eol_packet, sizeof(malformed_option_after_eol_packet));
     EXPECT_EQ(0U, tcp.options().size());
@@ -300,3 +326,44 @@ TEST_F(TCPTest, RemoveOption) {
     PDU::serialization_type new_buffer = tcp.serialize();
     EXPECT_EQ(old_buffer, new_buffer);
 }
+
+TEST_F(TCPTest, PatchPortsUpdatesChecksum) {
+    IP ip = IP("192.168.0.1", "10.0.0.1") / TCP(22, 52) / RawPDU("Test");
+    PDU::serialization_type buffer = ip.serialize();
+    const uint32_t header_size = ip.header_size();
+    const uint32_t tcp_size = static_cast<uint32_t>(buffer.size()) - header_size;
+    TCP::patch_sport(&buffer[header_size], tcp_size, 40000);
+    TCP::patch_dport(&buffer[header_size], tcp_size, 8080);
+
+    TCP& tcp = ip.rfind_pdu<TCP>();
+    tcp.sport(40000);
+    tcp.dport(8080);
+    EXPECT_EQ(ip.serialize(), buffer);
+}
+
+TEST_F(TCPTest, LazyOptions) {
+    const TCP eager(expected_packet, sizeof(expected_packet));
+    vector<uint8_t> buffer(expected_packet, expected_packet + sizeof(expected_packet));
+    DecodingScope scope(DecodingScope::LAZY_OPTIONS);
+    TCP tcp(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    EXPECT_EQ(eager.header_size(), tcp.header_size());
+    EXPECT_EQ(eager.mss(), tcp.mss());
+
+    TCP unparsed(&buffer[0], static_cast<uint32_t>(buffer.size()));
+    const TCP copy = unparsed;
+    // Copies keep their own option bytes
+    std::fill(buffer.begin(), buffer.end(), 0);
+    EXPECT_EQ(eager.options().size(), copy.options().size());
+    EXPECT_EQ(eager.mss(), copy.mss());
+    EXPECT_EQ(eager.timestamp(), copy.timestamp());
+}
+
+TEST_F(TCPTest, LazyOptionsAreValidated) {
+    DecodingScope scope(DecodingScope::LAZY_OPTIONS);
+    // The SACK option claims to be larger than the header
+    uint8_t buffer[] = {
+        0, 22, 0, 80, 0, 0, 0, 1, 0, 0, 0, 0, 96, 2, 0, 0, 0, 0, 0, 0,
+        5, 10, 0, 0
+    };
+    EXPECT_THROW(TCP(buffer, sizeof(buffer)), malformed_packet);
+}
\ No newline at end of file
@@ -210,3 +210,26 @@ TEST_F(UDPTest, ConstructorFromBuffer) {
     EXPECT_EQ(udp1.size(), udp2.size());
     EXPECT_EQ(udp1.header_size(), udp2.header_size());
 }
+
+TEST_F(UDPTest, PatchPortsUpdatesChecksum) {
+    IP ip = IP("192.168.0.1", "10.0.0.1") / UDP(53, 1000);
+    PDU::serialization_type buffer = ip.serialize();
+    const uint32_t header_size = ip.header_size();
+    const uint32_t udp_size = static_cast<uint32_t>(buffer.size()) - header_size;
+    UDP::patch_sport(&buffer[header_size], udp_size, 5353);
+    UDP::patch_dport(&buffer[header_size], udp_size, 1234);
+
+    UDP& udp = ip.rfind_pdu<UDP>();
+    udp.sport(5353);
+    udp.dport(1234);
+    EXPECT_EQ(ip.serialize(), buffer);
+}
+
+TEST_F(UDPTest, PatchPortsKeepsMissingChecksum) {
+    UDP udp(53, 1000);
+    PDU::serialization_type buffer = udp.serialize();
+    UDP::patch_dport(&buffer[0], static_cast<uint32_t>(buffer.size()), 1234);
+    EXPECT_EQ(1234, UDP(&buffer[0], static_cast<uint32_t>(buffer.size())).dport());
+    EXPECT_EQ(0, buffer[6]);
+    EXPECT_EQ(0, buffer[7]);
+}
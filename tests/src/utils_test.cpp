@@ -1,10 +1,14 @@
 #include <iostream>
 #include <stdexcept>
+#include <cstring>
+#include <vector>
+#include <algorithm>
 #include <gtest/gtest.h>
 #include <tins/utils.h>
 #include <tins/endianness.h>
 #include <tins/ip_address.h>
 #include <tins/ipv6_address.h>
+#include <tins/detail/checksum_kernels.h>
 
 using namespace Tins;
 
@@ -71,3 +75,138 @@ TEST_F(UtilsTest, Crc32) {
 
     EXPECT_EQ(crc, 0x78840f54U);
 }
+
+TEST_F(UtilsTest, UpdateChecksum) {
+    std::vector<uint8_t> buffer(data, data + 64);
+    uint16_t checksum = Endian::be_to_host<uint16_t>(
+        ~Utils::sum_range(&buffer[0], &buffer[0] + buffer.size())
+    );
+    const uint8_t new_data[] = { 1, 2, 3, 4, 5, 6 };
+    checksum = Utils::update_checksum(checksum, &buffer[10], new_data, sizeof(new_data));
+    std::copy(new_data, new_data + sizeof(new_data), buffer.begin() + 10);
+    uint16_t expected = Endian::be_to_host<uint16_t>(
+        ~Utils::sum_range(&buffer[0], &buffer[0] + buffer.size())
+    );
+    EXPECT_EQ(expected, checksum);
+
+    const uint16_t old_value = (buffer[20] << 8) | buffer[21];
+    checksum = Utils::update_checksum(checksum, old_value, 0xabcd);
+    buffer[20] = 0xab;
+    buffer[21] = 0xcd;
+    expected = Endian::be_to_host<uint16_t>(
+        ~Utils::sum_range(&buffer[0], &buffer[0] + buffer.size())
+    );
+    EXPECT_EQ(expected, checksum);
+}
+
+uint16_t reference_sum_range(const uint8_t* start, const uint8_t* end) {
+    uint32_t sum = 0;
+    const uint8_t* ptr = start;
+    for (; end - ptr >= 2; ptr += 2) {
+        uint16_t word;
+        std::memcpy(&word, ptr, sizeof(word));
+        sum += word;
+    }
+    if (ptr != end) {
+        const uint8_t padded[] = { *ptr, 0 };
+        uint16_t word;
+        std::memcpy(&word, padded, sizeof(word));
+        sum += word;
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(sum);
+}
+
+TEST_F(UtilsTest, ChecksumKernels) {
+    using namespace Internals;
+    // Large enough for a jumbo frame, filled with bytes that produce carries
+    std::vector<uint8_t> buffer(9100);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = static_cast<uint8_t>(0xff - (i * 7) % 13);
+    }
+    const checksum_kernel kernels[] = {
+        CHECKSUM_KERNEL_SCALAR,
+        CHECKSUM_KERNEL_SSE2,
+        CHECKSUM_KERNEL_AVX2,
+        CHECKSUM_KERNEL_NEON
+    };
+    EXPECT_TRUE(checksum_kernel_supported(best_checksum_kernel()));
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+        if (!checksum_kernel_supported(kernels[k])) {
+            continue;
+        }
+        // Try every alignment and sizes around the vector widths
+        for (size_t offset = 0; offset < 8; ++offset) {
+            for (size_t size = 0; size < 300; ++size) {
+                const uint8_t* start = &buffer[offset];
+                EXPECT_EQ(
+                    reference_sum_range(start, start + size),
+                    checksum_sum_range(kernels[k], start, start + size)
+                );
+            }
+        }
+        const uint8_t* start = &buffer[0];
+        const uint8_t* end = start + buffer.size();
+        EXPECT_EQ(reference_sum_range(start, end), checksum_sum_range(kernels[k], start, end));
+    }
+}
+
+TEST_F(UtilsTest, Crc32Kernels) {
+    using namespace Internals;
+    const uint8_t check_data[] = "123456789";
+    EXPECT_EQ(0xcbf43926U, Utils::crc32(check_data, sizeof(check_data) - 1));
+    EXPECT_TRUE(crc32_kernel_supported(best_crc32_kernel()));
+
+    std::vector<uint8_t> buffer(data, data + data_len);
+    buffer.insert(buffer.end(), data, data + data_len);
+    const crc32_kernel kernels[] = { CRC32_KERNEL_SLICE_BY_8, CRC32_KERNEL_PCLMUL };
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k) {
+        if (!crc32_kernel_supported(kernels[k])) {
+            continue;
+        }
+        EXPECT_EQ(0x78840f54U, crc32_update(kernels[k], 0, data, data_len));
+        // Check sizes around the block sizes, starting at every alignment
+        for (uint32_t offset = 0; offset < 16; ++offset) {
+            for (uint32_t size = 0; size < 300; ++size) {
+                const uint8_t* start = &buffer[offset];
+                const uint32_t expected = crc32_update(CRC32_KERNEL_SLICE_BY_8, 0,
+                                                       start, size);
+                EXPECT_EQ(expected, crc32_update(kernels[k], 0, start, size));
+            }
+        }
+        // Computing it in several steps yields the same result
+        uint32_t crc = crc32_update(kernels[k], 0, &buffer[0], 100);
+        crc = crc32_update(kernels[k], crc, &buffer[100], 900);
+        EXPECT_EQ(Utils::crc32(&buffer[0], 1000), crc);
+    }
+}
+
+void append_fcs(std::vector<uint8_t>& frame) {
+    const uint32_t crc = Utils::crc32(&frame[0], static_cast<uint32_t>(frame.size()));
+    for (size_t i = 0; i < sizeof(crc); ++i) {
+        frame.push_back(static_cast<uint8_t>(crc >> (i * 8)));
+    }
+}
+
+TEST_F(UtilsTest, ValidateFCS) {
+    std::vector<uint8_t> frame1(data, data + 200);
+    std::vector<uint8_t> frame2(data + 10, data + 50);
+    append_fcs(frame1);
+    append_fcs(frame2);
+    frame2[0] ^= 1;
+    const uint8_t short_frame[] = { 1, 2 };
+    const uint8_t* frames[] = { &frame1[0], &frame2[0], short_frame };
+    const uint32_t sizes[] = {
+        static_cast<uint32_t>(frame1.size()),
+        static_cast<uint32_t>(frame2.size()),
+        sizeof(short_frame)
+    };
+    bool results[3];
+    EXPECT_EQ(1U, Utils::validate_fcs(frames, sizes, 3, results));
+    EXPECT_TRUE(results[0]);
+    EXPECT_FALSE(results[1]);
+    EXPECT_FALSE(results[2]);
+    EXPECT_EQ(1U, Utils::validate_fcs(frames, sizes, 3, 0));
+}